@@ -1,9 +1,10 @@
 // https://github.com/iauns/cpm-glm-aabb
 
 #include "AABB.hpp"
-#include <glm/gtx/component_wise.hpp>
+// component_wise.inl calls min and max unqualified, so glm's must be declared first
 #include <glm/detail/func_common.hpp>
 #include <glm/detail/func_geometric.hpp>
+#include <glm/gtx/component_wise.hpp>
 
 AABB::AABB() { setNull(); }
 
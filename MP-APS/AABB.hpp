@@ -21,6 +21,7 @@ public:
 	AABB(const glm::vec3& p1, const glm::vec3& p2);
 
 	AABB(const AABB& aabb);
+	AABB& operator=(const AABB& aabb) = default;
 
 	/// Set the AABB as NULL (not set).
 	void setNull() {
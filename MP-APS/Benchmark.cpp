@@ -0,0 +1,180 @@
+#include "Benchmark.h"
+
+#include <pugixml.hpp>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#include <Windows.h>
+	#include <Psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+namespace {
+	void writeJsonString(std::ostream& out, const std::string_view str) {
+		out << '"';
+		for (const auto c : str) {
+			if (c == '"' || c == '\\') {
+				out << '\\' << c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20) {
+				out << ' ';
+			}
+			else {
+				out << c;
+			}
+		}
+		out << '"';
+	}
+}
+
+/***********************************************************************************/
+void Benchmark::Init(const pugi::xml_node& benchmarkNode) {
+	m_frames = std::max<std::size_t>(benchmarkNode.attribute("frames").as_uint(600), 1);
+	m_warmupFrames = benchmarkNode.attribute("warmup").as_uint(60);
+	m_timestep = benchmarkNode.attribute("timestep").as_double(1.0 / 60.0);
+	m_reportPath = benchmarkNode.attribute("report").as_string("benchmark.json");
+
+	m_cameraPath.Load(benchmarkNode);
+	if (m_cameraPath.IsEmpty()) {
+		std::cerr << "Benchmark: no camera keys, the camera stays at the origin\n";
+		m_cameraPath.AddKey({ 0.0, glm::vec3(0.0f), -90.0f, 0.0f });
+	}
+
+	// Every measured frame counts, hitches are frames slower than the timestep
+	m_statistics.Init(m_frames, m_timestep * 1000.0);
+	m_framesSeen = 0;
+	m_lastPresentTime = 0.0;
+	m_passes.clear();
+	m_drawCalls = {};
+	m_commandLists = {};
+}
+
+/***********************************************************************************/
+void Benchmark::AddFrame(const FramePipeline::FrameResult& result, const RenderSystem::FrameStats& renderStats) {
+	// The last warmup frame still provides the first present time
+	const auto frameMs{ m_framesSeen > 0 && m_framesSeen >= m_warmupFrames ? (result.PresentTime - m_lastPresentTime) * 1000.0 : 0.0 };
+	m_lastPresentTime = result.PresentTime;
+	if (m_framesSeen++ < m_warmupFrames) {
+		return;
+	}
+
+	double gpuMs{ 0.0 };
+	for (const auto& pass : result.GpuPasses) {
+		auto total{ std::find_if(m_passes.begin(), m_passes.end(), [&pass](const auto& p) { return p.Name == pass.Name; }) };
+		if (total == m_passes.end()) {
+			m_passes.push_back({ std::string(pass.Name) });
+			total = m_passes.end() - 1;
+		}
+		total->SumMs += pass.Milliseconds;
+		total->MaxMs = std::max(total->MaxMs, pass.Milliseconds);
+		++total->Frames;
+
+		gpuMs += pass.Milliseconds;
+	}
+
+	m_statistics.AddFrame({ frameMs, result.CpuMs, gpuMs });
+	m_drawCalls.Add(renderStats.NumDrawCalls);
+	m_commandLists.Add(renderStats.NumCommandLists);
+}
+
+/***********************************************************************************/
+bool Benchmark::WriteReport(const std::string_view renderer, const int width, const int height, const RenderSystem::MemoryStats& memory,
+	const ResourceManager::TextureMemory& textures) const {
+	std::ofstream out(m_reportPath);
+	if (!out) {
+		std::cerr << "Benchmark: failed to write " << m_reportPath << '\n';
+		return false;
+	}
+
+	const auto measured{ m_framesSeen > m_warmupFrames ? m_framesSeen - m_warmupFrames : 0 };
+	const auto mean = [measured](const CountTotal& total) { return measured > 0 ? static_cast<double>(total.Sum) / static_cast<double>(measured) : 0.0; };
+
+	out << "{\n\"renderer\":";
+	writeJsonString(out, renderer);
+	out << ",\n\"width\":" << width << ",\n\"height\":" << height
+		<< ",\n\"frames\":" << measured << ",\n\"warmup_frames\":" << m_warmupFrames << ",\n\"timestep_ms\":" << m_timestep * 1000.0;
+
+	// Frame time percentiles
+	for (std::size_t i = 0; i < FrameStatistics::NUM_METRICS; ++i) {
+		const auto metric{ static_cast<FrameStatistics::Metric>(i) };
+		out << ",\n\"" << FrameStatistics::GetMetricName(metric) << "_ms\":";
+		FrameStatistics::WriteSummaryJSON(out, m_statistics.GetRunSummary(metric));
+	}
+
+	// GPU time per pass, in execution order. Timer results arrive a few frames late, so the
+	// first frames of the run are missing and the last warmup frames are counted instead.
+	out << ",\n\"passes\":[";
+	for (std::size_t i = 0; i < m_passes.size(); ++i) {
+		const auto& pass{ m_passes[i] };
+		out << (i > 0 ? ",\n" : "\n") << "{\"name\":";
+		writeJsonString(out, pass.Name);
+		out << ",\"frames\":" << pass.Frames << ",\"mean_gpu_ms\":" << pass.SumMs / static_cast<double>(pass.Frames) << ",\"max_gpu_ms\":" << pass.MaxMs << '}';
+	}
+	out << "\n]";
+
+	out << ",\n\"draw_calls\":{\"mean\":" << mean(m_drawCalls) << ",\"max\":" << m_drawCalls.Max << '}'
+		<< ",\n\"command_lists\":{\"mean\":" << mean(m_commandLists) << ",\"max\":" << m_commandLists.Max << '}';
+
+	out << ",\n\"memory\":{\"render_target_bytes\":" << memory.RenderTargetBytes << ",\"shadow_map_bytes\":" << memory.ShadowMapBytes
+		<< ",\"geometry_pool_bytes\":" << memory.GeometryPoolBytes << ",\"output_bytes\":" << memory.OutputBytes
+		<< ",\"texture_bytes\":" << textures.ResidentBytes << ",\"texture_uncompressed_bytes\":" << textures.UncompressedBytes
+		<< ",\"peak_process_bytes\":" << peakProcessBytes() << "}\n}\n";
+
+	if (out) {
+		std::cout << "Benchmark: wrote " << m_reportPath << '\n';
+	}
+
+	return static_cast<bool>(out);
+}
+
+/***********************************************************************************/
+void Benchmark::Print(std::ostream& out) const {
+	m_statistics.Print(out);
+
+	out << std::fixed << std::setprecision(3);
+	for (const auto& pass : m_passes) {
+		out << "GPU " << pass.Name << ": mean " << pass.SumMs / static_cast<double>(pass.Frames) << " ms, max " << pass.MaxMs << " ms\n";
+	}
+	out << std::defaultfloat;
+}
+
+/***********************************************************************************/
+std::vector<Benchmark::Metric> Benchmark::GetMetrics() const {
+	std::vector<Metric> metrics;
+	for (std::size_t i = 0; i < FrameStatistics::NUM_METRICS; ++i) {
+		const auto metric{ static_cast<FrameStatistics::Metric>(i) };
+		const auto summary{ m_statistics.GetRunSummary(metric) };
+		const std::string name{ FrameStatistics::GetMetricName(metric) };
+		metrics.push_back({ name + "_p50_ms", summary.P50Ms });
+		metrics.push_back({ name + "_p99_ms", summary.P99Ms });
+	}
+
+	const auto measured{ static_cast<double>(m_framesSeen > m_warmupFrames ? m_framesSeen - m_warmupFrames : 1) };
+	metrics.push_back({ "draw_calls", static_cast<double>(m_drawCalls.Sum) / measured });
+	metrics.push_back({ "command_lists", static_cast<double>(m_commandLists.Sum) / measured });
+
+	return metrics;
+}
+
+/***********************************************************************************/
+std::size_t Benchmark::peakProcessBytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters{};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return counters.PeakWorkingSetSize;
+	}
+	return 0;
+#else
+	rusage usage{};
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		// Kilobytes on Linux
+		return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+	}
+	return 0;
+#endif
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "CameraPath.h"
+#include "FrameStatistics.h"
+#include "Core/FramePipeline.h"
+#include "Core/RenderSystem.h"
+#include "ResourceManager.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/***********************************************************************************/
+// Forward Declarations
+namespace pugi {
+class xml_node;
+}
+
+/***********************************************************************************/
+// Settings and results of a benchmark run: a fixed number of frames with a fixed timestep
+// along a scripted camera path, so two runs render the same frames. Warmup frames (shader
+// compilation, texture uploads, first allocations) are rendered but not measured.
+class Benchmark {
+public:
+	// Reads <Benchmark frames warmup timestep report> and its <Key/> camera keyframes
+	void Init(const pugi::xml_node& benchmarkNode);
+
+	auto GetTotalFrames() const noexcept { return m_warmupFrames + m_frames; }
+	auto GetTimestep() const noexcept { return m_timestep; }
+	const auto& GetCameraPath() const noexcept { return m_cameraPath; }
+
+	// Feeds a finished frame. renderStats are the renderer's stats of the same frame.
+	void AddFrame(const FramePipeline::FrameResult& result, const RenderSystem::FrameStats& renderStats);
+
+	// JSON with frame time percentiles, per-pass GPU times, draw counts and memory.
+	// renderer describes the GL implementation the run used.
+	bool WriteReport(const std::string_view renderer, const int width, const int height, const RenderSystem::MemoryStats& memory,
+		const ResourceManager::TextureMemory& textures) const;
+	// Short summary of the same numbers
+	void Print(std::ostream& out) const;
+
+	// Headline numbers of the run, lower is better for all of them
+	struct Metric {
+		std::string Name;
+		double Value;
+	};
+	// p50 and p99 of the frame, CPU and GPU times plus mean draw calls and command lists
+	std::vector<Metric> GetMetrics() const;
+
+private:
+	struct PassTotal {
+		std::string Name;
+		double SumMs{ 0.0 };
+		double MaxMs{ 0.0 };
+		std::size_t Frames{ 0 };
+	};
+
+	struct CountTotal {
+		std::uint64_t Sum{ 0 };
+		std::size_t Max{ 0 };
+
+		void Add(const std::size_t value) noexcept { Sum += value; Max = std::max(Max, value); }
+	};
+
+	// Largest resident set of the process so far, 0 if unknown
+	static std::size_t peakProcessBytes();
+
+	std::size_t m_frames{ 0 };
+	std::size_t m_warmupFrames{ 0 };
+	double m_timestep{ 0.0 };
+	std::filesystem::path m_reportPath;
+	CameraPath m_cameraPath;
+
+	// Measured frames only
+	std::size_t m_framesSeen{ 0 };
+	double m_lastPresentTime{ 0.0 };
+	FrameStatistics m_statistics;
+	std::vector<PassTotal> m_passes;
+	CountTotal m_drawCalls, m_commandLists;
+};
@@ -0,0 +1,145 @@
+// Scaling benchmark for the job system. Standalone, needs no window or GL context.
+// Linux: g++ -std=c++17 -O2 -pthread -I.. JobSystemBenchmark.cpp ../Core/JobSystem.cpp -o JobSystemBenchmark
+// Usage: JobSystemBenchmark [maxThreads] [repetitions]
+
+#include "../Core/JobSystem.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cmath>
+
+namespace {
+
+/***********************************************************************************/
+// Some floating-point busy work that the compiler can't fold away
+float work(const std::size_t seed, const std::size_t iterations) {
+	auto x{ static_cast<float>(seed % 1000) * 0.001f };
+	for (std::size_t i = 0; i < iterations; ++i) {
+		x = std::sin(x) * 0.5f + std::sqrt(x + 1.0f);
+	}
+	return x;
+}
+
+/***********************************************************************************/
+// Coarse data-parallel loop
+float parallelForWorkload(const std::size_t count) {
+	std::vector<float> results(count);
+	JobSystem::GetInstance().ParallelFor(count, [&](const auto begin, const auto end) {
+		for (auto i = begin; i < end; ++i) {
+			results[i] = work(i, 64);
+		}
+	});
+
+	float sum{ 0.0f };
+	for (const auto r : results) {
+		sum += r;
+	}
+	return sum;
+}
+
+/***********************************************************************************/
+// Recursive fork-join, spawns lots of tiny jobs from inside jobs so stealing matters
+void spawnTree(const std::size_t depth, std::atomic<std::size_t>& leaves) {
+	if (depth == 0) {
+		work(leaves.fetch_add(1), 256);
+		return;
+	}
+
+	JobCounter counter;
+	JobSystem::GetInstance().Run([depth, &leaves]() { spawnTree(depth - 1, leaves); }, &counter);
+	JobSystem::GetInstance().Run([depth, &leaves]() { spawnTree(depth - 1, leaves); }, &counter);
+	JobSystem::GetInstance().Wait(counter);
+}
+
+/***********************************************************************************/
+// Chains of jobs connected through counter dependencies
+std::size_t dependencyWorkload(const std::size_t numChains, const std::size_t chainLength) {
+	std::atomic<std::size_t> executed{ 0 };
+	std::vector<std::vector<std::unique_ptr<JobCounter>>> chains(numChains);
+	JobCounter all;
+
+	for (auto& chain : chains) {
+		for (std::size_t i = 0; i < chainLength; ++i) {
+			chain.push_back(std::make_unique<JobCounter>());
+			auto* dependency{ i > 0 ? chain[i - 1].get() : nullptr };
+			JobSystem::GetInstance().Run([&executed]() {
+				work(executed.fetch_add(1), 512);
+			}, chain[i].get(), dependency);
+		}
+		// Last job of each chain signals the shared counter
+		JobSystem::GetInstance().Run([]() {}, &all, chain.back().get());
+	}
+
+	JobSystem::GetInstance().Wait(all);
+	for (const auto& chain : chains) {
+		for (const auto& counter : chain) {
+			JobSystem::GetInstance().Wait(*counter);
+		}
+	}
+
+	return executed.load();
+}
+
+/***********************************************************************************/
+template<typename Func>
+double medianMs(const std::size_t repetitions, const Func& func) {
+	// Warmup
+	func();
+
+	std::vector<double> samples;
+	for (std::size_t i = 0; i < repetitions; ++i) {
+		const auto start{ std::chrono::steady_clock::now() };
+		func();
+		const auto end{ std::chrono::steady_clock::now() };
+		samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	std::sort(samples.begin(), samples.end());
+	return samples[samples.size() / 2];
+}
+
+}
+
+/***********************************************************************************/
+int main(int argc, char* argv[]) {
+	const std::size_t maxThreads{ argc > 1 ? std::stoul(argv[1]) : 64 };
+	const std::size_t repetitions{ argc > 2 ? std::stoul(argv[2]) : 5 };
+
+	std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << '\n';
+	std::cout << std::setw(8) << "threads"
+		<< std::setw(16) << "parallel_for ms" << std::setw(10) << "speedup"
+		<< std::setw(16) << "fork-join ms" << std::setw(10) << "speedup"
+		<< std::setw(16) << "dependency ms" << std::setw(10) << "speedup" << '\n';
+
+	double baseFor{ 0.0 }, baseTree{ 0.0 }, baseDeps{ 0.0 };
+	for (std::size_t threads = 1; threads <= maxThreads; threads *= 2) {
+		JobSystem::GetInstance().Init(threads);
+
+		const auto forMs{ medianMs(repetitions, []() { parallelForWorkload(1 << 18); }) };
+		const auto treeMs{ medianMs(repetitions, []() {
+			std::atomic<std::size_t> leaves{ 0 };
+			spawnTree(14, leaves);
+		}) };
+		const auto depsMs{ medianMs(repetitions, []() { dependencyWorkload(64, 64); }) };
+
+		JobSystem::GetInstance().Shutdown();
+
+		if (threads == 1) {
+			baseFor = forMs;
+			baseTree = treeMs;
+			baseDeps = depsMs;
+		}
+
+		std::cout << std::fixed << std::setprecision(2)
+			<< std::setw(8) << threads
+			<< std::setw(16) << forMs << std::setw(10) << baseFor / forMs
+			<< std::setw(16) << treeMs << std::setw(10) << baseTree / treeMs
+			<< std::setw(16) << depsMs << std::setw(10) << baseDeps / depsMs << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,154 @@
+// Light-to-cluster assignment on the CPU for 1k/10k/100k lights. Standalone, needs no window or GL context.
+// Linux: g++ -std=c++17 -O2 -ffp-contract=off -pthread -I.. -I../3rdParty/glm LightClusterBenchmark.cpp ../Graphics/LightClusterGrid.cpp ../Core/JobSystem.cpp -o LightClusterBenchmark
+// Usage: LightClusterBenchmark [width] [height] [repetitions]
+
+#include "../Graphics/LightClusterGrid.h"
+#include "../Core/JobSystem.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cmath>
+
+namespace {
+
+constexpr float NearPlane{ 0.1f };
+constexpr float FarPlane{ 100.0f };
+constexpr float FieldOfView{ 45.0f };
+
+/***********************************************************************************/
+// View-space bounding spheres of random lights inside the view frustum.
+// Spot lights use the same cone bounding sphere as the renderer.
+std::vector<glm::vec4> makeLights(const std::size_t count, const bool spot, const float aspect) {
+	std::mt19937 rng{ 1337 };
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> depthDist(1.0f, FarPlane);
+	std::uniform_real_distribution<float> radiusDist(1.0f, 6.0f);
+	std::uniform_real_distribution<float> angleDist(0.2f, 1.2f);
+
+	const auto tanHalfFov{ std::tan(glm::radians(FieldOfView) * 0.5f) };
+
+	std::vector<glm::vec4> spheres;
+	spheres.reserve(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		const auto depth{ depthDist(rng) };
+		const glm::vec3 position(unit(rng) * depth * tanHalfFov * aspect, unit(rng) * depth * tanHalfFov, -depth);
+		const auto radius{ radiusDist(rng) };
+
+		if (!spot) {
+			spheres.emplace_back(position, radius);
+			continue;
+		}
+
+		const auto direction{ glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 0.0f, 0.001f)) };
+		const auto cosAngle{ std::cos(angleDist(rng)) };
+		if (cosAngle > 0.70710678f) {
+			const auto coneRadius{ radius / (2.0f * cosAngle) };
+			spheres.emplace_back(position + direction * coneRadius, coneRadius);
+		}
+		else {
+			spheres.emplace_back(position + direction * (cosAngle * radius), std::sqrt(1.0f - cosAngle * cosAngle) * radius);
+		}
+	}
+
+	return spheres;
+}
+
+/***********************************************************************************/
+// Single-threaded brute force with the scalar test, the reference for the SIMD path
+bool matchesReference(const LightClusterGrid& grid, const std::vector<glm::vec4>& spheres) {
+	const auto& bounds{ grid.GetBounds() };
+	const auto& lightGrid{ grid.GetLightGrid() };
+	const auto& indices{ grid.GetLightIndices() };
+
+	std::uint32_t offset{ 0 };
+	for (std::size_t cluster = 0; cluster < bounds.size(); ++cluster) {
+		std::vector<std::uint32_t> expected;
+		for (std::size_t light = 0; light < spheres.size(); ++light) {
+			if (LightClusterGrid::Intersects(bounds[cluster], spheres[light])) {
+				expected.push_back(static_cast<std::uint32_t>(light));
+			}
+		}
+
+		if (lightGrid[cluster] != glm::uvec2(offset, expected.size()) ||
+			!std::equal(expected.cbegin(), expected.cend(), indices.cbegin() + offset)) {
+			return false;
+		}
+		offset += static_cast<std::uint32_t>(expected.size());
+	}
+
+	return true;
+}
+
+/***********************************************************************************/
+template<typename Func>
+double medianMs(const std::size_t repetitions, const Func& func) {
+	// Warmup
+	func();
+
+	std::vector<double> samples;
+	for (std::size_t i = 0; i < repetitions; ++i) {
+		const auto start{ std::chrono::steady_clock::now() };
+		func();
+		const auto end{ std::chrono::steady_clock::now() };
+		samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	std::sort(samples.begin(), samples.end());
+	return samples[samples.size() / 2];
+}
+
+}
+
+/***********************************************************************************/
+int main(int argc, char* argv[]) {
+	const std::uint32_t width{ argc > 1 ? static_cast<std::uint32_t>(std::stoul(argv[1])) : 1920 };
+	const std::uint32_t height{ argc > 2 ? static_cast<std::uint32_t>(std::stoul(argv[2])) : 1080 };
+	const std::size_t repetitions{ argc > 3 ? std::stoul(argv[3]) : 9 };
+
+	const auto aspect{ static_cast<float>(width) / static_cast<float>(height) };
+
+	LightClusterGrid grid;
+	grid.Update(width, height, glm::perspective(glm::radians(FieldOfView), aspect, NearPlane, FarPlane));
+
+	const auto dims{ grid.GetDims() };
+	std::cout << "Clusters: " << dims.x << 'x' << dims.y << 'x' << dims.z << " = " << grid.GetNumClusters() << '\n';
+
+	std::cout << std::setw(8) << "lights" << std::setw(8) << "type"
+		<< std::setw(10) << "threads" << std::setw(12) << "assign ms"
+		<< std::setw(14) << "indices" << std::setw(12) << "reference" << '\n';
+
+	// Single-threaded, then one thread per hardware thread
+	std::vector<std::size_t> threadCounts{ 1 };
+	if (std::thread::hardware_concurrency() > 1) {
+		threadCounts.push_back(std::thread::hardware_concurrency());
+	}
+
+	for (const auto count : { 1000, 10000, 100000 }) {
+		for (const auto spot : { false, true }) {
+			const auto spheres{ makeLights(count, spot, aspect) };
+
+			for (const auto threads : threadCounts) {
+				JobSystem::GetInstance().Init(threads);
+				const auto ms{ medianMs(repetitions, [&]() { grid.AssignLights(spheres); }) };
+				JobSystem::GetInstance().Shutdown();
+
+				// The brute force reference gets slow, only check the smaller sets
+				const std::string reference{ count > 10000 ? "-" : (matchesReference(grid, spheres) ? "match" : "MISMATCH") };
+
+				std::cout << std::fixed << std::setprecision(3)
+					<< std::setw(8) << count << std::setw(8) << (spot ? "spot" : "point")
+					<< std::setw(10) << threads << std::setw(12) << ms
+					<< std::setw(14) << grid.GetLightIndices().size() << std::setw(12) << reference << std::endl;
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,391 @@
+// Micro-benchmarks for CPU hot paths: frustum culling, bounding boxes, mesh conversion,
+// shader preprocessing, image decoding and mip generation. Standalone, needs no window or GL context.
+// Linux:
+// g++ -std=c++17 -O2 -pthread -Wall -Wextra -I.. -I../3rdParty/glm -I../3rdParty/glad/include -I../3rdParty/Assimp/include -I../3rdParty/stb MicroBenchmarks.cpp ../AABB.cpp ../ViewFrustum.cpp ../MeshData.cpp ../Graphics/ShaderPreprocessor.cpp ../Graphics/MipGenerator.cpp ../Core/JobSystem.cpp -o MicroBenchmarks
+// Usage: MicroBenchmarks [--scale s] [--repetitions n] [--warmup n] [--seed n] [--threads n] [--filter name] [--json path]
+// Every input is generated from the seed, so runs with the same arguments do the same work.
+
+#include "../AABB.hpp"
+#include "../ViewFrustum.h"
+#include "../MeshData.h"
+#include "../Graphics/MipGenerator.h"
+#include "../Graphics/ShaderPreprocessor.h"
+#include "../Core/JobSystem.h"
+
+#include <assimp/mesh.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct Settings {
+	double Scale{ 1.0 };	// Multiplies every problem size
+	std::size_t Repetitions{ 15 };
+	std::size_t Warmup{ 3 };
+	std::uint32_t Seed{ 1337 };
+	std::size_t Threads{ 1 };	// Job system threads, only the mip generator goes wide
+	std::string Filter;	// Only run benchmarks whose name contains this
+	std::string JsonPath;
+};
+
+struct Result {
+	std::string Name;
+	std::size_t Items;	// Work items per repetition
+	double MedianMs, MadMs, MinMs, MaxMs;
+};
+
+// Results of the measured work end up here so the compiler can't drop it
+volatile std::uint64_t g_sink{ 0 };
+
+/***********************************************************************************/
+std::size_t scaled(const Settings& settings, const std::size_t size) {
+	return std::max<std::size_t>(static_cast<std::size_t>(static_cast<double>(size) * settings.Scale), 1);
+}
+
+/***********************************************************************************/
+// Side of a square image whose pixel count scales with the settings
+int scaledSide(const Settings& settings, const int side) {
+	return std::max(static_cast<int>(static_cast<double>(side) * std::sqrt(settings.Scale)), 1);
+}
+
+/***********************************************************************************/
+double median(std::vector<double> values) {
+	std::sort(values.begin(), values.end());
+	const auto mid{ values.size() / 2 };
+	return values.size() % 2 == 1 ? values[mid] : (values[mid - 1] + values[mid]) * 0.5;
+}
+
+/***********************************************************************************/
+// Runs func warmup + repetitions times and keeps the median and the median absolute deviation,
+// which are not thrown off by the odd repetition that got preempted. func returns a checksum.
+template<typename Func>
+void run(const Settings& settings, std::vector<Result>& results, const std::string_view name, const std::size_t items, const Func& func) {
+	if (!settings.Filter.empty() && name.find(settings.Filter) == std::string_view::npos) {
+		return;
+	}
+
+	for (std::size_t i = 0; i < settings.Warmup; ++i) {
+		g_sink = g_sink + func();
+	}
+
+	std::vector<double> samples;
+	samples.reserve(settings.Repetitions);
+	for (std::size_t i = 0; i < settings.Repetitions; ++i) {
+		const auto start{ std::chrono::steady_clock::now() };
+		g_sink = g_sink + func();
+		const auto end{ std::chrono::steady_clock::now() };
+		samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	const auto med{ median(samples) };
+	std::vector<double> deviations;
+	deviations.reserve(samples.size());
+	for (const auto sample : samples) {
+		deviations.push_back(std::abs(sample - med));
+	}
+
+	const auto [minMs, maxMs] { std::minmax_element(samples.cbegin(), samples.cend()) };
+	results.push_back({ std::string(name), items, med, median(deviations), *minMs, *maxMs });
+
+	const auto& result{ results.back() };
+	std::cout << std::fixed << std::setprecision(3)
+		<< std::left << std::setw(24) << result.Name << std::right
+		<< std::setw(12) << result.Items << std::setw(12) << result.MedianMs
+		<< std::setw(10) << result.MadMs << std::setw(12) << result.MinMs
+		<< std::setw(12) << result.MedianMs * 1e6 / static_cast<double>(result.Items) << std::endl;
+}
+
+/***********************************************************************************/
+// View-projection pairs of a camera looking around the origin
+std::vector<std::pair<glm::mat4, glm::mat4>> makeCameras(const std::size_t count, std::mt19937& rng) {
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> fov(30.0f, 90.0f);
+
+	std::vector<std::pair<glm::mat4, glm::mat4>> cameras;
+	cameras.reserve(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		const glm::vec3 eye(position(rng), position(rng) * 0.2f, position(rng));
+		cameras.emplace_back(glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+			glm::perspective(glm::radians(fov(rng)), 16.0f / 9.0f, 0.1f, 100.0f));
+	}
+
+	return cameras;
+}
+
+/***********************************************************************************/
+// Boxes of 0.1-5 units scattered through a 200 unit cube
+std::vector<AABB> makeBoxes(const std::size_t count, std::mt19937& rng) {
+	std::uniform_real_distribution<float> center(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> extent(0.1f, 5.0f);
+
+	std::vector<AABB> boxes;
+	boxes.reserve(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		const glm::vec3 c(center(rng), center(rng), center(rng));
+		const glm::vec3 e(extent(rng), extent(rng), extent(rng));
+		boxes.emplace_back(c - e, c + e);
+	}
+
+	return boxes;
+}
+
+/***********************************************************************************/
+// Assimp mesh with positions, normals, tangents and uvs, two triangles per vertex like a typical
+// closed mesh. aiMesh frees the arrays.
+std::unique_ptr<aiMesh> makeMesh(const std::size_t numVertices, std::mt19937& rng) {
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_int_distribution<unsigned int> vertex(0, static_cast<unsigned int>(numVertices - 1));
+
+	auto mesh{ std::make_unique<aiMesh>() };
+	mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+	mesh->mNumVertices = static_cast<unsigned int>(numVertices);
+	mesh->mVertices = new aiVector3D[numVertices];
+	mesh->mNormals = new aiVector3D[numVertices];
+	mesh->mTangents = new aiVector3D[numVertices];
+	mesh->mBitangents = new aiVector3D[numVertices];
+	mesh->mTextureCoords[0] = new aiVector3D[numVertices];
+	mesh->mNumUVComponents[0] = 2;
+
+	// aiVector3D declares a copy constructor but no copy assignment, so values are Set()
+	const auto set = [](aiVector3D& dst, const aiVector3D& src) { dst.Set(src.x, src.y, src.z); };
+	for (std::size_t i = 0; i < numVertices; ++i) {
+		set(mesh->mVertices[i], aiVector3D(unit(rng), unit(rng), unit(rng)) * 10.0f);
+		set(mesh->mNormals[i], aiVector3D(unit(rng), unit(rng), unit(rng)).Normalize());
+		set(mesh->mTangents[i], aiVector3D(unit(rng), unit(rng), unit(rng)).Normalize());
+		set(mesh->mBitangents[i], mesh->mNormals[i] ^ mesh->mTangents[i]);
+		set(mesh->mTextureCoords[0][i], aiVector3D(unit(rng) * 0.5f + 0.5f, unit(rng) * 0.5f + 0.5f, 0.0f));
+	}
+
+	mesh->mNumFaces = static_cast<unsigned int>(numVertices * 2);
+	mesh->mFaces = new aiFace[mesh->mNumFaces];
+	for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
+		auto& face{ mesh->mFaces[i] };
+		face.mNumIndices = 3;
+		face.mIndices = new unsigned int[3]{ vertex(rng), vertex(rng), vertex(rng) };
+	}
+
+	return mesh;
+}
+
+/***********************************************************************************/
+// Shader that includes numIncludes files of about 2 KB each, loaded from memory
+std::pair<std::string, std::unordered_map<std::string, std::string>> makeShader(const std::size_t numIncludes, std::mt19937& rng) {
+	std::uniform_real_distribution<float> constant(0.0f, 1.0f);
+
+	std::unordered_map<std::string, std::string> files;
+	std::string code{ "hash version 440 core\n" };
+	for (std::size_t i = 0; i < numIncludes; ++i) {
+		const auto path{ "include" + std::to_string(i) + ".glsl" };
+		code += "#include \"" + path + "\"\n";
+
+		std::string include{ "hash define INCLUDE_" + std::to_string(i) + "\n" };
+		while (include.size() < 2048) {
+			include += "const float c" + std::to_string(include.size()) + " = " + std::to_string(constant(rng)) + ";\n";
+		}
+		files.emplace(path, std::move(include));
+	}
+	code += "void main() {\n\tgl_Position = vec4(0.0);\n}\n";
+
+	return { std::move(code), std::move(files) };
+}
+
+/***********************************************************************************/
+// RGBA8 image of smooth gradients plus noise, so it compresses somewhat like a photo texture
+std::vector<unsigned char> makeImage(const int side, std::mt19937& rng) {
+	std::uniform_int_distribution<int> noise(-12, 12);
+
+	std::vector<unsigned char> pixels(static_cast<std::size_t>(side) * side * 4);
+	for (int y = 0; y < side; ++y) {
+		for (int x = 0; x < side; ++x) {
+			auto* pixel{ &pixels[(static_cast<std::size_t>(y) * side + x) * 4] };
+			pixel[0] = static_cast<unsigned char>(std::clamp(x * 255 / side + noise(rng), 0, 255));
+			pixel[1] = static_cast<unsigned char>(std::clamp(y * 255 / side + noise(rng), 0, 255));
+			pixel[2] = static_cast<unsigned char>(std::clamp(128 + noise(rng) * 4, 0, 255));
+			pixel[3] = 255;
+		}
+	}
+
+	return pixels;
+}
+
+/***********************************************************************************/
+void appendBytes(void* context, void* data, const int size) {
+	auto& bytes{ *static_cast<std::vector<unsigned char>*>(context) };
+	const auto* begin{ static_cast<const unsigned char*>(data) };
+	bytes.insert(bytes.end(), begin, begin + size);
+}
+
+/***********************************************************************************/
+std::size_t decode(const std::vector<unsigned char>& file) {
+	int width, height, channels;
+	auto* data{ stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &width, &height, &channels, 0) };
+	const std::size_t checksum{ data ? data[0] + static_cast<std::size_t>(width) * height : 0 };
+	stbi_image_free(data);
+	return checksum;
+}
+
+/***********************************************************************************/
+void writeJson(const Settings& settings, const std::vector<Result>& results) {
+	std::ofstream out(settings.JsonPath);
+	if (!out) {
+		std::cerr << "Failed to write " << settings.JsonPath << '\n';
+		return;
+	}
+
+	out << "{\n\"scale\":" << settings.Scale << ",\n\"repetitions\":" << settings.Repetitions
+		<< ",\n\"warmup\":" << settings.Warmup << ",\n\"seed\":" << settings.Seed << ",\n\"benchmarks\":[";
+	for (std::size_t i = 0; i < results.size(); ++i) {
+		const auto& result{ results[i] };
+		out << (i > 0 ? ",\n" : "\n") << "{\"name\":\"" << result.Name << "\",\"items\":" << result.Items
+			<< ",\"median_ms\":" << result.MedianMs << ",\"mad_ms\":" << result.MadMs
+			<< ",\"min_ms\":" << result.MinMs << ",\"max_ms\":" << result.MaxMs
+			<< ",\"ns_per_item\":" << result.MedianMs * 1e6 / static_cast<double>(result.Items) << '}';
+	}
+	out << "\n]\n}\n";
+
+	std::cout << "Wrote " << settings.JsonPath << '\n';
+}
+
+}
+
+/***********************************************************************************/
+int main(int argc, char* argv[]) {
+	Settings settings;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		const std::string_view arg{ argv[i] };
+		if (arg == "--scale") settings.Scale = std::stod(argv[i + 1]);
+		else if (arg == "--repetitions") settings.Repetitions = std::max<std::size_t>(std::stoul(argv[i + 1]), 1);
+		else if (arg == "--warmup") settings.Warmup = std::stoul(argv[i + 1]);
+		else if (arg == "--seed") settings.Seed = static_cast<std::uint32_t>(std::stoul(argv[i + 1]));
+		else if (arg == "--threads") settings.Threads = std::max<std::size_t>(std::stoul(argv[i + 1]), 1);
+		else if (arg == "--filter") settings.Filter = argv[i + 1];
+		else if (arg == "--json") settings.JsonPath = argv[i + 1];
+		else {
+			std::cerr << "Unknown argument " << arg << '\n';
+			return 1;
+		}
+	}
+
+	JobSystem::GetInstance().Init(settings.Threads);
+
+	std::mt19937 rng{ settings.Seed };
+	std::vector<Result> results;
+
+	std::cout << std::left << std::setw(24) << "benchmark" << std::right
+		<< std::setw(12) << "items" << std::setw(12) << "median ms"
+		<< std::setw(10) << "MAD ms" << std::setw(12) << "min ms" << std::setw(12) << "ns/item" << '\n';
+
+	// Culling
+	{
+		const auto cameras{ makeCameras(scaled(settings, 100000), rng) };
+		run(settings, results, "frustum_construct", cameras.size(), [&]() {
+			std::size_t checksum{ 0 };
+			for (const auto& [view, proj] : cameras) {
+				const ViewFrustum frustum(view, proj);
+				checksum += frustum.GetPlane(ViewFrustum::LEFT).w > 0.0f;
+			}
+			return checksum;
+		});
+
+		const auto boxes{ makeBoxes(scaled(settings, 1000000), rng) };
+		const ViewFrustum frustum(cameras.front().first, cameras.front().second);
+		run(settings, results, "frustum_test_aabb", boxes.size(), [&]() {
+			std::size_t visible{ 0 };
+			for (const auto& box : boxes) {
+				visible += frustum.TestIntersection(box) != BoundingVolume::TestResult::OUTSIDE;
+			}
+			return visible;
+		});
+
+		run(settings, results, "aabb_intersect", boxes.size() - 1, [&]() {
+			std::size_t overlapping{ 0 };
+			for (std::size_t i = 0; i + 1 < boxes.size(); ++i) {
+				overlapping += boxes[i].intersect(boxes[i + 1]) != AABB::OUTSIDE;
+			}
+			return overlapping;
+		});
+
+		std::vector<glm::vec3> points;
+		points.reserve(boxes.size());
+		for (const auto& box : boxes) {
+			points.push_back(box.getCenter());
+		}
+		run(settings, results, "aabb_extend", points.size(), [&]() {
+			AABB bounds;
+			for (const auto& point : points) {
+				bounds.extend(point);
+			}
+			return static_cast<std::size_t>(bounds.getLongestEdge());
+		});
+	}
+
+	// Mesh conversion, as done for every mesh of a loaded model
+	{
+		const auto mesh{ makeMesh(scaled(settings, 250000), rng) };
+		run(settings, results, "mesh_convert", mesh->mNumVertices, [&]() {
+			const auto data{ MeshData::FromAssimp(mesh.get(), true) };
+			return data.Vertices.size() + data.Indices.size();
+		});
+	}
+
+	// Shader preprocessing, as done for every shader compile and hot reload
+	{
+		const auto [code, files] { makeShader(scaled(settings, 64), rng) };
+		const auto loadFile = [&files = files](const std::string& path) { return files.at(path); };
+		run(settings, results, "shader_preprocess", files.size(), [&]() {
+			auto shaderCode{ code };
+			ShaderPreprocessor::Process(shaderCode, loadFile);
+			return shaderCode.size();
+		});
+	}
+
+	// Texture loading
+	{
+		const auto side{ scaledSide(settings, 1024) };
+		const auto image{ makeImage(side, rng) };
+		const auto pixels{ static_cast<std::size_t>(side) * side };
+
+		std::vector<unsigned char> png, tga;
+		stbi_write_png_to_func(appendBytes, &png, side, side, 4, image.data(), side * 4);
+		stbi_write_tga_to_func(appendBytes, &tga, side, side, 4, image.data());
+
+		run(settings, results, "image_decode_png", pixels, [&]() { return decode(png); });
+		run(settings, results, "image_decode_tga", pixels, [&]() { return decode(tga); });
+
+		// As for material textures: linear masks, sRGB albedo, renormalised normals
+		const auto generateMips = [&](const MipGenerator::Filter filter, const MipGenerator::ColorSpace colorSpace) {
+			return static_cast<std::size_t>(MipGenerator::Generate(image.data(), side, side, 4, filter, colorSpace).back().Pixels[0]);
+		};
+		run(settings, results, "mip_chain_box_linear", pixels, [&]() { return generateMips(MipGenerator::Filter::Box, MipGenerator::ColorSpace::Linear); });
+		run(settings, results, "mip_chain_box_srgb", pixels, [&]() { return generateMips(MipGenerator::Filter::Box, MipGenerator::ColorSpace::SRGB); });
+		run(settings, results, "mip_chain_kaiser_srgb", pixels, [&]() { return generateMips(MipGenerator::Filter::Kaiser, MipGenerator::ColorSpace::SRGB); });
+		run(settings, results, "mip_chain_lanczos_normal", pixels, [&]() { return generateMips(MipGenerator::Filter::Lanczos, MipGenerator::ColorSpace::Normal); });
+	}
+
+	JobSystem::GetInstance().Shutdown();
+
+	if (!settings.JsonPath.empty()) {
+		writeJson(settings, results);
+	}
+
+	return 0;
+}
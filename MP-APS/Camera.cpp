@@ -23,6 +23,14 @@ void Camera::SetSpeed(const float speed) {
 	m_speed = speed;
 }
 
+/***********************************************************************************/
+void Camera::SetPose(const glm::vec3& position, const float yaw, const float pitch) {
+	m_position = position;
+	m_yaw = yaw;
+	m_pitch = pitch;
+	updateVectors();
+}
+
 /***********************************************************************************/
 void Camera::Update(const double deltaTime) {
 
@@ -10,6 +10,8 @@ public:
 	void SetNear(const float near);
 	void SetFar(const float far);
 	void SetSpeed(const float speed);
+	// Places the camera directly, angles in degrees
+	void SetPose(const glm::vec3& position, const float yaw, const float pitch);
 
 	void Update(const double deltaTime);
 
@@ -17,6 +19,8 @@ public:
 	// TODO: optimize projection matrix calculation
 	auto GetProjMatrix(const float width, const float height) const { return glm::perspective(m_FOV, width / height, m_near, m_far); }
 	auto GetPosition() const noexcept { return m_position; }
+	auto GetYaw() const noexcept { return m_yaw; }
+	auto GetPitch() const noexcept { return m_pitch; }
 
 private:
 	enum class Direction {
@@ -0,0 +1,99 @@
+#include "CameraPath.h"
+
+#include <pugixml.hpp>
+#include <glm/common.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+
+/***********************************************************************************/
+void CameraPath::Load(const pugi::xml_node& pathNode) {
+	m_keys.clear();
+
+	for (const auto& keyNode : pathNode.children("Key")) {
+		Key key{ keyNode.attribute("time").as_double(), glm::vec3(0.0f), keyNode.attribute("yaw").as_float(-90.0f), keyNode.attribute("pitch").as_float() };
+
+		std::istringstream position(keyNode.attribute("position").as_string("0 0 0"));
+		position >> key.Position.x >> key.Position.y >> key.Position.z;
+
+		m_keys.push_back(key);
+	}
+
+	std::stable_sort(m_keys.begin(), m_keys.end(), [](const auto& a, const auto& b) { return a.Time < b.Time; });
+}
+
+/***********************************************************************************/
+bool CameraPath::LoadFile(const std::filesystem::path& path) {
+	std::ifstream in(path);
+	if (!in) {
+		std::cerr << "Camera path: failed to open " << path << '\n';
+		return false;
+	}
+
+	std::vector<Key> keys;
+	std::string line;
+	while (std::getline(in, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+
+		std::istringstream fields(line);
+		Key key;
+		if (!(fields >> key.Time >> key.Position.x >> key.Position.y >> key.Position.z >> key.Yaw >> key.Pitch)) {
+			std::cerr << "Camera path: malformed key in " << path << ": " << line << '\n';
+			return false;
+		}
+		keys.push_back(key);
+	}
+
+	std::stable_sort(keys.begin(), keys.end(), [](const auto& a, const auto& b) { return a.Time < b.Time; });
+	m_keys = std::move(keys);
+
+	return true;
+}
+
+/***********************************************************************************/
+bool CameraPath::Save(const std::filesystem::path& path) const {
+	std::ofstream out(path);
+	if (!out) {
+		std::cerr << "Camera path: failed to write " << path << '\n';
+		return false;
+	}
+
+	out << "# time x y z yaw pitch\n";
+	for (const auto& key : m_keys) {
+		out << std::setprecision(std::numeric_limits<double>::max_digits10) << key.Time << ' '
+			<< std::setprecision(std::numeric_limits<float>::max_digits10) << key.Position.x << ' ' << key.Position.y << ' ' << key.Position.z << ' '
+			<< key.Yaw << ' ' << key.Pitch << '\n';
+	}
+
+	return static_cast<bool>(out);
+}
+
+/***********************************************************************************/
+void CameraPath::AddKey(const Key& key) {
+	m_keys.push_back(key);
+}
+
+/***********************************************************************************/
+CameraPath::Key CameraPath::Evaluate(const double time) const {
+	if (time <= m_keys.front().Time) {
+		return m_keys.front();
+	}
+	if (time >= m_keys.back().Time) {
+		return m_keys.back();
+	}
+
+	// First key after time, the one before it starts the segment
+	const auto next{ std::upper_bound(m_keys.begin(), m_keys.end(), time, [](const double t, const auto& key) { return t < key.Time; }) };
+	const auto& a{ *(next - 1) };
+	const auto& b{ *next };
+
+	const auto t{ static_cast<float>((time - a.Time) / (b.Time - a.Time)) };
+	return { time, glm::mix(a.Position, b.Position, t), glm::mix(a.Yaw, b.Yaw, t), glm::mix(a.Pitch, b.Pitch, t) };
+}
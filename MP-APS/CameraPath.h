@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+#include <filesystem>
+#include <vector>
+
+/***********************************************************************************/
+// Forward Declarations
+namespace pugi {
+class xml_node;
+}
+
+/***********************************************************************************/
+// Camera keyframes over time, linearly interpolated. Used to fly the same route every run.
+// Files are text, one key per line: time x y z yaw pitch. Lines starting with # are comments.
+class CameraPath {
+public:
+	struct Key {
+		double Time;	// Seconds from the start of the path
+		glm::vec3 Position;
+		float Yaw, Pitch;	// Degrees
+	};
+
+	// Reads <Key time="" position="x y z" yaw="" pitch=""/> children, sorted by time
+	void Load(const pugi::xml_node& pathNode);
+	// Replaces the keys with those of a file written by Save()
+	bool LoadFile(const std::filesystem::path& path);
+	// Floats are written with enough digits to read back exactly
+	bool Save(const std::filesystem::path& path) const;
+
+	// Keys must be added in time order
+	void AddKey(const Key& key);
+	void Clear() noexcept { m_keys.clear(); }
+
+	// Pose at a time, held at the first and last key outside the path. Needs at least one key.
+	Key Evaluate(const double time) const;
+
+	auto IsEmpty() const noexcept { return m_keys.empty(); }
+	auto GetDuration() const noexcept { return m_keys.empty() ? 0.0 : m_keys.back().Time; }
+	const auto& GetKeys() const noexcept { return m_keys; }
+
+private:
+	std::vector<Key> m_keys;
+};
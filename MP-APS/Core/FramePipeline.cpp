@@ -0,0 +1,73 @@
+#include "FramePipeline.h"
+
+#include <algorithm>
+
+/***********************************************************************************/
+void FramePipeline::Init(const std::size_t depth) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_depth = std::max<std::size_t>(depth, 1);
+	m_snapshots.clear();
+	m_running = true;
+}
+
+/***********************************************************************************/
+void FramePipeline::Shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+		m_snapshots.clear();
+	}
+	m_notFull.notify_all();
+	m_notEmpty.notify_all();
+}
+
+/***********************************************************************************/
+bool FramePipeline::Submit(RenderSnapshot&& snapshot) {
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notFull.wait(lock, [this]() { return m_snapshots.size() < m_depth || !m_running; });
+
+		if (!m_running) {
+			return false;
+		}
+
+		m_snapshots.push_back(std::move(snapshot));
+	}
+	m_notEmpty.notify_one();
+
+	return true;
+}
+
+/***********************************************************************************/
+bool FramePipeline::Acquire(RenderSnapshot& snapshot) {
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notEmpty.wait(lock, [this]() { return !m_snapshots.empty() || !m_running; });
+
+		if (!m_running) {
+			return false;
+		}
+
+		snapshot = std::move(m_snapshots.front());
+		m_snapshots.pop_front();
+	}
+	m_notFull.notify_one();
+
+	return true;
+}
+
+/***********************************************************************************/
+void FramePipeline::Complete(const FrameResult& result) {
+	std::lock_guard<std::mutex> lock(m_resultsMutex);
+	m_results.push_back(result);
+}
+
+/***********************************************************************************/
+std::vector<FramePipeline::FrameResult> FramePipeline::TakeResults() {
+	std::vector<FrameResult> results;
+	{
+		std::lock_guard<std::mutex> lock(m_resultsMutex);
+		results.swap(m_results);
+	}
+	return results;
+}
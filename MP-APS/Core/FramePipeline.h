@@ -0,0 +1,65 @@
+#pragma once
+
+#include "RenderSnapshot.h"
+#include "../Graphics/GPUProfiler.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <deque>
+
+/***********************************************************************************/
+// Hands render snapshots from the simulation thread to the render thread.
+// At most `depth` snapshots can be waiting, the simulation blocks beyond that. A deeper
+// pipeline absorbs more frame time jitter at the cost of input latency.
+class FramePipeline {
+public:
+	// Reported by the render thread once a frame has been presented
+	struct FrameResult {
+		std::uint64_t FrameIndex;
+		double LatencyMs;	// Input poll to SwapBuffers returning
+		double RecordMs;
+		double SubmitMs;
+		double LightAssignMs;
+		std::uint64_t ShadedFragments;
+		double GBufferMB;
+		double SceneGpuMs;	// Scene passes on the GPU, reported two frames late
+		float RenderScale;	// Dynamic resolution scale of the scene passes
+		std::vector<GPUProfiler::PassTime> GpuPasses;	// Per pass, from GPUProfiler::FramesInFlight frames ago
+		double PresentTime;	// Timer::GetTime() after SwapBuffers returned
+		double CpuMs;		// Simulation plus render submission, these overlap when pipelining
+	};
+
+	FramePipeline() noexcept = default;
+
+	FramePipeline(FramePipeline&&) = delete;
+	FramePipeline(const FramePipeline&) = delete;
+	FramePipeline& operator=(FramePipeline&&) = delete;
+	FramePipeline& operator=(const FramePipeline&) = delete;
+
+	void Init(const std::size_t depth);
+	// Wakes up both threads, Submit() and Acquire() return false afterwards.
+	void Shutdown();
+
+	// Simulation thread. Blocks while the pipeline is full.
+	bool Submit(RenderSnapshot&& snapshot);
+	// Render thread. Blocks until a snapshot is available.
+	bool Acquire(RenderSnapshot& snapshot);
+
+	// Render thread
+	void Complete(const FrameResult& result);
+	// Simulation thread. Returns the results reported since the last call.
+	std::vector<FrameResult> TakeResults();
+
+	auto GetDepth() const noexcept { return m_depth; }
+
+private:
+	std::size_t m_depth{ 1 };
+	bool m_running{ false };
+
+	std::mutex m_mutex;
+	std::condition_variable m_notFull, m_notEmpty;
+	std::deque<RenderSnapshot> m_snapshots;
+
+	std::mutex m_resultsMutex;
+	std::vector<FrameResult> m_results;
+};
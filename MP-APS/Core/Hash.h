@@ -0,0 +1,39 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+/***********************************************************************************/
+// 64-bit FNV-1a, used to key on-disk caches. Not for hash tables or anything security related.
+namespace Hash {
+	constexpr std::uint64_t Seed{ 14695981039346656037ull };
+
+	/***********************************************************************************/
+	inline std::uint64_t Bytes(const std::byte* data, const std::size_t size, std::uint64_t hash = Seed) noexcept {
+		for (std::size_t i = 0; i < size; ++i) {
+			hash ^= static_cast<std::uint64_t>(data[i]);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	/***********************************************************************************/
+	// Object representation of a trivially copyable value
+	template<typename T>
+	std::uint64_t Value(const T& value, const std::uint64_t hash = Seed) noexcept {
+		return Bytes(reinterpret_cast<const std::byte*>(&value), sizeof(T), hash);
+	}
+
+	/***********************************************************************************/
+	// Size and contents of a file. Missing files hash like empty ones.
+	inline std::uint64_t File(const std::filesystem::path& path, const std::uint64_t hash = Seed) {
+		MappedFile file;
+		if (!file.Open(path)) {
+			return Value(std::uint64_t{ 0 }, hash);
+		}
+		return Bytes(file.GetData(), file.GetSize(), Value(static_cast<std::uint64_t>(file.GetSize()), hash));
+	}
+}
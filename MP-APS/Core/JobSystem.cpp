@@ -0,0 +1,232 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <iostream>
+#include <random>
+#include <string>
+
+// Index of the current thread in the pool
+thread_local std::size_t t_threadIndex{ JobSystem::InvalidThreadIndex };
+
+/***********************************************************************************/
+void JobSystem::Init(const std::size_t numThreads) {
+	PROFILE_FUNCTION();
+	if (m_running) {
+		std::cerr << "Job System Error: Already initialized." << std::endl;
+		return;
+	}
+
+	m_numThreads = numThreads > 0 ? numThreads : std::max(std::thread::hardware_concurrency(), 1u);
+
+	m_queues.clear();
+	for (std::size_t i = 0; i < m_numThreads; ++i) {
+		m_queues.push_back(std::make_unique<WorkStealingQueue>());
+	}
+
+	m_running = true;
+
+	// The calling thread owns queue 0
+	t_threadIndex = 0;
+	for (std::size_t i = 1; i < m_numThreads; ++i) {
+		m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+
+#ifdef _DEBUG
+	std::cout << "Job System: started " << m_numThreads - 1 << " worker threads.\n";
+#endif
+}
+
+/***********************************************************************************/
+void JobSystem::Shutdown() {
+	if (!m_running) {
+		return;
+	}
+
+	m_running = false;
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+	}
+	m_wakeCondition.notify_all();
+
+	for (auto& worker : m_workers) {
+		worker.join();
+	}
+	m_workers.clear();
+
+	// Anything still queued at this point runs on the calling thread
+	while (auto* job = findJob()) {
+		execute(job);
+	}
+
+	m_queues.clear();
+	m_numThreads = 0;
+	t_threadIndex = InvalidThreadIndex;
+}
+
+/***********************************************************************************/
+void JobSystem::Run(std::function<void()> task, JobCounter* counter, JobCounter* dependency) {
+
+	// No workers, run it right away
+	if (!m_running) {
+		if (dependency) {
+			Wait(*dependency);
+		}
+		task();
+		return;
+	}
+
+	auto* job{ new Job{ std::move(task), counter } };
+
+	if (counter) {
+		counter->m_value.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (dependency) {
+		std::lock_guard<std::mutex> lock(dependency->m_continuationMutex);
+		// Check under the lock so we can't miss the counter reaching zero
+		if (!dependency->IsDone()) {
+			dependency->m_continuations.push_back(job);
+			return;
+		}
+	}
+
+	schedule(job);
+}
+
+/***********************************************************************************/
+void JobSystem::Wait(const JobCounter& counter) {
+	while (!counter.IsDone()) {
+		if (auto* job = findJob()) {
+			execute(job);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+
+	// Make sure the job that finished the counter is done touching it
+	std::lock_guard<std::mutex> lock(counter.m_continuationMutex);
+}
+
+/***********************************************************************************/
+std::size_t JobSystem::GetThreadIndex() noexcept {
+	return t_threadIndex;
+}
+
+/***********************************************************************************/
+void JobSystem::workerLoop(const std::size_t threadIndex) {
+	t_threadIndex = threadIndex;
+	PROFILE_THREAD("Worker " + std::to_string(threadIndex));
+
+	while (m_running.load(std::memory_order_acquire)) {
+		if (auto* job = findJob()) {
+			execute(job);
+			continue;
+		}
+
+		// Nothing to do, go to sleep until more work is scheduled
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		++m_numSleeping;
+		m_wakeCondition.wait(lock, [this]() {
+			return m_pendingJobs.load() > 0 || !m_running.load();
+		});
+		--m_numSleeping;
+	}
+}
+
+/***********************************************************************************/
+void JobSystem::schedule(Job* job) {
+	m_pendingJobs.fetch_add(1);
+
+	const auto threadIndex{ t_threadIndex };
+	if (threadIndex == InvalidThreadIndex || threadIndex >= m_queues.size() || !m_queues[threadIndex]->Push(job)) {
+		std::lock_guard<std::mutex> lock(m_sharedQueueMutex);
+		m_sharedQueue.push_back(job);
+	}
+
+	wakeWorkers();
+}
+
+/***********************************************************************************/
+Job* JobSystem::findJob() {
+	const auto threadIndex{ t_threadIndex };
+	const auto numQueues{ m_queues.size() };
+
+	Job* job{ nullptr };
+
+	// Own queue first (LIFO, cache friendly)
+	if (threadIndex < numQueues) {
+		job = m_queues[threadIndex]->Pop();
+	}
+
+	// Steal from a random victim (FIFO end)
+	if (!job && numQueues > 0) {
+		thread_local std::minstd_rand rng{ static_cast<std::minstd_rand::result_type>(std::hash<std::thread::id>()(std::this_thread::get_id())) };
+		const auto start{ rng() % numQueues };
+		for (std::size_t i = 0; i < numQueues && !job; ++i) {
+			const auto victim{ (start + i) % numQueues };
+			if (victim != threadIndex) {
+				job = m_queues[victim]->Steal();
+			}
+		}
+	}
+
+	if (!job) {
+		std::lock_guard<std::mutex> lock(m_sharedQueueMutex);
+		if (!m_sharedQueue.empty()) {
+			job = m_sharedQueue.front();
+			m_sharedQueue.pop_front();
+		}
+	}
+
+	if (job) {
+		m_pendingJobs.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	return job;
+}
+
+/***********************************************************************************/
+void JobSystem::execute(Job* job) {
+	{
+		PROFILE_SCOPE("Job");
+		job->Task();
+	}
+
+	if (job->Counter) {
+		finish(*job->Counter);
+	}
+
+	delete job;
+}
+
+/***********************************************************************************/
+void JobSystem::finish(JobCounter& counter) {
+	std::vector<Job*> continuations;
+	{
+		// Decrement under the lock: a waiter may destroy the counter as soon as it sees zero,
+		// and Wait() takes this lock before returning.
+		std::lock_guard<std::mutex> lock(counter.m_continuationMutex);
+		if (counter.m_value.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+			return;
+		}
+
+		// Counter reached zero, release any jobs that were waiting on it
+		continuations.swap(counter.m_continuations);
+	}
+
+	for (auto* job : continuations) {
+		schedule(job);
+	}
+}
+
+/***********************************************************************************/
+void JobSystem::wakeWorkers() {
+	if (m_numSleeping.load() > 0) {
+		// Take the lock so a worker can't miss the notification between its check and its wait
+		{
+			std::lock_guard<std::mutex> lock(m_wakeMutex);
+		}
+		m_wakeCondition.notify_one();
+	}
+}
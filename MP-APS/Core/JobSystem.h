@@ -0,0 +1,149 @@
+#pragma once
+
+#include "WorkStealingQueue.h"
+
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <deque>
+#include <mutex>
+
+/***********************************************************************************/
+// Forward Declarations
+class JobSystem;
+
+/***********************************************************************************/
+// Tracks completion of a group of jobs. Every job scheduled with a counter increments
+// it and decrements it again once finished. Jobs can also depend on a counter, in which
+// case they are only scheduled once it reaches zero.
+class JobCounter {
+	friend class JobSystem;
+public:
+	JobCounter() noexcept = default;
+
+	JobCounter(JobCounter&&) = delete;
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(JobCounter&&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	auto IsDone() const noexcept { return m_value.load(std::memory_order_acquire) == 0; }
+
+private:
+	std::atomic<int> m_value{ 0 };
+
+	// Jobs waiting on this counter to reach zero
+	mutable std::mutex m_continuationMutex;
+	std::vector<Job*> m_continuations;
+};
+
+/***********************************************************************************/
+struct Job {
+	std::function<void()> Task;
+	// Signalled when the task has finished (optional)
+	JobCounter* Counter{ nullptr };
+};
+
+/***********************************************************************************/
+// Fixed pool of worker threads, each owning a Chase-Lev deque. Idle workers steal from
+// each other. The thread that calls Init() becomes thread 0 and takes part in executing
+// jobs whenever it waits on a counter.
+class JobSystem {
+	JobSystem() = default;
+	~JobSystem() { Shutdown(); }
+public:
+
+	static auto& GetInstance() {
+		static JobSystem instance;
+		return instance;
+	}
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Spawns the worker pool. numThreads includes the calling thread. 0 = one per hardware thread.
+	void Init(const std::size_t numThreads = 0);
+	// Stops and joins the workers, then runs any jobs still queued on the calling thread.
+	void Shutdown();
+
+	// Schedules a task. If dependency is given, the task only runs once it reaches zero.
+	void Run(std::function<void()> task, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+	// Blocks until the counter reaches zero, executing other jobs in the meantime.
+	void Wait(const JobCounter& counter);
+
+	// Splits [0, count) into chunks of at most grainSize and calls func(begin, end) for each
+	// chunk on the pool. Blocks until all chunks are done.
+	template<typename Func>
+	void ParallelFor(const std::size_t count, const std::size_t grainSize, const Func& func);
+	// Same as above with a grain size chosen from the number of threads.
+	template<typename Func>
+	void ParallelFor(const std::size_t count, const Func& func);
+
+	// Number of threads executing jobs (workers + the thread that called Init).
+	auto GetNumThreads() const noexcept { return m_numThreads; }
+	// Index of the calling thread in the pool, or InvalidThreadIndex for foreign threads.
+	static std::size_t GetThreadIndex() noexcept;
+
+	static constexpr std::size_t InvalidThreadIndex{ static_cast<std::size_t>(-1) };
+
+private:
+	void workerLoop(const std::size_t threadIndex);
+	// Pushes a job on the calling thread's deque (or the shared queue for foreign threads).
+	void schedule(Job* job);
+	// Tries the own deque first, then steals from others.
+	Job* findJob();
+	void execute(Job* job);
+	void finish(JobCounter& counter);
+	void wakeWorkers();
+
+	std::size_t m_numThreads{ 0 };
+	std::atomic<bool> m_running{ false };
+
+	std::vector<std::thread> m_workers;
+	// One deque per thread, index 0 belongs to the thread that called Init()
+	std::vector<std::unique_ptr<WorkStealingQueue>> m_queues;
+
+	// Jobs submitted from threads that don't own a deque, or from full deques
+	std::mutex m_sharedQueueMutex;
+	std::deque<Job*> m_sharedQueue;
+
+	// Sleeping for idle workers
+	std::atomic<int> m_pendingJobs{ 0 };
+	std::atomic<int> m_numSleeping{ 0 };
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wakeCondition;
+};
+
+/***********************************************************************************/
+template<typename Func>
+void JobSystem::ParallelFor(const std::size_t count, const std::size_t grainSize, const Func& func) {
+	if (count == 0) {
+		return;
+	}
+
+	const auto grain{ grainSize > 0 ? grainSize : 1 };
+
+	// Not worth going wide
+	if (m_numThreads <= 1 || count <= grain) {
+		func(static_cast<std::size_t>(0), count);
+		return;
+	}
+
+	JobCounter counter;
+	for (std::size_t begin = 0; begin < count; begin += grain) {
+		const auto end{ std::min(begin + grain, count) };
+		Run([&func, begin, end]() { func(begin, end); }, &counter);
+	}
+
+	Wait(counter);
+}
+
+/***********************************************************************************/
+template<typename Func>
+void JobSystem::ParallelFor(const std::size_t count, const Func& func) {
+	// A few chunks per thread so stealing can balance uneven work
+	const auto numChunks{ std::max<std::size_t>(m_numThreads * 4, 1) };
+	ParallelFor(count, (count + numChunks - 1) / numChunks, func);
+}
@@ -0,0 +1,90 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+/***********************************************************************************/
+bool MappedFile::Open(const std::filesystem::path& path) {
+	Close();
+
+#ifdef _WIN32
+	m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE) {
+		m_file = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) {
+		Close();
+		return false;
+	}
+
+	m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping == nullptr) {
+		Close();
+		return false;
+	}
+
+	m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (m_data == nullptr) {
+		Close();
+		return false;
+	}
+	m_size = static_cast<std::size_t>(size.QuadPart);
+#else
+	const auto fd{ open(path.c_str(), O_RDONLY) };
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat status{};
+	if (fstat(fd, &status) != 0 || status.st_size == 0) {
+		close(fd);
+		return false;
+	}
+
+	auto* data{ mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0) };
+	// The mapping keeps the file alive
+	close(fd);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+
+	m_data = data;
+	m_size = static_cast<std::size_t>(status.st_size);
+#endif
+
+	return true;
+}
+
+/***********************************************************************************/
+void MappedFile::Close() noexcept {
+#ifdef _WIN32
+	if (m_data) {
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping) {
+		CloseHandle(m_mapping);
+	}
+	if (m_file) {
+		CloseHandle(m_file);
+	}
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	if (m_data) {
+		munmap(m_data, m_size);
+	}
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+}
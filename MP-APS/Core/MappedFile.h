@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+/***********************************************************************************/
+// Read-only memory mapping of a whole file. Pages are loaded by the OS on first access,
+// so only what is touched gets read from disk.
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile() { Close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Returns false if the file doesn't exist or can't be mapped. Empty files can't be mapped.
+	bool Open(const std::filesystem::path& path);
+	void Close() noexcept;
+
+	auto IsOpen() const noexcept { return m_data != nullptr; }
+	auto GetData() const noexcept { return static_cast<const std::byte*>(m_data); }
+	auto GetSize() const noexcept { return m_size; }
+
+private:
+	void* m_data{ nullptr };
+	std::size_t m_size{ 0 };
+#ifdef _WIN32
+	void* m_file{ nullptr };
+	void* m_mapping{ nullptr };
+#endif
+};
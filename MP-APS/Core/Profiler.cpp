@@ -0,0 +1,253 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+	// Nanoseconds on the steady clock
+	std::uint64_t steadyNow() noexcept {
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	// Names are identifiers and literals, only quotes, backslashes and control characters need escaping
+	void writeJsonString(std::ostream& out, const std::string_view str) {
+		out << '"';
+		for (const auto c : str) {
+			if (c == '"' || c == '\\') {
+				out << '\\' << c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20) {
+				out << ' ';
+			}
+			else {
+				out << c;
+			}
+		}
+		out << '"';
+	}
+
+	template<typename T>
+	void writePod(std::ostream& out, const T value) {
+		out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+}
+
+/***********************************************************************************/
+Profiler::Profiler() noexcept : m_epoch(steadyNow()) {
+}
+
+/***********************************************************************************/
+Profiler::Scope::Scope(const std::string_view name) :
+	m_buffer(GetInstance().getThreadBuffer()),
+	m_name(name),
+	m_frame(GetInstance().m_frame.load(std::memory_order_relaxed)),
+	m_depth(m_buffer.Depth++),
+	m_start(GetInstance().Now()) {
+}
+
+/***********************************************************************************/
+Profiler::Scope::~Scope() {
+	auto& profiler{ GetInstance() };
+	--m_buffer.Depth;
+	profiler.record(m_buffer, { m_name, m_start, profiler.Now(), m_frame, m_depth });
+}
+
+/***********************************************************************************/
+void Profiler::BeginFrame(const std::uint64_t frame) {
+	m_frame.store(frame, std::memory_order_relaxed);
+
+	if (m_capture.NumFrames > 0 && frame > m_capture.FirstFrame + m_capture.NumFrames) {
+		const auto lastFrame{ m_capture.FirstFrame + m_capture.NumFrames - 1 };
+		if (Write(m_capture.Path, m_capture.OutputFormat, m_capture.FirstFrame, lastFrame)) {
+			std::cout << "Profiler: wrote frames " << m_capture.FirstFrame << '-' << lastFrame << " to " << m_capture.Path << '\n';
+		}
+		m_capture.NumFrames = 0;
+	}
+}
+
+/***********************************************************************************/
+void Profiler::SetThreadName(const std::string_view name) {
+	auto& buffer{ getThreadBuffer() };
+	std::lock_guard<std::mutex> lock(m_threadsMutex);
+	buffer.Name = name;
+}
+
+/***********************************************************************************/
+void Profiler::RequestCapture(const std::uint64_t firstFrame, const std::uint64_t numFrames, const Format format, const std::filesystem::path& path) {
+	m_capture = { firstFrame, numFrames, format, path };
+}
+
+/***********************************************************************************/
+bool Profiler::Write(const std::filesystem::path& path, const Format format, const std::uint64_t firstFrame, const std::uint64_t lastFrame) const {
+	const auto threads{ collect(firstFrame, lastFrame) };
+
+	const auto written{ format == Format::ChromeTrace ? writeChromeTrace(path, threads) : writeBinary(path, threads) };
+	if (!written) {
+		std::cerr << "Profiler: failed to write " << path << '\n';
+	}
+
+	return written;
+}
+
+/***********************************************************************************/
+std::uint64_t Profiler::Now() const noexcept {
+	return steadyNow() - m_epoch;
+}
+
+/***********************************************************************************/
+Profiler::ThreadBuffer& Profiler::getThreadBuffer() {
+	thread_local ThreadBuffer* t_buffer{ nullptr };
+
+	if (!t_buffer) {
+		auto buffer{ std::make_unique<ThreadBuffer>() };
+		t_buffer = buffer.get();
+
+		std::lock_guard<std::mutex> lock(m_threadsMutex);
+		buffer->ThreadID = static_cast<std::uint32_t>(m_threads.size());
+		buffer->Name = "Thread " + std::to_string(buffer->ThreadID);
+		m_threads.push_back(std::move(buffer));
+	}
+
+	return *t_buffer;
+}
+
+/***********************************************************************************/
+void Profiler::record(ThreadBuffer& buffer, const Event& event) noexcept {
+	// Only the owning thread writes, readers see the event once Written covers it
+	const auto index{ buffer.Written.load(std::memory_order_relaxed) };
+	buffer.Events[index & Mask] = event;
+	buffer.Written.store(index + 1, std::memory_order_release);
+}
+
+/***********************************************************************************/
+std::vector<Profiler::ThreadEvents> Profiler::collect(const std::uint64_t firstFrame, const std::uint64_t lastFrame) const {
+	std::lock_guard<std::mutex> lock(m_threadsMutex);
+
+	std::vector<ThreadEvents> threads;
+	threads.reserve(m_threads.size());
+
+	for (const auto& buffer : m_threads) {
+		ThreadEvents thread{ buffer->ThreadID, buffer->Name, {} };
+
+		const auto written{ buffer->Written.load(std::memory_order_acquire) };
+		const auto oldest{ written > EventsPerThread ? written - EventsPerThread : 0 };
+		std::vector<Event> events;
+		events.reserve(written - oldest);
+		for (auto i = oldest; i < written; ++i) {
+			events.push_back(buffer->Events[i & Mask]);
+		}
+
+		// The owner kept recording while we copied, drop what it may have overwritten meanwhile
+		const auto writtenAfter{ buffer->Written.load(std::memory_order_acquire) };
+		const auto valid{ writtenAfter > EventsPerThread ? writtenAfter - EventsPerThread : 0 };
+		const auto firstValid{ std::min(static_cast<std::size_t>(std::max(valid, oldest) - oldest), events.size()) };
+
+		for (auto i = firstValid; i < events.size(); ++i) {
+			if (events[i].Frame >= firstFrame && events[i].Frame <= lastFrame) {
+				thread.Events.push_back(events[i]);
+			}
+		}
+
+		// Scopes are recorded when they end, parents after their children
+		std::sort(thread.Events.begin(), thread.Events.end(), [](const auto& a, const auto& b) {
+			return a.StartNs < b.StartNs || (a.StartNs == b.StartNs && a.Depth < b.Depth);
+		});
+
+		threads.push_back(std::move(thread));
+	}
+
+	return threads;
+}
+
+/***********************************************************************************/
+bool Profiler::writeChromeTrace(const std::filesystem::path& path, const std::vector<ThreadEvents>& threads) {
+	std::ofstream out(path);
+	if (!out) {
+		return false;
+	}
+
+	// Complete ("X") events with microsecond timestamps, one track per thread
+	out << "{\"traceEvents\":[\n";
+	auto first{ true };
+	for (const auto& thread : threads) {
+		out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.ThreadID << ",\"args\":{\"name\":";
+		writeJsonString(out, thread.Name);
+		out << "}}";
+		first = false;
+
+		for (const auto& event : thread.Events) {
+			out << ",\n{\"name\":";
+			writeJsonString(out, event.Name);
+			out << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.ThreadID << std::fixed << std::setprecision(3)
+				<< ",\"ts\":" << static_cast<double>(event.StartNs) / 1000.0
+				<< ",\"dur\":" << static_cast<double>(event.EndNs - event.StartNs) / 1000.0
+				<< ",\"args\":{\"frame\":" << event.Frame << "}}";
+		}
+	}
+	out << "\n]}\n";
+
+	return static_cast<bool>(out);
+}
+
+/***********************************************************************************/
+// Little endian, names stored once in a string table:
+//  char[8] "MPAPSPRF", uint32 version
+//  uint32 numStrings, numStrings * { uint32 length, char[length] }
+//  uint32 numThreads, numThreads * { uint32 threadID, uint32 nameString, uint32 numEvents,
+//                                   numEvents * { uint32 nameString, uint32 depth, uint64 frame, uint64 startNs, uint64 durationNs } }
+bool Profiler::writeBinary(const std::filesystem::path& path, const std::vector<ThreadEvents>& threads) {
+	std::vector<std::string_view> strings;
+	const auto stringIndex = [&strings](const std::string_view str) {
+		const auto it{ std::find(strings.begin(), strings.end(), str) };
+		if (it != strings.end()) {
+			return static_cast<std::uint32_t>(it - strings.begin());
+		}
+		strings.push_back(str);
+		return static_cast<std::uint32_t>(strings.size() - 1);
+	};
+
+	// Resolve all names first, the table comes before the events
+	std::vector<std::uint32_t> threadNames, eventNames;
+	for (const auto& thread : threads) {
+		threadNames.push_back(stringIndex(thread.Name));
+		for (const auto& event : thread.Events) {
+			eventNames.push_back(stringIndex(event.Name));
+		}
+	}
+
+	std::ofstream out(path, std::ios::binary);
+	if (!out) {
+		return false;
+	}
+
+	out.write("MPAPSPRF", 8);
+	writePod<std::uint32_t>(out, 1);
+
+	writePod(out, static_cast<std::uint32_t>(strings.size()));
+	for (const auto str : strings) {
+		writePod(out, static_cast<std::uint32_t>(str.size()));
+		out.write(str.data(), static_cast<std::streamsize>(str.size()));
+	}
+
+	writePod(out, static_cast<std::uint32_t>(threads.size()));
+	std::size_t eventIndex{ 0 };
+	for (std::size_t i = 0; i < threads.size(); ++i) {
+		const auto& thread{ threads[i] };
+		writePod(out, thread.ThreadID);
+		writePod(out, threadNames[i]);
+		writePod(out, static_cast<std::uint32_t>(thread.Events.size()));
+
+		for (const auto& event : thread.Events) {
+			writePod(out, eventNames[eventIndex++]);
+			writePod(out, event.Depth);
+			writePod(out, event.Frame);
+			writePod(out, event.StartNs);
+			writePod(out, event.EndNs - event.StartNs);
+		}
+	}
+
+	return static_cast<bool>(out);
+}
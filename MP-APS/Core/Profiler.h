@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/***********************************************************************************/
+// Instrumentation macros. Without ENABLE_PROFILER they expand to nothing.
+//  PROFILE_SCOPE(name)		times the enclosing scope, name must outlive the profiler (literals)
+//  PROFILE_FUNCTION()		PROFILE_SCOPE with the function's name
+//  PROFILE_FRAME(index)	marks the start of a frame, once per frame on the simulation thread
+//  PROFILE_THREAD(name)	names the calling thread in captures
+#ifdef ENABLE_PROFILER
+	#define PROFILE_CONCAT_INNER(a, b) a##b
+	#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+	#define PROFILE_SCOPE(name) const Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(name)
+	#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+	#define PROFILE_FRAME(index) Profiler::GetInstance().BeginFrame(index)
+	#define PROFILE_THREAD(name) Profiler::GetInstance().SetThreadName(name)
+#else
+	#define PROFILE_SCOPE(name)
+	#define PROFILE_FUNCTION()
+	#define PROFILE_FRAME(index)
+	#define PROFILE_THREAD(name)
+#endif
+
+/***********************************************************************************/
+// Hierarchical CPU scope profiler. Every thread records finished scopes into its own ring
+// buffer, so recording takes no locks and never waits. Buffers keep the last EventsPerThread
+// scopes of their thread, a capture writes those belonging to a range of frames as Chrome
+// trace JSON (chrome://tracing, ui.perfetto.dev) or a compact binary file.
+class Profiler {
+	Profiler() noexcept;
+	struct ThreadBuffer;
+public:
+	static auto& GetInstance() {
+		static Profiler instance;
+		return instance;
+	}
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	static constexpr std::size_t EventsPerThread{ 1 << 16 }; // Must be a power of two
+
+	enum class Format {
+		ChromeTrace,
+		Binary
+	};
+
+	struct Event {
+		std::string_view Name;
+		std::uint64_t StartNs;
+		std::uint64_t EndNs;
+		std::uint64_t Frame;	// Frame started last when the scope began
+		std::uint32_t Depth;	// Nesting level on its thread
+	};
+
+	class Scope {
+	public:
+		explicit Scope(const std::string_view name);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		ThreadBuffer& m_buffer;
+		const std::string_view m_name;
+		const std::uint64_t m_frame;
+		const std::uint32_t m_depth;
+		const std::uint64_t m_start;
+	};
+
+	// Scopes started from now on belong to this frame. Everything before the first frame
+	// (startup, loading) belongs to frame 0. Writes a requested capture once its last frame ended.
+	void BeginFrame(const std::uint64_t frame);
+	void SetThreadName(const std::string_view name);
+
+	// Writes the frames [firstFrame, firstFrame + numFrames) one frame after the last of them,
+	// so scopes still running on other threads (the render thread when pipelining) have ended.
+	// Buffers have to be large enough to still hold the first frame by then.
+	void RequestCapture(const std::uint64_t firstFrame, const std::uint64_t numFrames, const Format format, const std::filesystem::path& path);
+	// Writes the scopes of frames [firstFrame, lastFrame] still held by the buffers
+	bool Write(const std::filesystem::path& path, const Format format, const std::uint64_t firstFrame, const std::uint64_t lastFrame) const;
+
+	// Nanoseconds since the profiler was created
+	std::uint64_t Now() const noexcept;
+
+private:
+	struct ThreadBuffer {
+		std::array<Event, EventsPerThread> Events;
+		// Total events recorded, the owner publishes each event by incrementing it
+		std::atomic<std::uint64_t> Written{ 0 };
+		std::uint32_t Depth{ 0 };
+		std::uint32_t ThreadID{ 0 };
+		std::string Name;
+	};
+
+	struct ThreadEvents {
+		std::uint32_t ThreadID;
+		std::string Name;
+		std::vector<Event> Events;
+	};
+
+	// Registers the calling thread on first use
+	ThreadBuffer& getThreadBuffer();
+	void record(ThreadBuffer& buffer, const Event& event) noexcept;
+	// Copies the events of the frame range out of every buffer
+	std::vector<ThreadEvents> collect(const std::uint64_t firstFrame, const std::uint64_t lastFrame) const;
+
+	static bool writeChromeTrace(const std::filesystem::path& path, const std::vector<ThreadEvents>& threads);
+	static bool writeBinary(const std::filesystem::path& path, const std::vector<ThreadEvents>& threads);
+
+	static constexpr std::uint64_t Mask{ EventsPerThread - 1 };
+
+	const std::uint64_t m_epoch;
+	std::atomic<std::uint64_t> m_frame{ 0 };
+
+	// Only locked when a thread registers or names itself, and while collecting
+	mutable std::mutex m_threadsMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+
+	// Pending capture, numFrames 0 if none
+	struct Capture {
+		std::uint64_t FirstFrame{ 0 };
+		std::uint64_t NumFrames{ 0 };
+		Format OutputFormat{ Format::ChromeTrace };
+		std::filesystem::path Path;
+	} m_capture;
+};
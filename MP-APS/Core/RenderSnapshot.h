@@ -0,0 +1,56 @@
+#pragma once
+
+#include "../Model.h"
+
+#include "../Graphics/StaticDirectionalLight.h"
+#include "../Graphics/StaticPointLight.h"
+#include "../Graphics/StaticSpotLight.h"
+
+#include <glm/mat4x4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************************************/
+// How point and spot lights are matched to pixels
+enum class LightAssignment {
+	Tiled,			// 2D screen tiles culled against the depth buffer (compute)
+	ClusteredGPU,	// 3D froxels, assigned in a compute shader
+	ClusteredCPU	// 3D froxels, assigned on the job system and uploaded
+};
+
+/***********************************************************************************/
+// Everything the renderer needs to draw one frame, copied out of the simulation state.
+// Once handed to the renderer it is never modified, so the simulation is free to move on
+// to the next frame while this one is being submitted.
+struct RenderSnapshot {
+	struct Instance {
+		ModelPtr Model; // Keeps the GPU data alive while the frame is in flight
+		glm::mat4 Transform;
+	};
+
+	std::uint64_t FrameIndex{ 0 };
+	// Timer::GetTime() right after input for this frame was polled
+	double InputTime{ 0.0 };
+	// CPU time spent producing this snapshot
+	double SimulateMs{ 0.0 };
+
+	// Camera
+	glm::mat4 ViewMatrix, ProjMatrix;
+	glm::vec3 CameraPosition;
+	std::size_t Width{ 0 }, Height{ 0 };
+
+	// Visible models only, in scene order
+	std::vector<Instance> Instances;
+
+	std::vector<StaticDirectionalLight> DirectionalLights;
+	std::vector<StaticPointLight> PointLights;
+	std::vector<StaticSpotLight> SpotLights;
+
+	// Renderer toggles
+	bool Wireframe{ false };
+	bool DepthPrepass{ false };
+	LightAssignment LightAssignmentMode{ LightAssignment::Tiled };
+	// Run both cluster assignment paths this frame and compare their results
+	bool VerifyLightClusters{ false };
+};
@@ -1,22 +1,23 @@
 #include "RenderSystem.h"
+#include "JobSystem.h"
+#include "Profiler.h"
 
 #include "../Graphics/GLShader.h"
 #include "../Camera.h"
-
-#include "../Input.h"
-#include "../SceneBase.h"
+#include "../Timer.h"
 
 #include <pugixml.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <GLFW/glfw3.h>
 
+#include <algorithm>
 #include <iostream>
 
 /***********************************************************************************/
-void RenderSystem::Init(const pugi::xml_node& rendererNode) {
+void RenderSystem::Init(const pugi::xml_node& rendererNode, GLADloadproc loader, const bool offscreenOutput /*= false*/) {
+	PROFILE_FUNCTION();
 	
-	if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
+	if (!gladLoadGLLoader(loader)) {
 		std::cerr << "Failed to start GLAD.";
 		std::abort();
 	}
@@ -35,9 +36,34 @@ void RenderSystem::Init(const pugi::xml_node& rendererNode) {
 
 	m_width = width;
 	m_height = height;
+	m_renderWidth = width;
+	m_renderHeight = height;
 	m_shadowMapResolution = rendererNode.attribute("shadowResolution").as_uint();
+	const std::string_view shading{ rendererNode.attribute("shading").as_string("forward") };
+	if (shading == "deferred") {
+		m_shadingPath = ShadingPath::Deferred;
+	}
+	else if (shading == "visibility") {
+		m_shadingPath = ShadingPath::Visibility;
+	}
+
+	const auto dynamicResolution{ rendererNode.child("DynamicResolution") };
+	m_dynamicResolutionEnabled = dynamicResolution.attribute("enabled").as_bool(false);
+	m_dynamicResolution.Init(dynamicResolution.attribute("targetMs").as_double(12.0),
+		dynamicResolution.attribute("minScale").as_float(0.5f), dynamicResolution.attribute("maxScale").as_float(1.0f));
+	m_renderScale = m_dynamicResolutionEnabled ? m_dynamicResolution.GetScale() : 1.0f;
+
+	if (m_shadingPath == ShadingPath::Visibility) {
+		// Draws, vertices and indices live in storage buffers 7-9, next to the six light buffers
+		GLint maxBindings{ 0 }, maxFragmentBlocks{ 0 };
+		glGetIntegerv(GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS, &maxBindings);
+		glGetIntegerv(GL_MAX_FRAGMENT_SHADER_STORAGE_BLOCKS, &maxFragmentBlocks);
+		if (maxBindings < 10 || maxFragmentBlocks < 6) {
+			std::cerr << "Visibility buffer needs 10 storage buffer bindings, falling back to forward shading.\n";
+			m_shadingPath = ShadingPath::Forward;
+		}
+	}
 
-	m_hdrFBO.Init("HDR FBO");
 	m_skybox.Init("Data/hdri/barcelona.hdr", 2048);
 
 	// Compile all shader programs in config.xml
@@ -60,7 +86,12 @@ void RenderSystem::Init(const pugi::xml_node& rendererNode) {
 	setupScreenquad();
 	setupTextureSamplers();
 	setupShadowMap();
+	if (offscreenOutput) {
+		setupOffscreenOutput();
+	}
 	setupPostProcessing();
+	setupVisibilityBuffer();
+	setupLightCulling();
 
 #ifdef _DEBUG
 	glEnable(GL_DEBUG_OUTPUT);
@@ -75,6 +106,11 @@ void RenderSystem::Init(const pugi::xml_node& rendererNode) {
 	glBindBuffer(GL_UNIFORM_BUFFER, m_uboMatrices);
 	glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), nullptr, GL_STATIC_DRAW);
 	glBindBufferRange(GL_UNIFORM_BUFFER, 0, m_uboMatrices, 0, 2 * sizeof(glm::mat4));
+
+	if (GLAD_GL_ARB_pipeline_statistics_query) {
+		glGenQueries(static_cast<GLsizei>(m_fragmentQueries.size()), m_fragmentQueries.data());
+	}
+	glGenQueries(static_cast<GLsizei>(m_sceneTimerQueries.size()), m_sceneTimerQueries.data());
 	
 	auto& pbrShader = m_shaderCache.at("PBRShader");
 	pbrShader.Bind();
@@ -82,10 +118,41 @@ void RenderSystem::Init(const pugi::xml_node& rendererNode) {
 	pbrShader.SetUniformi("albedoMap", 3).SetUniformi("normalMap", 4).SetUniformi("metallicMap", 5);
 	pbrShader.SetUniformi("roughnessMap", 6).SetUniformi("shadowMap", 7).SetUniformf("bloomThreshold", 1.0f);//.SetUniformi("aoMap", 7);
 	
+	auto& gBufferShader = m_shaderCache.at("GBufferShader");
+	gBufferShader.Bind();
+	gBufferShader.SetUniformi("albedoMap", 3).SetUniformi("normalMap", 4).SetUniformi("metallicMap", 5).SetUniformi("roughnessMap", 6);
+
+	auto& deferredLightingShader = m_shaderCache.at("DeferredLightingShader");
+	deferredLightingShader.Bind();
+	deferredLightingShader.SetUniformi("irradianceMap", 0).SetUniformi("prefilterMap", 1).SetUniformi("brdfLUT", 2);
+	deferredLightingShader.SetUniformi("gAlbedoMetallic", 3).SetUniformi("gNormalRoughness", 4).SetUniformi("gDepth", 5);
+	deferredLightingShader.SetUniformi("shadowMap", 7).SetUniformf("bloomThreshold", 1.0f);
+
+	auto& materialDepthShader = m_shaderCache.at("MaterialDepthShader");
+	materialDepthShader.Bind();
+	materialDepthShader.SetUniformi("visibilityBuffer", 9);
+
+	auto& visibilityShadeShader = m_shaderCache.at("VisibilityShadeShader");
+	visibilityShadeShader.Bind();
+	visibilityShadeShader.SetUniformi("irradianceMap", 0).SetUniformi("prefilterMap", 1).SetUniformi("brdfLUT", 2);
+	visibilityShadeShader.SetUniformi("albedoMap", 3).SetUniformi("normalMap", 4).SetUniformi("metallicMap", 5).SetUniformi("roughnessMap", 6);
+	visibilityShadeShader.SetUniformi("shadowMap", 7).SetUniformi("visibilityBuffer", 9).SetUniformf("bloomThreshold", 1.0f);
+
 	auto& skyboxShader = m_shaderCache.at("SkyboxShader");
 	skyboxShader.Bind();
 	skyboxShader.SetUniformi("environmentMap", 0);
 
+	switch (m_shadingPath) {
+	case ShadingPath::Deferred:
+		std::cout << "Deferred shading, G-buffer: " << GBufferBytesPerPixel << " bytes per pixel + depth\n";
+		break;
+	case ShadingPath::Visibility:
+		std::cout << "Visibility buffer shading, 4 bytes per pixel + depth\n";
+		break;
+	default:
+		break;
+	}
+
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glViewport(0, 0, width, height);
@@ -93,109 +160,358 @@ void RenderSystem::Init(const pugi::xml_node& rendererNode) {
 }
 
 /***********************************************************************************/
-void RenderSystem::Update(const Camera& camera) {
-
-	// Window size changed.
-	if (Input::GetInstance().ShouldResize()) {
-		m_width = Input::GetInstance().GetWidth();
-		m_height = Input::GetInstance().GetHeight();
+void RenderSystem::Shutdown() {
+	for (const auto& shader : m_shaderCache) {
+		shader.second.DeleteProgram();
+	}
 
-		UpdateView(camera);
-		glViewport(0, 0, m_width, m_height);
+	if (m_fragmentQueries[0]) {
+		glDeleteQueries(static_cast<GLsizei>(m_fragmentQueries.size()), m_fragmentQueries.data());
+	}
+	glDeleteQueries(static_cast<GLsizei>(m_sceneTimerQueries.size()), m_sceneTimerQueries.data());
+
+	const std::array<GLuint, 7> lightBuffers{ m_lightBuffer, m_lightIndexBuffer, m_lightGridBuffer, m_lightIndexCounter,
+											   m_clusterBoundsBuffer, m_lightSphereBuffer, m_clusterLightCountBuffer };
+	glDeleteBuffers(static_cast<GLsizei>(lightBuffers.size()), lightBuffers.data());
+	for (auto& readback : m_lightCounterReadbacks) {
+		glDeleteBuffers(1, &readback.Buffer);
+		if (readback.Fence) {
+			glDeleteSync(readback.Fence);
+			readback.Fence = nullptr;
+		}
 	}
 
-	// Update view matrix inside UBO
-	const auto view = camera.GetViewMatrix();
-	glBindBuffer(GL_UNIFORM_BUFFER, m_uboMatrices);
-	glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(view));
-}
+	glDeleteBuffers(1, &m_visibilityDrawBuffer);
+	m_geometryPool.Delete();
 
-/***********************************************************************************/
-void RenderSystem::Shutdown() const {
-	for (const auto& shader : m_shaderCache) {
-		shader.second.DeleteProgram();
+	if (m_offscreenOutput) {
+		glDeleteTextures(1, &m_offscreenOutput);
+		m_offscreenOutput = 0;
 	}
+
+	m_renderGraph.Delete();
+	m_gpuProfiler.Delete();
 }
 
 /***********************************************************************************/
-void RenderSystem::Render(const Camera& camera, RenderListIterator renderListBegin, RenderListIterator renderListEnd, const SceneBase& scene, const bool globalWireframe) {
+void RenderSystem::Render(const RenderSnapshot& snapshot) {
+	PROFILE_FUNCTION();
 	
+	m_gpuProfiler.BeginFrame();
+
+	updateView(snapshot);
+
 	setDefaultState();
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glBindBuffer(GL_UNIFORM_BUFFER, m_uboMatrices);
 
+	m_frameStats = FrameStats();
+	updateRenderScale();
+
+	// Build draw packets on the job system, the passes below only replay them
+	{
+		ScopedTimer timer(m_frameStats.RecordMs);
+		recordCommands(snapshot);
+	}
+
+	buildRenderGraph(snapshot);
+	m_renderGraph.Compile();
+	reportRenderGraph();
+
+	m_renderGraph.Execute(&m_gpuProfiler);
+}
+
+/***********************************************************************************/
+void RenderSystem::buildRenderGraph(const RenderSnapshot& snapshot) {
+	using Access = RenderGraph::Access;
+
 	// Get the shaders we need (static vars initialized during first render call).
 	static auto& pbrShader = m_shaderCache.at("PBRShader");
 	static auto& blurShader = m_shaderCache.at("GaussianBlurShader");
 	static auto& bloomBlendShader = m_shaderCache.at("BloomBlendShader");
 	static auto& skyboxShader = m_shaderCache.at("SkyboxShader");
-	
-	// Shadow mapping
-	renderShadowMap(scene, renderListBegin, renderListEnd);
 
-	// Regular rendering
-	m_hdrFBO.Bind();
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	auto& graph{ m_renderGraph };
+	graph.Reset();
+
+	// Targets are always output sized, scene passes render into the lower left corner at the render size
+	const auto width{ static_cast<GLsizei>(m_width) };
+	const auto height{ static_cast<GLsizei>(m_height) };
+	const auto renderWidth{ static_cast<GLsizei>(m_renderWidth) };
+	const auto renderHeight{ static_cast<GLsizei>(m_renderHeight) };
+	const auto shadowSize{ static_cast<GLsizei>(m_shadowMapResolution) };
+
+	// Persistent resources
+	m_targets.ShadowDepth = graph.ImportTexture("Shadow depth", m_shadowDepthTexture, { shadowSize, shadowSize, GL_DEPTH_COMPONENT32 });
+	m_targets.ShadowColor = graph.ImportTexture("Shadow color", m_shadowColorTexture, { shadowSize, shadowSize, GL_RG32F, GL_LINEAR });
+	m_targets.Lights = graph.ImportBuffer("Light lists", m_lightGridBuffer);
+	m_targets.Backbuffer = m_offscreenOutput ? graph.ImportTexture("Offscreen output", m_offscreenOutput, { width, height, GL_RGBA8 })
+											 : graph.ImportBackbuffer("Backbuffer", width, height);
+	graph.MarkOutput(m_targets.Backbuffer);
+
+	// Transient render targets, only allocated if a pass uses them
+	m_targets.Depth = graph.CreateTexture("Depth", { width, height, GL_DEPTH_COMPONENT24 });
+	m_targets.HDRColor = graph.CreateTexture("HDR color", { width, height, GL_RGBA16F, GL_LINEAR });
+	m_targets.BrightColor = graph.CreateTexture("Bright color", { width, height, GL_RGBA16F, GL_LINEAR });
+	// Same format as the bright color so the second one can take its place after the first blur
+	m_targets.Bloom[0] = graph.CreateTexture("Bloom ping", { width, height, GL_RGBA16F, GL_LINEAR });
+	m_targets.Bloom[1] = graph.CreateTexture("Bloom pong", { width, height, GL_RGBA16F, GL_LINEAR });
+	m_targets.GAlbedoMetallic = graph.CreateTexture("G-buffer albedo + metallic", { width, height, GL_RGBA8 });
+	m_targets.GNormalRoughness = graph.CreateTexture("G-buffer normal + roughness", { width, height, GL_RGB10_A2 });
+	m_targets.Visibility = graph.CreateTexture("Visibility", { width, height, GL_R32UI });
+	// Float so every (index + 1) / MaterialDepthSteps is stored exactly
+	m_targets.MaterialDepth = graph.CreateTexture("Material depth", { width, height, GL_DEPTH_COMPONENT32F });
+
+	graph.AddPass("Shadow map", [this, &snapshot](const RenderGraph&) {
+		renderShadowMap(snapshot);
+		// Everything up to the skybox counts as the scene
+		beginSceneTimer();
+	}).Write(m_targets.ShadowDepth, Access::Attachment).Write(m_targets.ShadowColor, Access::Attachment);
+
+	if (snapshot.DepthPrepass) {
+		graph.AddPass("Depth prepass", [this](const RenderGraph&) {
+			glClear(GL_DEPTH_BUFFER_BIT);
+			renderDepthPrepass();
+		}).Write(m_targets.Depth, Access::Attachment).Viewport(renderWidth, renderHeight);
+	}
 
-	// Bind pre-computed IBL data
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, m_skybox.GetIrradianceMap());
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, m_skybox.GetPrefilterMap());
-	glActiveTexture(GL_TEXTURE2);
-	glBindTexture(GL_TEXTURE_2D, m_skybox.GetBRDFLUT());
-	glActiveTexture(GL_TEXTURE7);
-	glBindTexture(GL_TEXTURE_2D, m_shadowColorTexture);
+	auto lightCulling{ graph.AddPass("Light culling", [this, &snapshot](const RenderGraph&) {
+		cullLights(snapshot);
+	}) };
+	lightCulling.Write(m_targets.Lights, Access::Storage);
+	// Tight tile bounds need the prepass depth
+	if (snapshot.DepthPrepass && snapshot.LightAssignmentMode == LightAssignment::Tiled) {
+		lightCulling.Read(m_targets.Depth, Access::Texture);
+	}
 
-	pbrShader.Bind();
-	pbrShader.SetUniform("camPos", camera.GetPosition()).SetUniformi("wireframe", globalWireframe).SetUniform("lightSpaceMatrix", m_lightSpaceMatrix);
-	pbrShader.SetUniform("directionalLight", scene.m_staticDirectionalLights[0].Direction).SetUniform("lightColor", scene.m_staticDirectionalLights[0].Color);
+	// With a prepass only the front-most surface passes, and depth is already final
+	const auto beginScene = [prepass = snapshot.DepthPrepass]() {
+		if (prepass) {
+			glClear(GL_COLOR_BUFFER_BIT);
+			glDepthFunc(GL_EQUAL);
+			glDepthMask(GL_FALSE);
+		}
+		else {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
+	};
 
-	renderModelsWithTextures(pbrShader, renderListBegin, renderListEnd);
+	switch (m_shadingPath) {
+	case ShadingPath::Deferred:
+		graph.AddPass("G-buffer", [this, beginScene](const RenderGraph&) {
+			beginScene();
+			renderGBuffer();
+		}).Write(m_targets.GAlbedoMetallic, Access::Attachment).Write(m_targets.GNormalRoughness, Access::Attachment)
+		  .Read(m_targets.Depth, Access::Attachment).Write(m_targets.Depth, Access::Attachment).Viewport(renderWidth, renderHeight);
+
+		graph.AddPass("Deferred lighting", [this, &snapshot](const RenderGraph&) {
+			bindEnvironmentTextures();
+			shadeDeferred(snapshot);
+		}).Read(m_targets.GAlbedoMetallic, Access::Texture).Read(m_targets.GNormalRoughness, Access::Texture).Read(m_targets.Depth, Access::Texture)
+		  .Read(m_targets.Lights, Access::Storage).Read(m_targets.ShadowColor, Access::Texture)
+		  .Write(m_targets.HDRColor, Access::Image).Write(m_targets.BrightColor, Access::Image);
+		break;
+	case ShadingPath::Visibility:
+		graph.AddPass("Visibility buffer", [this, prepass = snapshot.DepthPrepass](const RenderGraph&) {
+			// 0 marks pixels no triangle covers
+			const std::array<GLuint, 4> noTriangle{ 0, 0, 0, 0 };
+			glClearBufferuiv(GL_COLOR, 0, noTriangle.data());
+			if (prepass) {
+				glDepthFunc(GL_EQUAL);
+				glDepthMask(GL_FALSE);
+			}
+			else {
+				glClear(GL_DEPTH_BUFFER_BIT);
+			}
+			renderVisibilityBuffer();
+		}).Write(m_targets.Visibility, Access::Attachment).Read(m_targets.Depth, Access::Attachment).Write(m_targets.Depth, Access::Attachment)
+		  .Viewport(renderWidth, renderHeight);
+
+		graph.AddPass("Material depth", [this](const RenderGraph&) {
+			renderMaterialDepth();
+		}).Read(m_targets.Visibility, Access::Texture).Write(m_targets.MaterialDepth, Access::Attachment).Viewport(renderWidth, renderHeight);
+
+		graph.AddPass("Visibility shading", [this, &snapshot](const RenderGraph&) {
+			glClear(GL_COLOR_BUFFER_BIT);
+			bindEnvironmentTextures();
+			shadeVisibilityBuffer(snapshot);
+		}).Write(m_targets.HDRColor, Access::Attachment).Write(m_targets.BrightColor, Access::Attachment)
+		  .Read(m_targets.MaterialDepth, Access::Attachment).Read(m_targets.Visibility, Access::Texture)
+		  .Read(m_targets.Lights, Access::Storage).Read(m_targets.ShadowColor, Access::Texture).Viewport(renderWidth, renderHeight);
+		break;
+	case ShadingPath::Forward:
+		graph.AddPass("Forward PBR", [this, &snapshot, beginScene](const RenderGraph&) {
+			beginScene();
+			bindEnvironmentTextures();
+
+			pbrShader.Bind();
+			pbrShader.SetUniform("camPos", snapshot.CameraPosition).SetUniformi("wireframe", snapshot.Wireframe).SetUniform("lightSpaceMatrix", m_lightSpaceMatrix);
+			pbrShader.SetUniform("directionalLight", snapshot.DirectionalLights[0].Direction).SetUniform("lightColor", snapshot.DirectionalLights[0].Color);
+			setLightGridUniforms(pbrShader, snapshot);
+
+			const auto fragmentQuery{ beginFragmentQuery() };
+			submitCommands(pbrShader, true);
+			endFragmentQuery(fragmentQuery);
+		}).Write(m_targets.HDRColor, Access::Attachment).Write(m_targets.BrightColor, Access::Attachment)
+		  .Read(m_targets.Depth, Access::Attachment).Write(m_targets.Depth, Access::Attachment)
+		  .Read(m_targets.Lights, Access::Storage).Read(m_targets.ShadowColor, Access::Texture).Viewport(renderWidth, renderHeight);
+		break;
+	}
 
-	// Draw skybox
-	skyboxShader.Bind();
-	glActiveTexture(GL_TEXTURE0);
-	m_skybox.Draw();
+	graph.AddPass("Skybox", [this](const RenderGraph&) {
+		// Skybox relies on the default depth state
+		glDepthFunc(GL_LEQUAL);
+		glDepthMask(GL_TRUE);
 
-	// Do bloom
-	blurShader.Bind();
-	bool horizontal = true, first_iteration = true;
-	static constexpr unsigned int amount = 10;
-	for (unsigned int i = 0; i < amount; ++i) {
-		m_pingPongFBOs[horizontal].Bind();
+		endSceneTimer();
+
+		skyboxShader.Bind();
+		glActiveTexture(GL_TEXTURE0);
+		m_skybox.Draw();
+	}).Write(m_targets.HDRColor, Access::Attachment).Write(m_targets.BrightColor, Access::Attachment)
+	  .Read(m_targets.Depth, Access::Attachment).Write(m_targets.Depth, Access::Attachment).Viewport(renderWidth, renderHeight);
+
+	// Part of the targets holding this frame's image, in texture coordinates
+	const glm::vec2 uvScale{ static_cast<float>(renderWidth) / width, static_cast<float>(renderHeight) / height };
+
+	// Do bloom at the render size, blurring back and forth between the two targets.
+	// One name per iteration so the profiler times them separately.
+	static constexpr std::array<std::string_view, BloomBlurPasses> blurPassNames{
+		"Bloom blur 1", "Bloom blur 2", "Bloom blur 3", "Bloom blur 4", "Bloom blur 5",
+		"Bloom blur 6", "Bloom blur 7", "Bloom blur 8", "Bloom blur 9", "Bloom blur 10"
+	};
+	auto bloomSource{ m_targets.BrightColor };
+	for (std::size_t i = 0; i < BloomBlurPasses; ++i) {
+		const auto horizontal{ i % 2 == 0 };
+		const auto source{ bloomSource };
+		const auto target{ m_targets.Bloom[horizontal] };
+
+		graph.AddPass(blurPassNames[i], [this, source, horizontal, uvScale](const RenderGraph& resources) {
+			blurShader.Bind();
+			blurShader.SetUniformi("horizontal", horizontal).SetUniform("uvScale", uvScale);
 
-		blurShader.SetUniformi("horizontal", horizontal);
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, resources.GetTexture(source));
 
-		// Bind texture of other framebuffer (or scene if first iteration)
-		glBindTexture(GL_TEXTURE_2D, first_iteration ? m_brightnessThresholdColorBuffer : m_pingPongColorBuffers[!horizontal]);
+			renderQuad();
+		}).Read(source, Access::Texture).Write(target, Access::Attachment).Viewport(renderWidth, renderHeight);
 
+		bloomSource = target;
+	}
+
+	// Blend bloom with original image and apply other post-processing effects.
+	// Renders at the output size, upscaling the scene with bilinear filtering.
+	graph.AddPass("Bloom blend", [this, bloom = bloomSource, uvScale](const RenderGraph& resources) {
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		bloomBlendShader.Bind();
+		bloomBlendShader.SetUniform("uvScale", uvScale);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, resources.GetTexture(m_targets.HDRColor));
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, resources.GetTexture(bloom));
 		renderQuad();
-		horizontal = !horizontal;
+	}).Read(m_targets.HDRColor, Access::Texture).Read(bloomSource, Access::Texture).Write(m_targets.Backbuffer, Access::Attachment);
+}
 
-		if (first_iteration) {
-			first_iteration = false;
-		}
+/***********************************************************************************/
+RenderSystem::MemoryStats RenderSystem::GetMemoryStats() const {
+	MemoryStats stats;
+	stats.RenderTargetBytes = m_renderGraph.GetStats().AllocatedBytes;
+	// Depth plus the mipmapped RG32F VSM target
+	const auto shadowTexels{ static_cast<std::size_t>(m_shadowMapResolution) * m_shadowMapResolution };
+	stats.ShadowMapBytes = shadowTexels * RenderGraph::GetFormatSize(GL_DEPTH_COMPONENT32) + shadowTexels * RenderGraph::GetFormatSize(GL_RG32F) * 4 / 3;
+	stats.GeometryPoolBytes = m_geometryPool.GetCapacity();
+	stats.OutputBytes = m_offscreenOutput ? m_width * m_height * RenderGraph::GetFormatSize(GL_RGBA8) : 0;
+
+	return stats;
+}
+
+/***********************************************************************************/
+bool RenderSystem::ReadOutput(std::vector<std::uint8_t>& pixels, int& width, int& height) const {
+	if (!m_offscreenOutput) {
+		return false;
 	}
 
-	// Blend bloom with original image and apply other post-processing effects
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	bloomBlendShader.Bind();
+	width = static_cast<int>(m_width);
+	height = static_cast<int>(m_height);
+	const auto rowBytes{ static_cast<std::size_t>(width) * 4 };
+	pixels.resize(rowBytes * height);
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glBindTexture(GL_TEXTURE_2D, m_offscreenOutput);
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+	// GL rows start at the bottom
+	std::vector<std::uint8_t> row(rowBytes);
+	for (int y = 0; y < height / 2; ++y) {
+		auto* top{ pixels.data() + y * rowBytes };
+		auto* bottom{ pixels.data() + (height - 1 - y) * rowBytes };
+		std::copy_n(top, rowBytes, row.data());
+		std::copy_n(bottom, rowBytes, top);
+		std::copy_n(row.data(), rowBytes, bottom);
+	}
+
+	return true;
+}
+
+/***********************************************************************************/
+void RenderSystem::reportRenderGraph() {
+	const auto& stats{ m_renderGraph.GetStats() };
+	if (stats.AllocatedBytes == m_reportedTargetBytes) {
+		return;
+	}
+	m_reportedTargetBytes = stats.AllocatedBytes;
+
+	const auto toMB = [](const std::size_t bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+	std::cout << "Render graph: " << stats.NumPasses << " passes (" << stats.NumCulledPasses << " culled), " << stats.NumBarriers << " barriers\n";
+	std::cout << "Render targets: " << toMB(stats.AllocatedBytes) << " MB, " << toMB(stats.TransientBytes) << " MB without aliasing, "
+		<< toMB(FixedTargetBytesPerPixel * m_width * m_height) << " MB with dedicated targets for every path\n";
+}
+
+/***********************************************************************************/
+void RenderSystem::bindEnvironmentTextures() const {
+	// Bind pre-computed IBL data
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, m_hdrColorBuffer);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_skybox.GetIrradianceMap());
 	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, m_pingPongColorBuffers[!horizontal]);
-	renderQuad();
-	
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_skybox.GetPrefilterMap());
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, m_skybox.GetBRDFLUT());
+	glActiveTexture(GL_TEXTURE7);
+	glBindTexture(GL_TEXTURE_2D, m_shadowColorTexture);
 }
 
 /***********************************************************************************/
-// TODO: This needs to be gutted and put elsewhere
-void RenderSystem::UpdateView(const Camera& camera) {
-	m_projMatrix = camera.GetProjMatrix(m_width, m_height);
+void RenderSystem::updateView(const RenderSnapshot& snapshot) {
+
+	// Window size changed
+	if (snapshot.Width != m_width || snapshot.Height != m_height) {
+		m_width = snapshot.Width;
+		m_height = snapshot.Height;
+		glViewport(0, 0, m_width, m_height);
+		if (m_offscreenOutput) {
+			setupOffscreenOutput();
+		}
+	}
+
+	m_projMatrix = snapshot.ProjMatrix;
+
+	// Projection and view matrix share the UBO
+	const std::array<glm::mat4, 2> matrices{ snapshot.ProjMatrix, snapshot.ViewMatrix };
 	glBindBuffer(GL_UNIFORM_BUFFER, m_uboMatrices);
-	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(m_projMatrix));
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(matrices), matrices.data());
+}
+
+/***********************************************************************************/
+void RenderSystem::updateRenderScale() {
+	// Only a new measurement moves the scale, the timer result isn't available every frame
+	if (m_dynamicResolutionEnabled && m_newSceneGpuSample) {
+		m_renderScale = m_dynamicResolution.Update(m_sceneGpuMs, m_sceneGpuScale);
+		m_newSceneGpuSample = false;
+	}
+
+	m_renderWidth = DynamicResolution::ScaleSize(static_cast<std::uint32_t>(m_width), m_renderScale);
+	m_renderHeight = DynamicResolution::ScaleSize(static_cast<std::uint32_t>(m_height), m_renderScale);
+	m_frameStats.RenderScale = m_renderScale;
 }
 
 /***********************************************************************************/
@@ -217,58 +533,129 @@ void RenderSystem::setDefaultState() {
 }
 
 /***********************************************************************************/
-void RenderSystem::renderModelsWithTextures(GLShaderProgram& shader, RenderListIterator renderListBegin, RenderListIterator renderListEnd) const {
-	glBindSampler(m_samplerPBRTextures, 3);
-	glBindSampler(m_samplerPBRTextures, 4);
-	glBindSampler(m_samplerPBRTextures, 5);
-	glBindSampler(m_samplerPBRTextures, 6);
-	// glBindSampler(m_samplerPBRTextures, 7);
-
-	auto begin{ renderListBegin };
-
-	while (begin != renderListEnd) {
-		shader.SetUniform("modelMatrix", (*begin)->GetModelMatrix());
-		
-		const auto& meshes{ (*begin)->GetMeshes() };
-		for (const auto& mesh : meshes) {
-			glActiveTexture(GL_TEXTURE3);
-			glBindTexture(GL_TEXTURE_2D, mesh.Material->GetParameterTexture(PBRMaterial::ALBEDO));
-			glActiveTexture(GL_TEXTURE4);
-			glBindTexture(GL_TEXTURE_2D, mesh.Material->GetParameterTexture(PBRMaterial::NORMAL));
-			glActiveTexture(GL_TEXTURE5);
-			glBindTexture(GL_TEXTURE_2D, mesh.Material->GetParameterTexture(PBRMaterial::METALLIC));
-			glActiveTexture(GL_TEXTURE6);
-			glBindTexture(GL_TEXTURE_2D, mesh.Material->GetParameterTexture(PBRMaterial::ROUGHNESS));
-			
-			//glActiveTexture(GL_TEXTURE7);
-			//glBindTexture(GL_TEXTURE_2D, mesh.Material.AOMap);
-
-			mesh.VAO.Bind();
-			glDrawElements(GL_TRIANGLES, mesh.IndexCount, GL_UNSIGNED_INT, nullptr);
-			glBindTexture(GL_TEXTURE_2D, 0);
+void RenderSystem::recordCommands(const RenderSnapshot& snapshot) {
+	PROFILE_FUNCTION();
+	
+	// Flatten to one item per mesh so a single large model still spreads across jobs
+	m_drawItems.clear();
+	for (const auto& instance : snapshot.Instances) {
+		for (const auto& mesh : instance.Model->GetMeshes()) {
+			m_drawItems.push_back({ &instance, &mesh });
 		}
-
-		++begin;
 	}
 
-	glBindSampler(m_samplerPBRTextures, 0);
+	const auto numItems{ m_drawItems.size() };
+	m_commands.Resize(numItems);
+
+	const auto camPos{ snapshot.CameraPosition };
+
+	// Each packet goes in its item's slot, so the result doesn't depend on how the work is chunked
+	JobSystem::GetInstance().ParallelFor(numItems, CommandChunkSize, [&](const auto begin, const auto end) {
+		for (auto i = begin; i < end; ++i) {
+			const auto& item{ m_drawItems[i] };
+			const auto& mesh{ *item.Submesh };
+
+			DrawCommand command;
+			command.ModelMatrix = item.Parent->Transform;
+			command.VertexArray = mesh.VAO.GetHandle();
+			command.IndexCount = static_cast<std::uint32_t>(mesh.IndexCount);
+			command.PositionScale = mesh.PositionRange.Scale;
+			command.PositionOffset = mesh.PositionRange.Offset;
+			command.PackedVertices = mesh.VertexFormat == VertexCompressor::Format::Packed;
+			command.ShortIndices = mesh.IndexType == GL_UNSIGNED_SHORT;
+
+			if (mesh.Material) {
+				command.Textures[DrawCommand::ALBEDO] = mesh.Material->GetParameterTexture(PBRMaterial::ALBEDO);
+				command.Textures[DrawCommand::NORMAL] = mesh.Material->GetParameterTexture(PBRMaterial::NORMAL);
+				command.Textures[DrawCommand::METALLIC] = mesh.Material->GetParameterTexture(PBRMaterial::METALLIC);
+				command.Textures[DrawCommand::ROUGHNESS] = mesh.Material->GetParameterTexture(PBRMaterial::ROUGHNESS);
+			}
+
+			const auto center{ glm::vec3(command.ModelMatrix * glm::vec4(item.Parent->Model->GetBoundingBox().getCenter(), 1.0f)) };
+			command.SortKey = CommandList::MakeSortKey(command.Textures[DrawCommand::ALBEDO], command.VertexArray, glm::distance(camPos, center));
+
+			m_commands[i] = command;
+		}
+	});
+
+	// One stable sort over the merged list: state-sorted and identical from run to run
+	m_commands.Sort();
+
+	m_frameStats.NumCommandLists = (numItems + CommandChunkSize - 1) / CommandChunkSize;
 }
 
 /***********************************************************************************/
-void RenderSystem::renderModelsNoTextures(GLShaderProgram& shader, RenderListIterator renderListBegin, RenderListIterator renderListEnd) const {
-	auto begin{ renderListBegin };
+void RenderSystem::submitCommands(GLShaderProgram& shader, const bool bindTextures, const bool writeDrawIDs) {
+	ScopedTimer timer(m_frameStats.SubmitMs);
+
+	if (bindTextures) {
+		for (GLuint unit = 3; unit < 3 + DrawCommand::NUM_TEXTURE_SLOTS; ++unit) {
+			glBindSampler(unit, m_samplerPBRTextures);
+		}
+	}
+
+	// Skip redundant state changes between consecutive packets
+	std::array<std::uint32_t, DrawCommand::NUM_TEXTURE_SLOTS> boundTextures{};
+	std::uint32_t boundVertexArray{ 0 };
+	const glm::mat4* boundModelMatrix{ nullptr };
+	const DrawCommand* boundVertexFormat{ nullptr };
+	GLuint drawIndex{ 0 };
+
+	for (const auto& command : m_commands) {
+		// buildVisibilityDraws() walked the same order and may have stopped early
+		if (writeDrawIDs && drawIndex == m_visibilityDraws.size()) {
+			continue;
+		}
+
+		if (!boundModelMatrix || *boundModelMatrix != command.ModelMatrix) {
+			shader.SetUniform("modelMatrix", command.ModelMatrix);
+			boundModelMatrix = &command.ModelMatrix;
+		}
+
+		if (bindTextures) {
+			for (std::size_t slot = 0; slot < DrawCommand::NUM_TEXTURE_SLOTS; ++slot) {
+				if (boundTextures[slot] != command.Textures[slot]) {
+					// PBR textures live in units 3-6
+					glActiveTexture(GL_TEXTURE3 + static_cast<GLenum>(slot));
+					glBindTexture(GL_TEXTURE_2D, command.Textures[slot]);
+					boundTextures[slot] = command.Textures[slot];
+				}
+			}
+		}
 
-	while(begin != renderListEnd) {
-		shader.SetUniform("modelMatrix", (*begin)->GetModelMatrix());
+		// Decodes packed positions, float meshes get the identity (see vertexformat.glsl)
+		if (!boundVertexFormat || boundVertexFormat->PackedVertices != command.PackedVertices ||
+			boundVertexFormat->PositionScale != command.PositionScale || boundVertexFormat->PositionOffset != command.PositionOffset) {
+			shader.SetUniform("positionScale", glm::vec4(command.PositionScale, command.PackedVertices ? 1.0f : 0.0f));
+			shader.SetUniform("positionOffset", command.PositionOffset);
+			boundVertexFormat = &command;
+		}
 
-		const auto& meshes{ (*begin)->GetMeshes() };
-		for (const auto& mesh : meshes) {
-			mesh.VAO.Bind();
-			glDrawElements(GL_TRIANGLES, mesh.IndexCount, GL_UNSIGNED_INT, nullptr);
-			glBindTexture(GL_TEXTURE_2D, 0);
+		if (boundVertexArray != command.VertexArray) {
+			glBindVertexArray(command.VertexArray);
+			boundVertexArray = command.VertexArray;
 		}
 
-		++begin;
+		const auto indexType{ command.ShortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT };
+		if (writeDrawIDs) {
+			// Triangle IDs only have TriangleBits, so each part of a large mesh gets its own draw ID
+			const auto indexSize{ command.ShortIndices ? sizeof(std::uint16_t) : sizeof(GLuint) };
+			for (std::uint32_t first = 0; first < command.IndexCount && drawIndex < m_visibilityDraws.size(); first += MaxVisibilityIndices) {
+				shader.SetUniformui("drawIndex", drawIndex++);
+				glDrawElements(GL_TRIANGLES, std::min(command.IndexCount - first, MaxVisibilityIndices), indexType, reinterpret_cast<const void*>(first * indexSize));
+				++m_frameStats.NumDrawCalls;
+			}
+		}
+		else {
+			glDrawElements(GL_TRIANGLES, command.IndexCount, indexType, nullptr);
+			++m_frameStats.NumDrawCalls;
+		}
+	}
+
+	if (bindTextures) {
+		for (GLuint unit = 3; unit < 3 + DrawCommand::NUM_TEXTURE_SLOTS; ++unit) {
+			glBindSampler(unit, 0);
+		}
 	}
 }
 
@@ -279,13 +666,541 @@ void RenderSystem::renderQuad() const {
 }
 
 /***********************************************************************************/
-void RenderSystem::renderShadowMap(const SceneBase& scene, RenderListIterator renderListBegin, RenderListIterator renderListEnd) {
+void RenderSystem::renderDepthPrepass() {
+	static auto& depthPassShader = m_shaderCache.at("DepthPassShader");
+	depthPassShader.Bind();
+
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	submitCommands(depthPassShader, false);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+/***********************************************************************************/
+void RenderSystem::renderGBuffer() {
+	static auto& gBufferShader = m_shaderCache.at("GBufferShader");
+	gBufferShader.Bind();
+
+	const auto fragmentQuery{ beginFragmentQuery() };
+	submitCommands(gBufferShader, true);
+	endFragmentQuery(fragmentQuery);
+
+	// Every G-buffer fragment writes both targets, lighting reads them and depth once per pixel
+	const auto pixels{ static_cast<double>(m_renderWidth * m_renderHeight) };
+	const auto fragments{ m_frameStats.ShadedFragments > 0 ? static_cast<double>(m_frameStats.ShadedFragments) : pixels };
+	m_frameStats.GBufferMB = (fragments * GBufferBytesPerPixel + pixels * (GBufferBytesPerPixel + DepthBytesPerPixel)) / (1024.0 * 1024.0);
+}
+
+/***********************************************************************************/
+void RenderSystem::shadeDeferred(const RenderSnapshot& snapshot) {
+	static auto& deferredLightingShader = m_shaderCache.at("DeferredLightingShader");
+
+	// Lighting doesn't touch depth, the skybox afterwards needs the default state
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(GL_TRUE);
+
+	glActiveTexture(GL_TEXTURE3);
+	glBindTexture(GL_TEXTURE_2D, m_renderGraph.GetTexture(m_targets.GAlbedoMetallic));
+	glActiveTexture(GL_TEXTURE4);
+	glBindTexture(GL_TEXTURE_2D, m_renderGraph.GetTexture(m_targets.GNormalRoughness));
+	glActiveTexture(GL_TEXTURE5);
+	glBindTexture(GL_TEXTURE_2D, m_renderGraph.GetTexture(m_targets.Depth));
+
+	glBindImageTexture(0, m_renderGraph.GetTexture(m_targets.HDRColor), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	glBindImageTexture(1, m_renderGraph.GetTexture(m_targets.BrightColor), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+	deferredLightingShader.Bind();
+	deferredLightingShader.SetUniform("camPos", snapshot.CameraPosition).SetUniform("lightSpaceMatrix", m_lightSpaceMatrix);
+	deferredLightingShader.SetUniform("directionalLight", snapshot.DirectionalLights[0].Direction).SetUniform("lightColor", snapshot.DirectionalLights[0].Color);
+	deferredLightingShader.SetUniform("inverseViewProjection", glm::inverse(snapshot.ProjMatrix * snapshot.ViewMatrix));
+	deferredLightingShader.SetUniform("screenSize", glm::ivec2(m_renderWidth, m_renderHeight));
+	setLightGridUniforms(deferredLightingShader, snapshot);
+
+	// Same tiles as light culling. The render graph adds the barrier for the skybox and bloom.
+	glDispatchCompute(m_numTilesX, m_numTilesY, 1);
+
+	// Depth is still attached to the framebuffer we are about to draw into
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/***********************************************************************************/
+void RenderSystem::renderVisibilityBuffer() {
+	static auto& visibilityShader = m_shaderCache.at("VisibilityShader");
+
+	buildVisibilityDraws();
+
+	// IDs only, no textures or attributes beyond position
+	visibilityShader.Bind();
+	submitCommands(visibilityShader, false, true);
+}
+
+/***********************************************************************************/
+void RenderSystem::renderMaterialDepth() {
+	static auto& materialDepthShader = m_shaderCache.at("MaterialDepthShader");
+
+	// Done with the prepass' GL_EQUAL
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(GL_TRUE);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	glActiveTexture(GL_TEXTURE9);
+	glBindTexture(GL_TEXTURE_2D, m_renderGraph.GetTexture(m_targets.Visibility));
+
+	// Write each pixel's material as depth, so a material's pass only runs on its own pixels
+	glDepthFunc(GL_ALWAYS);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	materialDepthShader.Bind();
+	renderQuad();
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glDepthFunc(GL_LEQUAL);
+}
+
+/***********************************************************************************/
+void RenderSystem::shadeVisibilityBuffer(const RenderSnapshot& snapshot) {
+	static auto& visibilityShadeShader = m_shaderCache.at("VisibilityShadeShader");
+
+	// One full-screen pass per material, early depth testing rejects every other pixel
+	glDepthFunc(GL_EQUAL);
+	glDepthMask(GL_FALSE);
+
+	glActiveTexture(GL_TEXTURE9);
+	glBindTexture(GL_TEXTURE_2D, m_renderGraph.GetTexture(m_targets.Visibility));
+
+	visibilityShadeShader.Bind();
+	visibilityShadeShader.SetUniform("camPos", snapshot.CameraPosition).SetUniform("lightSpaceMatrix", m_lightSpaceMatrix);
+	visibilityShadeShader.SetUniform("directionalLight", snapshot.DirectionalLights[0].Direction).SetUniform("lightColor", snapshot.DirectionalLights[0].Color);
+	visibilityShadeShader.SetUniform("screenSize", glm::vec2(m_renderWidth, m_renderHeight));
+	setLightGridUniforms(visibilityShadeShader, snapshot);
+
+	for (GLuint unit = 3; unit < 3 + DrawCommand::NUM_TEXTURE_SLOTS; ++unit) {
+		glBindSampler(unit, m_samplerPBRTextures);
+	}
+
+	const auto fragmentQuery{ beginFragmentQuery() };
+	for (std::size_t material = 0; material < m_visibilityMaterials.size(); ++material) {
+		for (std::size_t slot = 0; slot < DrawCommand::NUM_TEXTURE_SLOTS; ++slot) {
+			glActiveTexture(GL_TEXTURE3 + static_cast<GLenum>(slot));
+			glBindTexture(GL_TEXTURE_2D, m_visibilityMaterials[material][slot]);
+		}
+
+		// NDC depth of window depth (index + 1) / MaterialDepthSteps, exact in floating point
+		visibilityShadeShader.SetUniformf("materialDepth", 2.0f * static_cast<float>(material + 1) / MaterialDepthSteps - 1.0f);
+		renderQuad();
+	}
+	endFragmentQuery(fragmentQuery);
+
+	for (GLuint unit = 3; unit < 3 + DrawCommand::NUM_TEXTURE_SLOTS; ++unit) {
+		glBindSampler(unit, 0);
+	}
+
+	glActiveTexture(GL_TEXTURE9);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(GL_TRUE);
+}
+
+/***********************************************************************************/
+void RenderSystem::buildVisibilityDraws() {
+	// Only the first frame a mesh is seen in copies anything
+	for (const auto& item : m_drawItems) {
+		m_geometryPool.Add(item.Submesh->VAO, item.Submesh->IndexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(GLuint));
+	}
+	// Adding may have reallocated the pool
+	m_geometryPool.Bind(8, 9);
+
+	m_visibilityDraws.clear();
+	m_visibilityMaterialIndices.clear();
+	m_visibilityMaterials.clear();
+
+	// Report each limit once, not every frame
+	static bool reportedMaterialOverflow{ false }, reportedDrawOverflow{ false }, reportedSplit{ false };
+
+	// Same order as submitCommands(), so a draw's index in this list is its ID
+	for (const auto& command : m_commands) {
+		if (m_visibilityDraws.size() == MaxVisibilityDraws) {
+			break;
+		}
+
+		auto materialIndex{ static_cast<GLuint>(m_visibilityMaterials.size()) };
+		const auto material{ m_visibilityMaterialIndices.find(command.Textures) };
+		if (material != m_visibilityMaterialIndices.end()) {
+			materialIndex = material->second;
+		}
+		// Depth 1.0 is the cleared value, so one step is reserved
+		else if (materialIndex < MaterialDepthSteps - 1) {
+			m_visibilityMaterialIndices.emplace(command.Textures, materialIndex);
+			m_visibilityMaterials.push_back(command.Textures);
+		}
+		else {
+			// Out of material depths, wrong textures are better than a hole
+			--materialIndex;
+			if (!reportedMaterialOverflow) {
+				std::cerr << "Visibility buffer: more than " << MaterialDepthSteps - 1 << " materials, the rest share the last one.\n";
+				reportedMaterialOverflow = true;
+			}
+		}
+
+		const auto& entry{ m_geometryPool.Get(command.VertexArray) };
+		const auto flags{ (command.PackedVertices ? VisibilityPackedVertices : 0u) | (command.ShortIndices ? VisibilityShortIndices : 0u) };
+
+		if (command.IndexCount > MaxVisibilityIndices && !reportedSplit) {
+			std::cerr << "Visibility buffer: meshes over " << MaxVisibilityTriangles << " triangles are drawn in parts.\n";
+			reportedSplit = true;
+		}
+
+		// One draw per part, split the same way as submitCommands()
+		for (std::uint32_t first = 0; first < command.IndexCount && m_visibilityDraws.size() < MaxVisibilityDraws; first += MaxVisibilityIndices) {
+			m_visibilityDraws.push_back({ command.ModelMatrix, glm::vec4(command.PositionScale, 0.0f), glm::vec4(command.PositionOffset, 0.0f),
+				entry.VertexOffset, entry.FirstIndex + first, materialIndex, flags });
+		}
+	}
+
+	if (m_visibilityDraws.size() == MaxVisibilityDraws && !reportedDrawOverflow) {
+		std::cerr << "Visibility buffer: more than " << MaxVisibilityDraws << " draws, the rest are skipped.\n";
+		reportedDrawOverflow = true;
+	}
+
+	const auto drawBytes{ static_cast<GLsizeiptr>(m_visibilityDraws.size() * sizeof(VisibilityDraw)) };
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_visibilityDrawBuffer);
+	if (drawBytes > m_visibilityDrawBufferSize) {
+		m_visibilityDrawBufferSize = drawBytes;
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_visibilityDrawBufferSize, m_visibilityDraws.data(), GL_DYNAMIC_DRAW);
+	}
+	else if (drawBytes > 0) {
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, drawBytes, m_visibilityDraws.data());
+	}
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, m_visibilityDrawBuffer);
+}
+
+/***********************************************************************************/
+void RenderSystem::setLightGridUniforms(GLShaderProgram& shader, const RenderSnapshot& snapshot) {
+	const auto clustered{ snapshot.LightAssignmentMode != LightAssignment::Tiled };
+	shader.SetUniformui("numTilesX", m_numTilesX).SetUniformui("lightGridMode", clustered ? 1 : 0).SetUniform("clusterDims", m_lightClusters.GetDims());
+	shader.SetUniformf("sliceScale", m_lightClusters.GetSliceScale()).SetUniformf("sliceBias", m_lightClusters.GetSliceBias());
+}
+
+/***********************************************************************************/
+GLuint RenderSystem::beginFragmentQuery() {
+	const auto fragmentQuery{ m_fragmentQueries[m_queryFrame % m_fragmentQueries.size()] };
+	if (fragmentQuery) {
+		// The query issued two frames ago in this slot should be done by now, don't wait if it isn't
+		if (m_queryFrame >= m_fragmentQueries.size()) {
+			GLuint available{ GL_FALSE };
+			glGetQueryObjectuiv(fragmentQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available) {
+				GLuint64 fragments{ 0 };
+				glGetQueryObjectui64v(fragmentQuery, GL_QUERY_RESULT, &fragments);
+				m_shadedFragments = fragments;
+			}
+		}
+		glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB, fragmentQuery);
+	}
+
+	return fragmentQuery;
+}
+
+/***********************************************************************************/
+void RenderSystem::endFragmentQuery(const GLuint query) {
+	if (query) {
+		glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB);
+	}
+	++m_queryFrame;
+	m_frameStats.ShadedFragments = m_shadedFragments;
+}
+
+/***********************************************************************************/
+void RenderSystem::beginSceneTimer() {
+	const auto slot{ m_sceneTimerFrame % m_sceneTimerQueries.size() };
+	const auto query{ m_sceneTimerQueries[slot] };
+	// Same two frame delay as the fragment query
+	if (m_sceneTimerFrame >= m_sceneTimerQueries.size()) {
+		GLuint available{ GL_FALSE };
+		glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			GLuint64 nanoseconds{ 0 };
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+			m_sceneGpuMs = static_cast<double>(nanoseconds) / 1e6;
+			m_sceneGpuScale = m_sceneTimerScales[slot];
+			m_newSceneGpuSample = true;
+		}
+	}
+	m_sceneTimerScales[slot] = m_renderScale;
+	glBeginQuery(GL_TIME_ELAPSED, query);
+}
+
+/***********************************************************************************/
+void RenderSystem::endSceneTimer() {
+	glEndQuery(GL_TIME_ELAPSED);
+	++m_sceneTimerFrame;
+	m_frameStats.SceneGpuMs = m_sceneGpuMs;
+}
+
+/***********************************************************************************/
+void RenderSystem::cullLights(const RenderSnapshot& snapshot) {
+	const auto clustered{ snapshot.LightAssignmentMode != LightAssignment::Tiled || snapshot.VerifyLightClusters };
+	uploadLights(snapshot, clustered);
+
+	// Cluster bounds only depend on the screen size and projection
+	auto uploadBounds{ m_lightClusters.Update(static_cast<std::uint32_t>(m_renderWidth), static_cast<std::uint32_t>(m_renderHeight), snapshot.ProjMatrix) };
+
+	m_numTilesX = (static_cast<GLuint>(m_renderWidth) + LightTileSize - 1) / LightTileSize;
+	m_numTilesY = (static_cast<GLuint>(m_renderHeight) + LightTileSize - 1) / LightTileSize;
+	if (m_lightGridCapacity < std::max(m_numTilesX * m_numTilesY, static_cast<GLuint>(m_lightClusters.GetNumClusters()))) {
+		resizeLightGrid();
+		uploadBounds = true;
+	}
+
+	// Render scale changes only rewrite the bounds, the buffers are sized in resizeLightGrid()
+	if (uploadBounds) {
+		const auto& bounds{ m_lightClusters.GetBounds() };
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_clusterBoundsBuffer);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bounds.size() * sizeof(LightClusterGrid::Bounds), bounds.data());
+	}
+
+	// Grow the index list if a frame that has finished by now ran out of space. The counter is
+	// copied into alternating slots, this one was written two frames ago. If the GPU isn't done
+	// with it yet, it is left alone until a later frame instead of waiting.
+	auto& readback{ m_lightCounterReadbacks[snapshot.FrameIndex % m_lightCounterReadbacks.size()] };
+	if (readback.Fence) {
+		const auto status{ glClientWaitSync(readback.Fence, 0, 0) };
+		if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+			glDeleteSync(readback.Fence);
+			readback.Fence = nullptr;
+
+			GLuint requiredIndices{ 0 };
+			glBindBuffer(GL_COPY_READ_BUFFER, readback.Buffer);
+			glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(GLuint), &requiredIndices);
+			growLightIndexList(requiredIndices);
+		}
+	}
+
+	if (snapshot.VerifyLightClusters) {
+		verifyLightClusters();
+	}
+
+	switch (snapshot.LightAssignmentMode) {
+	case LightAssignment::Tiled:
+		cullLightsTiled(snapshot);
+		break;
+	case LightAssignment::ClusteredGPU:
+		assignLightClustersGPU();
+		break;
+	case LightAssignment::ClusteredCPU:
+		assignLightClustersCPU();
+		break;
+	}
+
+	// The copy reads the counter the compute shaders wrote. Passes reading the light lists
+	// get their barrier from the render graph.
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	// A slot still in flight keeps its older copy
+	if (!readback.Fence) {
+		glBindBuffer(GL_COPY_READ_BUFFER, m_lightIndexCounter);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, readback.Buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(GLuint));
+		readback.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+}
+
+/***********************************************************************************/
+void RenderSystem::uploadLights(const RenderSnapshot& snapshot, const bool clustered) {
+	// Pack point and spot lights into one array
+	m_gpuLights.clear();
+	for (const auto& light : snapshot.PointLights) {
+		m_gpuLights.push_back({ glm::vec4(light.Color, 0.0f), glm::vec4(light.Position, light.Radius), glm::vec4(0.0f), glm::vec4(0.0f) });
+	}
+	for (const auto& light : snapshot.SpotLights) {
+		m_gpuLights.push_back({ glm::vec4(light.Color, 1.0f), glm::vec4(light.Position, light.Radius), glm::vec4(light.Direction, light.Cutoff), glm::vec4(light.OuterCutoff, 0.0f, 0.0f, 0.0f) });
+	}
+
+	const auto lightBytes{ static_cast<GLsizeiptr>(m_gpuLights.size() * sizeof(GPULight)) };
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightBuffer);
+	if (lightBytes > m_lightBufferSize) {
+		m_lightBufferSize = lightBytes;
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_lightBufferSize, m_gpuLights.data(), GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_lightBuffer);
+	}
+	else if (lightBytes > 0) {
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, lightBytes, m_gpuLights.data());
+	}
+
+	if (!clustered) {
+		return;
+	}
+
+	// View-space bounding spheres, in the same order as m_gpuLights
+	m_lightSpheres.clear();
+	for (const auto& light : snapshot.PointLights) {
+		m_lightSpheres.emplace_back(glm::vec3(snapshot.ViewMatrix * glm::vec4(light.Position, 1.0f)), light.Radius);
+	}
+	for (const auto& light : snapshot.SpotLights) {
+		// Tightest sphere around the lit cone section (Wronski, "Cull that cone")
+		const auto cosAngle{ light.OuterCutoff };
+		const auto direction{ glm::normalize(light.Direction) };
+		auto center{ light.Position };
+		auto radius{ light.Radius };
+		if (cosAngle > 0.70710678f) {
+			// Narrower than 45 degrees, the rim of the cap lies on the sphere
+			radius = light.Radius / (2.0f * cosAngle);
+			center += direction * radius;
+		}
+		else if (cosAngle > 0.0f) {
+			center += direction * (cosAngle * light.Radius);
+			radius = std::sqrt(1.0f - cosAngle * cosAngle) * light.Radius;
+		}
+		m_lightSpheres.emplace_back(glm::vec3(snapshot.ViewMatrix * glm::vec4(center, 1.0f)), radius);
+	}
+
+	const auto sphereBytes{ static_cast<GLsizeiptr>(m_lightSpheres.size() * sizeof(glm::vec4)) };
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightSphereBuffer);
+	if (sphereBytes > m_lightSphereBufferSize) {
+		m_lightSphereBufferSize = sphereBytes;
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_lightSphereBufferSize, m_lightSpheres.data(), GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, m_lightSphereBuffer);
+	}
+	else if (sphereBytes > 0) {
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sphereBytes, m_lightSpheres.data());
+	}
+}
+
+/***********************************************************************************/
+void RenderSystem::growLightIndexList(const GLuint requiredIndices) {
+	if (requiredIndices <= m_lightIndexCapacity) {
+		return;
+	}
+
+	// Capacity is 0 while the output is, e.g. for a minimized window
+	m_lightIndexCapacity = std::max(m_lightIndexCapacity, 1u);
+	while (m_lightIndexCapacity < requiredIndices) {
+		m_lightIndexCapacity *= 2;
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightIndexBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_lightIndexCapacity * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_lightIndexBuffer);
+#ifdef _DEBUG
+	std::cout << "Light index list grown to " << m_lightIndexCapacity << " entries\n";
+#endif
+}
+
+/***********************************************************************************/
+void RenderSystem::cullLightsTiled(const RenderSnapshot& snapshot) {
+	static auto& lightCullShader = m_shaderCache.at("LightCullShader");
+
+	// Reset the global index counter
+	const GLuint zero{ 0 };
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightIndexCounter);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &zero);
+
+	glActiveTexture(GL_TEXTURE8);
+	glBindTexture(GL_TEXTURE_2D, m_renderGraph.GetTexture(m_targets.Depth));
+
+	lightCullShader.Bind();
+	lightCullShader.SetUniform("view", snapshot.ViewMatrix).SetUniform("projection", snapshot.ProjMatrix).SetUniform("inverseProjection", glm::inverse(snapshot.ProjMatrix));
+	lightCullShader.SetUniform("screenSize", glm::ivec2(m_renderWidth, m_renderHeight)).SetUniformi("lightCount", static_cast<int>(m_gpuLights.size()));
+	lightCullShader.SetUniformui("maxLightIndices", m_lightIndexCapacity).SetUniformi("useDepthBounds", snapshot.DepthPrepass);
+
+	glDispatchCompute(m_numTilesX, m_numTilesY, 1);
+
+	// Depth is still attached to the framebuffer we are about to draw into
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/***********************************************************************************/
+void RenderSystem::assignLightClustersGPU() {
+	static auto& lightClusterShader = m_shaderCache.at("LightClusterShader");
+	static auto& lightClusterScanShader = m_shaderCache.at("LightClusterScanShader");
+
+	const auto numClusters{ static_cast<GLuint>(m_lightClusters.GetNumClusters()) };
+	const auto numGroups{ (numClusters + ClusterGroupSize - 1) / ClusterGroupSize };
+
+	// Count
+	lightClusterShader.Bind();
+	lightClusterShader.SetUniformui("lightCount", static_cast<GLuint>(m_lightSpheres.size())).SetUniformui("numClusters", numClusters);
+	lightClusterShader.SetUniformui("assignPass", 0);
+	glDispatchCompute(numGroups, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// Offsets, also sets the index counter
+	lightClusterScanShader.Bind();
+	lightClusterScanShader.SetUniformui("numClusters", numClusters).SetUniformui("maxLightIndices", m_lightIndexCapacity);
+	glDispatchCompute(1, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// Write
+	lightClusterShader.Bind();
+	lightClusterShader.SetUniformui("assignPass", 1);
+	glDispatchCompute(numGroups, 1, 1);
+}
+
+/***********************************************************************************/
+void RenderSystem::assignLightClustersCPU() {
+	{
+		ScopedTimer timer(m_frameStats.LightAssignMs);
+		m_lightClusters.AssignLights(m_lightSpheres);
+	}
+
+	const auto& grid{ m_lightClusters.GetLightGrid() };
+	const auto& indices{ m_lightClusters.GetLightIndices() };
+	const auto numIndices{ static_cast<GLuint>(indices.size()) };
+
+	// The exact size is known up front, no need to wait for a readback
+	growLightIndexList(numIndices);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightGridBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, grid.size() * sizeof(glm::uvec2), grid.data());
+	if (numIndices > 0) {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightIndexBuffer);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, numIndices * sizeof(GLuint), indices.data());
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightIndexCounter);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &numIndices);
+}
+
+/***********************************************************************************/
+void RenderSystem::verifyLightClusters() {
+	// CPU first, it also makes sure the index list is big enough for the GPU path
+	assignLightClustersCPU();
+	const auto& cpuGrid{ m_lightClusters.GetLightGrid() };
+	const auto& cpuIndices{ m_lightClusters.GetLightIndices() };
+
+	assignLightClustersGPU();
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	std::vector<glm::uvec2> gpuGrid(cpuGrid.size());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightGridBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, gpuGrid.size() * sizeof(glm::uvec2), gpuGrid.data());
+
+	std::vector<GLuint> gpuIndices(cpuIndices.size());
+	if (!gpuIndices.empty()) {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightIndexBuffer);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, gpuIndices.size() * sizeof(GLuint), gpuIndices.data());
+	}
+
+	std::size_t mismatches{ 0 };
+	for (std::size_t i = 0; i < cpuGrid.size(); ++i) {
+		const auto cpuBegin{ cpuIndices.cbegin() + cpuGrid[i].x };
+		if (gpuGrid[i] != cpuGrid[i] || !std::equal(cpuBegin, cpuBegin + cpuGrid[i].y, gpuIndices.cbegin() + cpuGrid[i].x)) {
+			if (mismatches == 0) {
+				std::cerr << "Light cluster " << i << ": CPU has " << cpuGrid[i].y << " lights, GPU has " << gpuGrid[i].y << '\n';
+			}
+			++mismatches;
+		}
+	}
+
+	std::cout << "Light cluster verification " << (mismatches == 0 ? "passed" : "FAILED") << ": " << cpuGrid.size() << " clusters, "
+		<< m_lightSpheres.size() << " lights, " << cpuIndices.size() << " indices, " << mismatches << " mismatching clusters\n";
+}
+
+/***********************************************************************************/
+void RenderSystem::renderShadowMap(const RenderSnapshot& snapshot) {
 	static auto& shadowDepthShader = m_shaderCache.at("ShadowDepthShader");
 	shadowDepthShader.Bind();
 	static constexpr float near_plane = 0.0f, far_plane = 100.0f;
 	static const glm::mat4 lightProjection = glm::ortho(-50.0f, 50.0f, 50.0f, -50.0f, near_plane, far_plane);
 
-	static const auto& lightView = glm::lookAt(scene.m_staticDirectionalLights[0].Direction, 
+	static const auto& lightView = glm::lookAt(snapshot.DirectionalLights[0].Direction, 
 								  glm::vec3(0.0f), 
 								  glm::vec3(0.0f, -1.0f, 0.0f));
 
@@ -294,14 +1209,10 @@ void RenderSystem::renderShadowMap(const SceneBase& scene, RenderListIterator re
 	shadowDepthShader.SetUniform("lightSpaceMatrix", m_lightSpaceMatrix);
 	
 	glCullFace(GL_FRONT); // Solve peter-panning
-	glViewport(0, 0, m_shadowMapResolution, m_shadowMapResolution);
-	m_shadowFBO.Bind();
 	glClear(GL_DEPTH_BUFFER_BIT);
 
-	renderModelsNoTextures(shadowDepthShader, renderListBegin, renderListEnd);
+	submitCommands(shadowDepthShader, false);
 
-	m_shadowFBO.Unbind();
-	glViewport(0, 0, m_width, m_height);
 	glCullFace(GL_BACK);
 }
 
@@ -341,9 +1252,6 @@ void RenderSystem::setupTextureSamplers() {
 void RenderSystem::setupShadowMap() {
 	const static float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
 
-	m_shadowFBO.Init("Shadow Depth FBO");
-	m_shadowFBO.Bind();
-
 	// Depth texture
 	if (m_shadowDepthTexture) {
 		glDeleteTextures(1, &m_shadowDepthTexture);
@@ -371,67 +1279,23 @@ void RenderSystem::setupShadowMap() {
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
 	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, m_caps.MaxAnisotropy); // Anisotropic filtering for sharper angles
 	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+}
 
-	m_shadowFBO.AttachTexture(m_shadowDepthTexture, GLFramebuffer::AttachmentType::DEPTH);
-	m_shadowFBO.AttachTexture(m_shadowColorTexture, GLFramebuffer::AttachmentType::COLOR0);
-	
-	m_shadowFBO.Unbind();
+/***********************************************************************************/
+void RenderSystem::setupOffscreenOutput() {
+	if (m_offscreenOutput) {
+		glDeleteTextures(1, &m_offscreenOutput);
+	}
+	glGenTextures(1, &m_offscreenOutput);
+	glBindTexture(GL_TEXTURE_2D, m_offscreenOutput);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, static_cast<GLsizei>(m_width), static_cast<GLsizei>(m_height));
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 }
 
 /***********************************************************************************/
 void RenderSystem::setupPostProcessing() {
-	
-	// HDR
-	m_hdrFBO.Reset();
-	m_hdrFBO.Bind();
-
-	// Regular old HDR
-	glGenTextures(1, &m_hdrColorBuffer);
-	glBindTexture(GL_TEXTURE_2D, m_hdrColorBuffer);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, m_width, m_height, 0, GL_RGB, GL_FLOAT, nullptr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-	// For extracting bright parts of image for bloom
-	glGenTextures(1, &m_brightnessThresholdColorBuffer);
-	glBindTexture(GL_TEXTURE_2D, m_brightnessThresholdColorBuffer);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, m_width, m_height, 0, GL_RGB, GL_FLOAT, nullptr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-	GLuint rboDepth;
-	glGenRenderbuffers(1, &rboDepth);
-	glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_width, m_height);
-	
-	// Attach buffers
-	m_hdrFBO.AttachTexture(m_hdrColorBuffer, GLFramebuffer::AttachmentType::COLOR0);
-	m_hdrFBO.AttachTexture(m_brightnessThresholdColorBuffer, GLFramebuffer::AttachmentType::COLOR1);
-	m_hdrFBO.AttachRenderBuffer(rboDepth, GLFramebuffer::AttachmentType::DEPTH);
-
-	// Enable MRT
-	const unsigned int attachments[2] { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-	m_hdrFBO.DrawBuffers(attachments);
-
-	// Bloom
-	glGenTextures(2, m_pingPongColorBuffers.data());
-	for (auto i = 0; i < 2; i++) {
-		m_pingPongFBOs[i].Reset();
-		m_pingPongFBOs[i].Bind();
-
-		glBindTexture(GL_TEXTURE_2D, m_pingPongColorBuffers[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, m_width, m_height, 0, GL_RGB, GL_FLOAT, nullptr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-		m_pingPongFBOs[i].AttachTexture(m_pingPongColorBuffers[i], GLFramebuffer::AttachmentType::COLOR0);
-	}
+	// Targets are created by the render graph
 
 	// Configure bloom + blur shader
 	auto& blurShader = m_shaderCache.at("GaussianBlurShader");
@@ -447,6 +1311,80 @@ void RenderSystem::setupPostProcessing() {
 
 }
 
+/***********************************************************************************/
+void RenderSystem::setupVisibilityBuffer() {
+	m_geometryPool.Init();
+	glGenBuffers(1, &m_visibilityDrawBuffer);
+}
+
+/***********************************************************************************/
+void RenderSystem::setupLightCulling() {
+	glGenBuffers(1, &m_lightBuffer);
+	glGenBuffers(1, &m_lightIndexBuffer);
+	glGenBuffers(1, &m_lightGridBuffer);
+	glGenBuffers(1, &m_lightIndexCounter);
+	glGenBuffers(1, &m_clusterBoundsBuffer);
+	glGenBuffers(1, &m_lightSphereBuffer);
+	glGenBuffers(1, &m_clusterLightCountBuffer);
+
+	// Start with room for one light, grows on upload
+	m_lightBufferSize = sizeof(GPULight);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_lightBufferSize, nullptr, GL_DYNAMIC_DRAW);
+
+	m_lightSphereBufferSize = sizeof(glm::vec4);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightSphereBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_lightSphereBufferSize, nullptr, GL_DYNAMIC_DRAW);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightIndexCounter);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+
+	for (auto& readback : m_lightCounterReadbacks) {
+		glGenBuffers(1, &readback.Buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, readback.Buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_lightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_lightIndexCounter);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, m_lightSphereBuffer);
+
+	resizeLightGrid();
+
+	auto& lightCullShader = m_shaderCache.at("LightCullShader");
+	lightCullShader.Bind();
+	lightCullShader.SetUniformi("depthMap", 8);
+}
+
+/***********************************************************************************/
+void RenderSystem::resizeLightGrid() {
+	// Sized for the output resolution, so a lower render scale never reallocates
+	const auto width{ static_cast<GLuint>(m_width) }, height{ static_cast<GLuint>(m_height) };
+	const auto numTiles{ ((width + LightTileSize - 1) / LightTileSize) * ((height + LightTileSize - 1) / LightTileSize) };
+	constexpr auto ClusterTile{ LightClusterGrid::TileSize };
+	const auto numClusters{ ((width + ClusterTile - 1) / ClusterTile) * ((height + ClusterTile - 1) / ClusterTile) * LightClusterGrid::NumSlices };
+
+	// Tiles and clusters share the grid
+	m_lightGridCapacity = std::max({ numTiles, numClusters, static_cast<GLuint>(m_lightClusters.GetNumClusters()) });
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightGridBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_lightGridCapacity * sizeof(glm::uvec2), nullptr, GL_DYNAMIC_COPY);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_lightGridBuffer);
+
+	// One entry per cluster
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_clusterBoundsBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_lightGridCapacity * sizeof(LightClusterGrid::Bounds), nullptr, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_clusterBoundsBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_clusterLightCountBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_lightGridCapacity * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, m_clusterLightCountBuffer);
+
+	// Initial guess, grows when a frame needs more
+	m_lightIndexCapacity = std::max(m_lightIndexCapacity, numTiles * 32);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightIndexBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_lightIndexCapacity * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_lightIndexBuffer);
+}
+
 /***********************************************************************************/
 void RenderSystem::setProjectionMatrix(const Camera& camera) {
 	m_projMatrix = camera.GetProjMatrix(m_width, m_height);
@@ -5,8 +5,16 @@
 #include "../Graphics/GLFramebuffer.h"
 #include "../Graphics/GLVertexArray.h"
 #include "../Graphics/GLShaderProgram.h"
+#include "../Graphics/CommandList.h"
+#include "../Graphics/LightClusterGrid.h"
+#include "../Graphics/GeometryPool.h"
+#include "../Graphics/RenderGraph.h"
+#include "../Graphics/DynamicResolution.h"
+#include "../Graphics/GPUProfiler.h"
+#include "RenderSnapshot.h"
 
 #include <unordered_map>
+#include <map>
 #include <vector>
 
 //https://github.com/tapio/weep/blob/master/engine/glrenderer/renderdevice.cpp
@@ -15,7 +23,6 @@
 /***********************************************************************************/
 // Forward Declarations
 class Camera;
-class SceneBase;
 class GLShaderProgram;
 namespace pugi {
 	class xml_node;
@@ -23,24 +30,55 @@ namespace pugi {
 
 /***********************************************************************************/
 class RenderSystem {
-	using RenderListIterator = std::vector<ModelPtr>::const_iterator;
 public:
 
-	void Init(const pugi::xml_node& rendererNode);
-	void Update(const Camera& camera);
+	// loader resolves GL functions for the current context. With offscreenOutput the final pass
+	// writes into a texture instead of the default framebuffer, for contexts without one.
+	void Init(const pugi::xml_node& rendererNode, GLADloadproc loader, const bool offscreenOutput = false);
 	// Release OpenGL resources
-	void Shutdown() const;
+	void Shutdown();
 
-	//
-	void UpdateView(const Camera& camera);
+	// Where the magic happens. Only reads the snapshot, so the simulation can already
+	// be working on the next frame.
+	void Render(const RenderSnapshot& snapshot);
+
+	// CPU cost of the last Render() call
+	struct FrameStats {
+		double RecordMs{ 0.0 };		// Building draw packets on the job system
+		double SubmitMs{ 0.0 };		// Replaying packets on the GL thread (all passes)
+		double LightAssignMs{ 0.0 };	// Light-to-cluster assignment on the job system (clustered CPU mode)
+		std::size_t NumDrawCalls{ 0 };
+		std::size_t NumCommandLists{ 0 };	// Recording jobs, all merged into one sorted list
+		// Fragment shader invocations of the PBR pass. Read back with a two frame delay
+		// to avoid stalling, 0 if ARB_pipeline_statistics_query is missing.
+		std::uint64_t ShadedFragments{ 0 };
+		// Estimated G-buffer writes plus lighting reads (deferred shading only)
+		double GBufferMB{ 0.0 };
+		// GPU time of the passes between shadow mapping and the skybox, also two frames old
+		double SceneGpuMs{ 0.0 };
+		// Fraction of the output size the scene passes rendered at
+		float RenderScale{ 1.0f };
+	};
+
+	const auto& GetFrameStats() const noexcept { return m_frameStats; }
+
+	// GPU memory held by the renderer
+	struct MemoryStats {
+		std::size_t RenderTargetBytes{ 0 };	// Render graph transients of the last frame
+		std::size_t ShadowMapBytes{ 0 };
+		std::size_t GeometryPoolBytes{ 0 };	// Pooled meshes of the visibility buffer
+		std::size_t OutputBytes{ 0 };		// Offscreen output target
+	};
+	MemoryStats GetMemoryStats() const;
 
-	// Where the magic happens
-	void Render(const Camera& camera,
-				RenderListIterator renderListBegin,
-				RenderListIterator renderListEnd,
-				const SceneBase& scene,
-				const bool globalWireframe = false
-				);
+	// Copies the offscreen output of the last frame as RGBA8, top row first.
+	// Returns false if the renderer draws to the default framebuffer.
+	bool ReadOutput(std::vector<std::uint8_t>& pixels, int& width, int& height) const;
+
+	// Times every render graph pass. Frames start in Render(), so GPU work submitted between
+	// two Render() calls (the GUI) can be timed with a GPUProfiler::Scope as well.
+	auto& GetGPUProfiler() noexcept { return m_gpuProfiler; }
+	const auto& GetGPUProfiler() const noexcept { return m_gpuProfiler; }
 
 private:
 	struct HardwareCaps {
@@ -61,27 +99,91 @@ private:
 	void queryHardwareCaps();
 	// Sets the default state required for rendering
 	void setDefaultState();
-	// Render models contained in the renderlist
-	void renderModelsWithTextures(GLShaderProgram& shader, RenderListIterator renderListBegin, RenderListIterator renderListEnd) const;
-	// Render models without binding textures (for a depth or shadow pass perhaps)
-	void renderModelsNoTextures(GLShaderProgram& shader, RenderListIterator renderListBegin, RenderListIterator renderListEnd) const;
+	// Applies the snapshot's viewport and camera matrices
+	void updateView(const RenderSnapshot& snapshot);
+	// Picks this frame's render size from the latest scene GPU time
+	void updateRenderScale();
+	// Declares this frame's passes and the resources they read and write
+	void buildRenderGraph(const RenderSnapshot& snapshot);
+	// Prints pass counts and render target memory whenever the allocation changes
+	void reportRenderGraph();
+	// IBL maps in units 0-2 and the shadow map in unit 7
+	void bindEnvironmentTextures() const;
+	// Records draw packets for the visible instances in parallel, one command list per chunk
+	void recordCommands(const RenderSnapshot& snapshot);
+	// Replays the recorded packets. Textures can be skipped for a depth or shadow pass.
+	// writeDrawIDs sets the "drawIndex" uniform to each packet's index in m_visibilityDraws.
+	void submitCommands(GLShaderProgram& shader, const bool bindTextures, const bool writeDrawIDs = false);
 	// Render NDC screenquad
 	void renderQuad() const;
+	// Lays down depth only so the PBR pass shades each pixel once
+	void renderDepthPrepass();
+	// Deferred: writes material parameters for every visible pixel
+	void renderGBuffer();
+	// Deferred: lights the G-buffer per culling tile in a compute shader
+	void shadeDeferred(const RenderSnapshot& snapshot);
+	// Visibility buffer: packs draw and triangle IDs per pixel
+	void renderVisibilityBuffer();
+	// Writes each pixel's material index as depth
+	void renderMaterialDepth();
+	// One full-screen pass per material, tested against the material depth
+	void shadeVisibilityBuffer(const RenderSnapshot& snapshot);
+	// Copies new meshes into the geometry pool and uploads this frame's draws in submit order
+	void buildVisibilityDraws();
+	// Light list lookup uniforms declared in lightgrid.glsl
+	void setLightGridUniforms(GLShaderProgram& shader, const RenderSnapshot& snapshot);
+	// Counts fragment shader invocations of the enclosed draws, returns 0 if unsupported
+	GLuint beginFragmentQuery();
+	void endFragmentQuery(const GLuint query);
+	// GPU time of the enclosed passes, read back two frames later
+	void beginSceneTimer();
+	void endSceneTimer();
+	// Uploads point and spot lights and builds the per-tile or per-cluster light lists
+	void cullLights(const RenderSnapshot& snapshot);
+	// Packs lights for the GPU. Clustering also needs their view-space bounding spheres.
+	void uploadLights(const RenderSnapshot& snapshot, const bool clustered);
+	// Reallocates the light index list to hold at least requiredIndices
+	void growLightIndexList(const GLuint requiredIndices);
+	// Forward+ 2D tiles, culled in a compute shader against the depth buffer
+	void cullLightsTiled(const RenderSnapshot& snapshot);
+	// Clustered assignment in compute shaders: count, scan, write
+	void assignLightClustersGPU();
+	// Clustered assignment on the job system, the lists are uploaded afterwards
+	void assignLightClustersCPU();
+	// Runs both clustered paths and reports any cluster whose lists differ
+	void verifyLightClusters();
 	// Renders shadowmap
-	void renderShadowMap(const SceneBase& scene, RenderListIterator renderListBegin, RenderListIterator renderListEnd);
+	void renderShadowMap(const RenderSnapshot& snapshot);
 	// Configure NDC screenquad
 	void setupScreenquad();
 	// Setup texture samplers
 	void setupTextureSamplers();
 	// Setup FBO, resolution, etc for shadow mapping
 	void setupShadowMap();
+	// (Re)creates the offscreen output target at the output size
+	void setupOffscreenOutput();
 	// Configure post-processing effects
 	void setupPostProcessing();
+	// Create the geometry pool and draw buffer of the visibility buffer
+	void setupVisibilityBuffer();
+	// Create light buffers for tiled light culling
+	void setupLightCulling();
+	// Resizes the light grid to hold the tiles and clusters of the output resolution
+	void resizeLightGrid();
 	// Sets projection matrix variable and updates UBO
 	void setProjectionMatrix(const Camera& camera);
 
 	// Screen dimensions
 	std::size_t m_width{ 0 }, m_height{ 0 };
+	// Replaces the default framebuffer when rendering offscreen
+	GLuint m_offscreenOutput{ 0 };
+	// Size the scene passes render at, the output size scaled by m_renderScale
+	std::size_t m_renderWidth{ 0 }, m_renderHeight{ 0 };
+
+	// Dynamic resolution, configured in config.xml
+	DynamicResolution m_dynamicResolution;
+	bool m_dynamicResolutionEnabled{ false };
+	float m_renderScale{ 1.0f };
 
 	// Uniform buffer for projection and view matrix
 	GLuint m_uboMatrices{ 0 };
@@ -94,24 +196,127 @@ private:
 
 	// Shadow mapping
 	GLuint m_shadowMapResolution{ 1024 }, m_shadowDepthTexture{ 0 }, m_shadowColorTexture{ 0 };
-	GLFramebuffer m_shadowFBO;
 
 	// Environment map
 	Skybox m_skybox;
 
+	// Draw packet recording
+	struct DrawItem {
+		const RenderSnapshot::Instance* Parent;
+		const Mesh* Submesh;
+	};
+	static constexpr std::size_t CommandChunkSize{ 64 };
+	std::vector<DrawItem> m_drawItems;
+	CommandList m_commands; // One packet per draw item, grows to the largest frame seen and is reused
+	FrameStats m_frameStats;
+
+	// Counts PBR fragment shader invocations, one query per frame in flight
+	std::array<GLuint, 2> m_fragmentQueries{ 0, 0 };
+	std::size_t m_queryFrame{ 0 };
+	std::uint64_t m_shadedFragments{ 0 };
+
+	// Times the scene passes, one query per frame in flight
+	std::array<GLuint, 2> m_sceneTimerQueries{ 0, 0 };
+	std::size_t m_sceneTimerFrame{ 0 };
+	double m_sceneGpuMs{ 0.0 };
+	// Render scale of the frame each query timed, and of the last result read back
+	std::array<float, 2> m_sceneTimerScales{ 1.0f, 1.0f };
+	float m_sceneGpuScale{ 1.0f };
+	bool m_newSceneGpuSample{ false };
+
+	// Forward+
+	// Matches struct Light in lightgrid.glsl (std430)
+	struct GPULight {
+		glm::vec4 ColorAndType;
+		glm::vec4 PositionAndRadius;
+		glm::vec4 DirectionAndCutoff;
+		glm::vec4 OuterCutoff;
+	};
+	static constexpr GLuint LightTileSize{ 16 }; // TILE_SIZE in lightgrid.glsl
+	std::vector<GPULight> m_gpuLights;
+	GLuint m_lightBuffer{ 0 }, m_lightIndexBuffer{ 0 }, m_lightGridBuffer{ 0 }, m_lightIndexCounter{ 0 };
+	// Copies of the index counter from previous frames. Each slot has its own buffer and fence, so
+	// a slot is only read once the GPU is done with it and the CPU never waits.
+	struct CounterReadback {
+		GLuint Buffer{ 0 };
+		GLsync Fence{ nullptr };
+	};
+	std::array<CounterReadback, 2> m_lightCounterReadbacks;
+	GLsizeiptr m_lightBufferSize{ 0 };
+	GLuint m_lightIndexCapacity{ 0 };
+	GLuint m_numTilesX{ 0 }, m_numTilesY{ 0 };
+	// Entries in m_lightGridBuffer, enough for tiles and clusters
+	GLuint m_lightGridCapacity{ 0 };
+
+	// Clustered shading
+	static constexpr GLuint ClusterGroupSize{ 64 }; // local_size_x in lightclusteringcs.glsl
+	LightClusterGrid m_lightClusters;
+	std::vector<glm::vec4> m_lightSpheres;
+	GLuint m_clusterBoundsBuffer{ 0 }, m_lightSphereBuffer{ 0 }, m_clusterLightCountBuffer{ 0 };
+	GLsizeiptr m_lightSphereBufferSize{ 0 };
+
 	// Compiled shader cache
 	std::unordered_map<std::string, GLShaderProgram> m_shaderCache;
 
 	// Screen-quad
 	GLVertexArray m_quadVAO;
 
+	// Selected with shading="forward|deferred|visibility" in config.xml
+	enum class ShadingPath {
+		Forward,
+		Deferred,
+		Visibility
+	} m_shadingPath{ ShadingPath::Forward };
+
+	// Deferred shading
+	static constexpr std::size_t GBufferBytesPerPixel{ 4 + 4 };	// RGBA8 + RGB10_A2
+	static constexpr std::size_t DepthBytesPerPixel{ 4 };
+
+	// Visibility buffer
+	// Matches struct VisibilityDraw in visibility.glsl (std430)
+	struct VisibilityDraw {
+		glm::mat4 ModelMatrix;
+		glm::vec4 PositionScale;	// xyz, see VertexCompressor::PositionRange
+		glm::vec4 PositionOffset;
+		GLuint VertexOffset;		// In 32-bit words
+		GLuint FirstIndex;			// In the mesh's index size
+		GLuint MaterialIndex;
+		GLuint Flags;
+	};
+	static constexpr GLuint VisibilityPackedVertices{ 1 };	// PACKED_VERTICES in visibility.glsl
+	static constexpr GLuint VisibilityShortIndices{ 2 };	// SHORT_INDICES
+	static constexpr GLuint TriangleBits{ 20 };	// TRIANGLE_BITS in visibility.glsl
+	static constexpr GLuint MaxVisibilityDraws{ (1u << (32 - TriangleBits)) - 1 };
+	// Per draw ID, larger meshes are drawn in parts with an ID each
+	static constexpr GLuint MaxVisibilityTriangles{ 1u << TriangleBits };
+	static constexpr GLuint MaxVisibilityIndices{ MaxVisibilityTriangles * 3 };
+	static constexpr GLuint MaterialDepthSteps{ 1024 };	// MATERIAL_DEPTH_STEPS in visibility.glsl
+	GeometryPool m_geometryPool;
+	std::vector<VisibilityDraw> m_visibilityDraws;
+	// Unique texture sets of this frame's draws, one shading pass each
+	std::map<std::array<std::uint32_t, DrawCommand::NUM_TEXTURE_SLOTS>, GLuint> m_visibilityMaterialIndices;
+	std::vector<std::array<std::uint32_t, DrawCommand::NUM_TEXTURE_SLOTS>> m_visibilityMaterials;
+	GLuint m_visibilityDrawBuffer{ 0 };
+	GLsizeiptr m_visibilityDrawBufferSize{ 0 };
+
+	// Render graph, rebuilt every frame
+	RenderGraph m_renderGraph;
+	GPUProfiler m_gpuProfiler;
+	struct FrameTargets {
+		RenderGraph::Handle ShadowDepth, ShadowColor, Lights, Backbuffer;
+		RenderGraph::Handle Depth, HDRColor, BrightColor;
+		std::array<RenderGraph::Handle, 2> Bloom;
+		RenderGraph::Handle GAlbedoMetallic, GNormalRoughness;
+		RenderGraph::Handle Visibility, MaterialDepth;
+	} m_targets;
+	// HDR color, bright color, depth, two RGB16F bloom targets, G-buffer, visibility and
+	// material depth, each allocated up front for every shading path
+	static constexpr std::size_t FixedTargetBytesPerPixel{ 8 + 8 + 4 + 2 * 6 + GBufferBytesPerPixel + 4 + 4 };
+	std::size_t m_reportedTargetBytes{ 0 };
+
 	// Post-Processing
-	// HDR
-	GLuint m_hdrColorBuffer{ 0 }, m_brightnessThresholdColorBuffer{ 0 };
-	GLFramebuffer m_hdrFBO;
 	// Bloom
-	std::array<GLFramebuffer, 2> m_pingPongFBOs;
-	std::array<GLuint, 2> m_pingPongColorBuffers{0, 0};
+	static constexpr std::size_t BloomBlurPasses{ 10 };
 	// Vibrance
 	const float m_vibrance{ 0.1f };
 	const glm::vec4 m_coefficient{ 0.299f, 0.587f, 0.114f, 0.0f };
@@ -3,11 +3,31 @@
 
 #include <GLFW/glfw3.h>
 #include <pugixml.hpp>
+#ifdef MPAPS_EGL
+	#include <EGL/egl.h>
+	#include <EGL/eglext.h>
+#endif
 
 #include <iostream>
 
+namespace {
+	void* glfwLoader(const char* name) {
+		return reinterpret_cast<void*>(glfwGetProcAddress(name));
+	}
+
+#ifdef MPAPS_EGL
+	void* eglLoader(const char* name) {
+		return reinterpret_cast<void*>(eglGetProcAddress(name));
+	}
+#endif
+}
+
 /***********************************************************************************/
-void WindowSystem::Init(const pugi::xml_node& windowNode) {
+void WindowSystem::Init(const pugi::xml_node& windowNode, const bool headless /*= false*/) {
+	if (headless) {
+		initHeadless(windowNode);
+		return;
+	}
 
 	// Gross lambda to connect the Input singleton to GLFW callbacks
 #define genericInputCallback(functionName)\
@@ -73,9 +93,35 @@ void WindowSystem::SetWindowPos(const std::size_t x, const std::size_t y) const
 
 /***********************************************************************************/
 void WindowSystem::SwapBuffers() const {
+	// Nothing is presented, the renderer draws into its own output target
+	if (m_headless) {
+		return;
+	}
 	glfwSwapBuffers(m_window);
 }
 
+/***********************************************************************************/
+void WindowSystem::MakeContextCurrent() const {
+#ifdef MPAPS_EGL
+	if (m_eglContext) {
+		eglMakeCurrent(m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, m_eglContext);
+		return;
+	}
+#endif
+	glfwMakeContextCurrent(m_window);
+}
+
+/***********************************************************************************/
+void WindowSystem::DetachContext() const {
+#ifdef MPAPS_EGL
+	if (m_eglContext) {
+		eglMakeCurrent(m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		return;
+	}
+#endif
+	glfwMakeContextCurrent(nullptr);
+}
+
 /***********************************************************************************/
 void WindowSystem::EnableCursor() const {
 	glfwSetInputMode(m_window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
@@ -91,8 +137,22 @@ void WindowSystem::SetVsync(const bool vsync) const {
 	glfwSwapInterval(static_cast<int>(vsync));
 }
 
+/***********************************************************************************/
+WindowSystem::ProcLoader WindowSystem::GetProcLoader() const noexcept {
+#ifdef MPAPS_EGL
+	if (m_eglContext) {
+		return eglLoader;
+	}
+#endif
+	return glfwLoader;
+}
+
 /***********************************************************************************/
 std::pair<int, int> WindowSystem::GetFramebufferDims() const {
+	if (m_headless) {
+		return { m_width, m_height };
+	}
+
 	int width, height;
 	glfwGetFramebufferSize(m_window, &width, &height);
 
@@ -101,6 +161,11 @@ std::pair<int, int> WindowSystem::GetFramebufferDims() const {
 
 /***********************************************************************************/
 void WindowSystem::Update() {
+	// No input, runs until the caller stops
+	if (m_headless) {
+		return;
+	}
+
 	glfwPollEvents();
 
 	if (Input::GetInstance().IsKeyPressed(GLFW_KEY_TAB)) {
@@ -122,6 +187,78 @@ void WindowSystem::Update() {
 
 /***********************************************************************************/
 void WindowSystem::Shutdown() const {
+#ifdef MPAPS_EGL
+	if (m_eglContext) {
+		DetachContext();
+		eglDestroyContext(m_eglDisplay, m_eglContext);
+		eglTerminate(m_eglDisplay);
+		return;
+	}
+#endif
 	glfwDestroyWindow(m_window);
 	glfwTerminate();
 }
+
+/***********************************************************************************/
+void WindowSystem::initHeadless(const pugi::xml_node& windowNode) {
+	m_headless = true;
+	m_width = windowNode.attribute("width").as_int();
+	m_height = windowNode.attribute("height").as_int();
+
+#ifdef MPAPS_EGL
+	// Surfaceless platform: a context without any window system, rendering only into FBOs
+	const auto getPlatformDisplay{ reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT")) };
+	const auto display{ getPlatformDisplay ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr) : EGL_NO_DISPLAY };
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+		std::cerr << "Failed to open a surfaceless EGL display.";
+		std::abort();
+	}
+
+	const EGLint configAttributes[]{ EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config{ nullptr };
+	EGLint numConfigs{ 0 };
+	if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0) {
+		std::cerr << "Failed to find an EGL config for desktop OpenGL.";
+		std::abort();
+	}
+
+	const EGLint contextAttributes[]{
+		EGL_CONTEXT_MAJOR_VERSION, windowNode.attribute("major").as_int(),
+		EGL_CONTEXT_MINOR_VERSION, windowNode.attribute("minor").as_int(),
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	const auto context{ eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes) };
+	if (context == EGL_NO_CONTEXT) {
+		std::cerr << "Failed to create EGL context.";
+		std::abort();
+	}
+
+	m_eglDisplay = display;
+	m_eglContext = context;
+	MakeContextCurrent();
+#else
+	// Invisible window, only used for its context. It still needs a display, fail with a
+	// clear message rather than a bare GLFW error when there is none (e.g. on CI runners).
+	glfwSetErrorCallback([](const auto errorCode, const auto* message) {std::cerr << "GLFW Error: " << errorCode << ". " << message << std::endl; });
+	if (!glfwInit()) {
+		std::cerr << "Failed to start GLFW. Headless runs without MPAPS_EGL need a display, "
+			"build with MPAPS_EGL to use a surfaceless EGL context instead.\n";
+		std::abort();
+	}
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, windowNode.attribute("major").as_int());
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, windowNode.attribute("minor").as_int());
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	m_window = glfwCreateWindow(m_width, m_height, windowNode.attribute("title").as_string(), nullptr, nullptr);
+	if (!m_window) {
+		std::cerr << "Failed to create hidden GLFW window. Headless runs without MPAPS_EGL need a display, "
+			"build with MPAPS_EGL to use a surfaceless EGL context instead.\n";
+		std::abort();
+	}
+
+	glfwMakeContextCurrent(m_window);
+#endif
+}
@@ -24,27 +24,50 @@ public:
 
 	~WindowSystem() = default;
 
-	void Init(const pugi::xml_node& windowNode);
+	// A headless window renders offscreen at the configured size. Built with MPAPS_EGL it is a
+	// surfaceless EGL context (Mesa, runs on llvmpipe without a display server), otherwise a hidden GLFW window.
+	void Init(const pugi::xml_node& windowNode, const bool headless = false);
 	void Update();
 	void Shutdown() const;
 
 	void SetWindowPos(const std::size_t x, const std::size_t y) const;
 	void SwapBuffers() const;
 
+	// Binds the window's OpenGL context to the calling thread.
+	void MakeContextCurrent() const;
+	// Unbinds whatever context is current on the calling thread.
+	void DetachContext() const;
+
 	void EnableCursor() const;
 	void DisableCursor() const;
 
 	void SetVsync(const bool vsync) const;
 
+	using ProcLoader = void* (*)(const char* name);
+	// OpenGL function loader for the window's context
+	ProcLoader GetProcLoader() const noexcept;
+
 	auto ShouldClose() const noexcept { return m_shouldWindowClose; }
+	// ShouldClose() returns true from now on
+	void RequestClose() noexcept { m_shouldWindowClose = true; }
 	auto IsCursorVisible() const noexcept { return m_showCursor; }
+	auto IsHeadless() const noexcept { return m_headless; }
 
 	// Returns the window's framebuffer dimensions in pixels {width, height}.
 	std::pair<int, int> GetFramebufferDims() const;
 
 private:
+	void initHeadless(const pugi::xml_node& windowNode);
+
 	GLFWwindow* m_window{ nullptr };
 
+	// Headless only
+	bool m_headless{ false };
+	int m_width{ 0 }, m_height{ 0 };
+	// EGLDisplay and EGLContext, without pulling EGL into every includer
+	void* m_eglDisplay{ nullptr };
+	void* m_eglContext{ nullptr };
+
 	bool m_shouldWindowClose{ false };
 	bool m_showCursor{ false };
 };
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <cstdint>
+
+struct Job;
+
+/***********************************************************************************/
+// Fixed-size Chase-Lev work-stealing deque.
+// The owning thread pushes and pops at the bottom, any other thread steals from the top.
+// Memory orderings follow "Correct and Efficient Work-Stealing for Weak Memory Models"
+// (Le, Pop, Cohen, Zappa Nardelli 2013).
+class WorkStealingQueue {
+public:
+	static constexpr std::int64_t Capacity{ 4096 }; // Must be a power of two
+
+	WorkStealingQueue() noexcept {
+		for (auto& job : m_jobs) {
+			job.store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	WorkStealingQueue(const WorkStealingQueue&) = delete;
+	WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+	// Owner thread only. Returns false if the queue is full.
+	bool Push(Job* job) noexcept {
+		const auto bottom{ m_bottom.load(std::memory_order_relaxed) };
+		const auto top{ m_top.load(std::memory_order_acquire) };
+
+		if (bottom - top >= Capacity) {
+			return false;
+		}
+
+		m_jobs[bottom & Mask].store(job, std::memory_order_relaxed);
+		// Publishes the job to thieves that acquire m_bottom
+		m_bottom.store(bottom + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// Owner thread only. Returns nullptr if the queue is empty.
+	Job* Pop() noexcept {
+		const auto bottom{ m_bottom.load(std::memory_order_relaxed) - 1 };
+		m_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		auto top{ m_top.load(std::memory_order_relaxed) };
+
+		if (top > bottom) {
+			// Empty
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		auto* job{ m_jobs[bottom & Mask].load(std::memory_order_relaxed) };
+		if (top == bottom) {
+			// Last job in the queue, race any thieves for it
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				job = nullptr;
+			}
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+
+		return job;
+	}
+
+	// Any thread. Returns nullptr if the queue is empty or another thread won the race.
+	Job* Steal() noexcept {
+		auto top{ m_top.load(std::memory_order_acquire) };
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const auto bottom{ m_bottom.load(std::memory_order_acquire) };
+
+		if (top >= bottom) {
+			return nullptr;
+		}
+
+		auto* job{ m_jobs[top & Mask].load(std::memory_order_relaxed) };
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return nullptr;
+		}
+
+		return job;
+	}
+
+	auto IsEmpty() const noexcept {
+		return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+	}
+
+private:
+	static constexpr std::int64_t Mask{ Capacity - 1 };
+
+	// Keep the two ends on separate cache lines so owner and thieves don't false-share
+	alignas(64) std::atomic<std::int64_t> m_top{ 0 };
+	alignas(64) std::atomic<std::int64_t> m_bottom{ 0 };
+	alignas(64) std::array<std::atomic<Job*>, Capacity> m_jobs;
+};
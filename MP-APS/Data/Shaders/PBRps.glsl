@@ -1,5 +1,8 @@
 #version 440 core
 
+#include "Data/Shaders/lightgrid.glsl"
+#include "Data/Shaders/pbr.glsl"
+
 in FragData {
     vec2 TexCoords;
     vec3 FragPos;
@@ -31,77 +34,16 @@ uniform vec3 lightColor;
 
 uniform vec3 camPos;
 
+layout (std140, binding = 0) uniform Matrices {
+  mat4 projection;
+  mat4 view;
+};
+
 uniform bool wireframe;
 
 layout (location = 0) out vec4 FragColor;
 layout (location = 1) out vec4 BrightColor;
 
-const float PI = 3.14159265359;
-
-// ----------------------------------------------------------------------------
-// Piecewise linear interpolation
-float linstep(const float low, const float high, const float value) {
-    return clamp((value - low) / (high - low), 0.0, 1.0);
-}
-
-// ----------------------------------------------------------------------------
-// Variance shadow mapping
-float ComputeShadow(const vec4 fragPosLightSpace) {
-    // Perspective divide
-    vec2 screenCoords = fragPosLightSpace.xy / fragPosLightSpace.w;
-    screenCoords = screenCoords * 0.5 + 0.5; // [0, 1]
-
-    const float distance = fragPosLightSpace.z; // Use raw distance instead of linear junk
-    const vec2 moments = texture2D(shadowMap, screenCoords.xy).rg;
-
-    const float p = step(distance, moments.x);
-    const float variance = max(moments.y - (moments.x * moments.x), 0.00002);
-    const float d = distance - moments.x;
-    const float pMax = linstep(0.2, 1.0, variance / (variance + d*d)); // Solve light bleeding
-
-   return min(max(p, pMax), 1.0);
-}
-
-// ----------------------------------------------------------------------------
-float DistributionGGX(vec3 N, vec3 H, float roughness) {
-    float a = roughness*roughness;
-    float a2 = a*a;
-    float NdotH = max(dot(N, H), 0.0);
-    float NdotH2 = NdotH*NdotH;
-
-    float nom   = a2;
-    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
-    denom = PI * denom * denom;
-
-    return nom / denom;
-}
-// ----------------------------------------------------------------------------
-float GeometrySchlickGGX(float NdotV, float roughness) {
-    float r = (roughness + 1.0);
-    float k = (r*r) / 8.0;
-
-    float nom   = NdotV;
-    float denom = NdotV * (1.0 - k) + k;
-
-    return nom / denom;
-}
-// ----------------------------------------------------------------------------
-float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness) {
-    float NdotV = max(dot(N, V), 0.0);
-    float NdotL = max(dot(N, L), 0.0);
-    float ggx2 = GeometrySchlickGGX(NdotV, roughness);
-    float ggx1 = GeometrySchlickGGX(NdotL, roughness);
-
-    return ggx1 * ggx2;
-}
-// ----------------------------------------------------------------------------
-vec3 fresnelSchlick(float cosTheta, vec3 F0) {
-    return F0 + (1.0 - F0) * pow(1.0 - cosTheta, 5.0);
-}
-// ----------------------------------------------------------------------------
-vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness) {
-    return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(1.0 - cosTheta, 5.0);
-}   
 // ----------------------------------------------------------------------------
 void main() {       
     // material properties
@@ -112,11 +54,11 @@ void main() {
        
     // input lighting data
     // Get world-space normals from TBN matrix
-    vec3 N = texture(normalMap, fragData.TexCoords).rgb;
-    N = normalize(N * 2.0 - 1.0);
+    // Normal maps may be BC5 (two channels), z is rebuilt from x and y
+    const vec2 Nxy = texture(normalMap, fragData.TexCoords).rg * 2.0 - 1.0;
+    vec3 N = vec3(Nxy, sqrt(max(1.0 - dot(Nxy, Nxy), 0.0)));
     N = normalize(fragData.TBN * N); 
     const vec3 V = normalize(camPos - fragData.FragPos);
-    const vec3 R = reflect(-V, N); 
 
     // calculate reflectance at normal incidence; if di-electric (like plastic) use F0 
     // of 0.04 and if it's a metal, use the albedo color as F0 (metallic workflow)    
@@ -124,58 +66,23 @@ void main() {
     F0 = mix(F0, albedo, metallic);
 
     // reflectance equation
-    vec3 Lo = vec3(0.0);
-{
-    // calculate per-light radiance
-    const vec3 L = normalize(directionalLight);
-    const vec3 H = normalize(V + L);
-    const vec3 radiance = lightColor;
-
-    // Cook-Torrance BRDF
-    float NDF = DistributionGGX(N, H, roughness);   
-    float G   = GeometrySmith(N, V, L, roughness);
-    vec3 F    = fresnelSchlick(clamp(dot(H, V), 0.0, 1.0), F0);
-
-    vec3 nominator    = NDF * G * F; 
-    float denominator = 4 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0);
-    vec3 specular = nominator / max(denominator, 0.001); // prevent divide by zero for NdotV=0.0 or NdotL=0.0
-
-    // kS is equal to Fresnel
-    vec3 kS = F;
-    // for energy conservation, the diffuse and specular light can't
-    // be above 1.0 (unless the surface emits light); to preserve this
-    // relationship the diffuse component (kD) should equal 1.0 - kS.
-    vec3 kD = vec3(1.0) - kS;
-    // multiply kD by the inverse metalness such that only non-metals 
-    // have diffuse lighting, or a linear blend if partly metal (pure metals
-    // have no diffuse light).
-    kD *= 1.0 - metallic;     
-
-    // scale light by NdotL
-    float NdotL = max(dot(N, L), 0.0);        
-
-    const float shadow = ComputeShadow(fragData.FragPosLightSpace);
-    // add to outgoing radiance Lo
-    Lo = (kD * albedo / PI + specular) * radiance * NdotL * shadow;  // note that we already multiplied the BRDF by the Fresnel (kS) so we won't multiply by kS again
-}
+    // Sun
+    const float shadow = ComputeShadow(shadowMap, fragData.FragPosLightSpace);
+    vec3 Lo = CookTorrance(N, V, normalize(directionalLight), lightColor, albedo, metallic, roughness, F0) * shadow;
+
+    // Point and spot lights culled for this tile or cluster
+    const float viewDepth = -(view * vec4(fragData.FragPos, 1.0)).z;
+    const uvec2 tileLights = lightGrid[lightGridIndex(uvec2(gl_FragCoord.xy), viewDepth)];
+    for (uint i = 0; i < tileLights.y; ++i) {
+        const Light light = lights[lightIndices[tileLights.x + i]];
+        const vec3 L = normalize(light.positionAndRadius.xyz - fragData.FragPos);
+        const vec3 radiance = light.colorAndType.rgb * lightFalloff(light, fragData.FragPos, L);
+
+        Lo += CookTorrance(N, V, L, radiance, albedo, metallic, roughness, F0);
+    }
     
     // ambient lighting (we now use IBL as the ambient term)
-    const vec3 F = fresnelSchlickRoughness(max(dot(N, V), 0.0), F0, roughness);
-    
-    vec3 kS = F;
-    vec3 kD = 1.0 - kS;
-    kD *= 1.0 - metallic;     
-    
-    vec3 irradiance = texture(irradianceMap, N).rgb;
-    vec3 diffuse    = irradiance * albedo;
-    
-    // sample both the pre-filter map and the BRDF lut and combine them together as per the Split-Sum approximation to get the IBL specular part.
-    const float MAX_REFLECTION_LOD = 4.0;
-    vec3 prefilteredColor = textureLod(prefilterMap, R,  roughness * MAX_REFLECTION_LOD).rgb;    
-    vec2 brdf  = texture(brdfLUT, vec2(max(dot(N, V), 0.0), roughness)).rg;
-    vec3 specular = prefilteredColor * (F * brdf.x + brdf.y);
-    
-    const vec3 ambient = kD * diffuse + specular; // * ao;
+    const vec3 ambient = ImageBasedLighting(irradianceMap, prefilterMap, brdfLUT, N, V, albedo, metallic, roughness, F0);
     
     vec3 color = ambient * 0.5 + Lo;
 
@@ -1,9 +1,12 @@
 #version 440 core
 
-layout (location = 0) in vec3 position;
+#include "Data/Shaders/vertexformat.glsl"
+
+// Float or packed, see vertexformat.glsl
+layout (location = 0) in vec4 position;
 layout (location = 1) in vec2 texCoords;
 layout (location = 2) in vec3 normal;
-layout (location = 3) in vec3 tangent;
+layout (location = 3) in vec4 tangent;
 
 layout (std140, binding = 0) uniform Matrices {
   mat4 projection;
@@ -19,19 +22,23 @@ out VertexData {
     out vec4 FragPosLightSpace;
 } vertexData;
 
+// Must match the depth prepass (depthvs) exactly
+invariant gl_Position;
+
 void main() {
     vertexData.TexCoords = texCoords;
-    vertexData.FragPos = vec3(modelMatrix * vec4(position, 1.0));
+    vertexData.FragPos = vec3(modelMatrix * vec4(decodePosition(position), 1.0));
 
     // Construct TBN matrix
-    vec3 T = normalize(vec3(modelMatrix * vec4(tangent, 0.0)));
-    const vec3 N = normalize(vec3(modelMatrix * vec4(normal, 0.0)));
+    const vec4 modelTangent = decodeTangent(position, tangent);
+    vec3 T = normalize(vec3(modelMatrix * vec4(modelTangent.xyz, 0.0)));
+    const vec3 N = normalize(vec3(modelMatrix * vec4(decodeNormal(normal), 0.0)));
     
     // Gram-schmidt process (produces higher-quality normal mapping on large meshes)
     // Re-orthogonalize T with respect to N
     T = normalize(T - dot(T, N) * N);
-    // Then calculate Bitangent
-    const vec3 B = cross(N, T);
+    // Then calculate Bitangent, flipped for mirrored texture coordinates
+    const vec3 B = cross(N, T) * modelTangent.w;
 
     vertexData.TBN = mat3(T, B, N);
 
@@ -6,6 +6,8 @@ in vec2 TexCoords;
 
 uniform sampler2D scene;
 uniform sampler2D bloomBlur;
+// Scene and bloom cover this part of their targets, stretched over the output
+uniform vec2 uvScale;
 
 uniform vec4 vibranceCoefficient;
 uniform float vibranceAmount;
@@ -25,9 +27,12 @@ vec3 vibrance(const vec3 rgb, const float amount) {
 // ----------------------------------------------------------------------------
 void main() {             
     const float gamma = 2.2; 
-    const vec3 bloomColor = texture(bloomBlur, TexCoords).rgb;
+    // Bilinear upscale, clamped so the filter doesn't reach texels outside the rendered part
+    const vec2 halfTexel = 0.5 / textureSize(scene, 0);
+    const vec2 uv = clamp(TexCoords * uvScale, halfTexel, uvScale - halfTexel);
+    const vec3 bloomColor = texture(bloomBlur, uv).rgb;
     
-    vec3 hdrColor = texture(scene, TexCoords).rgb;
+    vec3 hdrColor = texture(scene, uv).rgb;
     hdrColor += bloomColor; // apply bloom
 
     hdrColor = vibrance(hdrColor, vibranceAmount);
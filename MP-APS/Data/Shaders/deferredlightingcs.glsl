@@ -0,0 +1,94 @@
+#version 440 core
+
+#include "Data/Shaders/lightgrid.glsl"
+#include "Data/Shaders/pbr.glsl"
+#include "Data/Shaders/gbuffer.glsl"
+
+layout (std140, binding = 0) uniform Matrices {
+  mat4 projection;
+  mat4 view;
+};
+
+// G-buffer
+uniform sampler2D gAlbedoMetallic;
+uniform sampler2D gNormalRoughness;
+uniform sampler2D gDepth;
+
+// IBL
+uniform samplerCube irradianceMap;
+uniform samplerCube prefilterMap;
+uniform sampler2D brdfLUT;
+
+// Shadow map
+uniform sampler2D shadowMap;
+uniform mat4 lightSpaceMatrix;
+
+uniform mat4 inverseViewProjection;
+uniform ivec2 screenSize;
+uniform float bloomThreshold;
+
+// lights
+uniform vec3 directionalLight;
+uniform vec3 lightColor;
+
+uniform vec3 camPos;
+
+layout (binding = 0, rgba16f) uniform writeonly image2D hdrColor;
+layout (binding = 1, rgba16f) uniform writeonly image2D brightColor;
+
+// One group per light culling tile
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE, local_size_z = 1) in;
+
+void main() {
+    const ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    if (pixel.x >= screenSize.x || pixel.y >= screenSize.y) {
+        return;
+    }
+
+    // Nothing was drawn here, the skybox fills it in later
+    const float depth = texelFetch(gDepth, pixel, 0).r;
+    if (depth == 1.0) {
+        return;
+    }
+
+    // Reconstruct world position from depth
+    const vec2 ndc = (vec2(pixel) + 0.5) / vec2(screenSize) * 2.0 - 1.0;
+    const vec4 worldPos = inverseViewProjection * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+    const vec3 fragPos = worldPos.xyz / worldPos.w;
+
+    // material properties
+    const vec4 albedoMetallic = texelFetch(gAlbedoMetallic, pixel, 0);
+    const vec4 normalRoughness = texelFetch(gNormalRoughness, pixel, 0);
+    const vec3 albedo = pow(albedoMetallic.rgb, vec3(2.2));
+    const float metallic = albedoMetallic.a;
+    const float roughness = normalRoughness.b;
+
+    const vec3 N = octDecode(normalRoughness.rg);
+    const vec3 V = normalize(camPos - fragPos);
+
+    vec3 F0 = vec3(0.04);
+    F0 = mix(F0, albedo, metallic);
+
+    // Sun
+    const float shadow = ComputeShadow(shadowMap, lightSpaceMatrix * vec4(fragPos, 1.0));
+    vec3 Lo = CookTorrance(N, V, normalize(directionalLight), lightColor, albedo, metallic, roughness, F0) * shadow;
+
+    // Point and spot lights culled for this tile or cluster
+    const float viewDepth = -(view * vec4(fragPos, 1.0)).z;
+    const uvec2 tileLights = lightGrid[lightGridIndex(uvec2(pixel), viewDepth)];
+    for (uint i = 0; i < tileLights.y; ++i) {
+        const Light light = lights[lightIndices[tileLights.x + i]];
+        const vec3 L = normalize(light.positionAndRadius.xyz - fragPos);
+        const vec3 radiance = light.colorAndType.rgb * lightFalloff(light, fragPos, L);
+
+        Lo += CookTorrance(N, V, L, radiance, albedo, metallic, roughness, F0);
+    }
+
+    const vec3 ambient = ImageBasedLighting(irradianceMap, prefilterMap, brdfLUT, N, V, albedo, metallic, roughness, F0);
+    const vec3 color = ambient * 0.5 + Lo;
+
+    // Apply bloom threshold
+    const float brightness = dot(color, vec3(0.2126, 0.7152, 0.0722));
+    imageStore(brightColor, pixel, brightness > bloomThreshold ? vec4(color, 1.0) : vec4(0.0, 0.0, 0.0, 1.0));
+    imageStore(hdrColor, pixel, vec4(color, 1.0));
+}
@@ -1,6 +1,8 @@
 #version 440 core
 
-layout (location = 0) in vec3 position;
+#include "Data/Shaders/vertexformat.glsl"
+
+layout (location = 0) in vec4 position;
 
 layout (std140, binding = 0) uniform Matrices {
   mat4 projection;
@@ -8,6 +10,10 @@ layout (std140, binding = 0) uniform Matrices {
 };
 uniform mat4 modelMatrix;
 
+// Must produce bit-identical depth to PBRvs, the PBR pass tests with GL_EQUAL
+invariant gl_Position;
+
 void main() {
-    gl_Position = projection * view * modelMatrix * vec4(position, 1.0);
+    const vec3 fragPos = vec3(modelMatrix * vec4(decodePosition(position), 1.0));
+    gl_Position = projection * view * vec4(fragPos, 1.0);
 }  
\ No newline at end of file
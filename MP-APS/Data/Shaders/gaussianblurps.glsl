@@ -7,23 +7,29 @@ in vec2 TexCoords;
 uniform sampler2D image;
   
 uniform bool horizontal;
+// Rendered part of the image, the rest holds stale texels from larger frames
+uniform vec2 uvScale;
 uniform float weight[5] = float[] (0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216);
 
 void main() {             
     
     const vec2 tex_offset = 1.0 / textureSize(image, 0); // gets size of single texel
+    const vec2 uv = TexCoords * uvScale;
+    // Keep the taps inside the rendered part
+    const vec2 uvMin = 0.5 * tex_offset;
+    const vec2 uvMax = uvScale - 0.5 * tex_offset;
     
-    vec3 result = texture(image, TexCoords).rgb * weight[0]; // current fragment's contribution
+    vec3 result = texture(image, uv).rgb * weight[0]; // current fragment's contribution
     if(horizontal) {
         for(int i = 1; i < 5; ++i) {
-            result += texture(image, TexCoords + vec2(tex_offset.x * i, 0.0)).rgb * weight[i];
-            result += texture(image, TexCoords - vec2(tex_offset.x * i, 0.0)).rgb * weight[i];
+            result += texture(image, clamp(uv + vec2(tex_offset.x * i, 0.0), uvMin, uvMax)).rgb * weight[i];
+            result += texture(image, clamp(uv - vec2(tex_offset.x * i, 0.0), uvMin, uvMax)).rgb * weight[i];
         }
     }
     else {
         for(int i = 1; i < 5; ++i) {
-            result += texture(image, TexCoords + vec2(0.0, tex_offset.y * i)).rgb * weight[i];
-            result += texture(image, TexCoords - vec2(0.0, tex_offset.y * i)).rgb * weight[i];
+            result += texture(image, clamp(uv + vec2(0.0, tex_offset.y * i), uvMin, uvMax)).rgb * weight[i];
+            result += texture(image, clamp(uv - vec2(0.0, tex_offset.y * i), uvMin, uvMax)).rgb * weight[i];
         }
     }
 
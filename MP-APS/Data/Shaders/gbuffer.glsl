@@ -0,0 +1,28 @@
+// Compact G-buffer layout shared by the geometry pass and deferred lighting.
+// Must match the G-buffer texture formats declared in RenderSystem::buildRenderGraph.
+//   0 RGBA8:    albedo (as stored in the texture, not linearized), metallic
+//   1 RGB10_A2: octahedral world-space normal, roughness
+// Position is reconstructed from the depth buffer.
+
+// ----------------------------------------------------------------------------
+vec2 signNotZero(const vec2 v) {
+	return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// ----------------------------------------------------------------------------
+// Unit vector to [0, 1]^2 (Cigolle et al., "A Survey of Efficient Representations for Independent Unit Vectors")
+vec2 octEncode(const vec3 n) {
+	vec2 p = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+	p = n.z <= 0.0 ? (1.0 - abs(p.yx)) * signNotZero(p) : p;
+	return p * 0.5 + 0.5;
+}
+
+// ----------------------------------------------------------------------------
+vec3 octDecode(const vec2 encoded) {
+	const vec2 e = encoded * 2.0 - 1.0;
+	vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (v.z < 0.0) {
+		v.xy = (1.0 - abs(v.yx)) * signNotZero(v.xy);
+	}
+	return normalize(v);
+}
@@ -1,23 +1,33 @@
 #version 440 core
 
-layout (location = 0) out vec3 gPosition;
-layout (location = 1) out vec3 gNormal;
-layout (location = 2) out vec4 gAlbedoSpec;
+#include "Data/Shaders/gbuffer.glsl"
 
-in vec2 TexCoords;
-in vec3 FragPos;
-in vec3 Normal;
+in VertexData {
+    vec2 TexCoords;
+    vec3 FragPos;
+    mat3 TBN;
+    vec4 FragPosLightSpace;
+} fragData;
 
-uniform sampler2D texture_diffuse1;
-uniform sampler2D texture_specular1;
+// PBR material parameters
+uniform sampler2D albedoMap;
+uniform sampler2D normalMap;
+uniform sampler2D metallicMap;
+uniform sampler2D roughnessMap;
+
+layout (location = 0) out vec4 gAlbedoMetallic;
+layout (location = 1) out vec4 gNormalRoughness;
 
 void main() {
-    // Store the fragment position vector in the first gbuffer texture
-    gPosition = FragPos;
-    // Also store the per-fragment normals into the gbuffer
-    gNormal = normalize(Normal);
-    // And the diffuse per-fragment color
-    gAlbedoSpec.rgb = texture(texture_diffuse1, TexCoords).rgb;
-    // Store specular intensity in gAlbedoSpec's alpha component
-    gAlbedoSpec.a = texture(texture_specular1, TexCoords).r;
+    const float metallic = texture(metallicMap, fragData.TexCoords).r;
+    const float roughness = texture(roughnessMap, fragData.TexCoords).r;
+
+    // Get world-space normals from TBN matrix
+    // Normal maps may be BC5 (two channels), z is rebuilt from x and y
+    const vec2 Nxy = texture(normalMap, fragData.TexCoords).rg * 2.0 - 1.0;
+    vec3 N = vec3(Nxy, sqrt(max(1.0 - dot(Nxy, Nxy), 0.0)));
+    N = normalize(fragData.TBN * N);
+
+    gAlbedoMetallic = vec4(texture(albedoMap, fragData.TexCoords).rgb, metallic);
+    gNormalRoughness = vec4(octEncode(N), roughness, 0.0);
 }
@@ -0,0 +1,58 @@
+#version 440 core
+
+#include "Data/Shaders/lightgrid.glsl"
+
+// One thread per cluster, lights are streamed through shared memory in batches
+#define LIGHT_BATCH_SIZE 64
+
+// Uniforms
+uniform uint lightCount;
+uniform uint numClusters;
+// 0: count the lights of each cluster, 1: write them at the offsets from lightclusterscancs
+uniform uint assignPass;
+
+shared vec4 batchSpheres[LIGHT_BATCH_SIZE];
+
+layout(local_size_x = LIGHT_BATCH_SIZE, local_size_y = 1, local_size_z = 1) in;
+
+void main() {
+	const uint clusterIndex = gl_GlobalInvocationID.x;
+	const bool active = clusterIndex < numClusters;
+
+	ClusterBounds bounds = ClusterBounds(vec4(0.0), vec4(0.0));
+	uvec2 gridEntry = uvec2(0u);
+	if (active) {
+		bounds = clusterBounds[clusterIndex];
+		if (assignPass == 1u) {
+			gridEntry = lightGrid[clusterIndex];
+		}
+	}
+
+	// Lights are visited in index order, so every list comes out sorted like on the CPU
+	uint count = 0u;
+	for (uint batch = 0u; batch < lightCount; batch += uint(LIGHT_BATCH_SIZE)) {
+		const uint lightIndex = batch + gl_LocalInvocationIndex;
+		batchSpheres[gl_LocalInvocationIndex] = lightIndex < lightCount ? lightSpheres[lightIndex] : vec4(0.0);
+
+		barrier();
+
+		const uint batchCount = min(uint(LIGHT_BATCH_SIZE), lightCount - batch);
+		if (active) {
+			for (uint i = 0u; i < batchCount; ++i) {
+				if (sphereIntersectsCluster(bounds, batchSpheres[i])) {
+					// y is already clamped to the list capacity by the scan
+					if (assignPass == 1u && count < gridEntry.y) {
+						lightIndices[gridEntry.x + count] = batch + i;
+					}
+					++count;
+				}
+			}
+		}
+
+		barrier();
+	}
+
+	if (active && assignPass == 0u) {
+		clusterLightCounts[clusterIndex] = count;
+	}
+}
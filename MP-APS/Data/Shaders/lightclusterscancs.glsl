@@ -0,0 +1,52 @@
+#version 440 core
+
+#include "Data/Shaders/lightgrid.glsl"
+
+// A single work group turns the per cluster light counts into offsets.
+// Each thread sums a contiguous segment, the segment sums are scanned in shared memory.
+#define SCAN_THREADS 1024
+
+// Uniforms
+uniform uint numClusters;
+// Capacity of lightIndices
+uniform uint maxLightIndices;
+
+shared uint segmentSums[SCAN_THREADS];
+
+layout(local_size_x = SCAN_THREADS, local_size_y = 1, local_size_z = 1) in;
+
+void main() {
+	const uint thread = gl_LocalInvocationIndex;
+	const uint segmentSize = (numClusters + uint(SCAN_THREADS) - 1u) / uint(SCAN_THREADS);
+	const uint first = min(thread * segmentSize, numClusters);
+	const uint last = min(first + segmentSize, numClusters);
+
+	uint sum = 0u;
+	for (uint i = first; i < last; ++i) {
+		sum += clusterLightCounts[i];
+	}
+	segmentSums[thread] = sum;
+
+	barrier();
+
+	// Inclusive Hillis-Steele scan of the segment sums
+	for (uint stride = 1u; stride < uint(SCAN_THREADS); stride <<= 1u) {
+		const uint value = thread >= stride ? segmentSums[thread - stride] : 0u;
+		barrier();
+		segmentSums[thread] += value;
+		barrier();
+	}
+
+	uint offset = segmentSums[thread] - sum;
+	for (uint i = first; i < last; ++i) {
+		const uint count = clusterLightCounts[i];
+		// Out of space, the CPU grows the list for the next frame
+		const uint capacity = offset < maxLightIndices ? min(count, maxLightIndices - offset) : 0u;
+		lightGrid[i] = uvec2(offset, capacity);
+		offset += count;
+	}
+
+	if (thread == uint(SCAN_THREADS) - 1u) {
+		lightIndexCount = segmentSums[thread];
+	}
+}
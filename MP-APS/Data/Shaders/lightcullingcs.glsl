@@ -1,154 +1,137 @@
-#version 430 core
+#version 440 core
 
-struct PointLight {
-	vec4 color;
-	vec4 position;
-	vec4 paddingAndRadius;
-};
-
-struct VisibleIndex {
-	int index;
-};
-
-// Shader storage buffer objects
-layout(std430, binding = 0) readonly buffer LightBuffer {
-	PointLight data[];
-} lightBuffer;
-
-layout(std430, binding = 1) writeonly buffer VisibleLightIndicesBuffer {
-	VisibleIndex data[];
-} visibleLightIndicesBuffer;
+#include "Data/Shaders/lightgrid.glsl"
 
 // Uniforms
 uniform sampler2D depthMap;
 uniform mat4 view;
 uniform mat4 projection;
+uniform mat4 inverseProjection;
 uniform ivec2 screenSize;
 uniform int lightCount;
+// Capacity of lightIndices
+uniform uint maxLightIndices;
+// Depth bounds need a depth prepass, without it tiles extend from near to far plane
+uniform bool useDepthBounds;
 
 // Shared values between all the threads in the group
 shared uint minDepthInt;
 shared uint maxDepthInt;
-shared uint visibleLightCount;
-shared vec4 frustumPlanes[6];
-// Shared local storage for visible indices, will be written out to the global buffer at the end
-shared int visibleLightIndices[128];
-shared mat4 viewProjection;
+shared vec3 tilePlanes[4];
+shared uint tileLightCount;
+shared uint tileLightOffset;
+shared uint tileLightCapacity;
+shared uint tileWriteCursor;
 
-#define TILE_SIZE 16
 layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE, local_size_z = 1) in;
 
+// ----------------------------------------------------------------------------
+// View-space point on the far plane for an NDC xy coordinate
+vec3 unprojectFar(const vec2 ndc) {
+	const vec4 p = inverseProjection * vec4(ndc, 1.0, 1.0);
+	return p.xyz / p.w;
+}
+
+// ----------------------------------------------------------------------------
+// Sphere against the tile frustum (view space)
+bool isLightVisible(const uint lightIndex, const float minDepth, const float maxDepth) {
+	const vec4 positionAndRadius = lights[lightIndex].positionAndRadius;
+	const vec3 center = vec3(view * vec4(positionAndRadius.xyz, 1.0));
+	const float radius = positionAndRadius.w;
+
+	// View space looks down -z
+	const float depth = -center.z;
+	if (depth + radius < minDepth || depth - radius > maxDepth) {
+		return false;
+	}
+
+	for (uint i = 0; i < 4; ++i) {
+		if (dot(tilePlanes[i], center) < -radius) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 void main() {
-	ivec2 location = ivec2(gl_GlobalInvocationID.xy);
-	ivec2 itemID = ivec2(gl_LocalInvocationID.xy);
-	ivec2 tileID = ivec2(gl_WorkGroupID.xy);
-	ivec2 tileNumber = ivec2(gl_NumWorkGroups.xy);
-	uint index = tileID.y * tileNumber.x + tileID.x;
+	const ivec2 location = ivec2(gl_GlobalInvocationID.xy);
+	const ivec2 tileID = ivec2(gl_WorkGroupID.xy);
+	const ivec2 tileNumber = ivec2(gl_NumWorkGroups.xy);
+	const uint tileIndex = tileID.y * tileNumber.x + tileID.x;
+	const uint threadCount = TILE_SIZE * TILE_SIZE;
 
-	// Initialize shared global values for depth and light count
 	if (gl_LocalInvocationIndex == 0) {
 		minDepthInt = 0xFFFFFFFF;
 		maxDepthInt = 0;
-		visibleLightCount = 0;
-		viewProjection = projection * view;
+		tileLightCount = 0;
+		tileWriteCursor = 0;
 	}
 
 	barrier();
 
-	// Step 1: Calculate the minimum and maximum depth values (from the depth buffer) for this group's tile
-	float maxDepth, minDepth;
-	vec2 text = vec2(location) / screenSize;
-	float depth = texture(depthMap, text).r;
-	// Linearize the depth value from depth buffer (must do this because we created it using projection)
-	depth = (0.5 * projection[3][2]) / (depth + 0.5 * projection[2][2] - 0.5);
-
-	// Convert depth to uint so we can do atomic min and max comparisons between the threads
-	uint depthInt = floatBitsToUint(depth);
-	atomicMin(minDepthInt, depthInt);
-	atomicMax(maxDepthInt, depthInt);
+	// Step 1: Min and max linear depth of this tile
+	if (useDepthBounds && location.x < screenSize.x && location.y < screenSize.y) {
+		const float ndcDepth = texelFetch(depthMap, location, 0).r * 2.0 - 1.0;
+		// Distance along the view direction, always positive so the uint ordering matches
+		const float linearDepth = projection[3][2] / (ndcDepth + projection[2][2]);
 
-	barrier();
+		const uint depthInt = floatBitsToUint(linearDepth);
+		atomicMin(minDepthInt, depthInt);
+		atomicMax(maxDepthInt, depthInt);
+	}
 
-	// Step 2: One thread should calculate the frustum planes to be used for this tile
+	// Step 2: Side planes of the tile frustum, they all go through the eye
 	if (gl_LocalInvocationIndex == 0) {
-		// Convert the min and max across the entire tile back to float
-		minDepth = uintBitsToFloat(minDepthInt);
-		maxDepth = uintBitsToFloat(maxDepthInt);
-
-		// Steps based on tile sale
-		vec2 negativeStep = (2.0 * vec2(tileID)) / vec2(tileNumber);
-		vec2 positiveStep = (2.0 * vec2(tileID + ivec2(1, 1))) / vec2(tileNumber);
-
-		// Set up starting values for planes using steps and min and max z values
-		frustumPlanes[0] = vec4(1.0, 0.0, 0.0, 1.0 - negativeStep.x); // Left
-		frustumPlanes[1] = vec4(-1.0, 0.0, 0.0, -1.0 + positiveStep.x); // Right
-		frustumPlanes[2] = vec4(0.0, 1.0, 0.0, 1.0 - negativeStep.y); // Bottom
-		frustumPlanes[3] = vec4(0.0, -1.0, 0.0, -1.0 + positiveStep.y); // Top
-		frustumPlanes[4] = vec4(0.0, 0.0, -1.0, -minDepth); // Near
-		frustumPlanes[5] = vec4(0.0, 0.0, 1.0, maxDepth); // Far
-
-		// Transform the first four planes
+		const vec2 ndcMin = vec2(tileID * TILE_SIZE) / vec2(screenSize) * 2.0 - 1.0;
+		const vec2 ndcMax = min(vec2((tileID + 1) * TILE_SIZE) / vec2(screenSize), vec2(1.0)) * 2.0 - 1.0;
+
+		const vec3 corners[4] = vec3[](
+			unprojectFar(vec2(ndcMin.x, ndcMin.y)),
+			unprojectFar(vec2(ndcMax.x, ndcMin.y)),
+			unprojectFar(vec2(ndcMax.x, ndcMax.y)),
+			unprojectFar(vec2(ndcMin.x, ndcMax.y))
+		);
+		const vec3 center = unprojectFar((ndcMin + ndcMax) * 0.5);
+
 		for (uint i = 0; i < 4; ++i) {
-			frustumPlanes[i] *= viewProjection;
-			frustumPlanes[i] /= length(frustumPlanes[i].xyz);
+			vec3 normal = normalize(cross(corners[i], corners[(i + 1) % 4]));
+			// Point the normals inwards
+			tilePlanes[i] = dot(normal, center) < 0.0 ? -normal : normal;
 		}
-
-		// Transform the depth planes
-		frustumPlanes[4] *= view;
-		frustumPlanes[4] /= length(frustumPlanes[4].xyz);
-		frustumPlanes[5] *= view;
-		frustumPlanes[5] /= length(frustumPlanes[5].xyz);
 	}
 
 	barrier();
 
-	// Step 3: Cull lights.
-	// Parallelize the threads against the lights now.
-	// Can handle 256 simultaniously. Anymore lights than that and additional passes are performed
-	const uint threadCount = TILE_SIZE * TILE_SIZE;
-	const uint passCount = (lightCount + threadCount - 1) / threadCount;
-	for (uint i = 0; i < passCount; ++i) {
-		// Get the lightIndex to test for this thread / pass. If the index is >= light count, then this thread can stop testing lights
-		uint lightIndex = i * threadCount + gl_LocalInvocationIndex;
-		if (lightIndex >= lightCount) {
-			break;
-		}
-
-		const vec4 position = lightBuffer.data[lightIndex].position;
-		const float radius = lightBuffer.data[lightIndex].paddingAndRadius.w;
-
-		// We check if the light exists in our frustum
-		float distance = 0.0;
-		for (uint j = 0; j < 6; ++j) {
-			distance = dot(position, frustumPlanes[j]) + radius;
-
-			// If one of the tests fails, then there is no intersection
-			if (distance <= 0.0) {
-				break;
-			}
-		}
+	const float minDepth = useDepthBounds ? uintBitsToFloat(minDepthInt) : 0.0;
+	const float maxDepth = useDepthBounds ? uintBitsToFloat(maxDepthInt) : 3.402823466e+38;
 
-		// If greater than zero, then it is a visible light
-		if (distance > 0.0) {
-			// Add index to the shared array of visible indices
-			uint offset = atomicAdd(visibleLightCount, 1);
-			visibleLightIndices[offset] = int(lightIndex);
+	// Step 3: Count the visible lights, all threads test lights in parallel
+	for (uint i = gl_LocalInvocationIndex; i < uint(lightCount); i += threadCount) {
+		if (isLightVisible(i, minDepth, maxDepth)) {
+			atomicAdd(tileLightCount, 1u);
 		}
 	}
 
 	barrier();
 
-	// One thread should fill the global light buffer
+	// Step 4: Reserve exactly the space this tile needs in the global list
 	if (gl_LocalInvocationIndex == 0) {
-		uint offset = index * 128; // Determine bosition in global buffer
-		for (uint i = 0; i < visibleLightCount; ++i) {
-			visibleLightIndicesBuffer.data[offset + i].index = visibleLightIndices[i];
-		}
+		tileLightOffset = atomicAdd(lightIndexCount, tileLightCount);
+		// Out of space, the CPU grows the list for the next frame
+		tileLightCapacity = tileLightOffset < maxLightIndices ? min(tileLightCount, maxLightIndices - tileLightOffset) : 0u;
+		lightGrid[tileIndex] = uvec2(tileLightOffset, tileLightCapacity);
+	}
 
-		if (visibleLightCount != 128) {
-			// Unless we have totally filled the entire array, mark it's end with -1
-			// Final shader step will use this to determine where to stop (without having to pass the light count)
-			visibleLightIndicesBuffer.data[offset + visibleLightCount].index = -1;
+	barrier();
+
+	// Step 5: Same test again, this time writing the indices
+	for (uint i = gl_LocalInvocationIndex; i < uint(lightCount); i += threadCount) {
+		if (isLightVisible(i, minDepth, maxDepth)) {
+			const uint slot = atomicAdd(tileWriteCursor, 1u);
+			if (slot < tileLightCapacity) {
+				lightIndices[tileLightOffset + slot] = i;
+			}
 		}
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,108 @@
+// Shared by the light culling compute shader and the shading passes.
+// Must match the layout of GPULight in RenderSystem.
+
+#define TILE_SIZE 16
+// Clustered shading, must match LightClusterGrid::TileSize
+#define CLUSTER_TILE_SIZE 64
+
+#define LIGHT_TYPE_POINT 0
+#define LIGHT_TYPE_SPOT 1
+
+struct Light {
+	vec4 colorAndType;			// rgb: color, w: LIGHT_TYPE_*
+	vec4 positionAndRadius;		// xyz: world position, w: radius of influence
+	vec4 directionAndCutoff;	// xyz: spot direction, w: cos(inner cutoff)
+	vec4 outerCutoff;			// x: cos(outer cutoff)
+};
+
+layout (std430, binding = 0) buffer LightBuffer {
+	Light lights[];
+};
+
+// Compacted list of visible light indices for all tiles
+layout (std430, binding = 1) buffer LightIndexBuffer {
+	uint lightIndices[];
+};
+
+// Per tile or cluster: x = offset into lightIndices, y = number of lights
+layout (std430, binding = 2) buffer LightGridBuffer {
+	uvec2 lightGrid[];
+};
+
+// Total number of indices the culling pass wanted to write (can exceed the capacity)
+layout (std430, binding = 3) buffer LightIndexCounter {
+	uint lightIndexCount;
+};
+
+// View-space AABB per cluster, see LightClusterGrid::Bounds
+struct ClusterBounds {
+	vec4 minPoint;
+	vec4 maxPoint;
+};
+
+layout (std430, binding = 4) buffer ClusterBoundsBuffer {
+	ClusterBounds clusterBounds[];
+};
+
+// View-space bounding sphere per light (xyz: center, w: radius), computed on the CPU
+layout (std430, binding = 5) buffer LightSphereBuffer {
+	vec4 lightSpheres[];
+};
+
+// Lights per cluster, written by the counting pass and scanned into lightGrid
+layout (std430, binding = 6) buffer ClusterLightCountBuffer {
+	uint clusterLightCounts[];
+};
+
+// ----------------------------------------------------------------------------
+// Sphere against cluster AABB. Must round exactly like LightClusterGrid::Intersects,
+// so no fused multiply-adds and the same evaluation order.
+bool sphereIntersectsCluster(const ClusterBounds bounds, const vec4 sphere) {
+	precise vec3 d = max(max(bounds.minPoint.xyz - sphere.xyz, sphere.xyz - bounds.maxPoint.xyz), vec3(0.0));
+	precise float distance2 = d.x * d.x + d.y * d.y + d.z * d.z;
+	precise float radius2 = sphere.w * sphere.w;
+	return distance2 <= radius2;
+}
+
+// Light list lookup for the shading passes
+uniform uint numTilesX;
+// 0: 2D tiles, 1: 3D clusters
+uniform uint lightGridMode;
+uniform uvec3 clusterDims;
+// Depth slice = log(view depth) * sliceScale + sliceBias
+uniform float sliceScale;
+uniform float sliceBias;
+
+// ----------------------------------------------------------------------------
+// Index into lightGrid for a pixel and its (positive) view-space depth
+uint lightGridIndex(const uvec2 pixel, const float viewDepth) {
+	if (lightGridMode == 0u) {
+		const uvec2 tile = pixel / uint(TILE_SIZE);
+		return tile.y * numTilesX + tile.x;
+	}
+
+	const uvec2 tile = pixel / uint(CLUSTER_TILE_SIZE);
+	const uint slice = min(uint(max(log(viewDepth) * sliceScale + sliceBias, 0.0)), clusterDims.z - 1u);
+	return (slice * clusterDims.y + tile.y) * clusterDims.x + tile.x;
+}
+
+// ----------------------------------------------------------------------------
+// Smooth inverse-square falloff that reaches exactly zero at the radius
+float lightAttenuation(const float distance, const float radius) {
+	const float ratio = distance / radius;
+	const float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+	return (window * window) / (distance * distance + 1.0);
+}
+
+// ----------------------------------------------------------------------------
+// Fraction of a light reaching fragPos, including the spot cone
+float lightFalloff(const Light light, const vec3 fragPos, const vec3 L) {
+	const float attenuation = lightAttenuation(length(light.positionAndRadius.xyz - fragPos), light.positionAndRadius.w);
+
+	if (int(light.colorAndType.w) == LIGHT_TYPE_SPOT) {
+		const float theta = dot(L, normalize(-light.directionAndCutoff.xyz));
+		return attenuation * smoothstep(light.outerCutoff.x, light.directionAndCutoff.w, theta);
+	}
+
+	return attenuation;
+}
@@ -0,0 +1,16 @@
+#version 440 core
+
+#include "Data/Shaders/vertexformat.glsl"
+#include "Data/Shaders/visibility.glsl"
+
+uniform usampler2D visibilityBuffer;
+
+void main() {
+    const uint visibility = texelFetch(visibilityBuffer, ivec2(gl_FragCoord.xy), 0).r;
+    if (visibility == 0u) {
+        discard;
+    }
+
+    const uint materialIndex = visibilityDraws[visibilityDrawIndex(visibility)].materialIndex;
+    gl_FragDepth = float(materialIndex + 1u) / float(MATERIAL_DEPTH_STEPS);
+}
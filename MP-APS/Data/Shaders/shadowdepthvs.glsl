@@ -1,5 +1,8 @@
 #version 440 core
-layout (location = 0) in vec3 position;
+
+#include "Data/Shaders/vertexformat.glsl"
+
+layout (location = 0) in vec4 position;
 
 uniform mat4 lightSpaceMatrix;
 uniform mat4 modelMatrix;
@@ -7,6 +10,6 @@ uniform mat4 modelMatrix;
 out float VertexDepth;
 
 void main() {
-    gl_Position = lightSpaceMatrix * modelMatrix * vec4(position, 1.0);
+    gl_Position = lightSpaceMatrix * modelMatrix * vec4(decodePosition(position), 1.0);
     VertexDepth = gl_Position.z;
 }
\ No newline at end of file
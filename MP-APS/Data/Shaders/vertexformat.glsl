@@ -0,0 +1,34 @@
+// Mesh vertex decoding, must match VertexCompressor.
+// Float meshes pass their attributes through, packed meshes store positions as unorm16 within
+// their bounds (the bitangent sign in w) and normals and tangents octahedral encoded.
+
+// xyz: model space size of the mesh bounds, w: 1 for packed vertices. 1 and 0 for float meshes.
+uniform vec4 positionScale;
+// Minimum corner of the mesh bounds, 0 for float meshes
+uniform vec3 positionOffset;
+
+// ----------------------------------------------------------------------------
+// Exact for float meshes, so passes drawing the same mesh get identical positions
+vec3 decodePosition(const vec4 position) {
+    return position.xyz * positionScale.xyz + positionOffset;
+}
+
+// ----------------------------------------------------------------------------
+// Unit vector from its octahedral encoding in [-1, 1]^2
+vec3 decodeOctahedral(const vec2 encoded) {
+    vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    const float fold = max(-direction.z, 0.0);
+    direction.xy += vec2(direction.x >= 0.0 ? -fold : fold, direction.y >= 0.0 ? -fold : fold);
+    return normalize(direction);
+}
+
+// ----------------------------------------------------------------------------
+vec3 decodeNormal(const vec3 normal) {
+    return positionScale.w > 0.5 ? decodeOctahedral(normal.xy) : normal;
+}
+
+// ----------------------------------------------------------------------------
+// xyz: tangent, w: bitangent sign
+vec4 decodeTangent(const vec4 position, const vec4 tangent) {
+    return positionScale.w > 0.5 ? vec4(decodeOctahedral(tangent.xy), position.w * 2.0 - 1.0) : tangent;
+}
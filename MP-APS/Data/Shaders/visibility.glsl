@@ -0,0 +1,144 @@
+// Visibility buffer layout and triangle reconstruction.
+// Must match RenderSystem (VisibilityDraw, TriangleBits, MaterialDepthSteps) and GeometryPool.
+// Include vertexformat.glsl first.
+
+// One texel: (draw index + 1) in the high bits, triangle index within the draw in the low bits.
+// 0 means nothing was drawn.
+#define TRIANGLE_BITS 20
+#define TRIANGLE_MASK 0xFFFFFu
+
+// Materials are written to a depth buffer as (index + 1) / MATERIAL_DEPTH_STEPS, which is
+// exact in a 32-bit float depth buffer
+#define MATERIAL_DEPTH_STEPS 1024
+
+// 32-bit words per Vertex (position, texcoords, normal, tangent) and VertexCompressor::PackedVertex
+#define VERTEX_WORDS 12
+#define PACKED_VERTEX_WORDS 5
+
+// VisibilityDraw flags
+#define PACKED_VERTICES 1u
+#define SHORT_INDICES 2u
+
+struct VisibilityDraw {
+	mat4 modelMatrix;
+	vec4 positionScale;		// xyz, packed vertices only
+	vec4 positionOffset;
+	uint vertexOffset;		// In words
+	uint firstIndex;		// In indices of the draw's size
+	uint materialIndex;
+	uint flags;
+};
+
+// Model space vertex
+struct PoolVertex {
+	vec3 position;
+	vec2 texCoords;
+	vec3 normal;
+	vec4 tangent;	// w: bitangent sign
+};
+
+layout (std430, binding = 7) buffer VisibilityDrawBuffer {
+	VisibilityDraw visibilityDraws[];
+};
+
+layout (std430, binding = 8) buffer VertexPool {
+	uint vertexData[];
+};
+
+layout (std430, binding = 9) buffer IndexPool {
+	uint indexData[];
+};
+
+// ----------------------------------------------------------------------------
+uint packVisibility(const uint drawIndex, const uint triangle) {
+	return ((drawIndex + 1u) << TRIANGLE_BITS) | (triangle & TRIANGLE_MASK);
+}
+
+// ----------------------------------------------------------------------------
+uint visibilityDrawIndex(const uint visibility) {
+	return (visibility >> TRIANGLE_BITS) - 1u;
+}
+
+// ----------------------------------------------------------------------------
+// Vertex index, relative to the draw's first vertex
+uint fetchIndex(const VisibilityDraw draw, const uint index) {
+	const uint position = draw.firstIndex + index;
+	if ((draw.flags & SHORT_INDICES) != 0u) {
+		return (indexData[position >> 1u] >> ((position & 1u) * 16u)) & 0xFFFFu;
+	}
+	return indexData[position];
+}
+
+// ----------------------------------------------------------------------------
+vec3 fetchVec3(const uint base) {
+	return vec3(uintBitsToFloat(vertexData[base]), uintBitsToFloat(vertexData[base + 1u]), uintBitsToFloat(vertexData[base + 2u]));
+}
+
+// ----------------------------------------------------------------------------
+PoolVertex fetchVertex(const VisibilityDraw draw, const uint vertex) {
+	PoolVertex result;
+
+	if ((draw.flags & PACKED_VERTICES) != 0u) {
+		const uint base = draw.vertexOffset + vertex * PACKED_VERTEX_WORDS;
+		const vec4 position = vec4(unpackUnorm2x16(vertexData[base]), unpackUnorm2x16(vertexData[base + 1u]));
+		result.position = position.xyz * draw.positionScale.xyz + draw.positionOffset.xyz;
+		result.texCoords = unpackHalf2x16(vertexData[base + 2u]);
+		result.normal = decodeOctahedral(unpackSnorm2x16(vertexData[base + 3u]));
+		result.tangent = vec4(decodeOctahedral(unpackSnorm2x16(vertexData[base + 4u])), position.w * 2.0 - 1.0);
+		return result;
+	}
+
+	const uint base = draw.vertexOffset + vertex * VERTEX_WORDS;
+	result.position = fetchVec3(base);
+	result.texCoords = vec2(uintBitsToFloat(vertexData[base + 3u]), uintBitsToFloat(vertexData[base + 4u]));
+	result.normal = fetchVec3(base + 5u);
+	result.tangent = vec4(fetchVec3(base + 8u), uintBitsToFloat(vertexData[base + 11u]));
+	return result;
+}
+
+// ----------------------------------------------------------------------------
+// Perspective-correct barycentrics of a pixel and their screen-space derivatives, from the
+// clip-space positions of the triangle. Replaces the rasterizer's interpolation and dFdx/dFdy.
+// After "The Forge" visibility buffer (Schied, Dachsbacher; Wihlidal).
+struct Barycentrics {
+	vec3 lambda;
+	vec3 ddx;
+	vec3 ddy;
+};
+
+Barycentrics computeBarycentrics(const vec4 clip0, const vec4 clip1, const vec4 clip2, const vec2 pixelNdc, const vec2 screenSize) {
+	Barycentrics result;
+
+	const vec3 invW = 1.0 / vec3(clip0.w, clip1.w, clip2.w);
+	const vec2 ndc0 = clip0.xy * invW.x;
+	const vec2 ndc1 = clip1.xy * invW.y;
+	const vec2 ndc2 = clip2.xy * invW.z;
+
+	const float invDet = 1.0 / determinant(mat2(ndc2 - ndc1, ndc0 - ndc1));
+	result.ddx = vec3(ndc1.y - ndc2.y, ndc2.y - ndc0.y, ndc0.y - ndc1.y) * invDet * invW;
+	result.ddy = vec3(ndc2.x - ndc1.x, ndc0.x - ndc2.x, ndc1.x - ndc0.x) * invDet * invW;
+	float ddxSum = dot(result.ddx, vec3(1.0));
+	float ddySum = dot(result.ddy, vec3(1.0));
+
+	const vec2 delta = pixelNdc - ndc0;
+	const float interpInvW = invW.x + delta.x * ddxSum + delta.y * ddySum;
+	const float interpW = 1.0 / interpInvW;
+
+	result.lambda.x = interpW * (invW.x + delta.x * result.ddx.x + delta.y * result.ddy.x);
+	result.lambda.y = interpW * (delta.x * result.ddx.y + delta.y * result.ddy.y);
+	result.lambda.z = interpW * (delta.x * result.ddx.z + delta.y * result.ddy.z);
+
+	// NDC to pixel steps
+	result.ddx *= 2.0 / screenSize.x;
+	result.ddy *= 2.0 / screenSize.y;
+	ddxSum *= 2.0 / screenSize.x;
+	ddySum *= 2.0 / screenSize.y;
+
+	// Barycentrics one pixel to the right and up, minus the current ones
+	const float interpWx = 1.0 / (interpInvW + ddxSum);
+	const float interpWy = 1.0 / (interpInvW + ddySum);
+	result.ddx = interpWx * (result.lambda * interpInvW + result.ddx) - result.lambda;
+	result.ddy = interpWy * (result.lambda * interpInvW + result.ddy) - result.lambda;
+
+	return result;
+}
@@ -0,0 +1,13 @@
+#version 440 core
+
+#include "Data/Shaders/vertexformat.glsl"
+#include "Data/Shaders/visibility.glsl"
+
+// Index of the current draw in visibilityDraws
+uniform uint drawIndex;
+
+layout (location = 0) out uint visibility;
+
+void main() {
+    visibility = packVisibility(drawIndex, uint(gl_PrimitiveID));
+}
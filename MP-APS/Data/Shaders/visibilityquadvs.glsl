@@ -0,0 +1,10 @@
+#version 440 core
+
+layout (location = 0) in vec3 position;
+
+// NDC depth of the quad, selects one material with GL_EQUAL against the material depth buffer
+uniform float materialDepth;
+
+void main() {
+    gl_Position = vec4(position.xy, materialDepth, 1.0);
+}
@@ -0,0 +1,122 @@
+#version 440 core
+
+#include "Data/Shaders/lightgrid.glsl"
+#include "Data/Shaders/pbr.glsl"
+#include "Data/Shaders/vertexformat.glsl"
+#include "Data/Shaders/visibility.glsl"
+
+layout (std140, binding = 0) uniform Matrices {
+  mat4 projection;
+  mat4 view;
+};
+
+uniform usampler2D visibilityBuffer;
+
+// IBL
+uniform samplerCube irradianceMap;
+uniform samplerCube prefilterMap;
+uniform sampler2D brdfLUT;
+
+// PBR material parameters of the material being resolved
+uniform sampler2D albedoMap;
+uniform sampler2D normalMap;
+uniform sampler2D metallicMap;
+uniform sampler2D roughnessMap;
+
+// Shadow map
+uniform sampler2D shadowMap;
+uniform mat4 lightSpaceMatrix;
+
+uniform vec2 screenSize;
+uniform float bloomThreshold;
+
+// lights
+uniform vec3 directionalLight;
+uniform vec3 lightColor;
+
+uniform vec3 camPos;
+
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec4 BrightColor;
+
+// ----------------------------------------------------------------------------
+vec3 interpolate(const Barycentrics bary, const vec3 a, const vec3 b, const vec3 c) {
+    return bary.lambda.x * a + bary.lambda.y * b + bary.lambda.z * c;
+}
+
+// ----------------------------------------------------------------------------
+void main() {
+    // Only pixels of this material pass the depth test, so this runs once per pixel
+    const uint visibility = texelFetch(visibilityBuffer, ivec2(gl_FragCoord.xy), 0).r;
+    const VisibilityDraw draw = visibilityDraws[visibilityDrawIndex(visibility)];
+    const uint firstIndex = (visibility & TRIANGLE_MASK) * 3u;
+
+    const PoolVertex v0 = fetchVertex(draw, fetchIndex(draw, firstIndex));
+    const PoolVertex v1 = fetchVertex(draw, fetchIndex(draw, firstIndex + 1u));
+    const PoolVertex v2 = fetchVertex(draw, fetchIndex(draw, firstIndex + 2u));
+
+    // Same transforms as PBRvs
+    const vec3 p0 = vec3(draw.modelMatrix * vec4(v0.position, 1.0));
+    const vec3 p1 = vec3(draw.modelMatrix * vec4(v1.position, 1.0));
+    const vec3 p2 = vec3(draw.modelMatrix * vec4(v2.position, 1.0));
+
+    const mat4 viewProjection = projection * view;
+    const vec2 pixelNdc = gl_FragCoord.xy / screenSize * 2.0 - 1.0;
+    const Barycentrics bary = computeBarycentrics(viewProjection * vec4(p0, 1.0), viewProjection * vec4(p1, 1.0), viewProjection * vec4(p2, 1.0), pixelNdc, screenSize);
+
+    const vec3 fragPos = interpolate(bary, p0, p1, p2);
+
+    // Texture coordinates and their derivatives for mip selection
+    const vec2 uv0 = v0.texCoords;
+    const vec2 uv1 = v1.texCoords;
+    const vec2 uv2 = v2.texCoords;
+    const vec2 texCoords = bary.lambda.x * uv0 + bary.lambda.y * uv1 + bary.lambda.z * uv2;
+    const vec2 texCoordsDx = bary.ddx.x * uv0 + bary.ddx.y * uv1 + bary.ddx.z * uv2;
+    const vec2 texCoordsDy = bary.ddy.x * uv0 + bary.ddy.y * uv1 + bary.ddy.z * uv2;
+
+    // Construct TBN matrix
+    const vec3 normal = interpolate(bary, v0.normal, v1.normal, v2.normal);
+    const vec3 tangent = interpolate(bary, v0.tangent.xyz, v1.tangent.xyz, v2.tangent.xyz);
+    const vec3 Nv = normalize(vec3(draw.modelMatrix * vec4(normal, 0.0)));
+    vec3 T = normalize(vec3(draw.modelMatrix * vec4(tangent, 0.0)));
+    T = normalize(T - dot(T, Nv) * Nv);
+    // Mirrored texture coordinates don't share vertices, so one sign holds for the triangle
+    const mat3 TBN = mat3(T, cross(Nv, T) * v0.tangent.w, Nv);
+
+    // material properties
+    const vec3 albedo = pow(textureGrad(albedoMap, texCoords, texCoordsDx, texCoordsDy).rgb, vec3(2.2));
+    const float metallic = textureGrad(metallicMap, texCoords, texCoordsDx, texCoordsDy).r;
+    const float roughness = textureGrad(roughnessMap, texCoords, texCoordsDx, texCoordsDy).r;
+
+    // Normal maps may be BC5 (two channels), z is rebuilt from x and y
+    const vec2 Nxy = textureGrad(normalMap, texCoords, texCoordsDx, texCoordsDy).rg * 2.0 - 1.0;
+    vec3 N = vec3(Nxy, sqrt(max(1.0 - dot(Nxy, Nxy), 0.0)));
+    N = normalize(TBN * N);
+    const vec3 V = normalize(camPos - fragPos);
+
+    vec3 F0 = vec3(0.04);
+    F0 = mix(F0, albedo, metallic);
+
+    // Sun
+    const float shadow = ComputeShadow(shadowMap, lightSpaceMatrix * vec4(fragPos, 1.0));
+    vec3 Lo = CookTorrance(N, V, normalize(directionalLight), lightColor, albedo, metallic, roughness, F0) * shadow;
+
+    // Point and spot lights culled for this tile or cluster
+    const float viewDepth = -(view * vec4(fragPos, 1.0)).z;
+    const uvec2 tileLights = lightGrid[lightGridIndex(uvec2(gl_FragCoord.xy), viewDepth)];
+    for (uint i = 0; i < tileLights.y; ++i) {
+        const Light light = lights[lightIndices[tileLights.x + i]];
+        const vec3 L = normalize(light.positionAndRadius.xyz - fragPos);
+        const vec3 radiance = light.colorAndType.rgb * lightFalloff(light, fragPos, L);
+
+        Lo += CookTorrance(N, V, L, radiance, albedo, metallic, roughness, F0);
+    }
+
+    const vec3 ambient = ImageBasedLighting(irradianceMap, prefilterMap, brdfLUT, N, V, albedo, metallic, roughness, F0);
+    const vec3 color = ambient * 0.5 + Lo;
+
+    // Apply bloom threshold
+    const float brightness = dot(color, vec3(0.2126, 0.7152, 0.0722));
+    BrightColor = brightness > bloomThreshold ? vec4(color, 1.0) : vec4(0.0, 0.0, 0.0, 1.0);
+    FragColor = vec4(color, 1.0);
+}
@@ -1,6 +1,12 @@
 #include "DemoCrytekSponza.h"
 
 #include "../ResourceManager.h"
+#include "../Core/Profiler.h"
+
+#include <glm/trigonometric.hpp>
+
+#include <array>
+#include <cmath>
 
 
 /***********************************************************************************/
@@ -9,6 +15,7 @@ DemoCrytekSponza::DemoCrytekSponza() {
 
 /***********************************************************************************/
 void DemoCrytekSponza::Init(const std::string_view sceneName) {
+	PROFILE_FUNCTION();
 	SceneBase::Init(sceneName);
 
 	auto model = ResourceManager::GetInstance().GetModel("Sponza", "Data/Models/crytek-sponza/sponza.obj");
@@ -18,5 +25,19 @@ void DemoCrytekSponza::Init(const std::string_view sceneName) {
 
 	// Sun
 	AddLight(StaticDirectionalLight({ 5.0f, 5.0f, 4.5f }, { 25.0f, 50.0f, 10.0f }));
+
+	// Rows of coloured point lights along both floors of the atrium
+	const std::array<glm::vec3, 4> colors{ glm::vec3(4.0f, 1.0f, 0.5f), glm::vec3(0.5f, 2.0f, 4.0f), glm::vec3(1.0f, 4.0f, 1.0f), glm::vec3(4.0f, 3.0f, 1.5f) };
+	std::size_t colorIndex{ 0 };
+	for (const auto y : { 1.5f, 6.5f }) {
+		for (const auto z : { -4.0f, 4.0f }) {
+			for (auto x = -12.0f; x <= 12.0f; x += 4.0f) {
+				AddLight(StaticPointLight(colors[colorIndex++ % colors.size()], { x, y, z }, 5.0f));
+			}
+		}
+	}
+
+	// Spot light looking down onto the courtyard
+	AddLight(StaticSpotLight({ 8.0f, 8.0f, 6.0f }, { 0.0f, 10.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }, std::cos(glm::radians(20.0f)), std::cos(glm::radians(30.0f)), 15.0f));
 }
 
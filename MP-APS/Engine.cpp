@@ -4,17 +4,23 @@
 #include "ViewFrustum.h"
 #include "ResourceManager.h"
 #include "SceneBase.h"
+#include "Core/JobSystem.h"
+#include "Core/Profiler.h"
 
 #include <GLFW/glfw3.h>
 #include <pugixml.hpp>
-#include <concrtrm.h>
 
 #include <iostream>
 #include <algorithm>
-#include <execution>
+#include <array>
+#include <thread>
 
 /***********************************************************************************/
-Engine::Engine(const std::filesystem::path& configPath) {
+Engine::Engine(const std::filesystem::path& configPath, const EngineOptions& options) : m_benchmarkMode(options.Benchmark || options.Regression),
+																						 m_regressionMode(options.Regression),
+																						 m_allowMissingReferences(options.AllowMissingReferences) {
+	PROFILE_THREAD("Main");
+	PROFILE_SCOPE("Engine startup");
 
 	std::cout << "**************************************************\n";
 	std::cout << "Engine starting up...\n";
@@ -22,7 +28,7 @@ Engine::Engine(const std::filesystem::path& configPath) {
 	std::cout << "DEBUG MODE!!\n";
 #endif
 	std::cout << "**************************************************\n";
-	std::cout << "Available processor cores: " << Concurrency::GetProcessorCount() << '\n';
+	std::cout << "Available processor cores: " << std::thread::hardware_concurrency() << '\n';
 	std::cout << "**************************************************\n";
 	std::cout << "Loading Engine config file...\n";
 	
@@ -32,15 +38,105 @@ Engine::Engine(const std::filesystem::path& configPath) {
 
 	const auto& engineNode{ doc.child("Engine") };
 
+	const auto& frameStatsNode{ engineNode.child("FrameStats") };
+	m_frameStatistics.Init(frameStatsNode.attribute("window").as_uint(1000), frameStatsNode.attribute("budgetMs").as_double(1000.0 / 60.0));
+	m_frameStatsCSV = frameStatsNode.attribute("csv").as_string();
+	m_frameStatsJSON = frameStatsNode.attribute("json").as_string();
+
+#ifdef ENABLE_PROFILER
+	const auto& profilerNode{ engineNode.child("Profiler") };
+	const auto captureFrames{ profilerNode.attribute("frames").as_ullong(0) };
+	if (captureFrames > 0) {
+		const std::string_view format{ profilerNode.attribute("format").as_string("chrome") };
+		Profiler::GetInstance().RequestCapture(profilerNode.attribute("firstFrame").as_ullong(0), captureFrames,
+			format == "binary" ? Profiler::Format::Binary : Profiler::Format::ChromeTrace, profilerNode.attribute("path").as_string("profile.json"));
+	}
+#endif
+
+	ResourceManager::GetInstance().SetMeshCacheDirectory(engineNode.child("MeshCache").attribute("path").as_string());
+	ResourceManager::GetInstance().SetVertexFormat(VertexCompressor::GetFormat(engineNode.child("Vertices").attribute("format").as_string("float")));
+	ResourceManager::GetInstance().SetMipFilter(MipGenerator::GetFilter(engineNode.child("MipMaps").attribute("filter").as_string("box")));
+	const auto& textureCompressionNode{ engineNode.child("TextureCompression") };
+	ResourceManager::GetInstance().SetTextureCompression(textureCompressionNode.attribute("enabled").as_bool(false),
+		textureCompressionNode.attribute("path").as_string(), std::string_view(textureCompressionNode.attribute("albedo").as_string("bc1")) == "bc7");
+	const auto& textureUploadNode{ engineNode.child("TextureUpload") };
+	ResourceManager::GetInstance().SetTextureUploads(textureUploadNode.attribute("async").as_bool(false),
+		textureUploadNode.attribute("budgetMs").as_double(2.0), textureUploadNode.attribute("buffers").as_uint(4));
+	const auto& textureStreamingNode{ engineNode.child("TextureStreaming") };
+	// Benchmarks and regression runs have to see the same textures every run
+	ResourceManager::GetInstance().SetTextureStreaming(textureStreamingNode.attribute("enabled").as_bool(false) && !m_benchmarkMode,
+		static_cast<std::size_t>(textureStreamingNode.attribute("budgetMB").as_double(256.0) * 1024.0 * 1024.0), textureStreamingNode.attribute("tailSize").as_int(64),
+		textureStreamingNode.attribute("maxLoads").as_uint(8), textureStreamingNode.attribute("bias").as_float(0.0f));
+	const auto& residencyNode{ engineNode.child("Residency") };
+	ResourceManager::GetInstance().SetResidency(residencyNode.attribute("enabled").as_bool(false) && !m_benchmarkMode,
+		static_cast<std::size_t>(residencyNode.attribute("budgetMB").as_double(1024.0) * 1024.0 * 1024.0));
+
 	std::cout << "**************************************************\n";
-	std::cout << "Initializing Window...\n";
-	m_window.Init(engineNode.child("Window"));
+	std::cout << "Initializing Job System...\n";
+	// 0 threads = one per hardware thread
+	JobSystem::GetInstance().Init(engineNode.child("Jobs").attribute("threads").as_uint(0));
+	std::cout << "Job System threads: " << JobSystem::GetInstance().GetNumThreads() << '\n';
+
+	if (m_benchmarkMode) {
+		m_benchmark.Init(engineNode.child("Benchmark"));
+		m_cameraPath = m_benchmark.GetCameraPath();
+		m_cameraPlayback = true;
+		m_fixedTimestep = m_benchmark.GetTimestep();
+	}
+	if (m_regressionMode) {
+		m_regressionGate.Init(engineNode.child("Regression"), options.UpdateGolden);
+	}
+
+	const auto& cameraPathNode{ engineNode.child("CameraPath") };
+	m_recordPath = cameraPathNode.attribute("record").as_string("camerapath.txt");
+	m_recordInterval = cameraPathNode.attribute("recordInterval").as_double(0.0);
+	const auto playPath{ options.PlayPath.empty() ? std::filesystem::path(cameraPathNode.attribute("play").as_string()) : options.PlayPath };
+	if (!playPath.empty()) {
+		CameraPath path;
+		if (path.LoadFile(playPath) && !path.IsEmpty()) {
+			m_cameraPath = std::move(path);
+			m_cameraPlayback = true;
+			if (!m_benchmarkMode) {
+				m_fixedTimestep = cameraPathNode.attribute("timestep").as_double(1.0 / 60.0);
+			}
+			std::cout << "Playing camera path " << playPath << ": " << m_cameraPath.GetKeys().size() << " keys, " << m_cameraPath.GetDuration() << " s\n";
+		}
+	}
+
+	std::cout << "**************************************************\n";
+	std::cout << (m_benchmarkMode ? "Initializing headless context...\n" : "Initializing Window...\n");
+	m_window.Init(engineNode.child("Window"), m_benchmarkMode);
 
 	std::cout << "**************************************************\n";
 	std::cout << "Initializing OpenGL Renderer...\n";
-	m_renderer.Init(engineNode.child("Renderer"));
+	m_renderer.Init(engineNode.child("Renderer"), m_window.GetProcLoader(), m_window.IsHeadless());
+	m_depthPrepass = engineNode.child("Renderer").attribute("depthPrepass").as_bool(false);
+	const std::string_view lightAssignment{ engineNode.child("Renderer").attribute("lightAssignment").as_string("tiled") };
+	if (lightAssignment == "clusteredGPU") {
+		m_lightAssignment = LightAssignment::ClusteredGPU;
+	}
+	else if (lightAssignment == "clusteredCPU") {
+		m_lightAssignment = LightAssignment::ClusteredCPU;
+	}
+
+	if (m_benchmarkMode) {
+		// Frames are rendered one after the other so every run is the same
+		std::cout << "**************************************************\n";
+		std::cout << "Benchmark mode: " << m_benchmark.GetTotalFrames() << " frames, " << m_benchmark.GetTimestep() * 1000.0 << " ms timestep\n";
+		return;
+	}
 
 	m_guiSystem.Init(m_window.m_window);
+
+	const auto& pipelineNode{ engineNode.child("Pipeline") };
+	m_pipelined = pipelineNode.attribute("enabled").as_bool(false);
+	m_framePipeline.Init(pipelineNode.attribute("depth").as_uint(1));
+	if (m_pipelined) {
+		std::cout << "**************************************************\n";
+		std::cout << "Frame pipelining enabled, depth: " << m_framePipeline.GetDepth() << '\n';
+		// nuklear polls GLFW input, which may only happen on the main thread
+		std::cout << "GUI is disabled while pipelining.\n";
+	}
 }
 
 /***********************************************************************************/
@@ -58,11 +154,10 @@ void Engine::SetActiveScene(const std::string_view sceneName) {
 	}
 
 	m_activeScene = scene->second.get();
-	m_renderer.UpdateView(m_camera);
 }
 
 /***********************************************************************************/
-void Engine::Execute() {
+int Engine::Execute() {
 
 	if (m_activeScene == nullptr) {
 		std::cerr << "Engine Error: No active scene specified!" << std::endl;
@@ -71,58 +166,433 @@ void Engine::Execute() {
 
 	std::cout << "**************************************************\n";
 	std::cout << "Engine initialization complete!\n";
+	// Benchmarks measure the finished scene, otherwise textures stream in over the first frames
+	if (m_benchmarkMode) {
+		ResourceManager::GetInstance().FinishTextureUploads();
+	}
+	if (!ResourceManager::GetInstance().IsLoadingTextures()) {
+		const auto& textureMemory{ ResourceManager::GetInstance().GetTextureMemory() };
+		std::cout << "Texture VRAM: " << textureMemory.ResidentBytes / (1024.0 * 1024.0) << " MB, "
+			<< textureMemory.UncompressedBytes / (1024.0 * 1024.0) << " MB uncompressed\n";
+	}
 	std::cout << "**************************************************\n";
 
-	// Main loop
+	auto regression{ RegressionGate::Result::Passed };
+	if (m_benchmarkMode) {
+		executeBenchmark();
+		if (m_regressionMode) {
+			regression = executeRegression();
+		}
+	}
+	else if (m_pipelined) {
+		executePipelined();
+	}
+	else {
+		executeSequential();
+	}
+
+	if (m_recordingCamera) {
+		stopCameraRecording();
+	}
+
+	shutdown();
+
+	switch (regression) {
+	case RegressionGate::Result::Failed:
+		return 1;
+	case RegressionGate::Result::NotConfigured:
+		// Nothing can be checked without references, so this fails CI unless explicitly allowed
+		if (!m_allowMissingReferences) {
+			std::cerr << "Regression: references are missing, run with --update-golden to create them\n";
+			return 1;
+		}
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+/***********************************************************************************/
+void Engine::shutdown() {
+	m_frameStatistics.Print(std::cout);
+	if (ResourceManager::GetInstance().IsResidencyEnabled()) {
+		const auto residency{ ResourceManager::GetInstance().GetResidencyStats() };
+		std::cout << "Residency: " << residency.Evictions << " evictions, " << residency.Reloads << " reloads, "
+			<< residency.NumEvicted << " of " << residency.NumResources << " resources evicted at exit\n";
+	}
+	if (!m_frameStatsCSV.empty()) {
+		m_frameStatistics.WriteCSV(m_frameStatsCSV);
+	}
+	if (!m_frameStatsJSON.empty()) {
+		m_frameStatistics.WriteJSON(m_frameStatsJSON);
+	}
+
+	if (!m_benchmarkMode) {
+		m_guiSystem.Shutdown();
+	}
+	m_renderer.Shutdown();
+	ResourceManager::GetInstance().ReleaseAllResources();
+	m_window.Shutdown();
+	JobSystem::GetInstance().Shutdown();
+}
+
+/***********************************************************************************/
+void Engine::executeSequential() {
 	while (!m_window.ShouldClose()) {
+		const auto snapshot{ simulate() };
 
-		m_timer.Update(glfwGetTime());
-		const auto dt{ m_timer.GetDelta() };
+		ResourceManager::GetInstance().ProcessTextureUploads();
+		ResourceManager::GetInstance().UpdateResidency(snapshot);
 
-		Input::GetInstance().Update();
+		double submitMs{ 0.0 };
+		{
+			ScopedTimer timer(submitMs);
+			m_renderer.Render(snapshot);
 
-		m_window.Update();
+			PROFILE_SCOPE("GUI");
+			GPUProfiler::Scope gpuScope(m_renderer.GetGPUProfiler(), "GUI");
+			m_guiSystem.Render();
+		}
 
-		m_camera.Update(dt);
+		{
+			PROFILE_SCOPE("SwapBuffers");
+			m_window.SwapBuffers();
+		}
+
+		reportFrame(makeFrameResult(snapshot, submitMs));
+	}
+}
+
+/***********************************************************************************/
+void Engine::executePipelined() {
+	// The render thread owns the GL context until it is joined
+	m_window.DetachContext();
+	std::thread renderThread(&Engine::renderLoop, this);
+
+	while (!m_window.ShouldClose()) {
+		auto snapshot{ simulate() };
+
+		for (const auto& result : m_framePipeline.TakeResults()) {
+			reportFrame(result);
+		}
 
-		m_activeScene->Update(dt);
+		// Blocks while the render thread is `depth` frames behind
+		if (!m_framePipeline.Submit(std::move(snapshot))) {
+			break;
+		}
+	}
 
-		m_renderer.Update(m_camera);
+	m_framePipeline.Shutdown();
+	renderThread.join();
 
-		const auto& renderList{ cullViewFrustum() };
-		m_renderer.Render(m_camera, renderList.cbegin(), renderList.cend(), *m_activeScene, false);
+	m_window.MakeContextCurrent();
+}
 
-		m_guiSystem.Render();
+/***********************************************************************************/
+void Engine::renderLoop() {
+	PROFILE_THREAD("Render");
+	m_window.MakeContextCurrent();
+
+	RenderSnapshot snapshot;
+	while (m_framePipeline.Acquire(snapshot)) {
+		ResourceManager::GetInstance().ProcessTextureUploads();
+		ResourceManager::GetInstance().UpdateResidency(snapshot);
+
+		double submitMs{ 0.0 };
+		{
+			ScopedTimer timer(submitMs);
+			m_renderer.Render(snapshot);
+		}
 
 		m_window.SwapBuffers();
+
+		m_framePipeline.Complete(makeFrameResult(snapshot, submitMs));
 	}
 
-	shutdown();
+	m_window.DetachContext();
 }
 
 /***********************************************************************************/
-void Engine::shutdown() const {
-	m_guiSystem.Shutdown();
-	m_renderer.Shutdown();
-	ResourceManager::GetInstance().ReleaseAllResources();
-	m_window.Shutdown();
+void Engine::executeBenchmark() {
+	for (std::size_t frame = 0; frame < m_benchmark.GetTotalFrames(); ++frame) {
+		const auto snapshot{ simulate() };
+
+		double submitMs{ 0.0 };
+		{
+			ScopedTimer timer(submitMs);
+			m_renderer.Render(snapshot);
+		}
+
+		// Nothing is presented, waiting for the GPU makes the frame time include its work
+		{
+			PROFILE_SCOPE("Finish");
+			glFinish();
+		}
+
+		const auto result{ makeFrameResult(snapshot, submitMs) };
+		reportFrame(result);
+		m_benchmark.AddFrame(result, m_renderer.GetFrameStats());
+	}
+
+	m_benchmark.Print(std::cout);
+	const auto& dims{ m_window.GetFramebufferDims() };
+	m_benchmark.WriteReport(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), dims.first, dims.second, m_renderer.GetMemoryStats(),
+		ResourceManager::GetInstance().GetTextureMemory());
 }
 
 /***********************************************************************************/
-std::vector<ModelPtr> Engine::cullViewFrustum() const {
-	std::vector<ModelPtr> renderList;
+RegressionGate::Result Engine::executeRegression() {
+	const std::string renderer{ reinterpret_cast<const char*>(glGetString(GL_RENDERER)) };
+	auto metrics{ m_benchmark.GetMetrics() };
 
+	// Each view is held until temporal effects have settled, then the last frame is read back
+	for (const auto& view : m_regressionGate.GetViews()) {
+		m_cameraPath.Clear();
+		m_cameraPath.AddKey({ 0.0, view.Position, view.Yaw, view.Pitch });
+
+		for (std::size_t frame = 0; frame < m_regressionGate.GetSettleFrames(); ++frame) {
+			m_renderer.Render(simulate());
+		}
+
+		std::vector<std::uint8_t> pixels;
+		int width, height;
+		if (!m_renderer.ReadOutput(pixels, width, height)) {
+			std::cerr << "Regression: the renderer has no offscreen output to read\n";
+			return RegressionGate::Result::Failed;
+		}
+
+		m_regressionGate.CheckImage(view, pixels, width, height);
+		// Deterministic for a fixed view, catches culling and batching changes
+		metrics.push_back({ view.Name + "_draw_calls", static_cast<double>(m_renderer.GetFrameStats().NumDrawCalls) });
+	}
+
+	m_regressionGate.CheckMetrics(metrics, renderer);
+	m_regressionGate.PrintSummary(std::cout);
+
+	return m_regressionGate.GetResult();
+}
+
+/***********************************************************************************/
+RenderSnapshot Engine::simulate() {
+	PROFILE_FRAME(m_frameIndex);
+	PROFILE_FUNCTION();
+	const auto start{ Timer::GetTime() };
+	m_timer.Update(Timer::GetTime());
+	const auto dt{ m_fixedTimestep > 0.0 ? m_fixedTimestep : m_timer.GetDelta() };
+
+	Input::GetInstance().Update();
+
+	m_window.Update();
+
+	RenderSnapshot snapshot;
+	snapshot.FrameIndex = m_frameIndex++;
+	snapshot.InputTime = Timer::GetTime();
+
+	if (m_cameraPlayback) {
+		const auto key{ m_cameraPath.Evaluate(m_simulatedTime) };
+		m_camera.SetPose(key.Position, key.Yaw, key.Pitch);
+
+		// Benchmarks stop after their frame count, interactive playback at the end of the path
+		if (!m_benchmarkMode && m_simulatedTime >= m_cameraPath.GetDuration()) {
+			std::cout << "Camera path finished\n";
+			m_window.RequestClose();
+		}
+	}
+	else {
+		m_camera.Update(dt);
+
+		if (Input::GetInstance().IsKeyPressed(GLFW_KEY_R)) {
+			if (m_recordingCamera) {
+				stopCameraRecording();
+			}
+			else {
+				startCameraRecording();
+			}
+		}
+		if (m_recordingCamera) {
+			recordCameraKey(false);
+		}
+	}
+	m_simulatedTime += dt;
+
+	m_activeScene->Update(dt);
+
+	if (Input::GetInstance().IsKeyPressed(GLFW_KEY_P)) {
+		m_depthPrepass = !m_depthPrepass;
+		std::cout << "Depth prepass: " << (m_depthPrepass ? "on" : "off") << '\n';
+	}
+	snapshot.DepthPrepass = m_depthPrepass;
+
+	if (Input::GetInstance().IsKeyPressed(GLFW_KEY_L)) {
+		static constexpr std::array<const char*, 3> modeNames{ "tiled", "clustered (GPU)", "clustered (CPU)" };
+		m_lightAssignment = static_cast<LightAssignment>((static_cast<int>(m_lightAssignment) + 1) % modeNames.size());
+		std::cout << "Light assignment: " << modeNames[static_cast<int>(m_lightAssignment)] << '\n';
+	}
+	snapshot.LightAssignmentMode = m_lightAssignment;
+	snapshot.VerifyLightClusters = Input::GetInstance().IsKeyPressed(GLFW_KEY_V);
+
+	if (Input::GetInstance().IsKeyPressed(GLFW_KEY_F)) {
+		m_frameStatistics.Print(std::cout);
+	}
+
+	const auto& dims{ m_window.GetFramebufferDims() };
+	snapshot.Width = dims.first;
+	snapshot.Height = dims.second;
+	snapshot.ViewMatrix = m_camera.GetViewMatrix();
+	snapshot.ProjMatrix = m_camera.GetProjMatrix(dims.first, dims.second);
+	snapshot.CameraPosition = m_camera.GetPosition();
+
+	const auto& renderList{ cullViewFrustum() };
+	snapshot.Instances.reserve(renderList.size());
+	for (const auto& model : renderList) {
+		snapshot.Instances.push_back({ model, model->GetModelMatrix() });
+	}
+	if (ResourceManager::GetInstance().IsStreamingTextures()) {
+		requestTextureDetail(snapshot);
+	}
+
+	snapshot.DirectionalLights = m_activeScene->m_staticDirectionalLights;
+	snapshot.PointLights = m_activeScene->m_staticPointLights;
+	snapshot.SpotLights = m_activeScene->m_staticSpotLights;
+
+	snapshot.SimulateMs = (Timer::GetTime() - start) * 1000.0;
+	return snapshot;
+}
+
+/***********************************************************************************/
+void Engine::startCameraRecording() {
+	m_recordedPath.Clear();
+	m_recordingCamera = true;
+	m_recordStartTime = m_simulatedTime;
+	std::cout << "Recording camera path...\n";
+}
+
+/***********************************************************************************/
+void Engine::stopCameraRecording() {
+	// Keep the final pose even if it falls between two keys
+	recordCameraKey(true);
+	m_recordingCamera = false;
+
+	if (m_recordedPath.Save(m_recordPath)) {
+		std::cout << "Recorded camera path: " << m_recordedPath.GetKeys().size() << " keys, " << m_recordedPath.GetDuration() << " s to " << m_recordPath << '\n';
+	}
+}
+
+/***********************************************************************************/
+void Engine::recordCameraKey(const bool force) {
+	const auto time{ m_simulatedTime - m_recordStartTime };
+	const auto& keys{ m_recordedPath.GetKeys() };
+	if (!keys.empty() && (time <= keys.back().Time || (!force && time - keys.back().Time < m_recordInterval))) {
+		return;
+	}
+
+	m_recordedPath.AddKey({ time, m_camera.GetPosition(), m_camera.GetYaw(), m_camera.GetPitch() });
+}
+
+/***********************************************************************************/
+FramePipeline::FrameResult Engine::makeFrameResult(const RenderSnapshot& snapshot, const double submitMs) const {
+	const auto& renderStats{ m_renderer.GetFrameStats() };
+	const auto presentTime{ Timer::GetTime() };
+
+	return { snapshot.FrameIndex, (presentTime - snapshot.InputTime) * 1000.0, renderStats.RecordMs, renderStats.SubmitMs, renderStats.LightAssignMs, renderStats.ShadedFragments, renderStats.GBufferMB, renderStats.SceneGpuMs, renderStats.RenderScale,
+			 m_renderer.GetGPUProfiler().GetLastFrame(), presentTime, snapshot.SimulateMs + submitMs };
+}
+
+/***********************************************************************************/
+void Engine::reportFrame(const FramePipeline::FrameResult& result) {
+	m_timer.AddScopeTime("record", result.RecordMs);
+	m_timer.AddScopeTime("submit", result.SubmitMs);
+	// Only the clustered CPU mode assigns lights on the CPU
+	if (result.LightAssignMs > 0.0) {
+		m_timer.AddScopeTime("light assign", result.LightAssignMs);
+	}
+	m_timer.AddScopeTime("input latency", result.LatencyMs);
+	m_timer.AddCounter("PBR fragments (M)", static_cast<double>(result.ShadedFragments) / 1e6);
+	if (result.GBufferMB > 0.0) {
+		m_timer.AddCounter("G-buffer traffic (MB)", result.GBufferMB);
+	}
+	// 0 until the first timer query has been read back
+	if (result.SceneGpuMs > 0.0) {
+		m_timer.AddScopeTime("scene GPU", result.SceneGpuMs);
+	}
+	m_timer.AddCounter("render scale", result.RenderScale);
+	// GPU pass times next to the CPU scopes
+	double gpuMs{ 0.0 };
+	for (const auto& pass : result.GpuPasses) {
+		m_timer.AddScopeTime(std::string("GPU ").append(pass.Name), pass.Milliseconds);
+		gpuMs += pass.Milliseconds;
+	}
+
+	// Present to present, the first frame has nothing to compare against
+	const auto frameMs{ m_lastPresentTime > 0.0 ? (result.PresentTime - m_lastPresentTime) * 1000.0 : 0.0 };
+	m_lastPresentTime = result.PresentTime;
+	m_frameStatistics.AddFrame({ frameMs, result.CpuMs, gpuMs });
+}
+
+/***********************************************************************************/
+std::vector<ModelPtr> Engine::cullViewFrustum() const {
+	PROFILE_FUNCTION();
 	const auto& dims{ m_window.GetFramebufferDims() };
 	const ViewFrustum viewFrustum(m_camera.GetViewMatrix(), m_camera.GetProjMatrix(dims.first, dims.second));
 
-	std::for_each(std::execution::parallel_unsequenced_policy(), m_activeScene->m_sceneModels.cbegin(), m_activeScene->m_sceneModels.cend(), 
-		[&](const auto& model) {
-		const auto result{ viewFrustum.TestIntersection(model->GetBoundingBox()) };
+	const auto& models{ m_activeScene->m_sceneModels };
 
-		if (result == BoundingVolume::TestResult::INSIDE || result == BoundingVolume::TestResult::INTERSECT) {
-			renderList.push_back(model);
+	// Test in parallel, each job only writes its own slots
+	std::vector<char> visible(models.size(), false);
+	JobSystem::GetInstance().ParallelFor(models.size(), [&](const auto begin, const auto end) {
+		for (auto i = begin; i < end; ++i) {
+			const auto result{ viewFrustum.TestIntersection(models[i]->GetBoundingBox()) };
+			visible[i] = result == BoundingVolume::TestResult::INSIDE || result == BoundingVolume::TestResult::INTERSECT;
 		}
 	});
 
+	// Compact in scene order
+	std::vector<ModelPtr> renderList;
+	renderList.reserve(models.size());
+	for (std::size_t i = 0; i < models.size(); ++i) {
+		if (visible[i]) {
+			renderList.push_back(models[i]);
+		}
+	}
+
 	return renderList;
 }
+
+/***********************************************************************************/
+void Engine::requestTextureDetail(const RenderSnapshot& snapshot) const {
+	PROFILE_FUNCTION();
+
+	const ViewFrustum viewFrustum(snapshot.ViewMatrix, snapshot.ProjMatrix);
+	// Pixels across one world unit at distance one
+	const auto pixelsPerUnit{ snapshot.ProjMatrix[1][1] * 0.5f * static_cast<float>(snapshot.Height) };
+
+	std::vector<TextureStreamer::Request> requests;
+	for (const auto& instance : snapshot.Instances) {
+		const auto& transform{ instance.Transform };
+		const auto scale{ std::max({ glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) }) };
+
+		for (const auto& mesh : instance.Model->GetMeshes()) {
+			if (!mesh.Material) {
+				continue;
+			}
+
+			// Bounding sphere in world space
+			const auto& bounds{ mesh.Bounds.isNull() ? instance.Model->GetBoundingBox() : mesh.Bounds };
+			const auto center{ glm::vec3(transform * glm::vec4(bounds.getCenter(), 1.0f)) };
+			const auto radius{ glm::length(bounds.getDiagonal()) * 0.5f * scale };
+			if (viewFrustum.TestIntersection(AABB(center, radius)) == BoundingVolume::TestResult::OUTSIDE) {
+				continue;
+			}
+
+			// Nearest point of the sphere, inside it the mesh wants full detail
+			const auto distance{ std::max(glm::distance(snapshot.CameraPosition, center) - radius, 0.01f) };
+			const auto pixels{ 2.0f * radius * pixelsPerUnit / distance };
+
+			for (const auto parameter : { PBRMaterial::ALBEDO, PBRMaterial::NORMAL, PBRMaterial::METALLIC, PBRMaterial::ROUGHNESS }) {
+				requests.push_back({ mesh.Material->GetParameterTexture(parameter), pixels });
+			}
+		}
+	}
+
+	ResourceManager::GetInstance().RequestTextureDetail(std::move(requests));
+}
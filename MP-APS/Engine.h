@@ -1,40 +1,120 @@
 #pragma once
 #include "Timer.h"
+#include "FrameStatistics.h"
+#include "Benchmark.h"
+#include "RegressionGate.h"
+#include "CameraPath.h"
 #include "Camera.h"
 
 #include "Core/WindowSystem.h"
 #include "Core/RenderSystem.h"
 #include "Core/GUISystem.h"
+#include "Core/FramePipeline.h"
 
 #include <unordered_map>
 #include <filesystem>
 
+class SceneBase;
+
+// Command line overrides of config.xml
+struct EngineOptions {
+	// Renders headless and runs the <Benchmark> settings instead of the interactive loop
+	bool Benchmark{ false };
+	// Camera path file to play back, replaces <CameraPath play> and the benchmark's keys
+	std::filesystem::path PlayPath;
+	// Runs the benchmark, then checks the <Regression> views and metrics against their references
+	bool Regression{ false };
+	// With Regression, rewrites the golden images and the baseline instead of checking them
+	bool UpdateGolden{ false };
+	// With Regression, missing references exit with 2 instead of failing the run
+	bool AllowMissingReferences{ false };
+};
+
 class Engine {
 public:
 	// Initializes engine from an XML config file
-	explicit Engine(const std::filesystem::path& configPath);
+	Engine(const std::filesystem::path& configPath, const EngineOptions& options);
 
 	void AddScene(const std::shared_ptr<SceneBase>& scene);
 	void SetActiveScene(const std::string_view sceneName);
 
-	// Load scene and run update loop
-	void Execute();
+	// Load scene and run update loop.
+	// Returns the process exit code: 1 if the regression gate failed or its references are missing,
+	// 2 instead for missing references if EngineOptions::AllowMissingReferences is set.
+	int Execute();
 
 private:
-	void shutdown() const;
+	void shutdown();
+
+	// Runs simulation and rendering back to back on the calling thread
+	void executeSequential();
+	// Simulates frame N+1 on the calling thread while a render thread submits frame N
+	void executePipelined();
+	// Render thread entry point for the pipelined mode
+	void renderLoop();
+	// Fixed number of frames along the benchmark camera path, then writes the report
+	void executeBenchmark();
+	// Renders and checks the regression views after the benchmark
+	RegressionGate::Result executeRegression();
+
+	// Polls input, advances camera and scene, and captures the result for the renderer
+	RenderSnapshot simulate();
+	// R toggles recording, the path is written when it stops
+	void startCameraRecording();
+	void stopCameraRecording();
+	void recordCameraKey(const bool force);
+
+	// Collects the renderer's stats for a frame that was just presented
+	FramePipeline::FrameResult makeFrameResult(const RenderSnapshot& snapshot, const double submitMs) const;
+	// Feeds the timings of a presented frame to the frame timer and statistics
+	void reportFrame(const FramePipeline::FrameResult& result);
 
 	// Performs view-frustum culling.
 	// Returns meshes visible by the camera.
 	std::vector<ModelPtr> cullViewFrustum() const;
+	// Reports the screen size of every visible mesh's textures to the texture streamer
+	void requestTextureDetail(const RenderSnapshot& snapshot) const;
 
 	Timer m_timer;
+	FrameStatistics m_frameStatistics;
+	double m_lastPresentTime{ 0.0 };
+	// Written on exit if set
+	std::string m_frameStatsCSV, m_frameStatsJSON;
+	// Headless run with a fixed timestep and scripted camera
+	bool m_benchmarkMode{ false };
+	Benchmark m_benchmark;
+	bool m_regressionMode{ false };
+	bool m_allowMissingReferences{ false };
+	RegressionGate m_regressionGate;
 	Camera m_camera;
 
+	// Playback drives the camera along m_cameraPath instead of input, at a fixed timestep so
+	// every run simulates the same frames. Benchmarks always play a path.
+	CameraPath m_cameraPath;
+	bool m_cameraPlayback{ false };
+	double m_fixedTimestep{ 0.0 };	// 0 uses the measured frame time
+	double m_simulatedTime{ 0.0 };	// Sum of all timesteps so far
+	// Recording
+	CameraPath m_recordedPath;
+	bool m_recordingCamera{ false };
+	double m_recordStartTime{ 0.0 };
+	double m_recordInterval{ 0.0 };	// Minimum seconds between keys, 0 records every frame
+	std::filesystem::path m_recordPath;
+
 	// Core Systems
 	WindowSystem m_window;
 	RenderSystem m_renderer;
 	GUISystem m_guiSystem;
 
+	// Frame pipelining
+	FramePipeline m_framePipeline;
+	bool m_pipelined{ false };
+	std::uint64_t m_frameIndex{ 0 };
+
+	// Renderer toggles, changed at runtime from the simulation thread
+	bool m_depthPrepass{ false };
+	LightAssignment m_lightAssignment{ LightAssignment::Tiled };
+
 	// All loaded scenes stored in memory
 	std::unordered_map<std::string, std::shared_ptr<SceneBase>> m_scenes;
 	// Current scene being processed by renderer
@@ -0,0 +1,261 @@
+#include "FrameStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+/***********************************************************************************/
+double LogHistogram::Percentile(const double fraction) const noexcept {
+	if (m_count == 0) {
+		return 0.0;
+	}
+
+	// Rank of the value, 1-based
+	const auto rank{ std::max<std::uint64_t>(static_cast<std::uint64_t>(std::ceil(std::clamp(fraction, 0.0, 1.0) * static_cast<double>(m_count))), 1) };
+
+	std::uint64_t seen{ 0 };
+	for (std::size_t bucket = 0; bucket < NumBuckets; ++bucket) {
+		seen += m_buckets[bucket];
+		if (seen >= rank) {
+			return getBucketMid(bucket);
+		}
+	}
+
+	return getBucketMid(NumBuckets - 1);
+}
+
+/***********************************************************************************/
+double LogHistogram::getBucketMid(const std::size_t bucket) noexcept {
+	return 0.5 * (GetBucketMin(bucket) + GetBucketMax(bucket));
+}
+
+/***********************************************************************************/
+double LogHistogram::GetBucketMin(const std::size_t bucket) noexcept {
+	const auto octave{ bucket / SubBuckets };
+	const auto sub{ bucket % SubBuckets };
+	if (bucket == 0) {
+		return 0.0;
+	}
+	return std::ldexp(MinValue, static_cast<int>(octave)) * (1.0 + static_cast<double>(sub) / SubBuckets);
+}
+
+/***********************************************************************************/
+double LogHistogram::GetBucketMax(const std::size_t bucket) noexcept {
+	const auto octave{ bucket / SubBuckets };
+	const auto sub{ bucket % SubBuckets };
+	return std::ldexp(MinValue, static_cast<int>(octave)) * (1.0 + static_cast<double>(sub + 1) / SubBuckets);
+}
+
+/***********************************************************************************/
+std::size_t LogHistogram::bucketIndex(const double value) noexcept {
+	const auto scaled{ value / MinValue };
+	if (!(scaled >= 1.0)) {
+		return 0;
+	}
+
+	// scaled = mantissa * 2^exponent with mantissa in [0.5, 1)
+	int exponent{ 0 };
+	const auto mantissa{ std::frexp(scaled, &exponent) };
+	const auto octave{ static_cast<std::size_t>(exponent - 1) };
+	if (octave >= NumOctaves) {
+		return NumBuckets - 1;
+	}
+
+	const auto sub{ static_cast<std::size_t>((mantissa * 2.0 - 1.0) * SubBuckets) };
+	return octave * SubBuckets + std::min(sub, SubBuckets - 1);
+}
+
+/***********************************************************************************/
+void FrameStatistics::Accumulator::Add(const double value, const double budget) noexcept {
+	Histogram.Add(value);
+	Sum += value;
+	Max = std::max(Max, value);
+	Hitches += value > budget;
+}
+
+/***********************************************************************************/
+void FrameStatistics::Accumulator::Remove(const double value, const double budget) noexcept {
+	Histogram.Remove(value);
+	Sum -= value;
+	Hitches -= value > budget;
+}
+
+/***********************************************************************************/
+void FrameStatistics::Init(const std::size_t windowFrames, const double budgetMs) {
+	m_windowFrames = std::max<std::size_t>(windowFrames, 1);
+	m_budgetMs = budgetMs;
+
+	m_window.assign(m_windowFrames, {});
+	m_next = 0;
+	m_windowCount = 0;
+
+	m_windowStats = {};
+	m_runStats = {};
+}
+
+/***********************************************************************************/
+void FrameStatistics::AddFrame(const Sample& sample) {
+	// Evict the oldest frame once the window is full
+	if (m_windowCount == m_windowFrames) {
+		const auto& oldest{ m_window[m_next] };
+		for (std::size_t i = 0; i < NUM_METRICS; ++i) {
+			const auto value{ getValue(oldest, static_cast<Metric>(i)) };
+			if (value > 0.0) {
+				m_windowStats[i].Remove(value, m_budgetMs);
+			}
+		}
+	}
+	else {
+		++m_windowCount;
+	}
+
+	m_window[m_next] = sample;
+	m_next = (m_next + 1) % m_windowFrames;
+
+	for (std::size_t i = 0; i < NUM_METRICS; ++i) {
+		const auto value{ getValue(sample, static_cast<Metric>(i)) };
+		if (value > 0.0) {
+			m_windowStats[i].Add(value, m_budgetMs);
+			m_runStats[i].Add(value, m_budgetMs);
+		}
+	}
+}
+
+/***********************************************************************************/
+FrameStatistics::Summary FrameStatistics::GetWindowSummary(const Metric metric) const {
+	// Removing samples can't lower a running maximum, so look it up
+	double maxMs{ 0.0 };
+	for (std::size_t i = 0; i < m_windowCount; ++i) {
+		maxMs = std::max(maxMs, getValue(m_window[i], metric));
+	}
+
+	return summarize(m_windowStats[metric], maxMs);
+}
+
+/***********************************************************************************/
+FrameStatistics::Summary FrameStatistics::GetRunSummary(const Metric metric) const {
+	return summarize(m_runStats[metric], m_runStats[metric].Max);
+}
+
+/***********************************************************************************/
+void FrameStatistics::Print(std::ostream& out) const {
+	const auto print = [&out](const char* scope, const char* name, const Summary& summary) {
+		out << std::fixed << std::setprecision(2) << scope << ' ' << name << ": " << summary.Count << " frames, mean " << summary.MeanMs
+			<< " ms, p50 " << summary.P50Ms << ", p90 " << summary.P90Ms << ", p99 " << summary.P99Ms << ", p99.9 " << summary.P999Ms
+			<< ", max " << summary.MaxMs << ", " << summary.Hitches << " hitches\n";
+	};
+
+	out << "Frame statistics (budget " << m_budgetMs << " ms):\n";
+	for (std::size_t i = 0; i < NUM_METRICS; ++i) {
+		const auto metric{ static_cast<Metric>(i) };
+		print("window", GetMetricName(metric), GetWindowSummary(metric));
+		print("run   ", GetMetricName(metric), GetRunSummary(metric));
+	}
+	out << std::defaultfloat;
+}
+
+/***********************************************************************************/
+bool FrameStatistics::WriteCSV(const std::filesystem::path& path) const {
+	std::ofstream out(path);
+	if (!out) {
+		std::cerr << "Frame statistics: failed to write " << path << '\n';
+		return false;
+	}
+
+	out << "scope,metric,frames,mean_ms,p50_ms,p90_ms,p99_ms,p99.9_ms,max_ms,hitches,budget_ms\n";
+	const auto write = [&out, this](const char* scope, const Metric metric, const Summary& summary) {
+		out << scope << ',' << GetMetricName(metric) << ',' << summary.Count << ',' << summary.MeanMs << ',' << summary.P50Ms << ',' << summary.P90Ms << ','
+			<< summary.P99Ms << ',' << summary.P999Ms << ',' << summary.MaxMs << ',' << summary.Hitches << ',' << m_budgetMs << '\n';
+	};
+
+	for (std::size_t i = 0; i < NUM_METRICS; ++i) {
+		const auto metric{ static_cast<Metric>(i) };
+		write("window", metric, GetWindowSummary(metric));
+		write("run", metric, GetRunSummary(metric));
+	}
+
+	return static_cast<bool>(out);
+}
+
+/***********************************************************************************/
+bool FrameStatistics::WriteJSON(const std::filesystem::path& path) const {
+	std::ofstream out(path);
+	if (!out) {
+		std::cerr << "Frame statistics: failed to write " << path << '\n';
+		return false;
+	}
+
+	out << "{\n\"budget_ms\":" << m_budgetMs << ",\n\"window_frames\":" << m_windowFrames << ",\n\"metrics\":{";
+	for (std::size_t i = 0; i < NUM_METRICS; ++i) {
+		const auto metric{ static_cast<Metric>(i) };
+		out << (i > 0 ? ",\n" : "\n") << '"' << GetMetricName(metric) << "\":{\"window\":";
+		WriteSummaryJSON(out, GetWindowSummary(metric));
+		out << ",\"run\":";
+		WriteSummaryJSON(out, GetRunSummary(metric));
+
+		// [lower bound ms, upper bound ms, frames] of every bucket that was hit
+		out << ",\"histogram\":[";
+		const auto& histogram{ m_runStats[i].Histogram };
+		auto first{ true };
+		for (std::size_t bucket = 0; bucket < LogHistogram::NumBuckets; ++bucket) {
+			if (const auto count = histogram.GetBucketCount(bucket); count > 0) {
+				out << (first ? "" : ",") << '[' << LogHistogram::GetBucketMin(bucket) << ',' << LogHistogram::GetBucketMax(bucket) << ',' << count << ']';
+				first = false;
+			}
+		}
+		out << "]}";
+	}
+	out << "\n}\n}\n";
+
+	return static_cast<bool>(out);
+}
+
+/***********************************************************************************/
+const char* FrameStatistics::GetMetricName(const Metric metric) noexcept {
+	switch (metric) {
+	case FRAME: return "frame";
+	case CPU: return "cpu";
+	case GPU: return "gpu";
+	default: return "unknown";
+	}
+}
+
+/***********************************************************************************/
+void FrameStatistics::WriteSummaryJSON(std::ostream& out, const Summary& summary) {
+	out << "{\"frames\":" << summary.Count << ",\"mean_ms\":" << summary.MeanMs << ",\"p50_ms\":" << summary.P50Ms << ",\"p90_ms\":" << summary.P90Ms
+		<< ",\"p99_ms\":" << summary.P99Ms << ",\"p99.9_ms\":" << summary.P999Ms << ",\"max_ms\":" << summary.MaxMs << ",\"hitches\":" << summary.Hitches << '}';
+}
+
+/***********************************************************************************/
+double FrameStatistics::getValue(const Sample& sample, const Metric metric) noexcept {
+	switch (metric) {
+	case FRAME: return sample.FrameMs;
+	case CPU: return sample.CpuMs;
+	case GPU: return sample.GpuMs;
+	default: return 0.0;
+	}
+}
+
+/***********************************************************************************/
+FrameStatistics::Summary FrameStatistics::summarize(const Accumulator& accumulator, const double maxMs) const {
+	Summary summary;
+	summary.Count = accumulator.Histogram.GetCount();
+	if (summary.Count == 0) {
+		return summary;
+	}
+
+	// Bucket bounds can overshoot the largest value
+	const auto percentile = [&](const double fraction) { return std::min(accumulator.Histogram.Percentile(fraction), maxMs); };
+
+	summary.MeanMs = accumulator.Sum / static_cast<double>(summary.Count);
+	summary.P50Ms = percentile(0.5);
+	summary.P90Ms = percentile(0.9);
+	summary.P99Ms = percentile(0.99);
+	summary.P999Ms = percentile(0.999);
+	summary.MaxMs = maxMs;
+	summary.Hitches = accumulator.Hitches;
+
+	return summary;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <vector>
+
+/***********************************************************************************/
+// Log-linear histogram in the style of HdrHistogram. Every power of two between MinValue and
+// MinValue * 2^NumOctaves is split into SubBuckets linear buckets, so values are kept with
+// a relative error below 1 / (2 * SubBuckets). Adding and removing are O(1).
+class LogHistogram {
+public:
+	static constexpr double MinValue{ 0.001 };
+	static constexpr std::size_t NumOctaves{ 24 };
+	static constexpr std::size_t SubBuckets{ 32 };
+	static constexpr std::size_t NumBuckets{ NumOctaves * SubBuckets };
+
+	void Add(const double value) noexcept { ++m_buckets[bucketIndex(value)]; ++m_count; }
+	// Only for values that were added before
+	void Remove(const double value) noexcept { --m_buckets[bucketIndex(value)]; --m_count; }
+
+	// Midpoint of the bucket holding the value at the given fraction (0-1), 0 if empty
+	double Percentile(const double fraction) const noexcept;
+
+	auto GetCount() const noexcept { return m_count; }
+	auto GetBucketCount(const std::size_t bucket) const noexcept { return m_buckets[bucket]; }
+	// Bounds of the values counted in a bucket
+	static double GetBucketMin(const std::size_t bucket) noexcept;
+	static double GetBucketMax(const std::size_t bucket) noexcept;
+
+private:
+	static std::size_t bucketIndex(const double value) noexcept;
+	static double getBucketMid(const std::size_t bucket) noexcept;
+
+	std::array<std::uint32_t, NumBuckets> m_buckets{};
+	std::uint64_t m_count{ 0 };
+};
+
+/***********************************************************************************/
+// Frame, CPU and GPU times of the last windowFrames frames and of the whole run, with
+// percentiles, maximum and the number of hitches (frames over budget).
+class FrameStatistics {
+public:
+	enum Metric {
+		FRAME,	// Present to present
+		CPU,	// Simulation and render submission
+		GPU,	// Sum of the GPU pass timers, arrives a few frames late
+		NUM_METRICS
+	};
+
+	// Times in ms. Times <= 0 are treated as not measured and skipped.
+	struct Sample {
+		double FrameMs;
+		double CpuMs;
+		double GpuMs;
+	};
+
+	struct Summary {
+		std::uint64_t Count{ 0 };
+		double MeanMs{ 0.0 };
+		double P50Ms{ 0.0 }, P90Ms{ 0.0 }, P99Ms{ 0.0 }, P999Ms{ 0.0 };
+		double MaxMs{ 0.0 };
+		std::uint64_t Hitches{ 0 };
+	};
+
+	void Init(const std::size_t windowFrames, const double budgetMs);
+
+	// Needs Init() first
+	void AddFrame(const Sample& sample);
+
+	// Over the rolling window
+	Summary GetWindowSummary(const Metric metric) const;
+	// Since Init()
+	Summary GetRunSummary(const Metric metric) const;
+	auto GetBudgetMs() const noexcept { return m_budgetMs; }
+
+	// One line per metric for the window and the whole run
+	void Print(std::ostream& out) const;
+	// Summaries of the window and the whole run
+	bool WriteCSV(const std::filesystem::path& path) const;
+	// Summaries plus the non-empty histogram buckets of the whole run
+	bool WriteJSON(const std::filesystem::path& path) const;
+
+	static const char* GetMetricName(const Metric metric) noexcept;
+	// {"frames":..,"mean_ms":..,"p50_ms":.., ...} as used by WriteJSON()
+	static void WriteSummaryJSON(std::ostream& out, const Summary& summary);
+
+private:
+	struct Accumulator {
+		LogHistogram Histogram;
+		double Sum{ 0.0 };
+		double Max{ 0.0 };
+		std::uint64_t Hitches{ 0 };
+
+		void Add(const double value, const double budget) noexcept;
+		void Remove(const double value, const double budget) noexcept;
+	};
+
+	static double getValue(const Sample& sample, const Metric metric) noexcept;
+	Summary summarize(const Accumulator& accumulator, const double maxMs) const;
+
+	std::size_t m_windowFrames{ 0 };
+	double m_budgetMs{ 0.0 };
+
+	// Ring buffer of the window's samples
+	std::vector<Sample> m_window;
+	std::size_t m_next{ 0 };
+	std::size_t m_windowCount{ 0 };
+
+	std::array<Accumulator, NUM_METRICS> m_windowStats;
+	std::array<Accumulator, NUM_METRICS> m_runStats;
+};
@@ -0,0 +1,24 @@
+#include "CommandList.h"
+
+#include <algorithm>
+
+/***********************************************************************************/
+void CommandList::Sort() {
+	std::stable_sort(m_commands.begin(), m_commands.end(), [](const auto& a, const auto& b) {
+		return a.SortKey < b.SortKey;
+	});
+}
+
+/***********************************************************************************/
+std::uint64_t CommandList::MakeSortKey(const std::uint32_t material, const std::uint32_t vertexArray, const float depth) noexcept {
+	static constexpr std::uint64_t MaterialBits{ 24 }, VertexArrayBits{ 20 }, DepthBits{ 20 };
+	static constexpr std::uint64_t DepthMax{ (1ull << DepthBits) - 1 };
+
+	// Map [0, inf) onto [0, 1) so no far plane is needed
+	const auto d{ std::max(depth, 0.0f) };
+	const auto depthBits{ static_cast<std::uint64_t>(d / (d + 1.0f) * static_cast<float>(DepthMax)) };
+
+	return (static_cast<std::uint64_t>(material & ((1u << MaterialBits) - 1)) << (VertexArrayBits + DepthBits)) |
+		(static_cast<std::uint64_t>(vertexArray & ((1u << VertexArrayBits) - 1)) << DepthBits) |
+		std::min(depthBits, DepthMax);
+}
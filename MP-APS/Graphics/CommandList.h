@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstdint>
+#include <vector>
+#include <array>
+
+/***********************************************************************************/
+// API-agnostic draw packet. Holds everything needed to issue one draw call, resolved
+// up front so the GL thread only has to walk the list.
+struct DrawCommand {
+	enum TextureSlot {
+		ALBEDO = 0,
+		NORMAL,
+		METALLIC,
+		ROUGHNESS,
+		NUM_TEXTURE_SLOTS
+	};
+
+	std::uint64_t SortKey{ 0 };
+	std::uint32_t VertexArray{ 0 };
+	std::uint32_t IndexCount{ 0 };
+	std::array<std::uint32_t, NUM_TEXTURE_SLOTS> Textures{};
+	glm::mat4 ModelMatrix;
+	// Vertex and index layout of the mesh, see VertexCompressor
+	glm::vec3 PositionScale{ 1.0f }, PositionOffset{ 0.0f };
+	bool PackedVertices{ false };
+	bool ShortIndices{ false };
+};
+
+/***********************************************************************************/
+// Draw packets for one frame. Recording touches no GL state, so after Resize() jobs
+// can fill disjoint slots from any thread and the list is sorted once afterwards.
+class CommandList {
+public:
+	void Clear() noexcept { m_commands.clear(); }
+	void Reserve(const std::size_t numCommands) { m_commands.reserve(numCommands); }
+	void Resize(const std::size_t numCommands) { m_commands.resize(numCommands); }
+	void Draw(const DrawCommand& command) { m_commands.push_back(command); }
+	DrawCommand& operator[](const std::size_t index) noexcept { return m_commands[index]; }
+	// Orders packets by sort key. Stable, so equal keys keep their recording order.
+	void Sort();
+
+	// Material in the top bits, then vertex array, then depth so state changes are
+	// minimized and each batch is drawn roughly front to back.
+	// depth is any non-negative view distance.
+	static std::uint64_t MakeSortKey(const std::uint32_t material, const std::uint32_t vertexArray, const float depth) noexcept;
+
+	auto begin() const noexcept { return m_commands.cbegin(); }
+	auto end() const noexcept { return m_commands.cend(); }
+	auto Size() const noexcept { return m_commands.size(); }
+
+private:
+	std::vector<DrawCommand> m_commands;
+};
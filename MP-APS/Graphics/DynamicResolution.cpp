@@ -0,0 +1,44 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+/***********************************************************************************/
+void DynamicResolution::Init(const double targetMs, const float minScale, const float maxScale) {
+	m_targetMs = targetMs;
+	m_minScale = std::clamp(minScale, StepSize, 1.0f);
+	m_maxScale = std::clamp(maxScale, m_minScale, 1.0f);
+	m_scale = m_maxScale;
+	m_fullResolutionMs = 0.0;
+}
+
+/***********************************************************************************/
+float DynamicResolution::Update(const double gpuMs, const float sampleScale) {
+	if (gpuMs <= 0.0 || sampleScale <= 0.0f || m_targetMs <= 0.0) {
+		return m_scale;
+	}
+
+	const auto fullResolutionMs{ gpuMs / (static_cast<double>(sampleScale) * sampleScale) };
+	m_fullResolutionMs = m_fullResolutionMs > 0.0 ? m_fullResolutionMs + (fullResolutionMs - m_fullResolutionMs) * Smoothing : fullResolutionMs;
+
+	// Largest scale whose estimated cost fits the budget
+	const auto ideal{ static_cast<float>(std::sqrt(m_targetMs * Headroom / m_fullResolutionMs)) };
+	const auto desired{ std::clamp(ideal, m_minScale, m_maxScale) };
+
+	// Within a step of the current scale is close enough
+	if (std::abs(desired - m_scale) < StepSize) {
+		return m_scale;
+	}
+
+	const auto step{ std::clamp(desired - m_scale, -MaxStep, MaxStep) };
+	const auto quantized{ std::round((m_scale + step) / StepSize) * StepSize };
+	m_scale = std::clamp(quantized, m_minScale, m_maxScale);
+
+	return m_scale;
+}
+
+/***********************************************************************************/
+std::uint32_t DynamicResolution::ScaleSize(const std::uint32_t size, const float scale) noexcept {
+	const auto scaled{ static_cast<std::uint32_t>(std::lround(static_cast<double>(size) * scale)) };
+	return std::clamp(scaled, 1u, std::max(size, 1u));
+}
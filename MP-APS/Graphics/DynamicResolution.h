@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+/***********************************************************************************/
+// Picks the scale the scene renders at from measured GPU time.
+//
+// Scene cost is assumed to grow with the pixel count, i.e. with scale squared, so every
+// sample is converted to the cost of a full resolution frame. The scale that would fit that
+// cost into the budget is then approached a limited step per frame. Steps are quantized and
+// only taken when the estimate leaves a band around the current scale, which keeps noise
+// from resizing the viewport every frame.
+class DynamicResolution {
+public:
+	// targetMs: GPU budget for the scene passes. Scales are fractions of the output size.
+	void Init(const double targetMs, const float minScale, const float maxScale);
+
+	// Feeds the GPU time of a frame that rendered at sampleScale. Samples arrive late,
+	// passing the scale they were measured at keeps the estimate correct while it changes.
+	// Returns the scale for the next frame.
+	float Update(const double gpuMs, const float sampleScale);
+
+	auto GetScale() const noexcept { return m_scale; }
+	auto GetTargetMs() const noexcept { return m_targetMs; }
+
+	// Render size for an output size, at least one pixel
+	static std::uint32_t ScaleSize(const std::uint32_t size, const float scale) noexcept;
+
+private:
+	// Aim slightly below the budget so the estimate's noise doesn't push frames over it
+	static constexpr double Headroom{ 0.9 };
+	// Weight of a new sample in the smoothed full resolution cost
+	static constexpr double Smoothing{ 0.1 };
+	// Scale changes are multiples of this, and at most MaxStep per frame
+	static constexpr float StepSize{ 1.0f / 32.0f };
+	static constexpr float MaxStep{ 2.0f * StepSize };
+
+	double m_targetMs{ 0.0 };
+	float m_minScale{ 1.0f }, m_maxScale{ 1.0f };
+	float m_scale{ 1.0f };
+	// Smoothed GPU time the scene would take at scale 1, 0 until the first sample
+	double m_fullResolutionMs{ 0.0 };
+};
@@ -1,4 +1,5 @@
 #include "GLShader.h"
+#include "ShaderPreprocessor.h"
 
 #include "../ResourceManager.h"
 
@@ -16,6 +17,12 @@ const std::unordered_map<std::string_view, int> ShaderTypes {
 	{"tesseval", GL_TESS_EVALUATION_SHADER }
 };
 
+namespace {
+	std::string loadInclude(const std::string& path) {
+		return ResourceManager::GetInstance().LoadTextFile(path);
+	}
+}
+
 /***********************************************************************************/
 GLShader::GLShader(const std::string_view path, const int type) {
 
@@ -23,8 +30,7 @@ GLShader::GLShader(const std::string_view path, const int type) {
 
 	auto shaderCode = ResourceManager::GetInstance().LoadTextFile(path);
 
-	scanForIncludes(shaderCode);
-	replaceAll(shaderCode, "hash ", "#");
+	ShaderPreprocessor::Process(shaderCode, loadInclude);
 
 	compile(shaderCode.c_str());
 }
@@ -36,8 +42,7 @@ GLShader::GLShader(const std::string_view path, const std::string_view type) {
 
 	auto shaderCode = ResourceManager::GetInstance().LoadTextFile(path);
 
-	scanForIncludes(shaderCode);
-	replaceAll(shaderCode, "hash ", "#");
+	ShaderPreprocessor::Process(shaderCode, loadInclude);
 	
 	compile(shaderCode.c_str());
 }
@@ -57,38 +62,6 @@ void GLShader::DeleteShader() const {
 	glDeleteShader(m_shaderID);
 }
 
-/***********************************************************************************/
-void GLShader::scanForIncludes(std::string& shaderCode) {
-	std::size_t startPos = 0;
-	const static std::string include_dir = "#include ";
-
-	// Scan string for all instances of include directive
-	while ((startPos = shaderCode.find(include_dir, startPos)) != std::string::npos) {
-		// Find position of include directive
-		const auto pos = startPos + include_dir.length() + 1;
-		const auto length = shaderCode.find('"', pos);
-		const auto pathToIncludedFile = shaderCode.substr(pos, length - pos);
-
-		// Load included file
-		const auto includedFile = ResourceManager::GetInstance().LoadTextFile(pathToIncludedFile) + "\n";
-		// Insert into shader code
-		shaderCode.replace(startPos, (length + 1) - startPos, includedFile);
-		
-		// Increment start position and continue scanning
-		startPos += includedFile.length();
-	}
-}
-
-/***********************************************************************************/
-void GLShader::replaceAll(std::string& str, const std::string& from, const std::string& to) {
-	std::size_t start_pos = 0;
-
-	while ((start_pos = str.find(from, start_pos)) != std::string::npos) {
-		str.replace(start_pos, from.length(), to);
-		start_pos += to.length(); // In case 'to' contains 'from', like replacing 'x' with 'yx'
-	}
-}
-
 /***********************************************************************************/
 void GLShader::compile(const GLchar* shaderCode) {
 #ifdef _DEBUG
@@ -13,10 +13,6 @@ public:
 	void DeleteShader() const;
 
 private:
-	// Implements the #include preprocessor directive for GLSL
-	void scanForIncludes(std::string& shaderCode);
-	// Replaces all occurances of a string in another string
-	void replaceAll(std::string& str, const std::string& from, const std::string& to);
 	// Compiles a shader file and checks for errors
 	void compile(const GLchar* shaderCode);
 
@@ -49,6 +49,13 @@ GLShaderProgram& GLShaderProgram::SetUniformi(const std::string& uniformName, co
 	return *this;
 }
 
+/***********************************************************************************/
+GLShaderProgram& GLShaderProgram::SetUniformui(const std::string& uniformName, const unsigned int value) {
+	glUniform1ui(m_uniforms.at(uniformName), value);
+
+	return *this;
+}
+
 /***********************************************************************************/
 GLShaderProgram& GLShaderProgram::SetUniformf(const std::string& uniformName, const float value) {
 	glUniform1f(m_uniforms.at(uniformName), value);
@@ -77,6 +84,13 @@ GLShaderProgram& GLShaderProgram::SetUniform(const std::string& uniformName, con
 	return *this;
 }
 
+/***********************************************************************************/
+GLShaderProgram& GLShaderProgram::SetUniform(const std::string& uniformName, const glm::uvec3& value) {
+	glUniform3uiv(m_uniforms.at(uniformName), 1, &value[0]);
+
+	return *this;
+}
+
 /***********************************************************************************/
 GLShaderProgram& GLShaderProgram::SetUniform(const std::string& uniformName, const glm::vec4& value) {
 	glUniform4f(m_uniforms.at(uniformName), value.x, value.y, value.z, value.w);
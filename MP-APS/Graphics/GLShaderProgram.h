@@ -17,10 +17,12 @@ public:
 	void DeleteProgram() const;
 
 	GLShaderProgram& SetUniformi(const std::string& uniformName, const int value);
+	GLShaderProgram& SetUniformui(const std::string& uniformName, const unsigned int value);
 	GLShaderProgram& SetUniformf(const std::string& uniformName, const float value);
 	GLShaderProgram& SetUniform(const std::string& uniformName, const glm::ivec2& value);
 	GLShaderProgram& SetUniform(const std::string& uniformName, const glm::vec2& value);
 	GLShaderProgram& SetUniform(const std::string& uniformName, const glm::vec3& value);
+	GLShaderProgram& SetUniform(const std::string& uniformName, const glm::uvec3& value);
 	GLShaderProgram& SetUniform(const std::string& uniformName, const glm::vec4& value);
 	GLShaderProgram& SetUniform(const std::string& uniformName, const glm::mat3x3& value);
 	GLShaderProgram& SetUniform(const std::string& uniformName, const glm::mat4x4& value);
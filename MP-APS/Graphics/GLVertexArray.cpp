@@ -13,6 +13,17 @@ void GLVertexArray::AttachBuffer(const BufferType type, const size_t size, const
 
 	glBindBuffer(type, buffer);
 	glBufferData(type, size, data, mode);
+
+	if (type == ARRAY) {
+		m_arrayBuffer = buffer;
+		m_arrayBufferSize = size;
+		m_arrayMode = mode;
+	}
+	else {
+		m_elementBuffer = buffer;
+		m_elementBufferSize = size;
+		m_elementMode = mode;
+	}
 }
 
 /***********************************************************************************/
@@ -25,8 +36,40 @@ void GLVertexArray::Delete() noexcept {
 	glDeleteVertexArrays(1, &m_vao);
 }
 
+/***********************************************************************************/
+std::size_t GLVertexArray::ReleaseBuffers() noexcept {
+	if (m_released) {
+		return 0;
+	}
+
+	// Through the copy target, binding the element buffer would change the bound VAO
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_arrayBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, 0, nullptr, m_arrayMode);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_elementBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, 0, nullptr, m_elementMode);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	m_released = true;
+	return m_arrayBufferSize + m_elementBufferSize;
+}
+
+/***********************************************************************************/
+void GLVertexArray::RefillBuffer(const BufferType type, const void* data) noexcept {
+	glBindBuffer(GL_COPY_WRITE_BUFFER, GetBuffer(type));
+	glBufferData(GL_COPY_WRITE_BUFFER, GetBufferSize(type), data, type == ARRAY ? m_arrayMode : m_elementMode);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	m_released = false;
+}
+
 /***********************************************************************************/
 void GLVertexArray::EnableAttribute(const unsigned int index, const int size, const unsigned int offset, const void* data) noexcept {
 	glEnableVertexAttribArray(index);
 	glVertexAttribPointer(index, size, GL_FLOAT, GL_FALSE, offset, data);
 }
+
+/***********************************************************************************/
+void GLVertexArray::EnableAttribute(const GLuint index, const int size, const GLenum type, const bool normalized, const GLuint stride, const void* data) noexcept {
+	glEnableVertexAttribArray(index);
+	glVertexAttribPointer(index, size, type, normalized ? GL_TRUE : GL_FALSE, stride, data);
+}
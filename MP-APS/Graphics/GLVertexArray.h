@@ -2,6 +2,8 @@
 
 #include <glad/glad.h>
 
+#include <cstddef>
+
 class GLVertexArray {
 
 public:
@@ -20,8 +22,26 @@ public:
 	void AttachBuffer(const BufferType type, const size_t size, const DrawMode mode, const void* data) noexcept;
 	void Bind() const noexcept;
 	void EnableAttribute(const GLuint index, const int size, const GLuint offset, const void* data) noexcept;
+	// Integer components of type, read as floats, normalized to [0, 1] or [-1, 1] if normalized is set
+	void EnableAttribute(const GLuint index, const int size, const GLenum type, const bool normalized, const GLuint stride, const void* data) noexcept;
 	void Delete() noexcept;
 
+	// Frees the storage of both buffers. Names, sizes and attribute bindings stay, so the VAO is
+	// valid again after RefillBuffer(). Returns the bytes freed, 0 if already released.
+	std::size_t ReleaseBuffers() noexcept;
+	// Refills a released buffer with as many bytes of data as it was attached with
+	void RefillBuffer(const BufferType type, const void* data) noexcept;
+	auto IsResident() const noexcept { return !m_released; }
+
+	auto GetHandle() const noexcept { return m_vao; }
+	// Last buffer attached with the given type and its size in bytes, 0 if none
+	auto GetBuffer(const BufferType type) const noexcept { return type == ARRAY ? m_arrayBuffer : m_elementBuffer; }
+	auto GetBufferSize(const BufferType type) const noexcept { return type == ARRAY ? m_arrayBufferSize : m_elementBufferSize; }
+
 private:
 	GLuint m_vao{ 0 };
+	GLuint m_arrayBuffer{ 0 }, m_elementBuffer{ 0 };
+	std::size_t m_arrayBufferSize{ 0 }, m_elementBufferSize{ 0 };
+	DrawMode m_arrayMode{ STATIC }, m_elementMode{ STATIC };
+	bool m_released{ false };
 };
@@ -0,0 +1,119 @@
+#include "GPUProfiler.h"
+
+#include <algorithm>
+
+/***********************************************************************************/
+void GPUProfiler::Delete() {
+	for (auto& frame : m_frames) {
+		if (!frame.Queries.empty()) {
+			glDeleteQueries(static_cast<GLsizei>(frame.Queries.size()), frame.Queries.data());
+		}
+		frame = FrameQueries();
+	}
+	m_started = false;
+}
+
+/***********************************************************************************/
+void GPUProfiler::BeginFrame() {
+	if (m_started) {
+		++m_frame;
+	}
+	m_started = true;
+
+	// This slot was recorded FramesInFlight frames ago
+	auto& frame{ m_frames[m_frame % FramesInFlight] };
+	if (frame.NumScopes > 0) {
+		readBack(frame);
+	}
+	frame.NumScopes = 0;
+}
+
+/***********************************************************************************/
+std::size_t GPUProfiler::Begin(const std::string_view name) {
+	if (!m_started) {
+		BeginFrame();
+	}
+
+	auto& frame{ m_frames[m_frame % FramesInFlight] };
+	const auto scope{ frame.NumScopes++ };
+
+	if (frame.Queries.size() < 2 * frame.NumScopes) {
+		const auto first{ frame.Queries.size() };
+		frame.Queries.resize(2 * frame.NumScopes);
+		glGenQueries(static_cast<GLsizei>(frame.Queries.size() - first), frame.Queries.data() + first);
+		frame.Names.resize(frame.NumScopes);
+	}
+
+	frame.Names[scope] = name;
+	glQueryCounter(frame.Queries[2 * scope], GL_TIMESTAMP);
+
+	return scope;
+}
+
+/***********************************************************************************/
+void GPUProfiler::End(const std::size_t scope) {
+	const auto& frame{ m_frames[m_frame % FramesInFlight] };
+	glQueryCounter(frame.Queries[2 * scope + 1], GL_TIMESTAMP);
+}
+
+/***********************************************************************************/
+double GPUProfiler::GetAverageMs(const std::string_view name) const noexcept {
+	const auto average{ std::find_if(m_averages.begin(), m_averages.end(), [name](const auto& a) { return a.Name == name; }) };
+	return average != m_averages.end() ? average->AverageMs : 0.0;
+}
+
+/***********************************************************************************/
+void GPUProfiler::readBack(FrameQueries& frame) {
+	// Queries complete in order, so the last one being done means they all are
+	GLuint available{ GL_FALSE };
+	glGetQueryObjectuiv(frame.Queries[2 * frame.NumScopes - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		++m_droppedFrames;
+		return;
+	}
+
+	m_lastFrame.clear();
+	for (std::size_t i = 0; i < frame.NumScopes; ++i) {
+		GLuint64 begin{ 0 }, end{ 0 };
+		glGetQueryObjectui64v(frame.Queries[2 * i], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(frame.Queries[2 * i + 1], GL_QUERY_RESULT, &end);
+		const auto milliseconds{ end > begin ? static_cast<double>(end - begin) / 1e6 : 0.0 };
+
+		const auto name{ frame.Names[i] };
+		auto pass{ std::find_if(m_lastFrame.begin(), m_lastFrame.end(), [name](const auto& p) { return p.Name == name; }) };
+		if (pass == m_lastFrame.end()) {
+			m_lastFrame.push_back({ name, milliseconds });
+		}
+		else {
+			pass->Milliseconds += milliseconds;
+		}
+	}
+
+	for (const auto& pass : m_lastFrame) {
+		addSample(pass.Name, pass.Milliseconds);
+	}
+}
+
+/***********************************************************************************/
+void GPUProfiler::addSample(const std::string_view name, const double milliseconds) {
+	auto average{ std::find_if(m_averages.begin(), m_averages.end(), [name](const auto& a) { return a.Name == name; }) };
+	if (average == m_averages.end()) {
+		m_averages.push_back({ name, 0.0, 0.0 });
+		m_history.emplace_back();
+		average = m_averages.end() - 1;
+	}
+
+	auto& history{ m_history[average - m_averages.begin()] };
+	if (history.Count == AverageFrames) {
+		history.Sum -= history.Samples[history.Next];
+	}
+	else {
+		++history.Count;
+	}
+	history.Samples[history.Next] = milliseconds;
+	history.Next = (history.Next + 1) % AverageFrames;
+	history.Sum += milliseconds;
+
+	average->LastMs = milliseconds;
+	average->AverageMs = history.Sum / static_cast<double>(history.Count);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/***********************************************************************************/
+// Times GPU work with a timestamp query at the start and end of each scope.
+// A frame's queries are read back FramesInFlight frames later, when the GPU has long finished
+// them, so reading never stalls. Frames whose results still aren't available are dropped.
+// Timestamps instead of GL_TIME_ELAPSED, which can't nest or overlap another elapsed query.
+class GPUProfiler {
+public:
+	static constexpr std::size_t FramesInFlight{ 4 };
+	// Samples the rolling averages cover
+	static constexpr std::size_t AverageFrames{ 64 };
+
+	struct PassTime {
+		std::string_view Name;
+		double Milliseconds;
+	};
+
+	struct PassAverage {
+		std::string_view Name;
+		double LastMs;
+		double AverageMs;
+	};
+
+	// Ends the enclosing scope's timer
+	class Scope {
+	public:
+		Scope(GPUProfiler& profiler, const std::string_view name) : m_profiler(profiler), m_scope(profiler.Begin(name)) {}
+		~Scope() { m_profiler.End(m_scope); }
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		GPUProfiler& m_profiler;
+		const std::size_t m_scope;
+	};
+
+	void Delete();
+
+	// Starts a new frame, reading back the oldest frame in flight. Everything timed until the
+	// next call, like GUI drawn after the renderer, belongs to this frame.
+	void BeginFrame();
+
+	// Names aren't copied and must stay valid, use string literals.
+	// Returns the scope to pass to End().
+	std::size_t Begin(const std::string_view name);
+	void End(const std::size_t scope);
+
+	// Times of the most recent frame read back, in the order the scopes began.
+	// Scopes with the same name are summed.
+	const auto& GetLastFrame() const noexcept { return m_lastFrame; }
+	// Rolling averages over the last AverageFrames samples of each scope
+	const auto& GetAverages() const noexcept { return m_averages; }
+	// 0 if no scope with that name has been read back yet
+	double GetAverageMs(const std::string_view name) const noexcept;
+	// Frames whose results weren't ready in time
+	auto GetDroppedFrames() const noexcept { return m_droppedFrames; }
+
+private:
+	struct FrameQueries {
+		// Begin and end timestamp of each scope, only grows
+		std::vector<GLuint> Queries;
+		std::vector<std::string_view> Names;
+		std::size_t NumScopes{ 0 };
+	};
+
+	struct History {
+		std::array<double, AverageFrames> Samples;
+		std::size_t Count{ 0 };
+		std::size_t Next{ 0 };
+		double Sum{ 0.0 };
+	};
+
+	void readBack(FrameQueries& frame);
+	void addSample(const std::string_view name, const double milliseconds);
+
+	std::array<FrameQueries, FramesInFlight> m_frames;
+	std::uint64_t m_frame{ 0 };
+	bool m_started{ false };
+
+	std::vector<PassTime> m_lastFrame;
+	// Same order in both
+	std::vector<PassAverage> m_averages;
+	std::vector<History> m_history;
+	std::size_t m_droppedFrames{ 0 };
+};
@@ -0,0 +1,82 @@
+#include "GeometryPool.h"
+
+#include <algorithm>
+
+/***********************************************************************************/
+void GeometryPool::Init() {
+	glGenBuffers(1, &m_vertexBuffer);
+	glGenBuffers(1, &m_indexBuffer);
+}
+
+/***********************************************************************************/
+void GeometryPool::Delete() {
+	glDeleteBuffers(1, &m_vertexBuffer);
+	glDeleteBuffers(1, &m_indexBuffer);
+	m_entries.clear();
+	m_vertexCapacity = m_indexCapacity = m_vertexBytes = m_indexBytes = 0;
+}
+
+/***********************************************************************************/
+GeometryPool::Entry GeometryPool::Add(const GLVertexArray& vao, const std::size_t indexSize) {
+	const auto existing{ m_entries.find(vao.GetHandle()) };
+	if (existing != m_entries.end()) {
+		return existing->second;
+	}
+
+	const auto vertexBytes{ static_cast<GLsizeiptr>(vao.GetBufferSize(GLVertexArray::ARRAY)) };
+	const auto indexBytes{ static_cast<GLsizeiptr>(vao.GetBufferSize(GLVertexArray::ELEMENT)) };
+
+	// 16-bit index counts may be odd and shaders read whole words, so meshes start and end on
+	// 4-byte boundaries. Vertices are multiples of 4 bytes.
+	const auto alignWord = [](const GLsizeiptr bytes) { return (bytes + 3) & ~GLsizeiptr{ 3 }; };
+	const auto indexStart{ alignWord(m_indexBytes) };
+
+	reserve(m_vertexBuffer, m_vertexCapacity, m_vertexBytes, m_vertexBytes + vertexBytes);
+	reserve(m_indexBuffer, m_indexCapacity, m_indexBytes, alignWord(indexStart + indexBytes));
+
+	const Entry entry{ static_cast<GLuint>(m_vertexBytes / sizeof(GLuint)), static_cast<GLuint>(indexStart / indexSize) };
+
+	glBindBuffer(GL_COPY_READ_BUFFER, vao.GetBuffer(GLVertexArray::ARRAY));
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_vertexBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, m_vertexBytes, vertexBytes);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, vao.GetBuffer(GLVertexArray::ELEMENT));
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, indexStart, indexBytes);
+
+	m_vertexBytes += vertexBytes;
+	m_indexBytes = indexStart + indexBytes;
+
+	m_entries.emplace(vao.GetHandle(), entry);
+
+	return entry;
+}
+
+/***********************************************************************************/
+void GeometryPool::Bind(const GLuint vertexBinding, const GLuint indexBinding) const {
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, vertexBinding, m_vertexBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, indexBinding, m_indexBuffer);
+}
+
+/***********************************************************************************/
+void GeometryPool::reserve(GLuint& buffer, GLsizeiptr& capacity, const GLsizeiptr used, const GLsizeiptr required) {
+	if (required <= capacity) {
+		return;
+	}
+
+	const auto newCapacity{ std::max(required, capacity * 2) };
+
+	GLuint newBuffer{ 0 };
+	glGenBuffers(1, &newBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, newCapacity, nullptr, GL_STATIC_DRAW);
+
+	if (used > 0) {
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+	}
+
+	glDeleteBuffers(1, &buffer);
+	buffer = newBuffer;
+	capacity = newCapacity;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "GLVertexArray.h"
+
+#include <unordered_map>
+
+/***********************************************************************************/
+// Copies of mesh vertex and index buffers packed into two shader storage buffers, so a
+// single full-screen pass can fetch the triangles of any draw. Meshes are copied in on the
+// GPU the first time they are added and never removed, scenes are not unloaded while the
+// renderer runs. Meshes keep their vertex and index formats, each starts on a 4-byte boundary.
+class GeometryPool {
+public:
+	// Where a mesh lives in the pool. Indices stay relative to the mesh's first vertex.
+	struct Entry {
+		GLuint VertexOffset;	// In 32-bit words
+		GLuint FirstIndex;		// In indices of the mesh's size
+	};
+
+	void Init();
+	void Delete();
+
+	// Copies the mesh in if it isn't pooled yet. indexSize is 2 or 4 bytes. GL thread only.
+	Entry Add(const GLVertexArray& vao, const std::size_t indexSize);
+	// Location of a mesh added earlier, keyed by its vertex array handle
+	const auto& Get(const GLuint vao) const { return m_entries.at(vao); }
+
+	void Bind(const GLuint vertexBinding, const GLuint indexBinding) const;
+
+	auto GetSize() const noexcept { return m_vertexBytes + m_indexBytes; }
+	// Bytes allocated, including room to grow
+	auto GetCapacity() const noexcept { return static_cast<std::size_t>(m_vertexCapacity + m_indexCapacity); }
+
+private:
+	// Reallocates buffer to hold at least required bytes, keeping the first used bytes
+	static void reserve(GLuint& buffer, GLsizeiptr& capacity, const GLsizeiptr used, const GLsizeiptr required);
+
+	std::unordered_map<GLuint, Entry> m_entries;
+
+	GLuint m_vertexBuffer{ 0 }, m_indexBuffer{ 0 };
+	GLsizeiptr m_vertexCapacity{ 0 }, m_indexCapacity{ 0 };
+	GLsizeiptr m_vertexBytes{ 0 }, m_indexBytes{ 0 };
+};
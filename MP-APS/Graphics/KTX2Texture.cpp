@@ -0,0 +1,284 @@
+#include "KTX2Texture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace {
+	constexpr std::uint8_t Identifier[12]{ 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	constexpr std::string_view SourceKeyName{ "MPAPS.sourceKey" };
+
+	// Header and index, everything up to the level index
+	struct FileHeader {
+		std::uint8_t Identifier[12];
+		std::uint32_t VkFormat, TypeSize;
+		std::uint32_t PixelWidth, PixelHeight, PixelDepth;
+		std::uint32_t LayerCount, FaceCount, LevelCount;
+		std::uint32_t SupercompressionScheme;
+		std::uint32_t DfdByteOffset, DfdByteLength;
+		std::uint32_t KvdByteOffset, KvdByteLength;
+		std::uint64_t SgdByteOffset, SgdByteLength;
+	};
+	static_assert(sizeof(FileHeader) == 80, "KTX2 header must not be padded");
+
+	struct LevelIndex {
+		std::uint64_t ByteOffset, ByteLength, UncompressedByteLength;
+	};
+
+	// Data format descriptor of a format: the Khronos colour model and one sample per
+	// 64-bit half of the block (BC3 alpha + colour, BC5 red + green)
+	struct FormatInfo {
+		TextureCompressor::Format Format;
+		std::uint32_t VkFormat;
+		std::uint8_t ColorModel;
+		std::uint8_t NumSamples;
+		std::uint8_t Channels[2];
+	};
+
+	constexpr FormatInfo Formats[]{
+		{ TextureCompressor::Format::BC1, 131, 128, 1, { 0, 0 } },	// VK_FORMAT_BC1_RGB_UNORM_BLOCK, KHR_DF_MODEL_BC1A
+		{ TextureCompressor::Format::BC3, 137, 130, 2, { 15, 0 } },	// VK_FORMAT_BC3_UNORM_BLOCK, KHR_DF_MODEL_BC3
+		{ TextureCompressor::Format::BC4, 139, 131, 1, { 0, 0 } },	// VK_FORMAT_BC4_UNORM_BLOCK, KHR_DF_MODEL_BC4
+		{ TextureCompressor::Format::BC5, 141, 132, 2, { 0, 1 } },	// VK_FORMAT_BC5_UNORM_BLOCK, KHR_DF_MODEL_BC5
+		{ TextureCompressor::Format::BC7, 145, 134, 1, { 0, 0 } }	// VK_FORMAT_BC7_UNORM_BLOCK, KHR_DF_MODEL_BC7
+	};
+
+	/***********************************************************************************/
+	const FormatInfo* findFormat(const TextureCompressor::Format format) noexcept {
+		const auto info{ std::find_if(std::cbegin(Formats), std::cend(Formats), [format](const auto& f) { return f.Format == format; }) };
+		return info != std::cend(Formats) ? info : nullptr;
+	}
+
+	/***********************************************************************************/
+	const FormatInfo* findFormat(const std::uint32_t vkFormat) noexcept {
+		const auto info{ std::find_if(std::cbegin(Formats), std::cend(Formats), [vkFormat](const auto& f) { return f.VkFormat == vkFormat; }) };
+		return info != std::cend(Formats) ? info : nullptr;
+	}
+
+	/***********************************************************************************/
+	void appendWord(std::vector<std::uint8_t>& out, const std::uint32_t word) {
+		const auto offset{ out.size() };
+		out.resize(offset + sizeof(word));
+		std::memcpy(out.data() + offset, &word, sizeof(word));
+	}
+
+	/***********************************************************************************/
+	// dfdTotalSize followed by one basic descriptor block
+	std::vector<std::uint8_t> buildDFD(const FormatInfo& info, const std::size_t blockBytes) {
+		const auto blockSize{ 24u + 16u * info.NumSamples };
+
+		std::vector<std::uint8_t> dfd;
+		appendWord(dfd, 4 + blockSize);
+		appendWord(dfd, 0);								// Khronos vendor, basic descriptor type
+		appendWord(dfd, 2 | (blockSize << 16));			// Version 1.3
+		appendWord(dfd, info.ColorModel | (1 << 8) | (1 << 16));	// BT.709 primaries, linear transfer, straight alpha
+		appendWord(dfd, 3 | (3 << 8));					// 4x4x1x1 texels, stored minus one
+		appendWord(dfd, static_cast<std::uint32_t>(blockBytes));	// Bytes in plane 0
+		appendWord(dfd, 0);
+
+		for (std::uint32_t i = 0; i < info.NumSamples; ++i) {
+			const auto bitLength{ static_cast<std::uint32_t>(blockBytes * 8 / info.NumSamples) };
+			appendWord(dfd, (i * bitLength) | ((bitLength - 1) << 16) | (static_cast<std::uint32_t>(info.Channels[i]) << 24));
+			appendWord(dfd, 0);							// Sample position
+			appendWord(dfd, 0);							// Lower
+			appendWord(dfd, 0xFFFFFFFF);				// Upper
+		}
+
+		return dfd;
+	}
+
+	/***********************************************************************************/
+	std::string formatKey(const std::uint64_t key) {
+		std::ostringstream str;
+		str << std::hex << std::setw(16) << std::setfill('0') << key;
+		return str.str();
+	}
+
+	/***********************************************************************************/
+	// One entry: byte length, then the key and the value, both null terminated, padded to 4
+	std::vector<std::uint8_t> buildKVD(const std::uint64_t key) {
+		const auto value{ formatKey(key) };
+		const auto length{ static_cast<std::uint32_t>(SourceKeyName.size() + 1 + value.size() + 1) };
+
+		std::vector<std::uint8_t> kvd;
+		appendWord(kvd, length);
+		kvd.insert(kvd.end(), SourceKeyName.cbegin(), SourceKeyName.cend());
+		kvd.push_back(0);
+		kvd.insert(kvd.end(), value.cbegin(), value.cend());
+		kvd.push_back(0);
+		kvd.resize((kvd.size() + 3) / 4 * 4, 0);
+
+		return kvd;
+	}
+
+	/***********************************************************************************/
+	// Value of the source key entry, empty if there is none or the data is malformed
+	std::string_view findSourceKey(const std::byte* data, const std::byte* end) {
+		while (end - data >= 4) {
+			std::uint32_t length;
+			std::memcpy(&length, data, sizeof(length));
+			data += sizeof(length);
+			if (end - data < static_cast<std::ptrdiff_t>(length)) {
+				return {};
+			}
+
+			const std::string_view entry{ reinterpret_cast<const char*>(data), length };
+			const auto separator{ entry.find('\0') };
+			if (separator != std::string_view::npos && entry.substr(0, separator) == SourceKeyName) {
+				auto value{ entry.substr(separator + 1) };
+				if (!value.empty() && value.back() == '\0') {
+					value.remove_suffix(1);
+				}
+				return value;
+			}
+
+			data += (length + 3) / 4 * 4;
+		}
+		return {};
+	}
+
+	/***********************************************************************************/
+	constexpr std::uint64_t alignTo(const std::uint64_t offset, const std::uint64_t alignment) noexcept {
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+}
+
+/***********************************************************************************/
+bool KTX2Texture::Write(const std::filesystem::path& path, const TextureCompressor::Format format, const int width, const int height, const std::uint64_t key, const std::vector<std::vector<std::uint8_t>>& levels) {
+	const auto* info{ findFormat(format) };
+	if (!info || levels.empty()) {
+		return false;
+	}
+
+	const auto blockBytes{ TextureCompressor::GetBlockBytes(format) };
+	const auto dfd{ buildDFD(*info, blockBytes) };
+	const auto kvd{ buildKVD(key) };
+
+	FileHeader header{};
+	std::memcpy(header.Identifier, Identifier, sizeof(Identifier));
+	header.VkFormat = info->VkFormat;
+	header.TypeSize = 1;
+	header.PixelWidth = width;
+	header.PixelHeight = height;
+	header.FaceCount = 1;
+	header.LevelCount = static_cast<std::uint32_t>(levels.size());
+	header.DfdByteOffset = static_cast<std::uint32_t>(sizeof(FileHeader) + levels.size() * sizeof(LevelIndex));
+	header.DfdByteLength = static_cast<std::uint32_t>(dfd.size());
+	header.KvdByteOffset = header.DfdByteOffset + header.DfdByteLength;
+	header.KvdByteLength = static_cast<std::uint32_t>(kvd.size());
+
+	// The smallest level is stored first, every level starts on a block boundary
+	std::vector<LevelIndex> levelIndex(levels.size());
+	auto offset{ static_cast<std::uint64_t>(header.KvdByteOffset) + header.KvdByteLength };
+	for (auto level = levels.size(); level-- > 0;) {
+		offset = alignTo(offset, blockBytes);
+		levelIndex[level] = { offset, levels[level].size(), levels[level].size() };
+		offset += levels[level].size();
+	}
+
+	if (path.has_parent_path()) {
+		std::filesystem::create_directories(path.parent_path());
+	}
+
+	auto tempPath{ path };
+	tempPath += ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary);
+		if (!out) {
+			std::cerr << "KTX2: failed to write " << tempPath << '\n';
+			return false;
+		}
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(levelIndex.data()), levelIndex.size() * sizeof(LevelIndex));
+		out.write(reinterpret_cast<const char*>(dfd.data()), dfd.size());
+		out.write(reinterpret_cast<const char*>(kvd.data()), kvd.size());
+
+		auto position{ static_cast<std::uint64_t>(header.KvdByteOffset) + header.KvdByteLength };
+		for (auto level = levels.size(); level-- > 0;) {
+			const char zeros[16]{};
+			out.write(zeros, levelIndex[level].ByteOffset - position);
+			out.write(reinterpret_cast<const char*>(levels[level].data()), levels[level].size());
+			position = levelIndex[level].ByteOffset + levels[level].size();
+		}
+
+		if (!out) {
+			std::cerr << "KTX2: failed to write " << tempPath << '\n';
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+	if (error) {
+		std::cerr << "KTX2: failed to replace " << path << ": " << error.message() << '\n';
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+/***********************************************************************************/
+bool KTX2Texture::Load(const std::filesystem::path& path, const std::uint64_t key) {
+	m_levels.clear();
+
+	if (!m_file.Open(path)) {
+		return false;
+	}
+
+	const auto fileSize{ static_cast<std::uint64_t>(m_file.GetSize()) };
+	const auto* data{ m_file.GetData() };
+
+	FileHeader header;
+	if (fileSize < sizeof(header)) {
+		m_file.Close();
+		return false;
+	}
+	std::memcpy(&header, data, sizeof(header));
+
+	const auto* info{ findFormat(header.VkFormat) };
+	const auto valid{ std::memcmp(header.Identifier, Identifier, sizeof(Identifier)) == 0 && info &&
+		header.PixelWidth > 0 && header.PixelHeight > 0 && header.PixelDepth == 0 && header.LayerCount == 0 &&
+		header.FaceCount == 1 && header.LevelCount > 0 && header.LevelCount <= 32 && header.SupercompressionScheme == 0 &&
+		sizeof(FileHeader) + header.LevelCount * sizeof(LevelIndex) <= fileSize &&
+		static_cast<std::uint64_t>(header.KvdByteOffset) + header.KvdByteLength <= fileSize };
+	if (!valid) {
+		std::cerr << "KTX2: " << path << " is not a supported texture, recompressing\n";
+		m_file.Close();
+		return false;
+	}
+
+	if (findSourceKey(data + header.KvdByteOffset, data + header.KvdByteOffset + header.KvdByteLength) != formatKey(key)) {
+		std::cerr << "KTX2: " << path << " is stale, recompressing\n";
+		m_file.Close();
+		return false;
+	}
+
+	m_format = info->Format;
+	m_width = static_cast<int>(header.PixelWidth);
+	m_height = static_cast<int>(header.PixelHeight);
+
+	// Reject levels outside the file or of the wrong size rather than uploading garbage
+	for (std::uint32_t level = 0; level < header.LevelCount; ++level) {
+		LevelIndex index;
+		std::memcpy(&index, data + sizeof(FileHeader) + level * sizeof(LevelIndex), sizeof(index));
+
+		const auto expectedSize{ TextureCompressor::GetCompressedSize(m_format, std::max(m_width >> level, 1), std::max(m_height >> level, 1)) };
+		if (index.ByteLength != expectedSize || index.ByteOffset > fileSize || fileSize - index.ByteOffset < index.ByteLength) {
+			std::cerr << "KTX2: " << path << " is damaged, recompressing\n";
+			m_levels.clear();
+			m_file.Close();
+			return false;
+		}
+
+		m_levels.push_back({ data + index.ByteOffset, static_cast<std::size_t>(index.ByteLength) });
+	}
+
+	return true;
+}
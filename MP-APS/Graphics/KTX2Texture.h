@@ -0,0 +1,48 @@
+#pragma once
+
+#include "TextureCompressor.h"
+#include "../Core/MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+/***********************************************************************************/
+// Block compressed 2D textures with all mips in a KTX2 file. Only what TextureCompressor
+// produces is supported: one layer, one face, no supercompression. The key the texture was
+// built for is stored in the key/value data as "MPAPS.sourceKey", 16 hex digits.
+//
+// Files are standard KTX2 and open in other tools (ktx info, RenderDoc).
+class KTX2Texture {
+public:
+	// A mip level inside the mapped file
+	struct Level {
+		const std::byte* Data;
+		std::size_t Size;
+	};
+
+	// levels[0] is the full size image, every level must hold GetCompressedSize() bytes.
+	// Written under a temporary name and renamed, like the mesh cache.
+	static bool Write(const std::filesystem::path& path,
+		const TextureCompressor::Format format,
+		const int width,
+		const int height,
+		const std::uint64_t key,
+		const std::vector<std::vector<std::uint8_t>>& levels);
+
+	// Maps a file written by Write(). Fails if it was written for another key or is damaged.
+	bool Load(const std::filesystem::path& path, const std::uint64_t key);
+
+	auto GetFormat() const noexcept { return m_format; }
+	auto GetWidth() const noexcept { return m_width; }
+	auto GetHeight() const noexcept { return m_height; }
+	// Level 0 first
+	const auto& GetLevels() const noexcept { return m_levels; }
+
+private:
+	MappedFile m_file;
+	TextureCompressor::Format m_format{ TextureCompressor::Format::BC7 };
+	int m_width{ 0 }, m_height{ 0 };
+	std::vector<Level> m_levels;
+};
@@ -0,0 +1,246 @@
+#include "LightClusterGrid.h"
+
+#include "../Core/JobSystem.h"
+#include "../Core/Profiler.h"
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+// No FMA contraction anywhere in here (MSVC default, -ffp-contract=off for gcc/clang), the
+// intersection test must round exactly like the `precise` GLSL version.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+	#define LIGHT_CLUSTER_SSE
+	#include <emmintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#endif
+
+namespace {
+
+#ifdef LIGHT_CLUSTER_SSE
+/***********************************************************************************/
+// Squared distance from 4 spheres to 4 boxes, same operation order as Intersects()
+inline __m128 distance2(const __m128 minX, const __m128 minY, const __m128 minZ,
+						const __m128 maxX, const __m128 maxY, const __m128 maxZ,
+						const __m128 x, const __m128 y, const __m128 z) {
+	const auto zero{ _mm_setzero_ps() };
+	const auto dx{ _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX, x), _mm_sub_ps(x, maxX)), zero) };
+	const auto dy{ _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY, y), _mm_sub_ps(y, maxY)), zero) };
+	const auto dz{ _mm_max_ps(_mm_max_ps(_mm_sub_ps(minZ, z), _mm_sub_ps(z, maxZ)), zero) };
+
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+}
+
+/***********************************************************************************/
+inline unsigned int lowestBit(const unsigned int mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return static_cast<unsigned int>(index);
+#else
+	return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+}
+#endif
+
+}
+
+/***********************************************************************************/
+bool LightClusterGrid::Update(const std::uint32_t width, const std::uint32_t height, const glm::mat4& projection) {
+	if (width == m_width && height == m_height && projection == m_projection && !m_bounds.empty()) {
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_projection = projection;
+
+	m_numX = (width + TileSize - 1) / TileSize;
+	m_numY = (height + TileSize - 1) / TileSize;
+
+	// Clip planes of a standard OpenGL perspective projection
+	const auto nearPlane{ projection[3][2] / (projection[2][2] - 1.0f) };
+	const auto farPlane{ projection[3][2] / (projection[2][2] + 1.0f) };
+	const auto logRatio{ std::log(farPlane / nearPlane) };
+
+	m_sliceScale = static_cast<float>(NumSlices) / logRatio;
+	m_sliceBias = -static_cast<float>(NumSlices) * std::log(nearPlane) / logRatio;
+
+	const auto inverseProjection{ glm::inverse(projection) };
+	const auto unprojectNear = [&inverseProjection](const float x, const float y) {
+		const auto p{ inverseProjection * glm::vec4(x, y, -1.0f, 1.0f) };
+		return glm::vec3(p) / p.w;
+	};
+
+	const auto numClusters{ m_numX * m_numY * NumSlices };
+	m_bounds.resize(numClusters);
+	m_rowBounds.resize(m_numY * NumSlices);
+
+	m_paddedX = (m_numX + 3) & ~3u;
+	for (auto* soa : { &m_minX, &m_minY, &m_minZ }) {
+		soa->assign(m_rowBounds.size() * m_paddedX, std::numeric_limits<float>::infinity());
+	}
+	for (auto* soa : { &m_maxX, &m_maxY, &m_maxZ }) {
+		soa->assign(m_rowBounds.size() * m_paddedX, -std::numeric_limits<float>::infinity());
+	}
+
+	for (std::uint32_t z = 0; z < NumSlices; ++z) {
+		const auto sliceNear{ nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z) / NumSlices) };
+		const auto sliceFar{ nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z + 1) / NumSlices) };
+
+		for (std::uint32_t y = 0; y < m_numY; ++y) {
+			const auto row{ z * m_numY + y };
+			auto& rowBounds{ m_rowBounds[row] };
+			rowBounds.Min = glm::vec4(std::numeric_limits<float>::max());
+			rowBounds.Max = glm::vec4(-std::numeric_limits<float>::max());
+
+			for (std::uint32_t x = 0; x < m_numX; ++x) {
+				// Tile corners in NDC
+				const auto ndcMinX{ static_cast<float>(x * TileSize) / width * 2.0f - 1.0f };
+				const auto ndcMaxX{ static_cast<float>(std::min((x + 1) * TileSize, width)) / width * 2.0f - 1.0f };
+				const auto ndcMinY{ static_cast<float>(y * TileSize) / height * 2.0f - 1.0f };
+				const auto ndcMaxY{ static_cast<float>(std::min((y + 1) * TileSize, height)) / height * 2.0f - 1.0f };
+
+				const glm::vec3 corners[4]{
+					unprojectNear(ndcMinX, ndcMinY), unprojectNear(ndcMaxX, ndcMinY),
+					unprojectNear(ndcMinX, ndcMaxY), unprojectNear(ndcMaxX, ndcMaxY)
+				};
+
+				// Slide the corners along their view rays to the slice's depth range
+				glm::vec3 boundsMin{ std::numeric_limits<float>::max() }, boundsMax{ -std::numeric_limits<float>::max() };
+				for (const auto& corner : corners) {
+					for (const auto depth : { sliceNear, sliceFar }) {
+						const auto point{ corner * (depth / -corner.z) };
+						boundsMin = glm::min(boundsMin, point);
+						boundsMax = glm::max(boundsMax, point);
+					}
+				}
+
+				auto& bounds{ m_bounds[row * m_numX + x] };
+				bounds.Min = glm::vec4(boundsMin, 0.0f);
+				bounds.Max = glm::vec4(boundsMax, 0.0f);
+
+				rowBounds.Min = glm::min(rowBounds.Min, bounds.Min);
+				rowBounds.Max = glm::max(rowBounds.Max, bounds.Max);
+
+				const auto soaIndex{ row * m_paddedX + x };
+				m_minX[soaIndex] = boundsMin.x;
+				m_minY[soaIndex] = boundsMin.y;
+				m_minZ[soaIndex] = boundsMin.z;
+				m_maxX[soaIndex] = boundsMax.x;
+				m_maxY[soaIndex] = boundsMax.y;
+				m_maxZ[soaIndex] = boundsMax.z;
+			}
+		}
+	}
+
+	m_clusterLights.resize(numClusters);
+
+	return true;
+}
+
+/***********************************************************************************/
+void LightClusterGrid::AssignLights(const std::vector<glm::vec4>& spheres) {
+	PROFILE_FUNCTION();
+	const auto numLights{ spheres.size() };
+	const auto paddedLights{ (numLights + 3) & ~static_cast<std::size_t>(3) };
+
+	// Padding lights sit infinitely far away and can't touch anything
+	m_lightX.assign(paddedLights, std::numeric_limits<float>::max());
+	m_lightY.assign(paddedLights, std::numeric_limits<float>::max());
+	m_lightZ.assign(paddedLights, std::numeric_limits<float>::max());
+	m_lightRadius2.assign(paddedLights, 0.0f);
+	for (std::size_t i = 0; i < numLights; ++i) {
+		m_lightX[i] = spheres[i].x;
+		m_lightY[i] = spheres[i].y;
+		m_lightZ[i] = spheres[i].z;
+		m_lightRadius2[i] = spheres[i].w * spheres[i].w;
+	}
+
+	// Each job owns one row of clusters and walks all lights in order, which keeps
+	// every cluster's list sorted without any synchronization.
+	JobSystem::GetInstance().ParallelFor(m_rowBounds.size(), 1, [&](const auto begin, const auto end) {
+		for (auto row = begin; row < end; ++row) {
+			const auto firstCluster{ row * m_numX };
+			for (std::size_t x = 0; x < m_numX; ++x) {
+				m_clusterLights[firstCluster + x].clear();
+			}
+
+#ifdef LIGHT_CLUSTER_SSE
+			const auto& rowBounds{ m_rowBounds[row] };
+			const auto rowMinX{ _mm_set1_ps(rowBounds.Min.x) }, rowMinY{ _mm_set1_ps(rowBounds.Min.y) }, rowMinZ{ _mm_set1_ps(rowBounds.Min.z) };
+			const auto rowMaxX{ _mm_set1_ps(rowBounds.Max.x) }, rowMaxY{ _mm_set1_ps(rowBounds.Max.y) }, rowMaxZ{ _mm_set1_ps(rowBounds.Max.z) };
+			const auto soaOffset{ row * m_paddedX };
+
+			for (std::size_t light = 0; light < paddedLights; light += 4) {
+				// 4 lights against the whole row
+				const auto radius2{ _mm_loadu_ps(&m_lightRadius2[light]) };
+				auto lightMask{ static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(distance2(rowMinX, rowMinY, rowMinZ, rowMaxX, rowMaxY, rowMaxZ,
+					_mm_loadu_ps(&m_lightX[light]), _mm_loadu_ps(&m_lightY[light]), _mm_loadu_ps(&m_lightZ[light])), radius2))) };
+
+				while (lightMask) {
+					const auto lightIndex{ light + lowestBit(lightMask) };
+					lightMask &= lightMask - 1;
+
+					// One light against 4 clusters at a time
+					const auto x{ _mm_set1_ps(m_lightX[lightIndex]) }, y{ _mm_set1_ps(m_lightY[lightIndex]) }, z{ _mm_set1_ps(m_lightZ[lightIndex]) };
+					const auto r2{ _mm_set1_ps(m_lightRadius2[lightIndex]) };
+
+					for (std::size_t cluster = 0; cluster < m_paddedX; cluster += 4) {
+						const auto i{ soaOffset + cluster };
+						auto clusterMask{ static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(distance2(
+							_mm_loadu_ps(&m_minX[i]), _mm_loadu_ps(&m_minY[i]), _mm_loadu_ps(&m_minZ[i]),
+							_mm_loadu_ps(&m_maxX[i]), _mm_loadu_ps(&m_maxY[i]), _mm_loadu_ps(&m_maxZ[i]), x, y, z), r2))) };
+
+						while (clusterMask) {
+							m_clusterLights[firstCluster + cluster + lowestBit(clusterMask)].push_back(static_cast<std::uint32_t>(lightIndex));
+							clusterMask &= clusterMask - 1;
+						}
+					}
+				}
+			}
+#else
+			for (std::size_t light = 0; light < numLights; ++light) {
+				if (!Intersects(m_rowBounds[row], spheres[light])) {
+					continue;
+				}
+				for (std::size_t x = 0; x < m_numX; ++x) {
+					if (Intersects(m_bounds[firstCluster + x], spheres[light])) {
+						m_clusterLights[firstCluster + x].push_back(static_cast<std::uint32_t>(light));
+					}
+				}
+			}
+#endif
+		}
+	});
+
+	// Compact into one index list
+	m_lightGrid.resize(m_clusterLights.size());
+	std::uint32_t offset{ 0 };
+	for (std::size_t i = 0; i < m_clusterLights.size(); ++i) {
+		const auto count{ static_cast<std::uint32_t>(m_clusterLights[i].size()) };
+		m_lightGrid[i] = glm::uvec2(offset, count);
+		offset += count;
+	}
+
+	m_lightIndices.resize(offset);
+	JobSystem::GetInstance().ParallelFor(m_clusterLights.size(), [this](const auto begin, const auto end) {
+		for (auto i = begin; i < end; ++i) {
+			std::copy(m_clusterLights[i].cbegin(), m_clusterLights[i].cend(), m_lightIndices.begin() + m_lightGrid[i].x);
+		}
+	});
+}
+
+/***********************************************************************************/
+bool LightClusterGrid::Intersects(const Bounds& bounds, const glm::vec4& sphere) noexcept {
+	const auto dx{ std::max(std::max(bounds.Min.x - sphere.x, sphere.x - bounds.Max.x), 0.0f) };
+	const auto dy{ std::max(std::max(bounds.Min.y - sphere.y, sphere.y - bounds.Max.y), 0.0f) };
+	const auto dz{ std::max(std::max(bounds.Min.z - sphere.z, sphere.z - bounds.Max.z), 0.0f) };
+
+	const auto distance2{ dx * dx + dy * dy + dz * dz };
+	return distance2 <= sphere.w * sphere.w;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************************************/
+// Froxel grid for clustered shading. The screen is split into TileSize pixel tiles and
+// NumSlices depth slices spaced exponentially between the near and far plane.
+//
+// AssignLights() is the CPU counterpart of lightclusteringcs.glsl. Both use the same
+// cluster bounds and light spheres, the same operation order for the intersection test,
+// and list each cluster's lights in ascending index order, so their results are identical.
+class LightClusterGrid {
+public:
+	static constexpr std::uint32_t TileSize{ 64 };	// CLUSTER_TILE_SIZE in lightgrid.glsl
+	static constexpr std::uint32_t NumSlices{ 24 };
+
+	// View-space AABB of one cluster, matches struct ClusterBounds in lightgrid.glsl
+	struct Bounds {
+		glm::vec4 Min;
+		glm::vec4 Max;
+	};
+
+	// Recomputes cluster bounds if the screen size or projection changed. Returns true if they did.
+	bool Update(const std::uint32_t width, const std::uint32_t height, const glm::mat4& projection);
+
+	// Assigns lights to clusters on the job system.
+	// spheres: xyz = view-space center, w = radius of influence
+	void AssignLights(const std::vector<glm::vec4>& spheres);
+
+	// The intersection test both paths use
+	static bool Intersects(const Bounds& bounds, const glm::vec4& sphere) noexcept;
+
+	auto GetNumClusters() const noexcept { return m_bounds.size(); }
+	auto GetDims() const noexcept { return glm::uvec3(m_numX, m_numY, NumSlices); }
+	// Slice of a view-space depth: log(depth) * scale + bias
+	auto GetSliceScale() const noexcept { return m_sliceScale; }
+	auto GetSliceBias() const noexcept { return m_sliceBias; }
+
+	const auto& GetBounds() const noexcept { return m_bounds; }
+	// Per cluster: x = offset into GetLightIndices(), y = number of lights
+	const auto& GetLightGrid() const noexcept { return m_lightGrid; }
+	const auto& GetLightIndices() const noexcept { return m_lightIndices; }
+
+private:
+	std::uint32_t m_width{ 0 }, m_height{ 0 };
+	glm::mat4 m_projection{ 0.0f };
+
+	std::uint32_t m_numX{ 0 }, m_numY{ 0 };
+	float m_sliceScale{ 0.0f }, m_sliceBias{ 0.0f };
+
+	std::vector<Bounds> m_bounds;
+
+	// One row is all clusters sharing a y and z index. Each row is one job.
+	// Bounds of the whole row, for rejecting lights before testing single clusters
+	std::vector<Bounds> m_rowBounds;
+	// Cluster bounds per row in structure-of-arrays form, padded to a multiple of 4
+	std::uint32_t m_paddedX{ 0 };
+	std::vector<float> m_minX, m_minY, m_minZ, m_maxX, m_maxY, m_maxZ;
+
+	// Lights in structure-of-arrays form, padded to a multiple of 4
+	std::vector<float> m_lightX, m_lightY, m_lightZ, m_lightRadius2;
+
+	std::vector<std::vector<std::uint32_t>> m_clusterLights;
+	std::vector<glm::uvec2> m_lightGrid;
+	std::vector<std::uint32_t> m_lightIndices;
+};
@@ -0,0 +1,372 @@
+#include "MipGenerator.h"
+
+#include "../Core/JobSystem.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+	#define MIP_GENERATOR_SSE
+	#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr float Pi{ 3.14159265358979f };
+// Texels per job, so the small levels aren't split into tiny jobs
+constexpr std::size_t TexelsPerJob{ 16384 };
+
+// Kaiser window parameters, as in NVIDIA Texture Tools
+constexpr float KaiserWidth{ 3.0f }, KaiserAlpha{ 4.0f };
+constexpr float LanczosWidth{ 3.0f };
+
+// Every image is RGBA float while filtering, missing channels are left at zero
+using FloatImage = std::vector<float>;
+
+// Source texels and weights of every texel along one axis of the output
+struct Taps {
+	int NumTaps;
+	std::vector<int> Indices;	// NumTaps per output texel, clamped to the source
+	std::vector<float> Weights;	// NumTaps per output texel, they sum to 1
+};
+
+struct ConversionTables {
+	std::array<float, 256> UNormToFloat;
+	std::array<float, 256> SRGBToLinear;
+	std::array<std::uint8_t, 4096> LinearToSRGB;	// Indexed by the linear value * 4095
+};
+
+/***********************************************************************************/
+const ConversionTables& getTables() {
+	static const auto tables{ []() {
+		ConversionTables tables;
+		for (std::size_t i = 0; i < tables.SRGBToLinear.size(); ++i) {
+			const auto c{ static_cast<float>(i) / 255.0f };
+			tables.UNormToFloat[i] = c;
+			tables.SRGBToLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		for (std::size_t i = 0; i < tables.LinearToSRGB.size(); ++i) {
+			const auto l{ static_cast<float>(i) / 4095.0f };
+			const auto c{ l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f };
+			tables.LinearToSRGB[i] = static_cast<std::uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+		}
+		return tables;
+	}() };
+
+	return tables;
+}
+
+/***********************************************************************************/
+float sinc(const float x) {
+	return std::abs(x) < 1e-5f ? 1.0f : std::sin(Pi * x) / (Pi * x);
+}
+
+/***********************************************************************************/
+// Modified Bessel function of the first kind, order 0
+float bessel0(const float x) {
+	auto sum{ 1.0f }, term{ 1.0f };
+	for (int k = 1; k < 32 && term > sum * 1e-8f; ++k) {
+		const auto factor{ x * 0.5f / static_cast<float>(k) };
+		term *= factor * factor;
+		sum += term;
+	}
+	return sum;
+}
+
+/***********************************************************************************/
+// Radius in output texels
+float getRadius(const MipGenerator::Filter filter) noexcept {
+	switch (filter) {
+	case MipGenerator::Filter::Kaiser:
+		return KaiserWidth;
+	case MipGenerator::Filter::Lanczos:
+		return LanczosWidth;
+	default:
+		return 0.5f;
+	}
+}
+
+/***********************************************************************************/
+// x is the distance in output texels
+float evaluate(const MipGenerator::Filter filter, const float x) {
+	switch (filter) {
+	case MipGenerator::Filter::Kaiser: {
+		const auto t{ x / KaiserWidth };
+		return t * t < 1.0f ? sinc(x) * bessel0(KaiserAlpha * std::sqrt(1.0f - t * t)) / bessel0(KaiserAlpha) : 0.0f;
+	}
+	case MipGenerator::Filter::Lanczos:
+		return std::abs(x) < LanczosWidth ? sinc(x) * sinc(x / LanczosWidth) : 0.0f;
+	default:
+		return std::abs(x) <= 0.5f ? 1.0f : 0.0f;
+	}
+}
+
+/***********************************************************************************/
+Taps computeTaps(const int srcSize, const int dstSize, const MipGenerator::Filter filter) {
+	const auto scale{ static_cast<float>(srcSize) / static_cast<float>(dstSize) };
+	const auto radius{ getRadius(filter) * scale };
+
+	// Every source texel within the radius, zero weights at the ends are trimmed below
+	const auto maxTaps{ static_cast<int>(std::ceil(radius * 2.0f)) + 1 };
+	std::vector<int> firsts(dstSize);
+	std::vector<float> weights(static_cast<std::size_t>(dstSize) * maxTaps);
+
+	Taps taps{ 1, {}, {} };
+	for (int x = 0; x < dstSize; ++x) {
+		auto* texelWeights{ &weights[static_cast<std::size_t>(x) * maxTaps] };
+
+		// Texel centers are at +0.5
+		const auto center{ (static_cast<float>(x) + 0.5f) * scale };
+		const auto first{ static_cast<int>(std::ceil(center - radius - 0.5f)) };
+
+		auto sum{ 0.0f };
+		for (int t = 0; t < maxTaps; ++t) {
+			texelWeights[t] = evaluate(filter, (static_cast<float>(first + t) + 0.5f - center) / scale);
+			sum += texelWeights[t];
+		}
+		for (int t = 0; t < maxTaps; ++t) {
+			texelWeights[t] /= sum;
+		}
+
+		auto begin{ 0 }, end{ maxTaps };
+		while (begin < end - 1 && texelWeights[begin] == 0.0f) {
+			++begin;
+		}
+		while (end > begin + 1 && texelWeights[end - 1] == 0.0f) {
+			--end;
+		}
+		std::fill(texelWeights, texelWeights + begin, 0.0f);
+		firsts[x] = first + begin;
+		std::rotate(texelWeights, texelWeights + begin, texelWeights + maxTaps);
+		taps.NumTaps = std::max(taps.NumTaps, end - begin);
+	}
+
+	taps.Indices.resize(static_cast<std::size_t>(dstSize) * taps.NumTaps);
+	taps.Weights.resize(taps.Indices.size());
+	for (int x = 0; x < dstSize; ++x) {
+		for (int t = 0; t < taps.NumTaps; ++t) {
+			const auto i{ static_cast<std::size_t>(x) * taps.NumTaps + t };
+			taps.Indices[i] = std::clamp(firsts[x] + t, 0, srcSize - 1);
+			taps.Weights[i] = weights[static_cast<std::size_t>(x) * maxTaps + t];
+		}
+	}
+
+	return taps;
+}
+
+/***********************************************************************************/
+void renormalize(float* texel) {
+	auto x{ texel[0] * 2.0f - 1.0f }, y{ texel[1] * 2.0f - 1.0f }, z{ texel[2] * 2.0f - 1.0f };
+	const auto length{ std::sqrt(x * x + y * y + z * z) };
+	if (length > 1e-6f) {
+		x /= length; y /= length; z /= length;
+	}
+	else {
+		x = 0.0f; y = 0.0f; z = 1.0f;
+	}
+	texel[0] = x * 0.5f + 0.5f;
+	texel[1] = y * 0.5f + 0.5f;
+	texel[2] = z * 0.5f + 0.5f;
+}
+
+/***********************************************************************************/
+// Weighted sum of NumTaps texels of src, all RGBA float
+inline void filterTexel(const float* src, const std::size_t stride, const int* indices, const float* weights, const int numTaps, float* dst) {
+#ifdef MIP_GENERATOR_SSE
+	auto sum{ _mm_setzero_ps() };
+	for (int t = 0; t < numTaps; ++t) {
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(src + indices[t] * stride)));
+	}
+	_mm_storeu_ps(dst, sum);
+#else
+	std::array<float, 4> sum{};
+	for (int t = 0; t < numTaps; ++t) {
+		for (int c = 0; c < 4; ++c) {
+			sum[c] += weights[t] * src[indices[t] * stride + c];
+		}
+	}
+	std::copy(sum.cbegin(), sum.cend(), dst);
+#endif
+}
+
+/***********************************************************************************/
+// 8 bit texels to RGBA float, color channels through the sRGB table if srgb
+void decodeRow(const std::uint8_t* pixels, const int width, const int channels, const bool srgb, float* dst) {
+	const auto& tables{ getTables() };
+	const auto numColors{ channels >= 3 ? 3 : 1 };
+
+	auto x{ 0 };
+#ifdef MIP_GENERATOR_SSE
+	if (channels == 4) {
+		const auto scale{ _mm_set1_ps(1.0f / 255.0f) };
+		const auto zero{ _mm_setzero_si128() };
+		for (; x < width; ++x) {
+			std::int32_t texel;
+			std::memcpy(&texel, pixels + x * 4, sizeof(texel));
+			const auto bytes{ _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(texel), zero), zero) };
+			_mm_storeu_ps(dst + x * 4, _mm_mul_ps(_mm_cvtepi32_ps(bytes), scale));
+		}
+		if (!srgb) {
+			return;
+		}
+		x = 0;
+	}
+#endif
+	for (; x < width; ++x) {
+		for (int c = 0; c < channels; ++c) {
+			const auto value{ pixels[x * channels + c] };
+			dst[x * 4 + c] = srgb && c < numColors ? tables.SRGBToLinear[value] : tables.UNormToFloat[value];
+		}
+	}
+}
+
+/***********************************************************************************/
+// Clamps RGBA float texels to [0, 1], renormalises normals and writes them with 8 bits per channel
+void encodeRow(float* texels, const int width, const int channels, const MipGenerator::ColorSpace colorSpace, std::uint8_t* pixels) {
+	const auto& tables{ getTables() };
+	const auto numColors{ channels >= 3 ? 3 : 1 };
+	const auto srgb{ colorSpace == MipGenerator::ColorSpace::SRGB };
+
+	for (int x = 0; x < width; ++x) {
+		auto* texel{ texels + x * 4 };
+		auto* pixel{ pixels + x * channels };
+
+		// Negative lobes can overshoot
+#ifdef MIP_GENERATOR_SSE
+		const auto value{ _mm_min_ps(_mm_max_ps(_mm_loadu_ps(texel), _mm_setzero_ps()), _mm_set1_ps(1.0f)) };
+		_mm_storeu_ps(texel, value);
+#else
+		for (int c = 0; c < 4; ++c) {
+			texel[c] = std::clamp(texel[c], 0.0f, 1.0f);
+		}
+#endif
+		if (colorSpace == MipGenerator::ColorSpace::Normal) {
+			renormalize(texel);
+		}
+
+#ifdef MIP_GENERATOR_SSE
+		if (channels == 4 && !srgb) {
+			const auto bytes{ _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(texel), _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f))) };
+			const auto packed{ _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(bytes, bytes), bytes)) };
+			std::memcpy(pixel, &packed, sizeof(packed));
+			continue;
+		}
+#endif
+		for (int c = 0; c < channels; ++c) {
+			pixel[c] = srgb && c < numColors ? tables.LinearToSRGB[static_cast<std::size_t>(texel[c] * 4095.0f + 0.5f)] : static_cast<std::uint8_t>(texel[c] * 255.0f + 0.5f);
+		}
+	}
+}
+
+/***********************************************************************************/
+// Filters src down to the size of level, writes the pixels of level and returns it as floats.
+// src is the previous level as floats, or empty for level 0 which is decoded from pixels.
+FloatImage downsample(const FloatImage& src, const std::uint8_t* pixels, const int srcWidth, const int srcHeight, const int channels,
+					  const MipGenerator::Filter filter, const MipGenerator::ColorSpace colorSpace, MipGenerator::Level& level) {
+	const auto tapsX{ computeTaps(srcWidth, level.Width, filter) };
+	const auto tapsY{ computeTaps(srcHeight, level.Height, filter) };
+	const auto srcRowSize{ static_cast<std::size_t>(srcWidth) * 4 };
+	const auto rowSize{ static_cast<std::size_t>(level.Width) * 4 };
+
+	FloatImage dst(rowSize * level.Height);
+	level.Pixels.resize(static_cast<std::size_t>(level.Width) * level.Height * channels);
+
+	// Bands of output rows. The source rows of a band are filtered horizontally into a buffer
+	// that stays in cache, bands with wide filters share a few of them.
+	JobSystem::GetInstance().ParallelFor(level.Height, std::max<std::size_t>(TexelsPerJob / level.Width, 1), [&](const auto begin, const auto end) {
+		// Tap indices only grow from row to row
+		const auto firstRow{ tapsY.Indices[begin * tapsY.NumTaps] };
+		const auto lastRow{ tapsY.Indices[end * tapsY.NumTaps - 1] };
+
+		FloatImage rows(rowSize * (lastRow - firstRow + 1));
+		FloatImage decoded(src.empty() ? srcRowSize : 0);
+		for (auto row = firstRow; row <= lastRow; ++row) {
+			const float* srcRow;
+			if (src.empty()) {
+				decodeRow(pixels + static_cast<std::size_t>(row) * srcWidth * channels, srcWidth, channels, colorSpace == MipGenerator::ColorSpace::SRGB, decoded.data());
+				srcRow = decoded.data();
+			}
+			else {
+				srcRow = &src[row * srcRowSize];
+			}
+
+			auto* filtered{ &rows[(row - firstRow) * rowSize] };
+			for (int x = 0; x < level.Width; ++x) {
+				const auto i{ static_cast<std::size_t>(x) * tapsX.NumTaps };
+				filterTexel(srcRow, 4, &tapsX.Indices[i], &tapsX.Weights[i], tapsX.NumTaps, filtered + x * 4);
+			}
+		}
+
+		std::vector<int> indices(tapsY.NumTaps);
+		for (auto y = begin; y < end; ++y) {
+			for (int t = 0; t < tapsY.NumTaps; ++t) {
+				indices[t] = tapsY.Indices[y * tapsY.NumTaps + t] - firstRow;
+			}
+			const auto* weights{ &tapsY.Weights[y * tapsY.NumTaps] };
+			auto* dstRow{ &dst[y * rowSize] };
+
+			for (std::size_t i = 0; i < rowSize; i += 4) {
+				filterTexel(&rows[i], rowSize, indices.data(), weights, tapsY.NumTaps, dstRow + i);
+			}
+			encodeRow(dstRow, level.Width, channels, colorSpace, &level.Pixels[y * level.Width * channels]);
+		}
+	});
+
+	return dst;
+}
+
+}
+
+/***********************************************************************************/
+std::vector<MipGenerator::Level> MipGenerator::Generate(const std::uint8_t* pixels, const int width, const int height, const int channels,
+														const Filter filter, const ColorSpace colorSpace) {
+	const auto space{ colorSpace == ColorSpace::Normal && channels < 3 ? ColorSpace::Linear : colorSpace };
+
+	std::vector<Level> levels;
+	levels.reserve(GetNumLevels(width, height));
+	levels.push_back({ width, height, std::vector<std::uint8_t>(pixels, pixels + static_cast<std::size_t>(width) * height * channels) });
+
+	FloatImage image;
+	while (levels.back().Width > 1 || levels.back().Height > 1) {
+		const auto srcWidth{ levels.back().Width }, srcHeight{ levels.back().Height };
+		Level level{ std::max(srcWidth / 2, 1), std::max(srcHeight / 2, 1), {} };
+		image = downsample(image, pixels, srcWidth, srcHeight, channels, filter, space, level);
+		levels.push_back(std::move(level));
+	}
+
+	return levels;
+}
+
+/***********************************************************************************/
+int MipGenerator::GetNumLevels(const int width, const int height) noexcept {
+	auto levels{ 1 };
+	for (auto size = std::max(width, height); size > 1; size /= 2) {
+		++levels;
+	}
+	return levels;
+}
+
+/***********************************************************************************/
+MipGenerator::Filter MipGenerator::GetFilter(const std::string_view name) noexcept {
+	if (name == "kaiser") {
+		return Filter::Kaiser;
+	}
+	if (name == "lanczos") {
+		return Filter::Lanczos;
+	}
+	return Filter::Box;
+}
+
+/***********************************************************************************/
+const char* MipGenerator::GetName(const Filter filter) noexcept {
+	switch (filter) {
+	case Filter::Kaiser:
+		return "kaiser";
+	case Filter::Lanczos:
+		return "lanczos";
+	default:
+		return "box";
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/***********************************************************************************/
+// Mip chains of 8 bit images on the CPU, for textures that are stored with precomputed mips.
+// Filtering happens in linear float space, separably and across the job system, with SSE where
+// available. Every level is filtered from the float result of the previous one.
+class MipGenerator {
+public:
+	// Changes to the output must bump this, it is part of the texture cache key
+	static constexpr std::uint32_t Version{ 2 };
+
+	enum class Filter : std::uint8_t {
+		Box,		// 2x2 average, what glGenerateMipmap does
+		Kaiser,		// Kaiser windowed sinc (width 3, alpha 4), sharp with little ringing
+		Lanczos		// Lanczos 3, sharpest, rings the most
+	};
+
+	// How the stored values are interpreted while filtering
+	enum class ColorSpace : std::uint8_t {
+		Linear,	// Every channel as stored
+		SRGB,	// Color channels are decoded from sRGB before filtering and encoded after, alpha is linear
+		Normal	// RGB is a unit vector in [0, 1], renormalised after filtering. Linear below 3 channels.
+	};
+
+	struct Level {
+		int Width, Height;
+		std::vector<std::uint8_t> Pixels;	// Same channels as the source, top row first
+	};
+
+	// Level 0 is a copy of the image, every further level halves both sizes (down to 1) until 1x1.
+	// Edges are clamped.
+	static std::vector<Level> Generate(const std::uint8_t* pixels, const int width, const int height, const int channels,
+										const Filter filter = Filter::Box, const ColorSpace colorSpace = ColorSpace::Linear);
+
+	static int GetNumLevels(const int width, const int height) noexcept;
+
+	// "box", "kaiser" or "lanczos", box for anything else
+	static Filter GetFilter(const std::string_view name) noexcept;
+	static const char* GetName(const Filter filter) noexcept;
+};
@@ -0,0 +1,439 @@
+#include "RenderGraph.h"
+#include "GPUProfiler.h"
+#include "../Core/Profiler.h"
+
+#include <algorithm>
+
+/***********************************************************************************/
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Read(const Handle resource, const Access access) {
+	m_graph.m_passes[m_pass].Usages.push_back({ resource, access, false });
+	return *this;
+}
+
+/***********************************************************************************/
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Write(const Handle resource, const Access access) {
+	m_graph.m_passes[m_pass].Usages.push_back({ resource, access, true });
+	return *this;
+}
+
+/***********************************************************************************/
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SideEffect() {
+	m_graph.m_passes[m_pass].SideEffect = true;
+	return *this;
+}
+
+/***********************************************************************************/
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Viewport(const GLsizei width, const GLsizei height) {
+	m_graph.m_passes[m_pass].ViewportWidth = width;
+	m_graph.m_passes[m_pass].ViewportHeight = height;
+	return *this;
+}
+
+/***********************************************************************************/
+void RenderGraph::Delete() {
+	for (auto& framebuffer : m_framebuffers) {
+		framebuffer.second.Delete();
+	}
+	m_framebuffers.clear();
+
+	for (const auto& pooled : m_texturePool) {
+		glDeleteTextures(1, &pooled.Texture);
+	}
+	m_texturePool.clear();
+
+	Reset();
+}
+
+/***********************************************************************************/
+void RenderGraph::Reset() {
+	m_resources.clear();
+	m_passes.clear();
+	m_stats = Stats();
+	++m_frame;
+}
+
+/***********************************************************************************/
+RenderGraph::Handle RenderGraph::CreateTexture(const std::string_view name, const TextureDesc& desc) {
+	Resource resource;
+	resource.Name = name;
+	resource.Type = ResourceType::Texture;
+	resource.Desc = desc;
+	m_resources.push_back(resource);
+
+	return static_cast<Handle>(m_resources.size() - 1);
+}
+
+/***********************************************************************************/
+RenderGraph::Handle RenderGraph::ImportTexture(const std::string_view name, const GLuint texture, const TextureDesc& desc) {
+	const auto handle{ CreateTexture(name, desc) };
+	m_resources[handle].Imported = true;
+	m_resources[handle].Physical = texture;
+
+	return handle;
+}
+
+/***********************************************************************************/
+RenderGraph::Handle RenderGraph::ImportBuffer(const std::string_view name, const GLuint buffer) {
+	const auto handle{ CreateTexture(name, {}) };
+	m_resources[handle].Type = ResourceType::Buffer;
+	m_resources[handle].Imported = true;
+	m_resources[handle].Physical = buffer;
+
+	return handle;
+}
+
+/***********************************************************************************/
+RenderGraph::Handle RenderGraph::ImportBackbuffer(const std::string_view name, const GLsizei width, const GLsizei height) {
+	const auto handle{ CreateTexture(name, { width, height, GL_RGBA8 }) };
+	m_resources[handle].Type = ResourceType::Backbuffer;
+	m_resources[handle].Imported = true;
+
+	return handle;
+}
+
+/***********************************************************************************/
+void RenderGraph::MarkOutput(const Handle resource) {
+	m_resources[resource].Output = true;
+}
+
+/***********************************************************************************/
+RenderGraph::PassBuilder RenderGraph::AddPass(const std::string_view name, ExecuteFunc execute) {
+	Pass pass;
+	pass.Name = name;
+	pass.Execute = std::move(execute);
+	m_passes.push_back(std::move(pass));
+
+	return PassBuilder(*this, m_passes.size() - 1);
+}
+
+/***********************************************************************************/
+void RenderGraph::Compile() {
+	PROFILE_FUNCTION();
+	m_stats.NumPasses = m_passes.size();
+
+	cullPasses();
+	allocateTextures();
+	trimPool();
+	createFramebuffers();
+	computeBarriers();
+}
+
+/***********************************************************************************/
+void RenderGraph::Execute(GPUProfiler* profiler) const {
+	for (const auto& pass : m_passes) {
+		if (pass.Culled) {
+			continue;
+		}
+
+		PROFILE_SCOPE(pass.Name);
+		const auto scope{ profiler ? profiler->Begin(pass.Name) : 0 };
+
+		if (pass.Barrier) {
+			glMemoryBarrier(pass.Barrier);
+		}
+
+		if (pass.HasAttachments) {
+			if (pass.Framebuffer) {
+				pass.Framebuffer->Bind();
+			}
+			else {
+				glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			}
+			glViewport(0, 0, pass.Width, pass.Height);
+		}
+
+		pass.Execute(*this);
+
+		if (profiler) {
+			profiler->End(scope);
+		}
+	}
+}
+
+/***********************************************************************************/
+GLuint RenderGraph::GetTexture(const Handle resource) const {
+	return resource < m_resources.size() ? m_resources[resource].Physical : 0;
+}
+
+/***********************************************************************************/
+std::size_t RenderGraph::GetFormatSize(const GLenum internalFormat) noexcept {
+	switch (internalFormat) {
+	case GL_R8:
+		return 1;
+	case GL_RG8:
+	case GL_R16F:
+	case GL_DEPTH_COMPONENT16:
+		return 2;
+	case GL_RGB8:
+		return 3;
+	case GL_RGB16F:
+		return 6;
+	case GL_RGBA16F:
+	case GL_RG32F:
+		return 8;
+	case GL_RGB32F:
+		return 12;
+	case GL_RGBA32F:
+		return 16;
+	default:
+		// RGBA8, RGB10_A2, R32UI, R32F, RG16F, 24 and 32-bit depth
+		return 4;
+	}
+}
+
+/***********************************************************************************/
+void RenderGraph::cullPasses() {
+	std::vector<bool> needed(m_resources.size(), false);
+	for (std::size_t i = 0; i < m_resources.size(); ++i) {
+		needed[i] = m_resources[i].Output;
+	}
+
+	// Walk backwards so each pass knows whether anything after it uses its writes
+	for (auto pass = m_passes.rbegin(); pass != m_passes.rend(); ++pass) {
+		auto keep{ pass->SideEffect };
+		for (const auto& usage : pass->Usages) {
+			keep = keep || (usage.Write && needed[usage.Target]);
+		}
+
+		pass->Culled = !keep;
+		if (!keep) {
+			++m_stats.NumCulledPasses;
+			continue;
+		}
+
+		// Writes count too, a partial write needs the earlier contents
+		for (const auto& usage : pass->Usages) {
+			needed[usage.Target] = true;
+		}
+	}
+}
+
+/***********************************************************************************/
+void RenderGraph::allocateTextures() {
+	for (std::size_t i = 0; i < m_passes.size(); ++i) {
+		if (m_passes[i].Culled) {
+			continue;
+		}
+		for (const auto& usage : m_passes[i].Usages) {
+			auto& resource{ m_resources[usage.Target] };
+			resource.FirstUse = std::min(resource.FirstUse, i);
+			resource.LastUse = std::max(resource.LastUse, i);
+		}
+	}
+
+	for (auto& pooled : m_texturePool) {
+		pooled.InUse = false;
+	}
+
+	for (std::size_t i = 0; i < m_passes.size(); ++i) {
+		// Acquire before releasing, a texture first used here can't share with one last used here
+		for (auto& resource : m_resources) {
+			if (!resource.Imported && resource.FirstUse == i) {
+				resource.Physical = acquireTexture(resource.Desc);
+				m_stats.TransientBytes += GetFormatSize(resource.Desc.InternalFormat) * resource.Desc.Width * resource.Desc.Height;
+			}
+		}
+
+		for (const auto& resource : m_resources) {
+			if (!resource.Imported && resource.LastUse == i && resource.Physical) {
+				releaseTexture(resource.Physical);
+			}
+		}
+	}
+}
+
+/***********************************************************************************/
+GLuint RenderGraph::acquireTexture(const TextureDesc& desc) {
+	for (auto& pooled : m_texturePool) {
+		if (!pooled.InUse && pooled.Desc == desc) {
+			// Count every allocation once per frame, no matter how many resources alias it
+			if (pooled.LastUsedFrame != m_frame) {
+				m_stats.AllocatedBytes += GetFormatSize(desc.InternalFormat) * desc.Width * desc.Height;
+			}
+			pooled.InUse = true;
+			pooled.LastUsedFrame = m_frame;
+			return pooled.Texture;
+		}
+	}
+
+	GLuint texture{ 0 };
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, desc.InternalFormat, desc.Width, desc.Height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, desc.Filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, desc.Filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	m_texturePool.push_back({ texture, desc, m_frame, true });
+	m_stats.AllocatedBytes += GetFormatSize(desc.InternalFormat) * desc.Width * desc.Height;
+
+	return texture;
+}
+
+/***********************************************************************************/
+void RenderGraph::releaseTexture(const GLuint texture) {
+	for (auto& pooled : m_texturePool) {
+		if (pooled.Texture == texture) {
+			pooled.InUse = false;
+			return;
+		}
+	}
+}
+
+/***********************************************************************************/
+void RenderGraph::trimPool() {
+	for (auto pooled = m_texturePool.begin(); pooled != m_texturePool.end();) {
+		if (m_frame - pooled->LastUsedFrame <= MaxIdleFrames) {
+			++pooled;
+			continue;
+		}
+
+		for (auto framebuffer = m_framebuffers.begin(); framebuffer != m_framebuffers.end();) {
+			const auto& attachments{ framebuffer->first };
+			if (std::find(attachments.begin(), attachments.end(), pooled->Texture) != attachments.end()) {
+				framebuffer->second.Delete();
+				framebuffer = m_framebuffers.erase(framebuffer);
+			}
+			else {
+				++framebuffer;
+			}
+		}
+
+		glDeleteTextures(1, &pooled->Texture);
+		pooled = m_texturePool.erase(pooled);
+	}
+}
+
+/***********************************************************************************/
+void RenderGraph::createFramebuffers() {
+	for (auto& pass : m_passes) {
+		if (pass.Culled) {
+			continue;
+		}
+
+		std::vector<GLuint> attachments;
+		std::vector<GLenum> formats;
+		auto backbuffer{ false };
+		for (const auto& usage : pass.Usages) {
+			if (usage.Mode != Access::Attachment) {
+				continue;
+			}
+
+			const auto& resource{ m_resources[usage.Target] };
+			if (!pass.HasAttachments) {
+				pass.HasAttachments = true;
+				pass.Width = pass.ViewportWidth > 0 ? std::min(pass.ViewportWidth, resource.Desc.Width) : resource.Desc.Width;
+				pass.Height = pass.ViewportHeight > 0 ? std::min(pass.ViewportHeight, resource.Desc.Height) : resource.Desc.Height;
+			}
+
+			// Declared as both read and write
+			if (resource.Type == ResourceType::Backbuffer) {
+				backbuffer = true;
+			}
+			else if (std::find(attachments.begin(), attachments.end(), resource.Physical) == attachments.end()) {
+				attachments.push_back(resource.Physical);
+				formats.push_back(resource.Desc.InternalFormat);
+			}
+		}
+
+		if (backbuffer || attachments.empty()) {
+			continue;
+		}
+
+		auto framebuffer{ m_framebuffers.find(attachments) };
+		if (framebuffer == m_framebuffers.end()) {
+			framebuffer = m_framebuffers.emplace(attachments, GLFramebuffer()).first;
+			framebuffer->second.Init(pass.Name);
+			framebuffer->second.Bind();
+
+			std::vector<GLenum> drawBuffers;
+			for (std::size_t i = 0; i < attachments.size(); ++i) {
+				if (isDepthFormat(formats[i])) {
+					framebuffer->second.AttachTexture(attachments[i], GLFramebuffer::AttachmentType::DEPTH);
+				}
+				else {
+					const auto attachment{ static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + drawBuffers.size()) };
+					framebuffer->second.AttachTexture(attachments[i], static_cast<GLFramebuffer::AttachmentType>(attachment));
+					drawBuffers.push_back(attachment);
+				}
+			}
+
+			if (drawBuffers.empty()) {
+				glDrawBuffer(GL_NONE);
+			}
+			else {
+				glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+			}
+
+			framebuffer->second.Unbind();
+		}
+
+		pass.Framebuffer = &framebuffer->second;
+	}
+}
+
+/***********************************************************************************/
+void RenderGraph::computeBarriers() {
+	for (auto& pass : m_passes) {
+		if (pass.Culled) {
+			continue;
+		}
+
+		for (const auto& usage : pass.Usages) {
+			const auto& resource{ m_resources[usage.Target] };
+			const auto bit{ barrierBit(usage.Mode) };
+			if (resource.IncoherentWrite && !(resource.VisibleBits & bit)) {
+				pass.Barrier |= bit;
+			}
+		}
+
+		if (pass.Barrier) {
+			++m_stats.NumBarriers;
+
+			// Barriers are global, they cover every earlier incoherent write
+			for (auto& resource : m_resources) {
+				if (resource.IncoherentWrite) {
+					resource.VisibleBits |= pass.Barrier;
+				}
+			}
+		}
+
+		for (const auto& usage : pass.Usages) {
+			if (usage.Write && (usage.Mode == Access::Image || usage.Mode == Access::Storage)) {
+				m_resources[usage.Target].IncoherentWrite = true;
+				m_resources[usage.Target].VisibleBits = 0;
+			}
+		}
+	}
+}
+
+/***********************************************************************************/
+bool RenderGraph::isDepthFormat(const GLenum internalFormat) noexcept {
+	switch (internalFormat) {
+	case GL_DEPTH_COMPONENT16:
+	case GL_DEPTH_COMPONENT24:
+	case GL_DEPTH_COMPONENT32:
+	case GL_DEPTH_COMPONENT32F:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/***********************************************************************************/
+GLbitfield RenderGraph::barrierBit(const Access access) noexcept {
+	switch (access) {
+	case Access::Texture:
+		return GL_TEXTURE_FETCH_BARRIER_BIT;
+	case Access::Image:
+		return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+	case Access::Attachment:
+		return GL_FRAMEBUFFER_BARRIER_BIT;
+	case Access::Storage:
+		return GL_SHADER_STORAGE_BARRIER_BIT;
+	}
+
+	return GL_ALL_BARRIER_BITS;
+}
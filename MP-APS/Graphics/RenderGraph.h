@@ -0,0 +1,187 @@
+#pragma once
+
+#include "GLFramebuffer.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+#include <map>
+
+class GPUProfiler;
+
+/***********************************************************************************/
+// Frame graph. Every frame the renderer declares its passes in execution order together
+// with the resources each pass reads and writes, then compiles and executes the graph.
+//
+// Compiling
+//  - culls passes whose writes are never read and don't reach a frame output. Writes are
+//    assumed to be partial (depth tested, blended), so earlier writers are kept as well.
+//  - allocates transient textures for the lifetime of the passes using them. Textures with
+//    the same description whose lifetimes don't overlap share one allocation.
+//  - creates a framebuffer for each set of attachments
+//  - inserts glMemoryBarrier() before passes reading what an earlier pass wrote through
+//    image stores or storage buffers (the only incoherent writes in GL)
+class RenderGraph {
+public:
+	using Handle = std::uint32_t;
+	static constexpr Handle InvalidHandle{ ~0u };
+
+	// How a pass accesses a resource, selects the barrier bit
+	enum class Access {
+		Texture,	// Sampled or fetched
+		Image,		// imageLoad/imageStore
+		Attachment,	// Framebuffer attachment, color or depth by format
+		Storage		// Shader storage buffer
+	};
+
+	struct TextureDesc {
+		GLsizei Width{ 0 };
+		GLsizei Height{ 0 };
+		GLenum InternalFormat{ GL_RGBA8 };
+		GLenum Filter{ GL_NEAREST };
+
+		bool operator==(const TextureDesc& other) const noexcept {
+			return Width == other.Width && Height == other.Height && InternalFormat == other.InternalFormat && Filter == other.Filter;
+		}
+	};
+
+	// Declares the resources of the pass it was returned for
+	class PassBuilder {
+		friend class RenderGraph;
+	public:
+		PassBuilder& Read(const Handle resource, const Access access);
+		PassBuilder& Write(const Handle resource, const Access access);
+		// Keeps the pass even if nothing reads its writes
+		PassBuilder& SideEffect();
+		// Renders into the lower left width x height texels of the attachments instead of all of them
+		PassBuilder& Viewport(const GLsizei width, const GLsizei height);
+
+	private:
+		PassBuilder(RenderGraph& graph, const std::size_t pass) noexcept : m_graph(graph), m_pass(pass) {}
+
+		RenderGraph& m_graph;
+		const std::size_t m_pass;
+	};
+
+	using ExecuteFunc = std::function<void(const RenderGraph&)>;
+
+	struct Stats {
+		std::size_t NumPasses{ 0 };
+		std::size_t NumCulledPasses{ 0 };
+		std::size_t NumBarriers{ 0 };
+		std::size_t TransientBytes{ 0 };	// If every transient texture had its own allocation
+		std::size_t AllocatedBytes{ 0 };	// Textures actually backing this frame's transients
+	};
+
+	// Releases pooled textures and framebuffers
+	void Delete();
+
+	// Drops the previous frame's passes and resources. Pooled textures stay for reuse.
+	void Reset();
+
+	Handle CreateTexture(const std::string_view name, const TextureDesc& desc);
+	// Resources owned by someone else, never aliased or freed
+	Handle ImportTexture(const std::string_view name, const GLuint texture, const TextureDesc& desc);
+	Handle ImportBuffer(const std::string_view name, const GLuint buffer);
+	// The default framebuffer, only valid as an attachment
+	Handle ImportBackbuffer(const std::string_view name, const GLsizei width, const GLsizei height);
+	// Passes contributing to an output are never culled
+	void MarkOutput(const Handle resource);
+
+	// Passes execute in the order they are added. Attachments are bound in the order they are
+	// declared, with the viewport set to the size of the first one unless the pass sets its own.
+	PassBuilder AddPass(const std::string_view name, ExecuteFunc execute);
+
+	void Compile();
+	// Times every executed pass under its name if a profiler is given
+	void Execute(GPUProfiler* profiler = nullptr) const;
+
+	// GL name backing a resource, 0 if it isn't used by any pass that survived culling
+	GLuint GetTexture(const Handle resource) const;
+	GLuint GetBuffer(const Handle resource) const { return GetTexture(resource); }
+
+	const auto& GetStats() const noexcept { return m_stats; }
+
+	// Bytes per texel
+	static std::size_t GetFormatSize(const GLenum internalFormat) noexcept;
+
+private:
+	enum class ResourceType {
+		Texture,
+		Buffer,
+		Backbuffer
+	};
+
+	struct Resource {
+		std::string_view Name;
+		ResourceType Type;
+		TextureDesc Desc;
+		bool Imported{ false };
+		bool Output{ false };
+		GLuint Physical{ 0 };
+		// Pass indices of the first and last use by a kept pass
+		std::size_t FirstUse{ ~std::size_t(0) };
+		std::size_t LastUse{ 0 };
+		// Barrier tracking while compiling
+		bool IncoherentWrite{ false };
+		GLbitfield VisibleBits{ 0 };
+	};
+
+	struct Usage {
+		Handle Target;
+		Access Mode;
+		bool Write;
+	};
+
+	struct Pass {
+		std::string_view Name;
+		ExecuteFunc Execute;
+		std::vector<Usage> Usages;
+		bool SideEffect{ false };
+		bool Culled{ false };
+		GLbitfield Barrier{ 0 };
+		// Framebuffer to bind before executing, only if the pass has attachments.
+		// nullptr is the default framebuffer.
+		bool HasAttachments{ false };
+		const GLFramebuffer* Framebuffer{ nullptr };
+		GLsizei Width{ 0 }, Height{ 0 };
+		// Requested with Viewport(), 0 covers the whole attachment
+		GLsizei ViewportWidth{ 0 }, ViewportHeight{ 0 };
+	};
+
+	struct PooledTexture {
+		GLuint Texture;
+		TextureDesc Desc;
+		std::uint64_t LastUsedFrame;
+		bool InUse;
+	};
+
+	// Pooled textures unused for this many frames are released
+	static constexpr std::uint64_t MaxIdleFrames{ 8 };
+
+	void cullPasses();
+	void allocateTextures();
+	// Reuses a free pooled texture with the same description or creates one
+	GLuint acquireTexture(const TextureDesc& desc);
+	void releaseTexture(const GLuint texture);
+	void createFramebuffers();
+	void computeBarriers();
+	// Deletes idle pooled textures and the framebuffers referencing them
+	void trimPool();
+
+	static bool isDepthFormat(const GLenum internalFormat) noexcept;
+	static GLbitfield barrierBit(const Access access) noexcept;
+
+	std::vector<Resource> m_resources;
+	std::vector<Pass> m_passes;
+
+	std::vector<PooledTexture> m_texturePool;
+	// Keyed by the attached textures in attachment order
+	std::map<std::vector<GLuint>, GLFramebuffer> m_framebuffers;
+
+	std::uint64_t m_frame{ 0 };
+	Stats m_stats;
+};
@@ -0,0 +1,125 @@
+#include "ResidencyManager.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+/***********************************************************************************/
+void ResidencyManager::Init(const std::size_t budgetBytes, EvictFunc evict, ReloadFunc reload) {
+	m_budgetBytes = budgetBytes;
+	m_evict = std::move(evict);
+	m_reload = std::move(reload);
+}
+
+/***********************************************************************************/
+void ResidencyManager::Delete() {
+	m_resources.clear();
+	m_trackedBytes = 0;
+	m_untrackedBytes = 0;
+	m_evict = nullptr;
+	m_reload = nullptr;
+}
+
+/***********************************************************************************/
+std::size_t ResidencyManager::Track(const Type type, const GLuint name, const std::size_t bytes, const bool evictable) {
+	std::size_t previousBytes{ 0 };
+	const auto [resource, inserted] = m_resources.try_emplace(getKey(type, name), Resource{ bytes, m_frame, evictable });
+	if (!inserted) {
+		previousBytes = resource->second.Bytes;
+		resource->second = Resource{ bytes, resource->second.LastUsed, evictable };
+	}
+	m_trackedBytes += bytes - previousBytes;
+
+	return previousBytes;
+}
+
+/***********************************************************************************/
+void ResidencyManager::Untrack(const Type type, const GLuint name) {
+	const auto resource = m_resources.find(getKey(type, name));
+	if (resource != m_resources.end()) {
+		m_trackedBytes -= resource->second.Bytes;
+		m_resources.erase(resource);
+	}
+}
+
+/***********************************************************************************/
+void ResidencyManager::Use(const Type type, const GLuint name) {
+	const auto resource = m_resources.find(getKey(type, name));
+	if (resource == m_resources.end()) {
+		return;
+	}
+
+	auto& used{ resource->second };
+	used.LastUsed = m_frame;
+	if (used.Evicted && !used.Reloading) {
+		used.Reloading = true;
+		++m_reloads;
+		// Meshes reload right away and track themselves again from in here
+		m_reload(type, name);
+	}
+}
+
+/***********************************************************************************/
+void ResidencyManager::Update(const std::size_t untrackedBytes) {
+	m_untrackedBytes = untrackedBytes;
+	auto residentBytes{ m_trackedBytes + untrackedBytes };
+	if (residentBytes <= m_budgetBytes) {
+		m_reportedOverBudget = false;
+		return;
+	}
+
+	// Oldest first, ties in name order so eviction doesn't depend on hashing
+	std::vector<std::pair<std::uint64_t, std::uint64_t>> candidates;
+	for (const auto& [key, resource] : m_resources) {
+		if (resource.Evictable && !resource.Exhausted && !resource.Reloading && resource.LastUsed < m_frame) {
+			candidates.emplace_back(resource.LastUsed, key);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end());
+
+	for (const auto& candidate : candidates) {
+		if (residentBytes <= m_budgetBytes) {
+			break;
+		}
+
+		auto& resource{ m_resources.at(candidate.second) };
+		const auto type{ static_cast<Type>(candidate.second >> 32) };
+		const auto name{ static_cast<GLuint>(candidate.second & 0xFFFFFFFF) };
+
+		while (residentBytes > m_budgetBytes) {
+			const auto freed{ std::min(m_evict(type, name), resource.Bytes) };
+			if (freed == 0) {
+				resource.Exhausted = true;
+				break;
+			}
+
+			if (!resource.Evicted) {
+				resource.Evicted = true;
+				++m_evictions;
+			}
+			resource.Bytes -= freed;
+			m_trackedBytes -= freed;
+			residentBytes -= freed;
+		}
+	}
+
+	if (residentBytes > m_budgetBytes && !m_reportedOverBudget) {
+		std::cerr << "Residency Manager: " << residentBytes / (1024.0 * 1024.0) << " MB in use this frame, over the budget of "
+			<< m_budgetBytes / (1024.0 * 1024.0) << " MB\n";
+		m_reportedOverBudget = true;
+	}
+}
+
+/***********************************************************************************/
+ResidencyManager::Stats ResidencyManager::GetStats() const {
+	Stats stats;
+	stats.NumResources = m_resources.size();
+	stats.ResidentBytes = m_trackedBytes + m_untrackedBytes;
+	stats.BudgetBytes = m_budgetBytes;
+	stats.Evictions = m_evictions;
+	stats.Reloads = m_reloads;
+	for (const auto& [key, resource] : m_resources) {
+		stats.NumEvicted += resource.Evicted ? 1 : 0;
+	}
+	return stats;
+}
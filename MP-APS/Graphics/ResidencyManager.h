@@ -0,0 +1,81 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+/***********************************************************************************/
+// Keeps the GPU memory of textures and meshes within a budget. Each resource is tracked with
+// its size and the last frame it was drawn in. While the total is over budget, the least
+// recently drawn resources give up memory through a callback: textures one top mip at a time,
+// meshes their buffers. GL names stay valid throughout, and an evicted resource that is drawn
+// again gets reloaded through a second callback.
+//
+// GL thread only.
+class ResidencyManager {
+public:
+	enum class Type : std::uint8_t {
+		Texture,
+		Mesh
+	};
+
+	// Frees part of a resource and returns the bytes freed, 0 once there is nothing left to free
+	using EvictFunc = std::function<std::size_t(const Type type, const GLuint name)>;
+	// Restores a resource. It may finish in a later frame, Track() marks it resident again.
+	using ReloadFunc = std::function<void(const Type type, const GLuint name)>;
+
+	struct Stats {
+		std::size_t NumResources{ 0 };
+		std::size_t NumEvicted{ 0 };		// Resources currently missing memory
+		std::size_t ResidentBytes{ 0 };		// Tracked bytes plus the untracked bytes of the last Update()
+		std::size_t BudgetBytes{ 0 };
+		std::size_t Evictions{ 0 };			// Resources evicted since Init()
+		std::size_t Reloads{ 0 };
+	};
+
+	void Init(const std::size_t budgetBytes, EvictFunc evict, ReloadFunc reload);
+	void Delete();
+
+	// Starts tracking a resource or updates its size. Resources that can't be evicted still count
+	// towards the budget. Clears the evicted state, so call this again once a reload is done.
+	// Returns the bytes tracked for it before, 0 if it is new.
+	std::size_t Track(const Type type, const GLuint name, const std::size_t bytes, const bool evictable);
+	void Untrack(const Type type, const GLuint name);
+
+	void BeginFrame() noexcept { ++m_frame; }
+	// Marks a resource as drawn this frame and reloads it if it was evicted. Untracked names are ignored.
+	void Use(const Type type, const GLuint name);
+	// Evicts the least recently drawn resources until the tracked bytes plus untrackedBytes fit
+	// the budget. Resources drawn this frame and reloads in flight are left alone.
+	void Update(const std::size_t untrackedBytes);
+
+	auto IsEnabled() const noexcept { return static_cast<bool>(m_evict); }
+	Stats GetStats() const;
+
+private:
+	struct Resource {
+		std::size_t Bytes;
+		std::uint64_t LastUsed;
+		bool Evictable;
+		bool Evicted{ false };		// Lost memory since it was last tracked
+		bool Exhausted{ false };	// Nothing left to evict
+		bool Reloading{ false };
+	};
+
+	static std::uint64_t getKey(const Type type, const GLuint name) noexcept {
+		return static_cast<std::uint64_t>(type) << 32 | name;
+	}
+
+	std::unordered_map<std::uint64_t, Resource> m_resources;
+	std::size_t m_trackedBytes{ 0 }, m_untrackedBytes{ 0 };
+	std::size_t m_budgetBytes{ 0 };
+	std::uint64_t m_frame{ 0 };
+
+	EvictFunc m_evict;
+	ReloadFunc m_reload;
+
+	std::size_t m_evictions{ 0 }, m_reloads{ 0 };
+	bool m_reportedOverBudget{ false };
+};
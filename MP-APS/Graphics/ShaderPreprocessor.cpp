@@ -0,0 +1,39 @@
+#include "ShaderPreprocessor.h"
+
+/***********************************************************************************/
+void ShaderPreprocessor::Process(std::string& shaderCode, const LoadFunc& loadFile) {
+	ScanForIncludes(shaderCode, loadFile);
+	ReplaceAll(shaderCode, "hash ", "#");
+}
+
+/***********************************************************************************/
+void ShaderPreprocessor::ScanForIncludes(std::string& shaderCode, const LoadFunc& loadFile) {
+	std::size_t startPos = 0;
+	const static std::string include_dir = "#include ";
+
+	// Scan string for all instances of include directive
+	while ((startPos = shaderCode.find(include_dir, startPos)) != std::string::npos) {
+		// Find position of include directive
+		const auto pos = startPos + include_dir.length() + 1;
+		const auto length = shaderCode.find('"', pos);
+		const auto pathToIncludedFile = shaderCode.substr(pos, length - pos);
+
+		// Load included file
+		const auto includedFile = loadFile(pathToIncludedFile) + "\n";
+		// Insert into shader code
+		shaderCode.replace(startPos, (length + 1) - startPos, includedFile);
+		
+		// Increment start position and continue scanning
+		startPos += includedFile.length();
+	}
+}
+
+/***********************************************************************************/
+void ShaderPreprocessor::ReplaceAll(std::string& str, const std::string& from, const std::string& to) {
+	std::size_t start_pos = 0;
+
+	while ((start_pos = str.find(from, start_pos)) != std::string::npos) {
+		str.replace(start_pos, from.length(), to);
+		start_pos += to.length(); // In case 'to' contains 'from', like replacing 'x' with 'yx'
+	}
+}
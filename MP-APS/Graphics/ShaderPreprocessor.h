@@ -0,0 +1,20 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+/***********************************************************************************/
+// Source transformations applied before GLSL compilation. Needs no GL context.
+class ShaderPreprocessor {
+public:
+	// Returns the contents of a file, path as written in the directive
+	using LoadFunc = std::function<std::string(const std::string& path)>;
+
+	// Expands includes, then replaces every "hash " with '#'
+	static void Process(std::string& shaderCode, const LoadFunc& loadFile);
+
+	// Implements the #include preprocessor directive for GLSL
+	static void ScanForIncludes(std::string& shaderCode, const LoadFunc& loadFile);
+	// Replaces all occurances of a string in another string
+	static void ReplaceAll(std::string& str, const std::string& from, const std::string& to);
+};
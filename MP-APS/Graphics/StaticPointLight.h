@@ -3,9 +3,13 @@
 #include <glm/vec3.hpp>
 
 struct StaticPointLight {
-	StaticPointLight(const glm::vec3& color, const glm::vec3& position) : Color(color),
-																		Position(position) { }
+	StaticPointLight(const glm::vec3& color, const glm::vec3& position, const float radius = 10.0f) : Color(color),
+																		Position(position),
+																		Radius(radius) { }
 
 	glm::vec3 Color;
 	glm::vec3 Position;
+
+	// Distance at which the light's contribution reaches zero. Used for light culling.
+	float Radius;
 };
\ No newline at end of file
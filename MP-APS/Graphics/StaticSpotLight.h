@@ -3,13 +3,17 @@
 #include <glm/vec3.hpp>
 
 struct StaticSpotLight {
-	StaticSpotLight(const glm::vec3& color, const glm::vec3& position, const glm::vec3& direction, const float cutoff, const float outerCutoff) : Color(color), 
-					Position(position), Direction(direction), Cutoff(cutoff), OuterCutoff(outerCutoff) {}
+	StaticSpotLight(const glm::vec3& color, const glm::vec3& position, const glm::vec3& direction, const float cutoff, const float outerCutoff, const float radius = 10.0f) : Color(color), 
+					Position(position), Direction(direction), Cutoff(cutoff), OuterCutoff(outerCutoff), Radius(radius) {}
 	
 	glm::vec3 Color;
 	glm::vec3 Position;
 	glm::vec3 Direction;
 
+	// Cosines of the inner and outer cone angles
 	float Cutoff;
 	float OuterCutoff;
+
+	// Distance at which the light's contribution reaches zero. Used for light culling.
+	float Radius;
 };
\ No newline at end of file
@@ -0,0 +1,518 @@
+#include "TextureCompressor.h"
+
+#include "../Core/JobSystem.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+	#define TEXTURE_COMPRESSOR_SSE
+	#include <emmintrin.h>
+#endif
+
+namespace {
+
+// 16 pixels of a block, channels as floats in 0-255
+using Block = std::array<std::array<float, 4>, 16>;
+using IndexArray = std::array<std::uint8_t, 16>;
+
+// Up to 16 palette entries stored channel by channel for the SIMD search
+struct Palette {
+	int Size{ 0 };
+	alignas(16) float Values[4][16];
+
+	Palette() {
+		// Unused entries are never the closest
+		std::fill(&Values[0][0], &Values[0][0] + 4 * 16, 1e15f);
+	}
+};
+
+// BC7 interpolation weights of the 4-bit indices, out of 64
+constexpr std::array<int, 16> BC7Weights{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+// Position of each BC1 index between the first and second endpoint
+constexpr std::array<float, 4> BC1Weights{ 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+/***********************************************************************************/
+Block loadBlock(const std::uint8_t* rgba, const int width, const int height, const int blockX, const int blockY) {
+	Block block;
+	for (int y = 0; y < 4; ++y) {
+		const auto py{ std::min(blockY * 4 + y, height - 1) };
+		for (int x = 0; x < 4; ++x) {
+			const auto px{ std::min(blockX * 4 + x, width - 1) };
+			const auto* pixel{ rgba + (static_cast<std::size_t>(py) * width + px) * 4 };
+			for (int c = 0; c < 4; ++c) {
+				block[y * 4 + x][c] = static_cast<float>(pixel[c]);
+			}
+		}
+	}
+	return block;
+}
+
+/***********************************************************************************/
+// Nearest palette entry for every pixel over the first numChannels channels, ties go to the
+// lower index. Returns the summed squared error.
+float assignIndices(const Block& block, const int numChannels, const Palette& palette, IndexArray& indices) {
+	float total{ 0.0f };
+
+#ifdef TEXTURE_COMPRESSOR_SSE
+	// Four palette entries per step
+	const auto numGroups{ (palette.Size + 3) / 4 };
+	for (std::size_t i = 0; i < 16; ++i) {
+		auto bestError{ _mm_set1_ps(std::numeric_limits<float>::max()) };
+		auto bestIndex{ _mm_setzero_ps() };
+		auto index{ _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f) };
+
+		for (int group = 0; group < numGroups; ++group) {
+			auto error{ _mm_setzero_ps() };
+			for (int c = 0; c < numChannels; ++c) {
+				const auto diff{ _mm_sub_ps(_mm_load_ps(&palette.Values[c][group * 4]), _mm_set1_ps(block[i][c])) };
+				error = _mm_add_ps(error, _mm_mul_ps(diff, diff));
+			}
+
+			const auto better{ _mm_cmplt_ps(error, bestError) };
+			bestError = _mm_min_ps(error, bestError);
+			bestIndex = _mm_or_ps(_mm_and_ps(better, index), _mm_andnot_ps(better, bestIndex));
+			index = _mm_add_ps(index, _mm_set1_ps(4.0f));
+		}
+
+		alignas(16) float errors[4], lanes[4];
+		_mm_store_ps(errors, bestError);
+		_mm_store_ps(lanes, bestIndex);
+
+		auto best{ 0 };
+		for (int lane = 1; lane < 4; ++lane) {
+			if (errors[lane] < errors[best] || (errors[lane] == errors[best] && lanes[lane] < lanes[best])) {
+				best = lane;
+			}
+		}
+
+		indices[i] = static_cast<std::uint8_t>(lanes[best]);
+		total += errors[best];
+	}
+#else
+	for (std::size_t i = 0; i < 16; ++i) {
+		auto bestError{ std::numeric_limits<float>::max() };
+		for (int entry = 0; entry < palette.Size; ++entry) {
+			float error{ 0.0f };
+			for (int c = 0; c < numChannels; ++c) {
+				const auto diff{ palette.Values[c][entry] - block[i][c] };
+				error += diff * diff;
+			}
+			if (error < bestError) {
+				bestError = error;
+				indices[i] = static_cast<std::uint8_t>(entry);
+			}
+		}
+		total += bestError;
+	}
+#endif
+
+	return total;
+}
+
+/***********************************************************************************/
+// Ends of the segment along the principal axis of the pixels that covers all of them
+void principalEndpoints(const Block& block, const int numChannels, float e0[4], float e1[4]) {
+	float mean[4]{};
+	for (const auto& pixel : block) {
+		for (int c = 0; c < numChannels; ++c) {
+			mean[c] += pixel[c] / 16.0f;
+		}
+	}
+
+	float covariance[4][4]{};
+	for (const auto& pixel : block) {
+		for (int a = 0; a < numChannels; ++a) {
+			for (int b = 0; b < numChannels; ++b) {
+				covariance[a][b] += (pixel[a] - mean[a]) * (pixel[b] - mean[b]);
+			}
+		}
+	}
+
+	// Power iteration, starting from the channel that varies most
+	float axis[4]{};
+	auto widest{ 0 };
+	for (int c = 1; c < numChannels; ++c) {
+		if (covariance[c][c] > covariance[widest][widest]) {
+			widest = c;
+		}
+	}
+	axis[widest] = 1.0f;
+
+	for (int iteration = 0; iteration < 8; ++iteration) {
+		float next[4]{};
+		float length{ 0.0f };
+		for (int a = 0; a < numChannels; ++a) {
+			for (int b = 0; b < numChannels; ++b) {
+				next[a] += covariance[a][b] * axis[b];
+			}
+			length += next[a] * next[a];
+		}
+		// Flat block
+		if (length < 1e-12f) {
+			break;
+		}
+		length = std::sqrt(length);
+		for (int c = 0; c < numChannels; ++c) {
+			axis[c] = next[c] / length;
+		}
+	}
+
+	auto minT{ std::numeric_limits<float>::max() }, maxT{ std::numeric_limits<float>::lowest() };
+	for (const auto& pixel : block) {
+		float t{ 0.0f };
+		for (int c = 0; c < numChannels; ++c) {
+			t += (pixel[c] - mean[c]) * axis[c];
+		}
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+
+	for (int c = 0; c < numChannels; ++c) {
+		e0[c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+		e1[c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+	}
+}
+
+/***********************************************************************************/
+// Endpoints with the least squared error for fixed interpolation weights (0 at e0, 1 at e1).
+// Returns false if every pixel has the same weight.
+bool refitEndpoints(const Block& block, const int numChannels, const std::array<float, 16>& weights, float e0[4], float e1[4]) {
+	float aa{ 0.0f }, ab{ 0.0f }, bb{ 0.0f };
+	float ax[4]{}, bx[4]{};
+	for (std::size_t i = 0; i < 16; ++i) {
+		const auto b{ weights[i] };
+		const auto a{ 1.0f - b };
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (int c = 0; c < numChannels; ++c) {
+			ax[c] += a * block[i][c];
+			bx[c] += b * block[i][c];
+		}
+	}
+
+	const auto det{ aa * bb - ab * ab };
+	if (std::abs(det) < 1e-6f) {
+		return false;
+	}
+
+	for (int c = 0; c < numChannels; ++c) {
+		e0[c] = std::clamp((bb * ax[c] - ab * bx[c]) / det, 0.0f, 255.0f);
+		e1[c] = std::clamp((aa * bx[c] - ab * ax[c]) / det, 0.0f, 255.0f);
+	}
+	return true;
+}
+
+/***********************************************************************************/
+std::uint16_t to565(const float color[4]) {
+	const auto r{ static_cast<int>(std::lround(color[0] * 31.0f / 255.0f)) };
+	const auto g{ static_cast<int>(std::lround(color[1] * 63.0f / 255.0f)) };
+	const auto b{ static_cast<int>(std::lround(color[2] * 31.0f / 255.0f)) };
+	return static_cast<std::uint16_t>((r << 11) | (g << 5) | b);
+}
+
+/***********************************************************************************/
+std::array<float, 3> from565(const std::uint16_t color) {
+	const auto r{ (color >> 11) & 31 }, g{ (color >> 5) & 63 }, b{ color & 31 };
+	return { static_cast<float>((r << 3) | (r >> 2)), static_cast<float>((g << 2) | (g >> 4)), static_cast<float>((b << 3) | (b >> 2)) };
+}
+
+/***********************************************************************************/
+struct BC1Color {
+	std::uint16_t Color0, Color1;
+	IndexArray Indices;
+	float Error;
+};
+
+/***********************************************************************************/
+// Always the four color mode (color0 > color1), also how BC3 decodes its color block
+BC1Color encodeBC1Color(const Block& block, const float e0[4], const float e1[4]) {
+	BC1Color result{ to565(e0), to565(e1), {}, 0.0f };
+	if (result.Color0 < result.Color1) {
+		std::swap(result.Color0, result.Color1);
+	}
+
+	const auto c0{ from565(result.Color0) }, c1{ from565(result.Color1) };
+	Palette palette;
+	palette.Size = result.Color0 == result.Color1 ? 1 : 4;
+	for (int c = 0; c < 3; ++c) {
+		palette.Values[c][0] = c0[c];
+		palette.Values[c][1] = c1[c];
+		palette.Values[c][2] = (2.0f * c0[c] + c1[c]) / 3.0f;
+		palette.Values[c][3] = (c0[c] + 2.0f * c1[c]) / 3.0f;
+	}
+
+	result.Error = assignIndices(block, 3, palette, result.Indices);
+	return result;
+}
+
+/***********************************************************************************/
+void compressBC1(const Block& block, std::uint8_t* out) {
+	float e0[4], e1[4];
+	principalEndpoints(block, 3, e0, e1);
+	auto best{ encodeBC1Color(block, e0, e1) };
+
+	std::array<float, 16> weights;
+	for (std::size_t i = 0; i < 16; ++i) {
+		weights[i] = BC1Weights[best.Indices[i]];
+	}
+	if (best.Color0 != best.Color1 && refitEndpoints(block, 3, weights, e0, e1)) {
+		const auto refit{ encodeBC1Color(block, e0, e1) };
+		if (refit.Error < best.Error) {
+			best = refit;
+		}
+	}
+
+	std::uint32_t packed{ 0 };
+	for (std::size_t i = 0; i < 16; ++i) {
+		packed |= static_cast<std::uint32_t>(best.Indices[i]) << (i * 2);
+	}
+
+	std::memcpy(out, &best.Color0, 2);
+	std::memcpy(out + 2, &best.Color1, 2);
+	std::memcpy(out + 4, &packed, 4);
+}
+
+/***********************************************************************************/
+// One channel with the eight value mode (red0 > red1), used for BC3 alpha, BC4 and BC5
+void compressBC4(const Block& block, const int channel, std::uint8_t* out) {
+	Block values{};
+	auto minValue{ 255.0f }, maxValue{ 0.0f };
+	for (std::size_t i = 0; i < 16; ++i) {
+		values[i][0] = block[i][channel];
+		minValue = std::min(minValue, values[i][0]);
+		maxValue = std::max(maxValue, values[i][0]);
+	}
+
+	const auto red0{ static_cast<std::uint8_t>(maxValue) }, red1{ static_cast<std::uint8_t>(minValue) };
+	out[0] = red0;
+	out[1] = red1;
+
+	IndexArray indices{};
+	if (red0 != red1) {
+		Palette palette;
+		palette.Size = 8;
+		palette.Values[0][0] = red0;
+		palette.Values[0][1] = red1;
+		for (int i = 2; i < 8; ++i) {
+			palette.Values[0][i] = (static_cast<float>(8 - i) * red0 + static_cast<float>(i - 1) * red1) / 7.0f;
+		}
+		assignIndices(values, 1, palette, indices);
+	}
+
+	std::uint64_t packed{ 0 };
+	for (std::size_t i = 0; i < 16; ++i) {
+		packed |= static_cast<std::uint64_t>(indices[i]) << (i * 3);
+	}
+	for (std::size_t i = 0; i < 6; ++i) {
+		out[2 + i] = static_cast<std::uint8_t>(packed >> (i * 8));
+	}
+}
+
+/***********************************************************************************/
+struct BC7Endpoints {
+	std::array<int, 4> Color0, Color1;	// 7 bits per channel
+	int Parity0, Parity1;				// Shared lowest bit of each endpoint
+	IndexArray Indices;
+	float Error;
+};
+
+/***********************************************************************************/
+// 7 bits plus the parity bit that reconstructs the endpoint best
+void quantizeBC7(const float endpoint[4], std::array<int, 4>& color, int& parity) {
+	auto bestError{ std::numeric_limits<float>::max() };
+	for (int p = 0; p < 2; ++p) {
+		std::array<int, 4> q;
+		float error{ 0.0f };
+		for (int c = 0; c < 4; ++c) {
+			q[c] = std::clamp(static_cast<int>(std::lround((endpoint[c] - static_cast<float>(p)) * 0.5f)), 0, 127);
+			const auto diff{ static_cast<float>(q[c] * 2 + p) - endpoint[c] };
+			error += diff * diff;
+		}
+		if (error < bestError) {
+			bestError = error;
+			color = q;
+			parity = p;
+		}
+	}
+}
+
+/***********************************************************************************/
+BC7Endpoints encodeBC7Mode6(const Block& block, const float e0[4], const float e1[4]) {
+	BC7Endpoints result;
+	quantizeBC7(e0, result.Color0, result.Parity0);
+	quantizeBC7(e1, result.Color1, result.Parity1);
+
+	Palette palette;
+	palette.Size = 16;
+	for (int c = 0; c < 4; ++c) {
+		const auto low{ result.Color0[c] * 2 + result.Parity0 }, high{ result.Color1[c] * 2 + result.Parity1 };
+		for (int i = 0; i < 16; ++i) {
+			palette.Values[c][i] = static_cast<float>(((64 - BC7Weights[i]) * low + BC7Weights[i] * high + 32) >> 6);
+		}
+	}
+
+	result.Error = assignIndices(block, 4, palette, result.Indices);
+	return result;
+}
+
+/***********************************************************************************/
+void compressBC7(const Block& block, std::uint8_t* out) {
+	float e0[4], e1[4];
+	principalEndpoints(block, 4, e0, e1);
+	auto best{ encodeBC7Mode6(block, e0, e1) };
+
+	std::array<float, 16> weights;
+	for (std::size_t i = 0; i < 16; ++i) {
+		weights[i] = static_cast<float>(BC7Weights[best.Indices[i]]) / 64.0f;
+	}
+	if (refitEndpoints(block, 4, weights, e0, e1)) {
+		const auto refit{ encodeBC7Mode6(block, e0, e1) };
+		if (refit.Error < best.Error) {
+			best = refit;
+		}
+	}
+
+	// The first index is stored with 3 bits, its top bit must be 0
+	if (best.Indices[0] >= 8) {
+		std::swap(best.Color0, best.Color1);
+		std::swap(best.Parity0, best.Parity1);
+		for (auto& index : best.Indices) {
+			index = static_cast<std::uint8_t>(15 - index);
+		}
+	}
+
+	std::memset(out, 0, 16);
+	std::size_t bit{ 0 };
+	const auto write = [out, &bit](const std::uint32_t value, const std::size_t numBits) {
+		for (std::size_t i = 0; i < numBits; ++i, ++bit) {
+			out[bit / 8] |= static_cast<std::uint8_t>(((value >> i) & 1) << (bit % 8));
+		}
+	};
+
+	// Mode 6 is bit 6
+	write(1 << 6, 7);
+	for (int c = 0; c < 4; ++c) {
+		write(best.Color0[c], 7);
+		write(best.Color1[c], 7);
+	}
+	write(best.Parity0, 1);
+	write(best.Parity1, 1);
+	for (std::size_t i = 0; i < 16; ++i) {
+		write(best.Indices[i], i == 0 ? 3 : 4);
+	}
+}
+
+}
+
+/***********************************************************************************/
+TextureCompressor::Format TextureCompressor::ChooseFormat(const Semantic semantic, const bool hasAlpha, const bool preferBC7) noexcept {
+	switch (semantic) {
+	case Semantic::Normal:
+		return Format::BC5;
+	case Semantic::Mask:
+		return Format::BC4;
+	case Semantic::Albedo:
+	default:
+		if (preferBC7) {
+			return Format::BC7;
+		}
+		return hasAlpha ? Format::BC3 : Format::BC1;
+	}
+}
+
+/***********************************************************************************/
+std::vector<std::uint8_t> TextureCompressor::Compress(const std::uint8_t* rgba, const int width, const int height, const Format format) {
+	const auto blocksX{ (width + 3) / 4 }, blocksY{ (height + 3) / 4 };
+	const auto blockBytes{ GetBlockBytes(format) };
+	std::vector<std::uint8_t> blocks(static_cast<std::size_t>(blocksX) * blocksY * blockBytes);
+
+	// Rows of blocks are independent
+	JobSystem::GetInstance().ParallelFor(blocksY, [&](const auto begin, const auto end) {
+		for (auto blockY = begin; blockY < end; ++blockY) {
+			for (int blockX = 0; blockX < blocksX; ++blockX) {
+				compressBlock(rgba, width, height, blockX, static_cast<int>(blockY), format, &blocks[(blockY * blocksX + blockX) * blockBytes]);
+			}
+		}
+	});
+
+	return blocks;
+}
+
+/***********************************************************************************/
+std::size_t TextureCompressor::GetBlockBytes(const Format format) noexcept {
+	return format == Format::BC1 || format == Format::BC4 ? 8 : 16;
+}
+
+/***********************************************************************************/
+std::size_t TextureCompressor::GetCompressedSize(const Format format, const int width, const int height) noexcept {
+	return static_cast<std::size_t>((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format);
+}
+
+/***********************************************************************************/
+GLenum TextureCompressor::GetGLFormat(const Format format) noexcept {
+	switch (format) {
+	case Format::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case Format::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case Format::BC4: return GL_COMPRESSED_RED_RGTC1;
+	case Format::BC5: return GL_COMPRESSED_RG_RGTC2;
+	case Format::BC7:
+	default: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+	}
+}
+
+/***********************************************************************************/
+const char* TextureCompressor::GetName(const Format format) noexcept {
+	switch (format) {
+	case Format::BC1: return "BC1";
+	case Format::BC3: return "BC3";
+	case Format::BC4: return "BC4";
+	case Format::BC5: return "BC5";
+	case Format::BC7:
+	default: return "BC7";
+	}
+}
+
+/***********************************************************************************/
+bool TextureCompressor::IsSupported(const Format format) noexcept {
+	switch (format) {
+	case Format::BC1:
+	case Format::BC3:
+		return GLAD_GL_EXT_texture_compression_s3tc != 0;
+	case Format::BC4:
+	case Format::BC5:
+		return GLAD_GL_VERSION_3_0 != 0 || GLAD_GL_ARB_texture_compression_rgtc != 0;
+	case Format::BC7:
+	default:
+		return GLAD_GL_VERSION_4_2 != 0 || GLAD_GL_ARB_texture_compression_bptc != 0;
+	}
+}
+
+/***********************************************************************************/
+void TextureCompressor::compressBlock(const std::uint8_t* rgba, const int width, const int height, const int blockX, const int blockY, const Format format, std::uint8_t* out) {
+	const auto block{ loadBlock(rgba, width, height, blockX, blockY) };
+
+	switch (format) {
+	case Format::BC1:
+		compressBC1(block, out);
+		break;
+	case Format::BC3:
+		compressBC4(block, 3, out);
+		compressBC1(block, out + 8);
+		break;
+	case Format::BC4:
+		compressBC4(block, 0, out);
+		break;
+	case Format::BC5:
+		compressBC4(block, 0, out);
+		compressBC4(block, 1, out + 8);
+		break;
+	case Format::BC7:
+		compressBC7(block, out);
+		break;
+	}
+}
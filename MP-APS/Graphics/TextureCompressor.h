@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************************************/
+// Block compression of RGBA8 images into BC1/BC3/BC4/BC5/BC7 on the job system. The encoders
+// take one pass: endpoints along the principal axis, nearest palette entries (SSE2), one
+// least-squares endpoint refit. BC7 only uses mode 6 (one subset, RGBA, 16 levels).
+// Good enough for runtime caching, not a replacement for exhaustive offline encoders.
+class TextureCompressor {
+public:
+	// Part of the texture cache key, bump it when the output of an encoder changes
+	static constexpr std::uint32_t Version{ 1 };
+
+	enum class Format : std::uint32_t {
+		BC1,	// RGB, 4 bpp
+		BC3,	// RGBA, 8 bpp
+		BC4,	// R, 4 bpp
+		BC5,	// RG, 8 bpp
+		BC7		// RGBA, 8 bpp
+	};
+
+	// What a texture holds, decides the format
+	enum class Semantic {
+		Albedo,	// BC1, BC3 if it has alpha, BC7 for either with preferBC7
+		Normal,	// BC5, z is reconstructed in the shaders
+		Mask	// BC4, single channel (metallic, roughness, AO, alpha masks)
+	};
+
+	static Format ChooseFormat(const Semantic semantic, const bool hasAlpha, const bool preferBC7) noexcept;
+
+	// rgba holds width * height pixels. Blocks are stored row by row, partial blocks at the
+	// right and bottom edges repeat the last column and row.
+	static std::vector<std::uint8_t> Compress(const std::uint8_t* rgba, const int width, const int height, const Format format);
+
+	static std::size_t GetBlockBytes(const Format format) noexcept;
+	static std::size_t GetCompressedSize(const Format format, const int width, const int height) noexcept;
+	static GLenum GetGLFormat(const Format format) noexcept;
+	static const char* GetName(const Format format) noexcept;
+	// BC1 and BC3 need EXT_texture_compression_s3tc, the others are core
+	static bool IsSupported(const Format format) noexcept;
+
+private:
+	static void compressBlock(const std::uint8_t* rgba, const int width, const int height, const int blockX, const int blockY, const Format format, std::uint8_t* out);
+};
@@ -0,0 +1,265 @@
+#include "TextureStreamer.h"
+#include "KTX2Texture.h"
+#include "MipGenerator.h"
+#include "../Core/Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+/***********************************************************************************/
+void TextureStreamer::Init(TextureUploader& uploader, const std::size_t budgetBytes, const int tailSize, const std::size_t maxLoads, const float bias) {
+	m_uploader = &uploader;
+	m_budgetBytes = budgetBytes;
+	m_tailSize = std::max(tailSize, 1);
+	m_maxLoads = std::max<std::size_t>(maxLoads, 1);
+	m_bias = bias;
+}
+
+/***********************************************************************************/
+void TextureStreamer::Delete() {
+	JobSystem::GetInstance().Wait(m_loadJobs);
+
+	m_textures.clear();
+	m_textureLookup.clear();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_added.clear();
+	m_requests.clear();
+	m_hasRequests = false;
+}
+
+/***********************************************************************************/
+void TextureStreamer::Add(TextureUploader::Image&& tail, const TextureCompressor::Format format, const std::filesystem::path& path, const std::uint64_t key) {
+	auto texture{ std::make_unique<Texture>() };
+	texture->Name = tail.Texture;
+	texture->Format = format;
+	texture->Width = tail.Width;
+	texture->Height = tail.Height;
+	texture->NumLevels = MipGenerator::GetNumLevels(tail.Width, tail.Height);
+	texture->TailLevel = tail.FirstLevel;
+	texture->Path = path;
+	texture->Key = key;
+	texture->ResidentLevel = tail.FirstLevel;
+	texture->WantedLevel = tail.FirstLevel;
+
+	// Added before the tail is queued, so IsStreamed() holds by the time it is uploaded. Uploads
+	// are in submission order, so the tail is in place before any level above it.
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_added.push_back(std::move(texture));
+	m_uploader->Submit(std::move(tail));
+}
+
+/***********************************************************************************/
+bool TextureStreamer::IsStreamed(const GLuint texture) const {
+	if (m_textureLookup.count(texture) > 0) {
+		return true;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return std::any_of(m_added.cbegin(), m_added.cend(), [texture](const auto& added) { return added->Name == texture; });
+}
+
+/***********************************************************************************/
+void TextureStreamer::SetRequests(std::vector<Request>&& requests) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_requests = std::move(requests);
+	m_hasRequests = true;
+}
+
+/***********************************************************************************/
+std::size_t TextureStreamer::Update() {
+	if (!m_uploader) {
+		return 0;
+	}
+
+	PROFILE_FUNCTION();
+
+	std::vector<Request> requests;
+	auto hasRequests{ false };
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto& texture : m_added) {
+			m_textureLookup.emplace(texture->Name, texture.get());
+			m_textures.push_back(std::move(texture));
+		}
+		m_added.clear();
+
+		hasRequests = m_hasRequests;
+		if (hasRequests) {
+			requests.swap(m_requests);
+			m_hasRequests = false;
+		}
+	}
+
+	// The render thread may run ahead of the simulation, the last requests stand until new ones arrive
+	if (hasRequests) {
+		++m_frame;
+		for (auto& texture : m_textures) {
+			texture->Pixels = 0.0f;
+		}
+
+		for (const auto& request : requests) {
+			const auto texture{ m_textureLookup.find(request.Texture) };
+			if (texture != m_textureLookup.end()) {
+				texture->second->Pixels = std::max(texture->second->Pixels, request.Pixels);
+				texture->second->LastRequested = m_frame;
+			}
+		}
+
+		// One texel per pixel across the mesh. Textures out of view only need their tail.
+		for (auto& texture : m_textures) {
+			if (texture->LastRequested != m_frame) {
+				texture->WantedLevel = texture->TailLevel;
+				continue;
+			}
+
+			const auto level{ std::log2(static_cast<float>(std::max(texture->Width, texture->Height)) / std::max(texture->Pixels, 1.0f)) + m_bias };
+			texture->WantedLevel = std::clamp(static_cast<int>(std::floor(level)), 0, texture->TailLevel);
+		}
+	}
+
+	std::size_t residentBytes{ 0 }, numLoads{ 0 };
+	std::vector<Texture*> loads, victims;
+	for (auto& texture : m_textures) {
+		if (texture->LoadingLevel >= 0 && texture->LoadFailed.load(std::memory_order_acquire)) {
+			texture->LoadingLevel = -1;
+			texture->Broken = true;
+		}
+
+		residentBytes += getResidentSize(*texture);
+		numLoads += texture->LoadingLevel >= 0 ? 1 : 0;
+
+		if (texture->LoadingLevel < 0 && !texture->Broken && texture->WantedLevel < texture->ResidentLevel) {
+			loads.push_back(texture.get());
+		}
+		else if (texture->LoadingLevel < 0 && texture->ResidentLevel < texture->WantedLevel) {
+			victims.push_back(texture.get());
+		}
+	}
+
+	// Largest on screen first. Victims are only dropped under pressure, least recently seen first.
+	std::sort(loads.begin(), loads.end(), [](const auto* lhs, const auto* rhs) {
+		return lhs->Pixels != rhs->Pixels ? lhs->Pixels > rhs->Pixels : lhs->Name < rhs->Name;
+	});
+	std::sort(victims.begin(), victims.end(), [](const auto* lhs, const auto* rhs) {
+		return lhs->LastRequested != rhs->LastRequested ? lhs->LastRequested < rhs->LastRequested : lhs->Name < rhs->Name;
+	});
+
+	std::size_t freedBytes{ 0 };
+	auto victim{ victims.begin() };
+	for (auto* texture : loads) {
+		if (numLoads >= m_maxLoads) {
+			break;
+		}
+
+		// One level at a time, so quality fills in evenly across the screen
+		const auto level{ texture->ResidentLevel - 1 };
+		const auto size{ getLevelSize(*texture, level) };
+
+		while (residentBytes + size > m_budgetBytes && victim != victims.end()) {
+			if ((*victim)->ResidentLevel >= (*victim)->WantedLevel) {
+				++victim;
+				continue;
+			}
+			const auto dropped{ dropLevel(**victim) };
+			residentBytes -= dropped;
+			freedBytes += dropped;
+		}
+
+		if (residentBytes + size > m_budgetBytes) {
+			break;
+		}
+
+		startLoad(*texture, level);
+		residentBytes += size;
+		++numLoads;
+	}
+
+	return freedBytes;
+}
+
+/***********************************************************************************/
+int TextureStreamer::GetTailLevel(const int width, const int height) const noexcept {
+	const auto lastLevel{ MipGenerator::GetNumLevels(width, height) - 1 };
+	auto level{ 0 };
+	while (level < lastLevel && std::max(width >> level, height >> level) > m_tailSize) {
+		++level;
+	}
+	return level;
+}
+
+/***********************************************************************************/
+TextureStreamer::Stats TextureStreamer::GetStats() const {
+	Stats stats;
+	stats.NumTextures = m_textures.size();
+	stats.BudgetBytes = m_budgetBytes;
+	for (const auto& texture : m_textures) {
+		stats.ResidentBytes += getResidentSize(*texture);
+		stats.NumLoads += texture->LoadingLevel >= 0 ? 1 : 0;
+	}
+	return stats;
+}
+
+/***********************************************************************************/
+std::size_t TextureStreamer::getLevelSize(const Texture& texture, const int level) const noexcept {
+	return TextureCompressor::GetCompressedSize(texture.Format, std::max(texture.Width >> level, 1), std::max(texture.Height >> level, 1));
+}
+
+/***********************************************************************************/
+std::size_t TextureStreamer::getResidentSize(const Texture& texture) const noexcept {
+	const auto firstLevel{ texture.LoadingLevel >= 0 ? std::min(texture.LoadingLevel, texture.ResidentLevel) : texture.ResidentLevel };
+
+	std::size_t size{ 0 };
+	for (auto level = firstLevel; level < texture.NumLevels; ++level) {
+		size += getLevelSize(texture, level);
+	}
+	return size;
+}
+
+/***********************************************************************************/
+std::size_t TextureStreamer::dropLevel(Texture& texture) {
+	const auto level{ texture.ResidentLevel };
+
+	glBindTexture(GL_TEXTURE_2D, texture.Name);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+	// An empty image releases the level's storage
+	glCompressedTexImage2D(GL_TEXTURE_2D, level, TextureCompressor::GetGLFormat(texture.Format), 0, 0, 0, 0, nullptr);
+
+	++texture.ResidentLevel;
+
+	return getLevelSize(texture, level);
+}
+
+/***********************************************************************************/
+void TextureStreamer::startLoad(Texture& texture, const int level) {
+	texture.LoadingLevel = level;
+	texture.LoadFailed.store(false, std::memory_order_relaxed);
+
+	JobSystem::GetInstance().Run([this, texture = &texture, level]() {
+		// Mapped, only the pages of this level are read
+		KTX2Texture file;
+		if (!file.Load(texture->Path, texture->Key) || file.GetFormat() != texture->Format ||
+			static_cast<int>(file.GetLevels().size()) != texture->NumLevels) {
+			texture->LoadFailed.store(true, std::memory_order_release);
+			return;
+		}
+
+		const auto& data{ file.GetLevels()[level] };
+		const auto* bytes{ reinterpret_cast<const std::uint8_t*>(data.Data) };
+
+		TextureUploader::Image image;
+		image.Texture = texture->Name;
+		image.InternalFormat = TextureCompressor::GetGLFormat(texture->Format);
+		image.Width = texture->Width;
+		image.Height = texture->Height;
+		image.FirstLevel = level;
+		image.Levels.emplace_back(bytes, bytes + data.Size);
+		image.OnUploaded = [texture, level]() {
+			texture->ResidentLevel = level;
+			texture->LoadingLevel = -1;
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+		};
+
+		m_uploader->Submit(std::move(image));
+	}, &m_loadJobs);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "TextureCompressor.h"
+#include "TextureUploader.h"
+#include "../Core/JobSystem.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************************************/
+// Keeps only the mips of block compressed textures that are needed on screen. A texture
+// starts with its mip tail (levels up to tailSize texels), GL_TEXTURE_BASE_LEVEL hides the
+// levels above. Every frame the engine reports how many pixels each visible texture covers,
+// the streamer then loads the missing levels one at a time from the texture's KTX2 cache
+// file on the job system, largest on screen first. Under the VRAM budget the top levels of
+// textures that haven't been seen for the longest time are dropped again to make room.
+//
+// Everything except Add() and SetRequests() belongs to the GL thread.
+class TextureStreamer {
+public:
+	// Screen coverage of a texture in one frame
+	struct Request {
+		GLuint Texture;
+		float Pixels;	// Projected size of the largest mesh using it, in pixels across
+	};
+
+	struct Stats {
+		std::size_t NumTextures{ 0 };
+		std::size_t ResidentBytes{ 0 };		// Streamed textures only, loads in flight included
+		std::size_t BudgetBytes{ 0 };
+		std::size_t NumLoads{ 0 };			// Levels in flight
+	};
+
+	// uploader receives the loaded levels. maxLoads limits the levels loading at once. bias is
+	// added to the mip level that matches the screen size, negative values load sharper mips.
+	void Init(TextureUploader& uploader, const std::size_t budgetBytes, const int tailSize, const std::size_t maxLoads, const float bias);
+	// Waits for loads in flight and forgets every texture
+	void Delete();
+
+	// Any thread. Passes tail (the image of the smallest levels, see GetTailLevel()) to the
+	// uploader and streams the rest of the texture from the KTX2 file at path.
+	void Add(TextureUploader::Image&& tail, const TextureCompressor::Format format, const std::filesystem::path& path, const std::uint64_t key);
+	// Any thread. Replaces the requests of the previous frame.
+	void SetRequests(std::vector<Request>&& requests);
+
+	// GL thread, once per frame. Drops levels that are over budget and starts loading the
+	// levels that are needed most. Returns the number of bytes freed.
+	std::size_t Update();
+
+	// First level of the tail for a texture of this size
+	int GetTailLevel(const int width, const int height) const noexcept;
+	auto IsEnabled() const noexcept { return m_uploader != nullptr; }
+	// Whether the streamer manages the mips of a texture. True from the upload of its tail on.
+	bool IsStreamed(const GLuint texture) const;
+	Stats GetStats() const;
+
+private:
+	struct Texture {
+		GLuint Name;
+		TextureCompressor::Format Format;
+		int Width, Height;
+		int NumLevels, TailLevel;
+		std::filesystem::path Path;
+		std::uint64_t Key;
+
+		int ResidentLevel;			// Base level, everything from here to the last level is uploaded
+		int LoadingLevel{ -1 };		// Level in flight, -1 for none
+		std::atomic<bool> LoadFailed{ false };	// Set by the loading job
+		bool Broken{ false };		// The file went away or changed, stays at what it has
+
+		int WantedLevel;
+		float Pixels{ 0.0f };
+		std::uint64_t LastRequested{ 0 };
+	};
+
+	std::size_t getLevelSize(const Texture& texture, const int level) const noexcept;
+	// Bytes of every uploaded level plus the one in flight
+	std::size_t getResidentSize(const Texture& texture) const noexcept;
+	// Drops the base level of texture
+	std::size_t dropLevel(Texture& texture);
+	void startLoad(Texture& texture, const int level);
+
+	TextureUploader* m_uploader{ nullptr };
+	std::size_t m_budgetBytes{ 0 };
+	int m_tailSize{ 64 };
+	std::size_t m_maxLoads{ 8 };
+	float m_bias{ 0.0f };
+
+	// Stable addresses, the loading jobs hold pointers to their texture
+	std::vector<std::unique_ptr<Texture>> m_textures;
+	std::unordered_map<GLuint, Texture*> m_textureLookup;
+	std::uint64_t m_frame{ 0 };
+	JobCounter m_loadJobs;
+
+	// Filled from other threads
+	mutable std::mutex m_mutex;
+	std::vector<std::unique_ptr<Texture>> m_added;
+	std::vector<Request> m_requests;
+	bool m_hasRequests{ false };
+};
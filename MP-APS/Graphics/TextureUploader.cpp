@@ -0,0 +1,205 @@
+#include "TextureUploader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace {
+	// Offsets into a pixel buffer must be multiples of the texel or block size
+	constexpr std::size_t LevelAlignment{ 16 };
+
+	/***********************************************************************************/
+	std::size_t alignLevel(const std::size_t offset) noexcept {
+		return (offset + LevelAlignment - 1) / LevelAlignment * LevelAlignment;
+	}
+
+	/***********************************************************************************/
+	std::size_t getStagingSize(const TextureUploader::Image& image) noexcept {
+		std::size_t size{ 0 };
+		for (const auto& level : image.Levels) {
+			size = alignLevel(size) + level.size();
+		}
+		return size;
+	}
+}
+
+/***********************************************************************************/
+void TextureUploader::Init(const std::size_t numBuffers) {
+	m_buffers.resize(std::max<std::size_t>(numBuffers, 1));
+	for (auto& buffer : m_buffers) {
+		glGenBuffers(1, &buffer.Name);
+	}
+}
+
+/***********************************************************************************/
+void TextureUploader::Delete() {
+	for (auto& buffer : m_buffers) {
+		if (buffer.Fence) {
+			glDeleteSync(buffer.Fence);
+		}
+		glDeleteBuffers(1, &buffer.Name);
+	}
+	m_buffers.clear();
+	m_capacity = 0;
+
+	std::lock_guard<std::mutex> lock(m_queueMutex);
+	m_queue.clear();
+}
+
+/***********************************************************************************/
+void TextureUploader::Submit(Image&& image) {
+	std::lock_guard<std::mutex> lock(m_queueMutex);
+	m_queue.push_back(std::move(image));
+}
+
+/***********************************************************************************/
+TextureUploader::Stats TextureUploader::Process(const double budgetMs) {
+	Stats stats;
+	const auto start{ std::chrono::steady_clock::now() };
+
+	while (true) {
+		if (budgetMs >= 0.0 && stats.Textures > 0 &&
+			std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= budgetMs) {
+			break;
+		}
+
+		Image image;
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			if (m_queue.empty()) {
+				break;
+			}
+			image = std::move(m_queue.front());
+			m_queue.pop_front();
+		}
+
+		// Failed to load, the texture stays empty
+		if (image.Levels.empty()) {
+			continue;
+		}
+
+		auto* buffer{ acquireBuffer(getStagingSize(image), budgetMs < 0.0) };
+		if (!buffer) {
+			// Every buffer is still being read, try again next frame
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			m_queue.push_front(std::move(image));
+			break;
+		}
+
+		const auto residentBytes{ upload(image, *buffer) };
+		++stats.Textures;
+		stats.ResidentBytes += residentBytes;
+		stats.Uploads.push_back({ image.Texture, residentBytes });
+		stats.UncompressedBytes += image.UncompressedBytes;
+	}
+
+	return stats;
+}
+
+/***********************************************************************************/
+bool TextureUploader::IsEmpty() const {
+	std::lock_guard<std::mutex> lock(m_queueMutex);
+	return m_queue.empty();
+}
+
+/***********************************************************************************/
+TextureUploader::Buffer* TextureUploader::acquireBuffer(const std::size_t size, const bool wait) {
+	Buffer* free{ nullptr };
+	for (auto& buffer : m_buffers) {
+		if (buffer.Fence) {
+			const auto status{ glClientWaitSync(buffer.Fence, 0, 0) };
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+				continue;
+			}
+			glDeleteSync(buffer.Fence);
+			buffer.Fence = nullptr;
+		}
+
+		// Prefer one that is already big enough
+		if (!free || (free->Capacity < size && buffer.Capacity >= size)) {
+			free = &buffer;
+		}
+	}
+
+	if (!free && wait) {
+		free = &m_buffers.front();
+		while (glClientWaitSync(free->Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+		glDeleteSync(free->Fence);
+		free->Fence = nullptr;
+	}
+
+	if (free && free->Capacity < size) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, free->Name);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		m_capacity += size - free->Capacity;
+		free->Capacity = size;
+	}
+
+	return free;
+}
+
+/***********************************************************************************/
+std::size_t TextureUploader::upload(const Image& image, Buffer& buffer) {
+	const auto size{ getStagingSize(image) };
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.Name);
+	// The fence has passed, nothing reads the buffer anymore
+	auto* mapped{ static_cast<std::uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size),
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT)) };
+	if (!mapped) {
+		std::cerr << "Texture Uploader: failed to map pixel buffer\n";
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return 0;
+	}
+
+	std::vector<std::size_t> offsets;
+	std::size_t offset{ 0 };
+	for (const auto& level : image.Levels) {
+		offset = alignLevel(offset);
+		std::memcpy(mapped + offset, level.data(), level.size());
+		offsets.push_back(offset);
+		offset += level.size();
+	}
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	// Pointers are offsets into the bound pixel buffer from here on
+	glBindTexture(GL_TEXTURE_2D, image.Texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	std::size_t residentBytes{ 0 };
+	if (image.PixelFormat == 0) {
+		for (std::size_t i = 0; i < image.Levels.size(); ++i) {
+			const auto level{ image.FirstLevel + static_cast<int>(i) };
+			glCompressedTexImage2D(GL_TEXTURE_2D, level, image.InternalFormat, std::max(image.Width >> level, 1), std::max(image.Height >> level, 1),
+				0, static_cast<GLsizei>(image.Levels[i].size()), reinterpret_cast<const void*>(offsets[i]));
+			residentBytes += image.Levels[i].size();
+		}
+	}
+	else {
+		for (std::size_t i = 0; i < image.Levels.size(); ++i) {
+			const auto level{ static_cast<int>(i) };
+			glTexImage2D(GL_TEXTURE_2D, level, image.InternalFormat, std::max(image.Width >> level, 1), std::max(image.Height >> level, 1),
+				0, image.PixelFormat, GL_UNSIGNED_BYTE, reinterpret_cast<const void*>(offsets[i]));
+			residentBytes += image.Levels[i].size();
+		}
+	}
+
+	if (!image.OnUploaded) {
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, image.FirstLevel);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.FirstLevel + static_cast<GLint>(image.Levels.size() - 1));
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	buffer.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	if (image.OnUploaded) {
+		image.OnUploaded();
+	}
+
+	return residentBytes;
+}
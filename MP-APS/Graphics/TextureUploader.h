@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/***********************************************************************************/
+// Uploads textures that were decoded on other threads. Images are queued from any thread
+// and copied into a small pool of pixel unpack buffers on the GL thread, the texture is then
+// filled from the buffer so the driver can copy asynchronously. A fence per buffer keeps it
+// from being overwritten before the GPU has read it.
+class TextureUploader {
+public:
+	// Pixels for a texture name created on the GL thread
+	struct Image {
+		GLuint Texture{ 0 };
+		GLenum InternalFormat{ 0 };
+		GLenum PixelFormat{ 0 };		// 0 if the levels are block compressed
+		int Width{ 0 }, Height{ 0 };
+		std::vector<std::vector<std::uint8_t>> Levels;	// Largest first, empty if loading failed
+		int FirstLevel{ 0 };			// Mip level of Levels[0], block compressed only
+		std::size_t UncompressedBytes{ 0 };	// For the memory stats, see ResourceManager::TextureMemory
+		// GL thread, right after the upload with the texture bound. The levels otherwise become
+		// the texture's base to max level range, with it they are left alone.
+		std::function<void()> OnUploaded;
+	};
+
+	// What a call to Process() uploaded
+	struct Stats {
+		struct Upload {
+			GLuint Texture;
+			std::size_t ResidentBytes;
+		};
+
+		std::size_t Textures{ 0 };
+		std::size_t ResidentBytes{ 0 };
+		std::size_t UncompressedBytes{ 0 };
+		std::vector<Upload> Uploads;	// Per image, in upload order
+	};
+
+	// numBuffers pixel buffers, each grows to the largest image copied into it
+	void Init(const std::size_t numBuffers);
+	void Delete();
+
+	// Any thread
+	void Submit(Image&& image);
+
+	// GL thread. Uploads queued images until budgetMs have passed, at least one per call if a
+	// buffer is free. A negative budget uploads everything queued.
+	Stats Process(const double budgetMs);
+
+	bool IsEmpty() const;
+	auto GetNumBuffers() const noexcept { return m_buffers.size(); }
+	// Bytes allocated for the pixel buffers
+	auto GetCapacity() const noexcept { return m_capacity; }
+
+private:
+	struct Buffer {
+		GLuint Name{ 0 };
+		std::size_t Capacity{ 0 };
+		GLsync Fence{ nullptr };
+	};
+
+	// A buffer the GPU is done with, grown to at least size. nullptr if all are in use, unless
+	// wait blocks on the first buffer instead.
+	Buffer* acquireBuffer(const std::size_t size, const bool wait);
+	// Copies image through buffer into its texture
+	static std::size_t upload(const Image& image, Buffer& buffer);
+
+	std::vector<Buffer> m_buffers;
+	std::size_t m_capacity{ 0 };
+
+	mutable std::mutex m_queueMutex;
+	std::deque<Image> m_queue;
+};
@@ -0,0 +1,95 @@
+#include "VertexCompressor.h"
+
+#include <glm/common.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	/***********************************************************************************/
+	std::int16_t toSnorm16(const float value) noexcept {
+		return static_cast<std::int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	/***********************************************************************************/
+	// Projects a direction onto the octahedron and unfolds it into [-1, 1]^2. Zero vectors map
+	// to +z. decodeOctahedral() in vertexformat.glsl reverses it.
+	void encodeOctahedral(const glm::vec3& direction, std::int16_t* encoded) noexcept {
+		const auto length{ std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z) };
+		if (length <= 0.0f) {
+			encoded[0] = encoded[1] = 0;
+			return;
+		}
+
+		auto octahedron{ glm::vec2(direction) / length };
+		// The lower half folds over the diagonals
+		if (direction.z < 0.0f) {
+			const glm::vec2 signs{ octahedron.x >= 0.0f ? 1.0f : -1.0f, octahedron.y >= 0.0f ? 1.0f : -1.0f };
+			octahedron = (1.0f - glm::abs(glm::vec2(octahedron.y, octahedron.x))) * signs;
+		}
+
+		encoded[0] = toSnorm16(octahedron.x);
+		encoded[1] = toSnorm16(octahedron.y);
+	}
+}
+
+/***********************************************************************************/
+VertexCompressor::PositionRange VertexCompressor::GetPositionRange(const Vertex* vertices, const std::size_t numVertices) noexcept {
+	PositionRange range;
+	if (numVertices == 0) {
+		return range;
+	}
+
+	auto min{ vertices[0].Position }, max{ vertices[0].Position };
+	for (std::size_t i = 1; i < numVertices; ++i) {
+		min = glm::min(min, vertices[i].Position);
+		max = glm::max(max, vertices[i].Position);
+	}
+
+	range.Offset = min;
+	range.Scale = max - min;
+	for (auto axis = 0; axis < 3; ++axis) {
+		if (range.Scale[axis] <= 0.0f) {
+			range.Scale[axis] = 1.0f;
+		}
+	}
+	return range;
+}
+
+/***********************************************************************************/
+void VertexCompressor::Pack(const Vertex* vertices, const std::size_t numVertices, const PositionRange& range, PackedVertex* packed) noexcept {
+	const auto toUnit{ 1.0f / range.Scale };
+
+	for (std::size_t i = 0; i < numVertices; ++i) {
+		const auto& vertex{ vertices[i] };
+		auto& out{ packed[i] };
+
+		const auto position{ glm::clamp((vertex.Position - range.Offset) * toUnit, 0.0f, 1.0f) };
+		for (auto axis = 0; axis < 3; ++axis) {
+			out.Position[axis] = static_cast<std::uint16_t>(std::lround(position[axis] * 65535.0f));
+		}
+		out.Position[3] = vertex.Tangent.w < 0.0f ? 0 : 0xFFFF;
+
+		out.TexCoords[0] = glm::packHalf1x16(vertex.TexCoords.x);
+		out.TexCoords[1] = glm::packHalf1x16(vertex.TexCoords.y);
+
+		encodeOctahedral(vertex.Normal, out.Normal);
+		encodeOctahedral(glm::vec3(vertex.Tangent), out.Tangent);
+	}
+}
+
+/***********************************************************************************/
+void VertexCompressor::PackIndices(const GLuint* indices, const std::size_t numIndices, std::uint16_t* packed) noexcept {
+	std::transform(indices, indices + numIndices, packed, [](const auto index) { return static_cast<std::uint16_t>(index); });
+}
+
+/***********************************************************************************/
+VertexCompressor::Format VertexCompressor::GetFormat(const std::string_view name) noexcept {
+	return name == "packed" ? Format::Packed : Format::Float;
+}
+
+/***********************************************************************************/
+const char* VertexCompressor::GetName(const Format format) noexcept {
+	return format == Format::Packed ? "packed" : "float";
+}
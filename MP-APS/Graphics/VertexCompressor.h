@@ -0,0 +1,48 @@
+#pragma once
+
+#include "../Vertex.h"
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string_view>
+
+/***********************************************************************************/
+// Compact GPU layouts for mesh vertices and indices, 20 instead of 48 bytes per vertex.
+// Positions are quantised to 16 bits within the mesh bounds, texture coordinates stored as
+// half floats, normals and tangents octahedral encoded in two 16-bit snorms each. The bitangent
+// sign goes into the spare position component. Decoded by Data/Shaders/vertexformat.glsl.
+class VertexCompressor {
+public:
+	enum class Format : std::uint8_t {
+		Float,	// Vertex as is
+		Packed	// PackedVertex
+	};
+
+	struct PackedVertex {
+		std::uint16_t Position[4];	// unorm xyz within the position range, w is 0xFFFF for a positive bitangent sign
+		std::uint16_t TexCoords[2];	// Half floats
+		std::int16_t Normal[2];		// snorm, octahedral
+		std::int16_t Tangent[2];
+	};
+	static_assert(sizeof(PackedVertex) == 20, "PackedVertex must match vertexformat.glsl");
+
+	// Maps packed positions in [0, 1] back to model space as position * Scale + Offset
+	struct PositionRange {
+		glm::vec3 Scale{ 1.0f };
+		glm::vec3 Offset{ 0.0f };
+	};
+
+	// Bounds of the positions, sides of zero length are widened so they can be divided by
+	static PositionRange GetPositionRange(const Vertex* vertices, const std::size_t numVertices) noexcept;
+	static void Pack(const Vertex* vertices, const std::size_t numVertices, const PositionRange& range, PackedVertex* packed) noexcept;
+
+	// Indices fit 16 bits up to 65535 vertices, the largest index is then 65534
+	static bool CanUseShortIndices(const std::size_t numVertices) noexcept { return numVertices <= 0xFFFF; }
+	static void PackIndices(const GLuint* indices, const std::size_t numIndices, std::uint16_t* packed) noexcept;
+
+	// "float" or "packed", float for anything else
+	static Format GetFormat(const std::string_view name) noexcept;
+	static const char* GetName(const Format format) noexcept;
+	static std::size_t GetVertexSize(const Format format) noexcept { return format == Format::Packed ? sizeof(PackedVertex) : sizeof(Vertex); }
+};
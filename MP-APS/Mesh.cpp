@@ -3,7 +3,7 @@
 /***********************************************************************************/
 Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices) : IndexCount(indices.size()) {
 
-	setupMesh(vertices, indices);
+	setupMesh(vertices.data(), vertices.size(), indices.data(), indices.size());
 }
 
 /***********************************************************************************/
@@ -11,21 +11,66 @@ Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indic
 	IndexCount(indices.size()),
 	Material(material) {
 
-	setupMesh(vertices, indices);
+	setupMesh(vertices.data(), vertices.size(), indices.data(), indices.size());
 }
 
 /***********************************************************************************/
-void Mesh::setupMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices) {
-	
+Mesh::Mesh(const void* vertices, const std::size_t numVertices, const void* indices, const std::size_t numIndices, const GLenum indexType,
+	const PBRMaterialPtr& material, const VertexCompressor::Format format, const VertexCompressor::PositionRange& range) :
+	IndexCount(numIndices),
+	Material(material),
+	VertexFormat(format),
+	PositionRange(range),
+	IndexType(indexType) {
+
+	setupBuffers(vertices, numVertices, indices);
+}
+
+/***********************************************************************************/
+void Mesh::Refill(const void* vertices, const void* indices) {
+	VAO.RefillBuffer(GLVertexArray::BufferType::ARRAY, vertices);
+	VAO.RefillBuffer(GLVertexArray::BufferType::ELEMENT, indices);
+}
+
+/***********************************************************************************/
+void Mesh::setupMesh(const Vertex* vertices, const std::size_t numVertices, const GLuint* indices, const std::size_t numIndices) {
+	if (!VertexCompressor::CanUseShortIndices(numVertices)) {
+		setupBuffers(vertices, numVertices, indices);
+		return;
+	}
+
+	IndexType = GL_UNSIGNED_SHORT;
+	std::vector<std::uint16_t> shortIndices(numIndices);
+	VertexCompressor::PackIndices(indices, numIndices, shortIndices.data());
+	setupBuffers(vertices, numVertices, shortIndices.data());
+}
+
+/***********************************************************************************/
+void Mesh::setupBuffers(const void* vertices, const std::size_t numVertices, const void* indices) {
+	const auto indexSize{ IndexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(GLuint) };
+
 	VAO.Init();
 	VAO.Bind();
 	// Attach VBO
-	VAO.AttachBuffer(GLVertexArray::BufferType::ARRAY, vertices.size() * sizeof(Vertex), GLVertexArray::DrawMode::STATIC, &vertices[0]);
+	VAO.AttachBuffer(GLVertexArray::BufferType::ARRAY, numVertices * VertexCompressor::GetVertexSize(VertexFormat), GLVertexArray::DrawMode::STATIC, vertices);
 	// Attach EBO
-	VAO.AttachBuffer(GLVertexArray::BufferType::ELEMENT, indices.size() * sizeof(GLuint), GLVertexArray::DrawMode::STATIC, &indices[0]);
+	VAO.AttachBuffer(GLVertexArray::BufferType::ELEMENT, IndexCount * indexSize, GLVertexArray::DrawMode::STATIC, indices);
 
 	// Vertex Attributes
 
+	if (VertexFormat == VertexCompressor::Format::Packed) {
+		const auto vertexSize{ static_cast<GLuint>(sizeof(VertexCompressor::PackedVertex)) };
+		// Position, the bitangent sign in w
+		VAO.EnableAttribute(0, 4, GL_UNSIGNED_SHORT, true, vertexSize, reinterpret_cast<void*>(offsetof(VertexCompressor::PackedVertex, Position)));
+		// Texture Coords
+		VAO.EnableAttribute(1, 2, GL_HALF_FLOAT, false, vertexSize, reinterpret_cast<void*>(offsetof(VertexCompressor::PackedVertex, TexCoords)));
+		// Normal
+		VAO.EnableAttribute(2, 2, GL_SHORT, true, vertexSize, reinterpret_cast<void*>(offsetof(VertexCompressor::PackedVertex, Normal)));
+		// Tangent
+		VAO.EnableAttribute(3, 2, GL_SHORT, true, vertexSize, reinterpret_cast<void*>(offsetof(VertexCompressor::PackedVertex, Tangent)));
+		return;
+	}
+
 	const static auto vertexSize = sizeof(Vertex);
 	// Position
 	VAO.EnableAttribute(0, 3, vertexSize, nullptr);
@@ -33,6 +78,6 @@ void Mesh::setupMesh(const std::vector<Vertex>& vertices, const std::vector<GLui
 	VAO.EnableAttribute(1, 2, vertexSize, reinterpret_cast<void*>(offsetof(Vertex, TexCoords)));
 	// Normal
 	VAO.EnableAttribute(2, 3, vertexSize, reinterpret_cast<void*>(offsetof(Vertex, Normal)));
-	// Tangent
-	VAO.EnableAttribute(3, 3, vertexSize, reinterpret_cast<void*>(offsetof(Vertex, Tangent)));
-}
\ No newline at end of file
+	// Tangent, the bitangent sign in w
+	VAO.EnableAttribute(3, 4, vertexSize, reinterpret_cast<void*>(offsetof(Vertex, Tangent)));
+}
@@ -2,24 +2,41 @@
 
 #include "Vertex.h"
 #include "Graphics/GLVertexArray.h"
+#include "Graphics/VertexCompressor.h"
 #include "PBRMaterial.h"
+#include "AABB.hpp"
 
 #include <vector>
 
-// TODO: Add per-mesh AABB
 /***********************************************************************************/
 struct Mesh {
 	Mesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices);
 	Mesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, const PBRMaterialPtr& material);
+	// Uploads arrays already in their GPU layout, e.g. straight from a mapped mesh cache. Vertices are
+	// stored in format with packed positions decoded by range, indices are of indexType.
+	Mesh(const void* vertices, const std::size_t numVertices, const void* indices, const std::size_t numIndices, const GLenum indexType,
+		const PBRMaterialPtr& material, const VertexCompressor::Format format, const VertexCompressor::PositionRange& range);
 
 	void Clear();
+	// Fills buffers freed with VAO.ReleaseBuffers() again, from the arrays the mesh was created with
+	void Refill(const void* vertices, const void* indices);
 
 	auto GetTriangleCount() const noexcept { return IndexCount / 3; }
 	
 	const std::size_t IndexCount;
 	GLVertexArray VAO;
 	PBRMaterialPtr Material;
+	// Model space, null if unknown
+	AABB Bounds;
+
+	// How the buffers store the mesh. Shaders decode positions with the range, see vertexformat.glsl.
+	VertexCompressor::Format VertexFormat{ VertexCompressor::Format::Float };
+	VertexCompressor::PositionRange PositionRange;
+	GLenum IndexType{ GL_UNSIGNED_INT };
 
 private:
-	void setupMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices);
+	// Float vertices, indices in 16 bits if they fit
+	void setupMesh(const Vertex* vertices, const std::size_t numVertices, const GLuint* indices, const std::size_t numIndices);
+	// Creates the buffers from arrays in the mesh's formats and sets up the attributes
+	void setupBuffers(const void* vertices, const std::size_t numVertices, const void* indices);
 };
@@ -0,0 +1,269 @@
+#include "MeshCache.h"
+#include "Core/Hash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+	constexpr char Magic[4]{ 'M', 'P', 'M', 'C' };
+	constexpr std::size_t DataAlignment{ 16 };
+	constexpr std::uint64_t IndexAlignment{ 4 };
+
+	/***********************************************************************************/
+	std::uint64_t getIndexSize(const GLenum indexType) noexcept {
+		return indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(GLuint);
+	}
+
+	/***********************************************************************************/
+	void writeString(std::ostream& out, const std::string& str) {
+		const auto length{ static_cast<std::uint32_t>(str.size()) };
+		out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+		out.write(str.data(), length);
+	}
+
+	/***********************************************************************************/
+	// Advances data, fails if the string would run past end
+	bool readString(const std::byte*& data, const std::byte* end, std::string& str) {
+		std::uint32_t length;
+		if (end - data < static_cast<std::ptrdiff_t>(sizeof(length))) {
+			return false;
+		}
+		std::memcpy(&length, data, sizeof(length));
+		data += sizeof(length);
+
+		if (end - data < static_cast<std::ptrdiff_t>(length)) {
+			return false;
+		}
+		str.assign(reinterpret_cast<const char*>(data), length);
+		data += length;
+
+		return true;
+	}
+}
+
+/***********************************************************************************/
+std::uint64_t MeshCache::ComputeKey(const std::filesystem::path& source, const std::uint32_t importFlags, const bool loadTexCoords,
+	const VertexCompressor::Format format) {
+	auto key{ Hash::File(source) };
+	// Materials of OBJ files, usually named after the model
+	key = Hash::File(std::filesystem::path(source).replace_extension(".mtl"), key);
+
+	key = Hash::Value(importFlags, key);
+	key = Hash::Value(loadTexCoords, key);
+	key = Hash::Value(Version, key);
+	key = Hash::Value(static_cast<std::uint32_t>(format), key);
+	return Hash::Value(static_cast<std::uint32_t>(VertexCompressor::GetVertexSize(format)), key);
+}
+
+/***********************************************************************************/
+std::filesystem::path MeshCache::GetCachePath(const std::filesystem::path& cacheDir, const std::filesystem::path& source, const std::uint64_t key) {
+	std::ostringstream name;
+	name << source.stem().string() << '-' << std::hex << std::setw(16) << std::setfill('0') << key << ".mpmesh";
+	return cacheDir / name.str();
+}
+
+/***********************************************************************************/
+std::size_t MeshCache::ReserveSubmesh(const std::uint32_t numVertices, const std::uint32_t numIndices, const std::int32_t material) {
+	const auto indexType{ VertexCompressor::CanUseShortIndices(numVertices) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT };
+
+	std::uint64_t vertexOffset{ 0 }, indexOffset{ 0 };
+	if (!m_submeshes.empty()) {
+		const auto& previous{ m_submeshes.back() };
+		vertexOffset = previous.VertexOffset + previous.NumVertices * VertexCompressor::GetVertexSize(m_format);
+		indexOffset = previous.IndexOffset + previous.NumIndices * getIndexSize(previous.IndexType);
+		indexOffset = (indexOffset + IndexAlignment - 1) / IndexAlignment * IndexAlignment;
+	}
+
+	const AABB empty;
+	m_submeshes.push_back({ vertexOffset, indexOffset, numVertices, numIndices, empty.getMin(), empty.getMax(), {}, material, static_cast<GLenum>(indexType) });
+
+	return m_submeshes.size() - 1;
+}
+
+/***********************************************************************************/
+void MeshCache::Allocate() {
+	if (!m_submeshes.empty()) {
+		const auto& last{ m_submeshes.back() };
+		m_vertexBlob.resize(last.VertexOffset + last.NumVertices * VertexCompressor::GetVertexSize(m_format));
+		m_indexBlob.resize(last.IndexOffset + last.NumIndices * getIndexSize(last.IndexType));
+	}
+
+	m_vertexData = m_vertexBlob.data();
+	m_indexData = m_indexBlob.data();
+}
+
+/***********************************************************************************/
+void MeshCache::SetSubmesh(const std::size_t index, const Vertex* vertices, const GLuint* indices, const AABB& bounds) noexcept {
+	auto& submesh{ m_submeshes[index] };
+	submesh.BoundsMin = bounds.getMin();
+	submesh.BoundsMax = bounds.getMax();
+
+	auto* vertexData{ m_vertexBlob.data() + submesh.VertexOffset };
+	if (m_format == VertexCompressor::Format::Packed) {
+		submesh.PositionRange = VertexCompressor::GetPositionRange(vertices, submesh.NumVertices);
+		VertexCompressor::Pack(vertices, submesh.NumVertices, submesh.PositionRange, reinterpret_cast<VertexCompressor::PackedVertex*>(vertexData));
+	}
+	else {
+		std::memcpy(vertexData, vertices, submesh.NumVertices * sizeof(Vertex));
+	}
+
+	auto* indexData{ m_indexBlob.data() + submesh.IndexOffset };
+	if (submesh.IndexType == GL_UNSIGNED_SHORT) {
+		VertexCompressor::PackIndices(indices, submesh.NumIndices, reinterpret_cast<std::uint16_t*>(indexData));
+	}
+	else {
+		std::memcpy(indexData, indices, submesh.NumIndices * sizeof(GLuint));
+	}
+}
+
+/***********************************************************************************/
+std::int32_t MeshCache::AddMaterial(const Material& material) {
+	const auto existing{ std::find_if(m_materials.cbegin(), m_materials.cend(), [&material](const auto& m) { return m.Name == material.Name; }) };
+	if (existing != m_materials.cend()) {
+		return static_cast<std::int32_t>(existing - m_materials.cbegin());
+	}
+
+	m_materials.push_back(material);
+	return static_cast<std::int32_t>(m_materials.size() - 1);
+}
+
+/***********************************************************************************/
+bool MeshCache::Save(const std::filesystem::path& path, const std::uint64_t key) const {
+	std::ostringstream materials;
+	for (const auto& material : m_materials) {
+		for (const auto* str : { &material.Name, &material.AlbedoPath, &material.MetallicPath, &material.NormalPath, &material.RoughnessPath, &material.AlphaMaskPath }) {
+			writeString(materials, *str);
+		}
+	}
+	const auto materialBytes{ materials.str() };
+
+	Header header{};
+	std::memcpy(header.Magic, Magic, sizeof(Magic));
+	header.Version = Version;
+	header.Key = key;
+	header.VertexFormat = static_cast<std::uint32_t>(m_format);
+	header.NumSubmeshes = static_cast<std::uint32_t>(m_submeshes.size());
+	header.NumMaterials = static_cast<std::uint32_t>(m_materials.size());
+	header.MaterialBytes = static_cast<std::uint32_t>(materialBytes.size());
+	header.VertexBytes = m_vertexBlob.size();
+	header.IndexBytes = m_indexBlob.size();
+
+	if (path.has_parent_path()) {
+		std::filesystem::create_directories(path.parent_path());
+	}
+
+	// Written under a temporary name so a crash never leaves a truncated cache behind
+	auto tempPath{ path };
+	tempPath += ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary);
+		if (!out) {
+			std::cerr << "Mesh cache: failed to write " << tempPath << '\n';
+			return false;
+		}
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(m_submeshes.data()), m_submeshes.size() * sizeof(Submesh));
+		out.write(materialBytes.data(), materialBytes.size());
+
+		const auto padding{ getDataOffset(header) - (sizeof(header) + m_submeshes.size() * sizeof(Submesh) + materialBytes.size()) };
+		const char zeros[DataAlignment]{};
+		out.write(zeros, padding);
+
+		out.write(reinterpret_cast<const char*>(m_vertexBlob.data()), m_vertexBlob.size());
+		out.write(reinterpret_cast<const char*>(m_indexBlob.data()), m_indexBlob.size());
+
+		if (!out) {
+			std::cerr << "Mesh cache: failed to write " << tempPath << '\n';
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, path, error);
+	if (error) {
+		std::cerr << "Mesh cache: failed to replace " << path << ": " << error.message() << '\n';
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+/***********************************************************************************/
+bool MeshCache::Load(const std::filesystem::path& path, const std::uint64_t key) {
+	m_submeshes.clear();
+	m_materials.clear();
+	m_vertexBlob.clear();
+	m_indexBlob.clear();
+	m_vertexData = nullptr;
+	m_indexData = nullptr;
+
+	if (!m_file.Open(path)) {
+		return false;
+	}
+
+	Header header;
+	if (m_file.GetSize() < sizeof(header)) {
+		m_file.Close();
+		return false;
+	}
+	std::memcpy(&header, m_file.GetData(), sizeof(header));
+
+	const auto dataOffset{ getDataOffset(header) };
+	const auto expectedSize{ dataOffset + header.VertexBytes + header.IndexBytes };
+	if (std::memcmp(header.Magic, Magic, sizeof(Magic)) != 0 || header.Version != Version || header.Key != key ||
+		header.VertexFormat > static_cast<std::uint32_t>(VertexCompressor::Format::Packed) || m_file.GetSize() != expectedSize) {
+		std::cerr << "Mesh cache: " << path << " is stale or damaged, reimporting\n";
+		m_file.Close();
+		return false;
+	}
+
+	m_format = static_cast<VertexCompressor::Format>(header.VertexFormat);
+
+	const auto* data{ m_file.GetData() + sizeof(header) };
+	m_submeshes.resize(header.NumSubmeshes);
+	std::memcpy(m_submeshes.data(), data, header.NumSubmeshes * sizeof(Submesh));
+	data += header.NumSubmeshes * sizeof(Submesh);
+
+	const auto* materialsEnd{ data + header.MaterialBytes };
+	m_materials.resize(header.NumMaterials);
+	for (auto& material : m_materials) {
+		for (auto* str : { &material.Name, &material.AlbedoPath, &material.MetallicPath, &material.NormalPath, &material.RoughnessPath, &material.AlphaMaskPath }) {
+			if (!readString(data, materialsEnd, *str)) {
+				std::cerr << "Mesh cache: " << path << " is damaged, reimporting\n";
+				m_file.Close();
+				return false;
+			}
+		}
+	}
+
+	// Reject ranges outside the blobs rather than reading past the mapping later
+	const auto vertexSize{ VertexCompressor::GetVertexSize(m_format) };
+	for (const auto& submesh : m_submeshes) {
+		if ((submesh.IndexType != GL_UNSIGNED_SHORT && submesh.IndexType != GL_UNSIGNED_INT) ||
+			submesh.VertexOffset > header.VertexBytes || submesh.NumVertices * vertexSize > header.VertexBytes - submesh.VertexOffset ||
+			submesh.IndexOffset > header.IndexBytes || submesh.NumIndices * getIndexSize(submesh.IndexType) > header.IndexBytes - submesh.IndexOffset ||
+			submesh.MaterialIndex >= static_cast<std::int32_t>(header.NumMaterials)) {
+			std::cerr << "Mesh cache: " << path << " is damaged, reimporting\n";
+			m_file.Close();
+			return false;
+		}
+	}
+
+	// The vertex blob is 16-byte aligned and the mapping is page aligned
+	m_vertexData = m_file.GetData() + dataOffset;
+	m_indexData = m_file.GetData() + dataOffset + header.VertexBytes;
+
+	return true;
+}
+
+/***********************************************************************************/
+std::size_t MeshCache::getDataOffset(const Header& header) noexcept {
+	const auto offset{ sizeof(Header) + header.NumSubmeshes * sizeof(Submesh) + header.MaterialBytes };
+	return (offset + DataAlignment - 1) / DataAlignment * DataAlignment;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "MeshData.h"
+#include "Core/MappedFile.h"
+#include "Graphics/VertexCompressor.h"
+
+#include <glm/vec3.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/***********************************************************************************/
+// Compiled form of an imported model: one vertex and one index blob already in the GPU layout
+// the meshes are drawn with (see VertexCompressor), submesh ranges with bounds, and material
+// references. A loaded cache maps the file and hands pointers into it straight to GL, nothing
+// is converted per vertex, neither on load nor when evicted buffers are refilled.
+//
+// Layout, native endianness: Header | Submesh[] | materials | padding to 16 | vertex blob | index blob
+// Materials are six strings each, stored as a 32-bit length followed by the characters.
+// Submeshes store 16-bit indices if their vertices allow it, each index range starts on 4 bytes.
+class MeshCache {
+public:
+	static constexpr std::uint32_t Version{ 3 };
+
+	// Texture paths as passed to ResourceManager::CacheMaterial
+	struct Material {
+		std::string Name;
+		std::string AlbedoPath, MetallicPath, NormalPath, RoughnessPath, AlphaMaskPath;
+	};
+
+	struct Submesh {
+		std::uint64_t VertexOffset, IndexOffset;	// In bytes into the blobs
+		std::uint32_t NumVertices, NumIndices;	// Indices are relative to the submesh's first vertex
+		glm::vec3 BoundsMin, BoundsMax;		// Min > max if the mesh has no positions
+		VertexCompressor::PositionRange PositionRange;	// Decodes packed positions, identity for float vertices
+		std::int32_t MaterialIndex;		// -1 for none
+		GLenum IndexType;			// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	};
+
+	// Blobs are built in format, Load() takes the format from the file
+	explicit MeshCache(const VertexCompressor::Format format = VertexCompressor::Format::Float) noexcept : m_format(format) {}
+
+	// Changes whenever the source file, the .mtl next to it, the import settings or the format change
+	static std::uint64_t ComputeKey(const std::filesystem::path& source, const std::uint32_t importFlags, const bool loadTexCoords,
+		const VertexCompressor::Format format);
+	// <cacheDir>/<source name>-<key>.mpmesh
+	static std::filesystem::path GetCachePath(const std::filesystem::path& cacheDir, const std::filesystem::path& source, const std::uint64_t key);
+
+	// Building takes two stages so submeshes can be converted in parallel. ReserveSubmesh() lays
+	// out the submeshes in order and Allocate() sizes the blobs once. Each submesh is then
+	// encoded into its range with SetSubmesh(), from any thread, one per submesh.
+	// material is an index returned by AddMaterial() or -1. Returns the index of the submesh.
+	std::size_t ReserveSubmesh(const std::uint32_t numVertices, const std::uint32_t numIndices, const std::int32_t material);
+	void Allocate();
+	// Takes the converted arrays with the sizes passed to ReserveSubmesh()
+	void SetSubmesh(const std::size_t submesh, const Vertex* vertices, const GLuint* indices, const AABB& bounds) noexcept;
+	// Returns the index of the material, materials with the same name are stored once
+	std::int32_t AddMaterial(const Material& material);
+	bool Save(const std::filesystem::path& path, const std::uint64_t key) const;
+
+	// Maps a file written by Save(). Fails if it was written for another key or version, or is damaged.
+	bool Load(const std::filesystem::path& path, const std::uint64_t key);
+
+	const auto& GetSubmeshes() const noexcept { return m_submeshes; }
+	const auto& GetMaterials() const noexcept { return m_materials; }
+	auto GetFormat() const noexcept { return m_format; }
+	// Point into the mapped file after Load(), into the added data otherwise.
+	// Vertices are in GetFormat(), indices of the submesh's IndexType.
+	const void* GetVertices(const Submesh& submesh) const noexcept { return m_vertexData + submesh.VertexOffset; }
+	const void* GetIndices(const Submesh& submesh) const noexcept { return m_indexData + submesh.IndexOffset; }
+
+private:
+	struct Header {
+		char Magic[4];
+		std::uint32_t Version;
+		std::uint64_t Key;
+		std::uint32_t VertexFormat;
+		std::uint32_t NumSubmeshes;
+		std::uint32_t NumMaterials;
+		std::uint32_t MaterialBytes;
+		std::uint64_t VertexBytes;
+		std::uint64_t IndexBytes;
+	};
+
+	// Offset of the vertex blob
+	static std::size_t getDataOffset(const Header& header) noexcept;
+
+	VertexCompressor::Format m_format;
+	std::vector<Submesh> m_submeshes;
+	std::vector<Material> m_materials;
+
+	// Built with ReserveSubmesh() and Allocate()
+	std::vector<std::byte> m_vertexBlob;
+	std::vector<std::byte> m_indexBlob;
+	// Loaded
+	MappedFile m_file;
+
+	const std::byte* m_vertexData{ nullptr };
+	const std::byte* m_indexData{ nullptr };
+};
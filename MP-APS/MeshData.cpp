@@ -0,0 +1,78 @@
+#include "MeshData.h"
+
+#include <assimp/mesh.h>
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+
+/***********************************************************************************/
+MeshData MeshData::FromAssimp(const aiMesh* mesh, const bool loadTexCoords) {
+	MeshData data;
+	data.Vertices.resize(mesh->mNumVertices);
+	data.Indices.resize(CountIndices(mesh));
+	data.Bounds = Convert(mesh, loadTexCoords, data.Vertices.data(), data.Indices.data());
+
+	return data;
+}
+
+/***********************************************************************************/
+std::size_t MeshData::CountIndices(const aiMesh* mesh) noexcept {
+	std::size_t numIndices{ 0 };
+	for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
+		numIndices += mesh->mFaces[i].mNumIndices;
+	}
+	return numIndices;
+}
+
+/***********************************************************************************/
+AABB MeshData::Convert(const aiMesh* mesh, const bool loadTexCoords, Vertex* vertices, GLuint* indices) noexcept {
+	AABB bounds;
+
+	for (unsigned int i = 0; i < mesh->mNumVertices; ++i) {
+		// Zeroed, the cache must not depend on uninitialised memory
+		Vertex vertex{};
+
+		if (mesh->HasPositions()) {
+			vertex.Position.x = mesh->mVertices[i].x;
+			vertex.Position.y = mesh->mVertices[i].y;
+			vertex.Position.z = mesh->mVertices[i].z;
+
+			// Construct bounding box
+			bounds.extend(vertex.Position);
+		}
+
+		if (mesh->HasNormals()) {
+			vertex.Normal.x = mesh->mNormals[i].x;
+			vertex.Normal.y = mesh->mNormals[i].y;
+			vertex.Normal.z = mesh->mNormals[i].z;
+		}
+
+		if (mesh->HasTangentsAndBitangents()) {
+			vertex.Tangent.x = mesh->mTangents[i].x;
+			vertex.Tangent.y = mesh->mTangents[i].y;
+			vertex.Tangent.z = mesh->mTangents[i].z;
+
+			// Mirrored texture coordinates flip the bitangent
+			const auto& bitangent{ mesh->mBitangents[i] };
+			const auto crossed{ glm::cross(vertex.Normal, glm::vec3(vertex.Tangent)) };
+			vertex.Tangent.w = crossed.x * bitangent.x + crossed.y * bitangent.y + crossed.z * bitangent.z < 0.0f ? -1.0f : 1.0f;
+		}
+
+		if (mesh->HasTextureCoords(0) && loadTexCoords) {
+			// Just take the first set of texture coords (since we could have up to 8)
+			vertex.TexCoords.x = mesh->mTextureCoords[0][i].x;
+			vertex.TexCoords.y = mesh->mTextureCoords[0][i].y;
+		}
+
+		vertices[i] = vertex;
+	}
+
+	// Get indices from each face
+	for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
+		const auto& face = mesh->mFaces[i];
+		indices = std::copy(face.mIndices, face.mIndices + face.mNumIndices, indices);
+	}
+
+	return bounds;
+}
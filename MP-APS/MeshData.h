@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Vertex.h"
+#include "AABB.hpp"
+
+#include <glad/glad.h>
+
+#include <vector>
+
+struct aiMesh;
+
+/***********************************************************************************/
+// CPU-side mesh data converted from Assimp, ready to be uploaded
+struct MeshData {
+	std::vector<Vertex> Vertices;
+	std::vector<GLuint> Indices;
+	AABB Bounds;
+
+	// Converts vertices and indices. Touches no shared state, so safe to call from worker threads.
+	// Texture coordinates are zeroed unless loadTexCoords is set.
+	static MeshData FromAssimp(const aiMesh* mesh, const bool loadTexCoords);
+
+	// Number of indices the faces of mesh hold
+	static std::size_t CountIndices(const aiMesh* mesh) noexcept;
+	// Same as FromAssimp(), but writes mNumVertices vertices and CountIndices() indices in place
+	// and returns the bounds. Attributes the mesh lacks are zero.
+	static AABB Convert(const aiMesh* mesh, const bool loadTexCoords, Vertex* vertices, GLuint* indices) noexcept;
+};
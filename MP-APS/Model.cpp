@@ -7,8 +7,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <iostream>
-#include <ppl.h>
 #include "ResourceManager.h"
+#include "Core/JobSystem.h"
+#include "Core/Profiler.h"
 
 /***********************************************************************************/
 Model::Model(const std::string_view Path, const std::string_view Name, const bool flipWindingOrder, const bool loadMaterial) : m_name(Name), m_path(Path) {
@@ -67,45 +68,88 @@ void Model::Delete() {
 	}
 }
 
+/***********************************************************************************/
+bool Model::CanReloadMesh(const std::size_t index) const noexcept {
+	return m_meshSource && index < m_meshSource->GetSubmeshes().size();
+}
+
+/***********************************************************************************/
+std::size_t Model::EvictMesh(const std::size_t index) noexcept {
+	return CanReloadMesh(index) ? m_meshes[index].VAO.ReleaseBuffers() : 0;
+}
+
+/***********************************************************************************/
+std::size_t Model::ReloadMesh(const std::size_t index) noexcept {
+	auto& vao{ m_meshes[index].VAO };
+	if (!CanReloadMesh(index) || vao.IsResident()) {
+		return 0;
+	}
+
+	const auto& submesh{ m_meshSource->GetSubmeshes()[index] };
+	m_meshes[index].Refill(m_meshSource->GetVertices(submesh), m_meshSource->GetIndices(submesh));
+
+	return vao.GetBufferSize(GLVertexArray::BufferType::ARRAY) + vao.GetBufferSize(GLVertexArray::BufferType::ELEMENT);
+}
+
 /***********************************************************************************/
 bool Model::loadModel(const std::string_view Path, const bool flipWindingOrder, const bool loadMaterial = true) {
+	PROFILE_FUNCTION();
 #ifdef _DEBUG
 	std::cout << "Loading model: " << m_name << '\n';
 #endif
 
 	std::cout << sizeof(PBRMaterial) << '\n';
 
-	Assimp::Importer importer;
-	const aiScene* scene = nullptr;
-
-	if (flipWindingOrder) {
-		scene = importer.ReadFile(Path.data(), aiProcess_Triangulate |
-		                          aiProcess_JoinIdenticalVertices |
-		                          aiProcess_GenUVCoords |
-		                          aiProcess_SortByPType |
-		                          aiProcess_RemoveRedundantMaterials |
-		                          aiProcess_FindInvalidData |
-		                          aiProcess_FlipUVs |
-		                          aiProcess_FlipWindingOrder | // Reverse back-face culling
-		                          aiProcess_CalcTangentSpace |
-		                          aiProcess_OptimizeMeshes |
-		                          aiProcess_SplitLargeMeshes);
-	}
-	else {
-		scene = importer.ReadFile(Path.data(), aiProcess_Triangulate |
-		                          aiProcess_JoinIdenticalVertices |
-		                          aiProcess_GenUVCoords |
-		                          aiProcess_SortByPType |
-		                          aiProcess_RemoveRedundantMaterials |
-		                          aiProcess_FindInvalidData |
-		                          aiProcess_FlipUVs |
-		                          aiProcess_CalcTangentSpace |
-		                          aiProcess_GenSmoothNormals |
-		                          aiProcess_ImproveCacheLocality |
-		                          aiProcess_OptimizeMeshes |
-		                          aiProcess_SplitLargeMeshes);
+	const unsigned int importFlags = flipWindingOrder ?
+		aiProcess_Triangulate |
+		aiProcess_JoinIdenticalVertices |
+		aiProcess_GenUVCoords |
+		aiProcess_SortByPType |
+		aiProcess_RemoveRedundantMaterials |
+		aiProcess_FindInvalidData |
+		aiProcess_FlipUVs |
+		aiProcess_FlipWindingOrder | // Reverse back-face culling
+		aiProcess_CalcTangentSpace |
+		aiProcess_OptimizeMeshes |
+		aiProcess_SplitLargeMeshes :
+		aiProcess_Triangulate |
+		aiProcess_JoinIdenticalVertices |
+		aiProcess_GenUVCoords |
+		aiProcess_SortByPType |
+		aiProcess_RemoveRedundantMaterials |
+		aiProcess_FindInvalidData |
+		aiProcess_FlipUVs |
+		aiProcess_CalcTangentSpace |
+		aiProcess_GenSmoothNormals |
+		aiProcess_ImproveCacheLocality |
+		aiProcess_OptimizeMeshes |
+		aiProcess_SplitLargeMeshes;
+
+	m_path = Path.substr(0, Path.find_last_of('/')); // Strip the model file name and keep the model folder.
+	m_path += "/";
+
+	// The cache holds the result of the import below, keyed by everything that affects it
+	const auto& cacheDir{ ResourceManager::GetInstance().GetMeshCacheDirectory() };
+	const auto vertexFormat{ ResourceManager::GetInstance().GetVertexFormat() };
+	std::filesystem::path cachePath;
+	std::uint64_t cacheKey{ 0 };
+	if (!cacheDir.empty()) {
+		cacheKey = MeshCache::ComputeKey(Path, importFlags, loadMaterial, vertexFormat);
+		cachePath = MeshCache::GetCachePath(cacheDir, Path, cacheKey);
+
+		// Stays mapped, evicted mesh buffers are refilled from it
+		auto cache{ std::make_shared<MeshCache>() };
+		if (cache->Load(cachePath, cacheKey)) {
+			PROFILE_SCOPE("Upload cached meshes");
+			createMeshes(*cache);
+			m_meshSource = std::move(cache);
+			return true;
+		}
 	}
 
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFile(Path.data(), importFlags);
+
 	// Check if scene is not null and model is done loading
 	if (!scene || scene->mFlags == AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
 		std::cerr << "Assimp Error for " << m_name << ": " << importer.GetErrorString() << '\n';
@@ -114,136 +158,141 @@ bool Model::loadModel(const std::string_view Path, const bool flipWindingOrder,
 		return false;
 	}
 
-	m_path = Path.substr(0, Path.find_last_of('/')); // Strip the model file name and keep the model folder.
-	m_path += "/";
-	
-	processNode(scene->mRootNode, scene, loadMaterial);
-
+	MeshCache cache(vertexFormat);
+	importMeshes(scene, loadMaterial, cache);
 	importer.FreeScene();
+
+	if (!cachePath.empty() && cache.Save(cachePath, cacheKey)) {
+		std::cout << "Mesh cache: wrote " << cachePath << '\n';
+
+		// Refilled from the file rather than by keeping the imported data in memory
+		auto mapped{ std::make_shared<MeshCache>() };
+		if (mapped->Load(cachePath, cacheKey)) {
+			m_meshSource = std::move(mapped);
+		}
+	}
+
+	createMeshes(cache);
 	return true;
 }
 
 /***********************************************************************************/
-void Model::processNode(aiNode* node, const aiScene* scene, const bool loadMaterial) {
+void Model::importMeshes(const aiScene* scene, const bool loadMaterial, MeshCache& cache) const {
+	PROFILE_FUNCTION();
 
-	// Process all node meshes
-	concurrency::parallel_for(static_cast<unsigned int>(0), node->mNumMeshes, [&](const auto idx)
-	{
-		auto* mesh = scene->mMeshes[node->mMeshes[idx]];
-		m_meshes.push_back(processMesh(mesh, scene, loadMaterial));
+	std::vector<unsigned int> meshes;
+	collectMeshes(scene->mRootNode, meshes);
+
+	auto& jobSystem{ JobSystem::GetInstance() };
+
+	// Sizes first, so nothing grows while converting
+	std::vector<std::size_t> numIndices(meshes.size());
+	jobSystem.ParallelFor(meshes.size(), 1, [&](const auto begin, const auto end) {
+		for (auto i = begin; i < end; ++i) {
+			numIndices[i] = MeshData::CountIndices(scene->mMeshes[meshes[i]]);
+		}
 	});
 
-	// Process their children via recursive tree traversal
-	for (auto i = 0; i < node->mNumChildren; ++i) {
-		processNode(node->mChildren[i], scene, loadMaterial);
+	// Layout and materials in node order, the material cache isn't thread-safe
+	const auto firstSubmesh{ cache.GetSubmeshes().size() };
+	for (std::size_t i = 0; i < meshes.size(); ++i) {
+		const auto* mesh{ scene->mMeshes[meshes[i]] };
+		const auto material{ loadMaterial ? cache.AddMaterial(getMaterial(mesh, scene)) : -1 };
+		cache.ReserveSubmesh(mesh->mNumVertices, static_cast<std::uint32_t>(numIndices[i]), material);
 	}
+	cache.Allocate();
+
+	// Every mesh encodes its own range, through scratch arrays reused within a job
+	jobSystem.ParallelFor(meshes.size(), 1, [&](const auto begin, const auto end) {
+		std::vector<Vertex> vertices;
+		std::vector<GLuint> indices;
+		for (auto i = begin; i < end; ++i) {
+			const auto* mesh{ scene->mMeshes[meshes[i]] };
+			vertices.resize(mesh->mNumVertices);
+			indices.resize(numIndices[i]);
+			const auto bounds{ MeshData::Convert(mesh, loadMaterial, vertices.data(), indices.data()) };
+			cache.SetSubmesh(firstSubmesh + i, vertices.data(), indices.data(), bounds);
+		}
+	});
 }
 
 /***********************************************************************************/
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene, const bool loadMaterial) {
-	std::vector<Vertex> vertices;
-	glm::vec3 min, max;
+void Model::collectMeshes(const aiNode* node, std::vector<unsigned int>& meshes) {
+	meshes.insert(meshes.end(), node->mMeshes, node->mMeshes + node->mNumMeshes);
+
+	for (auto i = 0; i < node->mNumChildren; ++i) {
+		collectMeshes(node->mChildren[i], meshes);
+	}
+}
 
-	for (auto i = 0; i < mesh->mNumVertices; ++i) {
-		Vertex vertex;
+/***********************************************************************************/
+MeshCache::Material Model::getMaterial(const aiMesh* mesh, const aiScene* scene) const {
+	// http://assimp.sourceforge.net/lib_html/structai_material.html
+	const auto* mat = scene->mMaterials[mesh->mMaterialIndex];
 
-		if (mesh->HasPositions()) {
-			vertex.Position.x = mesh->mVertices[i].x;
-			vertex.Position.y = mesh->mVertices[i].y;
-			vertex.Position.z = mesh->mVertices[i].z;
+	aiString name;
+	mat->Get(AI_MATKEY_NAME, name);
 
-			// Construct bounding box
-			if (vertex.Position.x < min.x) min.x = vertex.Position.x;
-			if (vertex.Position.x > max.x) max.x = vertex.Position.x;
+	// Get the first texture for each texture type we need
+	// since there could be multiple textures per type
+	aiString albedoPath;
+	mat->GetTexture(aiTextureType_DIFFUSE, 0, &albedoPath);
 
-			if (vertex.Position.y < min.y) min.y = vertex.Position.y;
-			if (vertex.Position.y > max.y) max.y = vertex.Position.y;
+	aiString metallicPath;
+	mat->GetTexture(aiTextureType_AMBIENT, 0, &metallicPath);
 
-			if (vertex.Position.z < min.z) min.z = vertex.Position.z;
-			if (vertex.Position.z > max.z) max.z = vertex.Position.z;
+	aiString normalPath;
+	mat->GetTexture(aiTextureType_HEIGHT, 0, &normalPath);
 
-		}
+	aiString roughnessPath;
+	mat->GetTexture(aiTextureType_SHININESS, 0, &roughnessPath);
 
-		if (mesh->HasNormals()) {
-			vertex.Normal.x = mesh->mNormals[i].x;
-			vertex.Normal.y = mesh->mNormals[i].y;
-			vertex.Normal.z = mesh->mNormals[i].z;
-		}
+	aiString alphaMaskPath;
+	mat->GetTexture(aiTextureType_OPACITY, 0, &alphaMaskPath);
 
-		if (mesh->HasTangentsAndBitangents()) {
-			vertex.Tangent.x = mesh->mTangents[i].x;
-			vertex.Tangent.y = mesh->mTangents[i].y;
-			vertex.Tangent.z = mesh->mTangents[i].z;
-		}
+	return { name.C_Str(),
+		m_path + albedoPath.C_Str(),
+		m_path + metallicPath.C_Str(),
+		m_path + normalPath.C_Str(),
+		m_path + roughnessPath.C_Str(),
+		m_path + alphaMaskPath.C_Str() };
+}
 
-		if (mesh->HasTextureCoords(0) && loadMaterial) {
-			// Just take the first set of texture coords (since we could have up to 8)
-			vertex.TexCoords.x = mesh->mTextureCoords[0][i].x;
-			vertex.TexCoords.y = mesh->mTextureCoords[0][i].y;
-		} else { 
-			vertex.TexCoords = glm::vec2(0.0f);
+/***********************************************************************************/
+void Model::createMeshes(const MeshCache& cache) {
+	// The material cache and GL objects aren't thread-safe, so this stays on the calling thread
+	const auto& materials{ cache.GetMaterials() };
+	std::vector<PBRMaterialPtr> resolved(materials.size());
+	for (std::size_t i = 0; i < materials.size(); ++i) {
+		const auto& material{ materials[i] };
+
+		// Is the material cached?
+		const auto cachedMaterial = ResourceManager::GetInstance().GetMaterial(material.Name);
+		if (cachedMaterial.has_value()) {
+			resolved[i] = cachedMaterial.value();
+			continue;
 		}
 
-		vertices.push_back(vertex);
+		resolved[i] = ResourceManager::GetInstance().CacheMaterial(material.Name,
+			material.AlbedoPath,
+			"",
+			material.MetallicPath,
+			material.NormalPath,
+			material.RoughnessPath,
+			material.AlphaMaskPath);
+		++m_numMats;
 	}
 
-	// Resize the bounding box
-	m_aabb.extend(min);
-	m_aabb.extend(max);
-
-	// Get indices from each face
-	std::vector<GLuint> indices;
-	for (auto i = 0; i < mesh->mNumFaces; ++i) {
-		const auto face = mesh->mFaces[i];
-		for (auto j = 0; j < face.mNumIndices; ++j) {
-			indices.emplace_back(face.mIndices[j]);
-		}
-	}
+	// Already in the GPU layout, uploaded as is
+	m_meshes.reserve(m_meshes.size() + cache.GetSubmeshes().size());
+	for (const auto& submesh : cache.GetSubmeshes()) {
+		m_meshes.emplace_back(cache.GetVertices(submesh), submesh.NumVertices, cache.GetIndices(submesh), submesh.NumIndices, submesh.IndexType,
+			submesh.MaterialIndex >= 0 ? resolved[submesh.MaterialIndex] : nullptr, cache.GetFormat(), submesh.PositionRange);
 
-	// Process material
-	// http://assimp.sourceforge.net/lib_html/structai_material.html
-	if (loadMaterial) {
-		if (mesh->mMaterialIndex >= 0) {
-			const auto* mat = scene->mMaterials[mesh->mMaterialIndex];
-
-			aiString name;
-			mat->Get(AI_MATKEY_NAME, name);
-
-			// Is the material cached?
-			const auto cachedMaterial = ResourceManager::GetInstance().GetMaterial(name.C_Str());
-			if (cachedMaterial.has_value()) {
-				return Mesh(vertices, indices, cachedMaterial.value());
-			}
-
-			// Get the first texture for each texture type we need
-			// since there could be multiple textures per type
-			aiString albedoPath;
-			mat->GetTexture(aiTextureType_DIFFUSE, 0, &albedoPath);
-
-			aiString metallicPath;
-			mat->GetTexture(aiTextureType_AMBIENT, 0, &metallicPath);
-
-			aiString normalPath;
-			mat->GetTexture(aiTextureType_HEIGHT, 0, &normalPath);
-
-			aiString roughnessPath;
-			mat->GetTexture(aiTextureType_SHININESS, 0, &roughnessPath);
-
-			aiString alphaMaskPath;
-			mat->GetTexture(aiTextureType_OPACITY, 0, &alphaMaskPath);
-
-			const auto newMaterial = ResourceManager::GetInstance().CacheMaterial(name.C_Str(),
-				m_path + albedoPath.C_Str(),
-				"",
-				m_path + metallicPath.C_Str(),
-				m_path + normalPath.C_Str(),
-				m_path + roughnessPath.C_Str(),
-				m_path + alphaMaskPath.C_Str());
-
-			++m_numMats;
-			return Mesh(vertices, indices, newMaterial);
+		// Meshes without positions have no bounds
+		if (submesh.BoundsMin.x <= submesh.BoundsMax.x) {
+			m_meshes.back().Bounds = AABB(submesh.BoundsMin, submesh.BoundsMax);
+			m_aabb.extend(m_meshes.back().Bounds);
 		}
 	}
-
-	return Mesh(vertices, indices);
 }
@@ -3,6 +3,8 @@
 #include <glm/mat4x4.hpp>
 
 #include "Mesh.h"
+#include "MeshData.h"
+#include "MeshCache.h"
 #include "AABB.hpp"
 
 #include <memory>
@@ -30,16 +32,31 @@ public:
 	// Destroys all OpenGL handles for all submeshes. This should only be called by ResourceManager.
 	void Delete();
 
-	auto GetMeshes() const noexcept { return m_meshes; }
+	// Mesh buffers can be freed and filled again from the mapped mesh cache, for meshes loaded
+	// from one. GL thread. Evict returns the bytes freed, reload the bytes uploaded.
+	bool CanReloadMesh(const std::size_t index) const noexcept;
+	std::size_t EvictMesh(const std::size_t index) noexcept;
+	std::size_t ReloadMesh(const std::size_t index) noexcept;
+
+	const auto& GetMeshes() const noexcept { return m_meshes; }
 	auto GetBoundingBox() const noexcept { return m_aabb; }
 
 protected:
 	std::vector<Mesh> m_meshes;
 
 private:
+	// Loads the compiled mesh cache if it is current, otherwise imports with Assimp and writes the cache
 	bool loadModel(const std::string_view Path, const bool flipWindingOrder, const bool loadMaterial);
-	void processNode(aiNode* node, const aiScene* scene, const bool loadMaterial);
-	Mesh processMesh(aiMesh* mesh, const aiScene* scene, const bool loadMaterial);
+	// Converts every mesh of the scene into the cache, in node order. Index counts and vertex data
+	// are converted on the job system straight into the preallocated cache arrays, the layout and
+	// materials in order on this thread, so the cache is identical however the jobs run.
+	void importMeshes(const aiScene* scene, const bool loadMaterial, MeshCache& cache) const;
+	// Meshes of a node and its children in depth first order
+	static void collectMeshes(const aiNode* node, std::vector<unsigned int>& meshes);
+	// Texture paths of a mesh's material
+	MeshCache::Material getMaterial(const aiMesh* mesh, const aiScene* scene) const;
+	// Resolves the materials and creates the OpenGL buffers. Must be called on the GL thread.
+	void createMeshes(const MeshCache& cache);
 	
 	// Transformation data
 	glm::vec3 m_scale, m_position, m_axis;
@@ -53,6 +70,9 @@ private:
 	std::string m_path;
 
 	std::size_t m_numMats;
+
+	// Mapped cache the meshes were created from, null without a mesh cache. Submesh i is m_meshes[i].
+	std::shared_ptr<const MeshCache> m_meshSource;
 };
 
 using ModelPtr = std::shared_ptr<Model>;
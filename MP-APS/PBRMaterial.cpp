@@ -20,13 +20,16 @@ void PBRMaterial::Init(const std::string_view name,
 {
 	Name = name;
 
-	m_materialTextures[ALBEDO] = ResourceManager::GetInstance().LoadTexture(albedoPath);
-	m_materialTextures[AO] = ResourceManager::GetInstance().LoadTexture(aoPath);
-	m_materialTextures[METALLIC] = ResourceManager::GetInstance().LoadTexture(metallicPath);
-	m_materialTextures[NORMAL] = ResourceManager::GetInstance().LoadTexture(normalPath);
-	m_materialTextures[ROUGHNESS] = ResourceManager::GetInstance().LoadTexture(roughnessPath);
+	using Semantic = TextureCompressor::Semantic;
+	auto& resources{ ResourceManager::GetInstance() };
+
+	m_materialTextures[ALBEDO] = resources.LoadCompressedTexture(albedoPath, Semantic::Albedo);
+	m_materialTextures[AO] = resources.LoadCompressedTexture(aoPath, Semantic::Mask);
+	m_materialTextures[METALLIC] = resources.LoadCompressedTexture(metallicPath, Semantic::Mask);
+	m_materialTextures[NORMAL] = resources.LoadCompressedTexture(normalPath, Semantic::Normal);
+	m_materialTextures[ROUGHNESS] = resources.LoadCompressedTexture(roughnessPath, Semantic::Mask);
 	
-	m_alpha = ResourceManager::GetInstance().LoadTexture(alphaMaskPath);
+	m_alpha = resources.LoadCompressedTexture(alphaMaskPath, Semantic::Mask);
 }
 
 /***********************************************************************************/
@@ -0,0 +1,265 @@
+#include "RegressionGate.h"
+
+#include <pugixml.hpp>
+#include <stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+	/***********************************************************************************/
+	// sRGB to CIELAB (D65 white). Differences in Lab roughly match perceived differences,
+	// so dark and bright regions get the same tolerance.
+	std::array<float, 3> toLab(const std::uint8_t* rgb) {
+		static const auto linear{ [] {
+			std::array<float, 256> table{};
+			for (std::size_t i = 0; i < table.size(); ++i) {
+				const auto c{ static_cast<float>(i) / 255.0f };
+				table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			return table;
+		}() };
+
+		const auto r{ linear[rgb[0]] }, g{ linear[rgb[1]] }, b{ linear[rgb[2]] };
+		const std::array<float, 3> xyz{
+			(0.4124f * r + 0.3576f * g + 0.1805f * b) / 0.95047f,
+			0.2126f * r + 0.7152f * g + 0.0722f * b,
+			(0.0193f * r + 0.1192f * g + 0.9505f * b) / 1.08883f
+		};
+
+		std::array<float, 3> f;
+		for (std::size_t i = 0; i < 3; ++i) {
+			f[i] = xyz[i] > 0.008856f ? std::cbrt(xyz[i]) : 7.787f * xyz[i] + 16.0f / 116.0f;
+		}
+
+		return { 116.0f * f[1] - 16.0f, 500.0f * (f[0] - f[1]), 200.0f * (f[1] - f[2]) };
+	}
+
+	/***********************************************************************************/
+	std::string formatNumber(const double value) {
+		std::ostringstream out;
+		out << std::setprecision(4) << value;
+		return out.str();
+	}
+}
+
+/***********************************************************************************/
+void RegressionGate::Init(const pugi::xml_node& regressionNode, const bool update) {
+	m_update = update;
+	m_goldenDir = regressionNode.attribute("golden").as_string("Data/Regression");
+	m_baselinePath = regressionNode.attribute("baseline").as_string("Data/Regression/baseline.xml");
+	m_outputDir = regressionNode.attribute("output").as_string("regression");
+	m_settleFrames = std::max<std::size_t>(regressionNode.attribute("settleFrames").as_uint(8), 1);
+	m_maxDeltaE = regressionNode.attribute("deltaE").as_double(6.0);
+	m_maxBadPixels = regressionNode.attribute("maxBadPixels").as_double(0.005);
+	m_timeTolerance = regressionNode.attribute("timeTolerance").as_double(0.25);
+	m_timeSlackMs = regressionNode.attribute("timeSlackMs").as_double(0.5);
+	m_countTolerance = regressionNode.attribute("countTolerance").as_double(0.0);
+
+	m_views.clear();
+	for (const auto& viewNode : regressionNode.children("View")) {
+		View view{ viewNode.attribute("name").as_string(), glm::vec3(0.0f), viewNode.attribute("yaw").as_float(-90.0f), viewNode.attribute("pitch").as_float() };
+
+		std::istringstream position(viewNode.attribute("position").as_string("0 0 0"));
+		position >> view.Position.x >> view.Position.y >> view.Position.z;
+
+		m_views.push_back(std::move(view));
+	}
+
+	m_checks.clear();
+}
+
+/***********************************************************************************/
+void RegressionGate::CheckImage(const View& view, const std::vector<std::uint8_t>& pixels, const int width, const int height) {
+	const auto goldenPath{ m_goldenDir / (view.Name + ".png") };
+	const auto checkName{ "image " + view.Name };
+
+	if (m_update) {
+		std::filesystem::create_directories(m_goldenDir);
+		const auto written{ stbi_write_png(goldenPath.string().c_str(), width, height, 4, pixels.data(), width * 4) != 0 };
+		m_checks.push_back({ checkName, written ? Status::Passed : Status::Failed, written ? "golden updated" : "failed to write " + goldenPath.string() });
+		return;
+	}
+
+	int goldenWidth, goldenHeight, channels;
+	auto* golden{ stbi_load(goldenPath.string().c_str(), &goldenWidth, &goldenHeight, &channels, 4) };
+	if (golden == nullptr) {
+		m_checks.push_back({ checkName, Status::Missing, "no golden image at " + goldenPath.string() + ", run with --update-golden" });
+		return;
+	}
+	if (goldenWidth != width || goldenHeight != height) {
+		stbi_image_free(golden);
+		m_checks.push_back({ checkName, Status::Failed, "size " + std::to_string(width) + 'x' + std::to_string(height) +
+			", golden is " + std::to_string(goldenWidth) + 'x' + std::to_string(goldenHeight) });
+		return;
+	}
+
+	std::vector<std::uint8_t> diffImage;
+	const auto numPixels{ static_cast<std::size_t>(width) * height };
+	const auto diff{ compareImages(golden, pixels.data(), numPixels, diffImage) };
+	stbi_image_free(golden);
+
+	const auto badFraction{ static_cast<double>(diff.BadPixels) / static_cast<double>(numPixels) };
+	const auto passed{ badFraction <= m_maxBadPixels };
+	auto detail{ formatNumber(badFraction * 100.0) + "% pixels over dE " + formatNumber(m_maxDeltaE) +
+		" (limit " + formatNumber(m_maxBadPixels * 100.0) + "%), mean dE " + formatNumber(diff.MeanDeltaE) + ", max dE " + formatNumber(diff.MaxDeltaE) };
+
+	// Keep what was rendered next to the differences for inspection
+	if (!passed) {
+		std::filesystem::create_directories(m_outputDir);
+		const auto actualPath{ m_outputDir / (view.Name + ".png") };
+		const auto diffPath{ m_outputDir / (view.Name + ".diff.png") };
+		stbi_write_png(actualPath.string().c_str(), width, height, 4, pixels.data(), width * 4);
+		stbi_write_png(diffPath.string().c_str(), width, height, 4, diffImage.data(), width * 4);
+		detail += ", see " + diffPath.string();
+	}
+
+	m_checks.push_back({ checkName, passed ? Status::Passed : Status::Failed, std::move(detail) });
+}
+
+/***********************************************************************************/
+void RegressionGate::CheckMetrics(const std::vector<Benchmark::Metric>& metrics, const std::string_view renderer) {
+	if (m_update) {
+		updateBaseline(metrics, renderer);
+		return;
+	}
+
+	pugi::xml_document doc;
+	if (!doc.load_file(m_baselinePath.c_str())) {
+		m_checks.push_back({ "baseline", Status::Missing, "no baseline at " + m_baselinePath.string() + ", run with --update-golden" });
+		return;
+	}
+
+	const auto& baselineNode{ doc.child("Baseline") };
+	const std::string_view baselineRenderer{ baselineNode.attribute("renderer").as_string() };
+	const auto compareTimings{ baselineRenderer == renderer };
+	if (!compareTimings) {
+		std::cout << "Regression: baseline was recorded on " << baselineRenderer << ", not " << renderer << ". Timings are not compared.\n";
+	}
+
+	for (const auto& metric : metrics) {
+		if (isTiming(metric.Name) && !compareTimings) {
+			continue;
+		}
+
+		const auto& metricNode{ baselineNode.find_child_by_attribute("Metric", "name", metric.Name.c_str()) };
+		if (!metricNode) {
+			m_checks.push_back({ metric.Name, Status::Missing, "missing from the baseline, run with --update-golden" });
+			continue;
+		}
+
+		const auto baseline{ metricNode.attribute("value").as_double() };
+		const auto tolerance{ metricNode.attribute("tolerance").as_double() };
+		const auto slack{ metricNode.attribute("slack").as_double() };
+		const auto limit{ baseline * (1.0 + tolerance) + slack };
+		const auto change{ baseline > 0.0 ? (metric.Value / baseline - 1.0) * 100.0 : 0.0 };
+
+		m_checks.push_back({ metric.Name, metric.Value <= limit ? Status::Passed : Status::Failed, formatNumber(metric.Value) + " vs baseline " + formatNumber(baseline) +
+			" (" + (change >= 0.0 ? "+" : "") + formatNumber(change) + "%, limit " + formatNumber(limit) + ')' });
+	}
+}
+
+/***********************************************************************************/
+void RegressionGate::PrintSummary(std::ostream& out) const {
+	const auto count = [this](const Status state) {
+		return std::count_if(m_checks.cbegin(), m_checks.cend(), [state](const auto& check) { return check.State == state; });
+	};
+
+	out << "**************************************************\n";
+	out << "Regression " << (m_update ? "update" : "gate") << ": " << count(Status::Passed) << " passed, " << count(Status::Failed) << " failed, "
+		<< count(Status::Missing) << " not configured\n";
+	for (const auto state : { Status::Failed, Status::Missing, Status::Passed }) {
+		for (const auto& check : m_checks) {
+			if (check.State == state) {
+				const auto* label{ state == Status::Failed ? "  FAIL  " : state == Status::Missing ? "  MISS  " : "  ok    " };
+				out << label << std::left << std::setw(24) << check.Name << std::right << check.Detail << '\n';
+			}
+		}
+	}
+}
+
+/***********************************************************************************/
+RegressionGate::Result RegressionGate::GetResult() const noexcept {
+	const auto any = [this](const Status state) {
+		return std::any_of(m_checks.cbegin(), m_checks.cend(), [state](const auto& check) { return check.State == state; });
+	};
+
+	if (any(Status::Failed)) {
+		return Result::Failed;
+	}
+	return any(Status::Missing) ? Result::NotConfigured : Result::Passed;
+}
+
+/***********************************************************************************/
+RegressionGate::ImageDiff RegressionGate::compareImages(const std::uint8_t* a, const std::uint8_t* b, const std::size_t numPixels, std::vector<std::uint8_t>& diffImage) const {
+	ImageDiff diff;
+	diffImage.resize(numPixels * 4);
+
+	double sum{ 0.0 };
+	for (std::size_t i = 0; i < numPixels; ++i) {
+		const auto labA{ toLab(a + i * 4) };
+		const auto labB{ toLab(b + i * 4) };
+		const auto deltaE{ std::sqrt((labA[0] - labB[0]) * (labA[0] - labB[0]) + (labA[1] - labB[1]) * (labA[1] - labB[1]) + (labA[2] - labB[2]) * (labA[2] - labB[2])) };
+
+		sum += deltaE;
+		diff.MaxDeltaE = std::max(diff.MaxDeltaE, static_cast<double>(deltaE));
+
+		auto* out{ &diffImage[i * 4] };
+		if (deltaE > m_maxDeltaE) {
+			++diff.BadPixels;
+			out[0] = 255;
+			out[1] = 0;
+			out[2] = 0;
+		}
+		else {
+			out[0] = b[i * 4] / 4;
+			out[1] = b[i * 4 + 1] / 4;
+			out[2] = b[i * 4 + 2] / 4;
+		}
+		out[3] = 255;
+	}
+
+	diff.MeanDeltaE = numPixels > 0 ? sum / static_cast<double>(numPixels) : 0.0;
+	return diff;
+}
+
+/***********************************************************************************/
+void RegressionGate::updateBaseline(const std::vector<Benchmark::Metric>& metrics, const std::string_view renderer) {
+	// Tolerances are kept, they are tuned by hand
+	pugi::xml_document previous;
+	previous.load_file(m_baselinePath.c_str());
+	const auto& previousNode{ previous.child("Baseline") };
+
+	pugi::xml_document doc;
+	auto baselineNode{ doc.append_child("Baseline") };
+	baselineNode.append_attribute("renderer") = std::string(renderer).c_str();
+
+	for (const auto& metric : metrics) {
+		const auto& previousMetric{ previousNode.find_child_by_attribute("Metric", "name", metric.Name.c_str()) };
+		const auto timing{ isTiming(metric.Name) };
+
+		auto metricNode{ baselineNode.append_child("Metric") };
+		metricNode.append_attribute("name") = metric.Name.c_str();
+		metricNode.append_attribute("value") = metric.Value;
+		metricNode.append_attribute("tolerance") = previousMetric.attribute("tolerance").as_double(timing ? m_timeTolerance : m_countTolerance);
+		metricNode.append_attribute("slack") = previousMetric.attribute("slack").as_double(timing ? m_timeSlackMs : 0.0);
+	}
+
+	if (m_baselinePath.has_parent_path()) {
+		std::filesystem::create_directories(m_baselinePath.parent_path());
+	}
+	const auto saved{ doc.save_file(m_baselinePath.c_str(), "    ") };
+	m_checks.push_back({ "baseline", saved ? Status::Passed : Status::Failed, saved ? "updated " + m_baselinePath.string() : "failed to write " + m_baselinePath.string() });
+}
+
+/***********************************************************************************/
+bool RegressionGate::isTiming(const std::string_view metric) noexcept {
+	constexpr std::string_view suffix{ "_ms" };
+	return metric.size() >= suffix.size() && metric.substr(metric.size() - suffix.size()) == suffix;
+}
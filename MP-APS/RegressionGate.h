@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Benchmark.h"
+
+#include <glm/vec3.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/***********************************************************************************/
+// Forward Declarations
+namespace pugi {
+class xml_node;
+}
+
+/***********************************************************************************/
+// Checks a benchmark run against checked-in references: fixed camera views against golden
+// images, and the benchmark's metrics against a baseline with a tolerance per metric.
+// In update mode the references are rewritten from the run instead. Missing references are
+// reported as not configured rather than as regressions.
+class RegressionGate {
+public:
+	enum class Result : std::uint8_t {
+		Passed,
+		Failed,			// At least one check regressed
+		NotConfigured	// Nothing regressed, but references are missing
+	};
+
+	struct View {
+		std::string Name;	// Golden image is <golden>/<Name>.png
+		glm::vec3 Position;
+		float Yaw, Pitch;	// Degrees
+	};
+
+	// Reads <Regression golden baseline output settleFrames deltaE maxBadPixels ...> and its <View/> children
+	void Init(const pugi::xml_node& regressionNode, const bool update);
+
+	const auto& GetViews() const noexcept { return m_views; }
+	// Frames rendered at a view before it is captured, lets temporal effects converge
+	auto GetSettleFrames() const noexcept { return m_settleFrames; }
+
+	// Compares RGBA8 pixels (top row first) with the view's golden image. Pixels further than
+	// deltaE apart in CIELAB count as different, the view fails if more than maxBadPixels of them do.
+	void CheckImage(const View& view, const std::vector<std::uint8_t>& pixels, const int width, const int height);
+	// Fails metrics over baseline * (1 + tolerance) + slack. Timings are only compared if the
+	// baseline was recorded on the same renderer.
+	void CheckMetrics(const std::vector<Benchmark::Metric>& metrics, const std::string_view renderer);
+
+	// One line per check, failures first, then missing references
+	void PrintSummary(std::ostream& out) const;
+	Result GetResult() const noexcept;
+
+private:
+	enum class Status : std::uint8_t {
+		Passed,
+		Failed,
+		Missing		// No reference to compare with
+	};
+
+	struct Check {
+		std::string Name;
+		Status State;
+		std::string Detail;
+	};
+
+	struct ImageDiff {
+		double MaxDeltaE{ 0.0 };
+		double MeanDeltaE{ 0.0 };
+		std::size_t BadPixels{ 0 };
+	};
+
+	// Per-pixel CIE76 difference, marks pixels over deltaE in red on a dimmed copy of b
+	ImageDiff compareImages(const std::uint8_t* a, const std::uint8_t* b, const std::size_t numPixels, std::vector<std::uint8_t>& diffImage) const;
+	void updateBaseline(const std::vector<Benchmark::Metric>& metrics, const std::string_view renderer);
+	static bool isTiming(const std::string_view metric) noexcept;
+
+	bool m_update{ false };
+	std::filesystem::path m_goldenDir;
+	std::filesystem::path m_baselinePath;
+	std::filesystem::path m_outputDir;	// Actual and diff images of failed views
+	std::size_t m_settleFrames{ 0 };
+	double m_maxDeltaE{ 0.0 };
+	double m_maxBadPixels{ 0.0 };	// Fraction of the image
+	// Defaults for metrics that are new to the baseline
+	double m_timeTolerance{ 0.0 }, m_timeSlackMs{ 0.0 };
+	double m_countTolerance{ 0.0 };
+
+	std::vector<View> m_views;
+	std::vector<Check> m_checks;
+};
@@ -1,17 +1,121 @@
 #include "ResourceManager.h"
+#include "Core/Hash.h"
+#include "Core/JobSystem.h"
+#include "Core/Profiler.h"
+#include "Core/RenderSnapshot.h"
+#include "Graphics/KTX2Texture.h"
 
+#include <algorithm>
 #include <iostream>
+#include <iomanip>
 #include <sstream>
 #include <fstream>
 #include <cassert>
+#include <chrono>
 #include <string_view>
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STBI_FAILURE_USERMSG
 #include <stb_image.h>
 
+namespace {
+	/***********************************************************************************/
+	// 8 bits per channel with a full mip chain
+	std::size_t getUncompressedSize(const int width, const int height, const int channels) noexcept {
+		return static_cast<std::size_t>(width) * height * channels * 4 / 3;
+	}
+
+	/***********************************************************************************/
+	MipGenerator::ColorSpace getColorSpace(const TextureCompressor::Semantic semantic) noexcept {
+		switch (semantic) {
+		case TextureCompressor::Semantic::Albedo:
+			return MipGenerator::ColorSpace::SRGB;
+		case TextureCompressor::Semantic::Normal:
+			return MipGenerator::ColorSpace::Normal;
+		default:
+			return MipGenerator::ColorSpace::Linear;
+		}
+	}
+
+	/***********************************************************************************/
+	// Pixels as stored in the file, with mips if useMipMaps. No levels if it can't be read.
+	// Safe on any thread.
+	TextureUploader::Image decodeTexture(const std::string_view path, const bool useMipMaps, const MipGenerator::Filter filter, const MipGenerator::ColorSpace colorSpace) {
+		TextureUploader::Image image;
+
+		int nrComponents;
+		auto* data{ stbi_load(path.data(), &image.Width, &image.Height, &nrComponents, 0) };
+		if (!data) {
+			std::cerr << "Failed to load texture: " << path << std::endl;
+			return image;
+		}
+
+		switch (nrComponents) {
+		case 1:
+			image.PixelFormat = GL_RED;
+			break;
+		case 2:
+			image.PixelFormat = GL_RG;
+			break;
+		case 3:
+			image.PixelFormat = GL_RGB;
+			break;
+		case 4:
+			image.PixelFormat = GL_RGBA;
+			break;
+		}
+		image.InternalFormat = image.PixelFormat;
+
+		const auto size{ static_cast<std::size_t>(image.Width) * image.Height * nrComponents };
+		if (useMipMaps) {
+			for (auto& level : MipGenerator::Generate(data, image.Width, image.Height, nrComponents, filter, colorSpace)) {
+				image.Levels.push_back(std::move(level.Pixels));
+			}
+		}
+		else {
+			image.Levels.emplace_back(data, data + size);
+		}
+		image.UncompressedBytes = useMipMaps ? getUncompressedSize(image.Width, image.Height, nrComponents) : size;
+
+		stbi_image_free(data);
+
+		return image;
+	}
+
+	/***********************************************************************************/
+	// Uploads decoded levels from client memory into texture and returns their size
+	std::size_t uploadTexture(const GLuint texture, const TextureUploader::Image& image) {
+		// Rows of the levels are tightly packed
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		std::size_t residentBytes{ 0 };
+		glBindTexture(GL_TEXTURE_2D, texture);
+		for (std::size_t i = 0; i < image.Levels.size(); ++i) {
+			const auto level{ static_cast<int>(i) };
+			glTexImage2D(GL_TEXTURE_2D, level, image.InternalFormat, std::max(image.Width >> level, 1), std::max(image.Height >> level, 1),
+				0, image.PixelFormat, GL_UNSIGNED_BYTE, image.Levels[i].data());
+			residentBytes += image.Levels[i].size();
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.Levels.size() - 1));
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		return residentBytes;
+	}
+}
+
 /***********************************************************************************/
 void ResourceManager::ReleaseAllResources() {
+	// Loads still running would upload into deleted textures
+	JobSystem::GetInstance().Wait(m_textureJobs);
+	// Before the uploader, queued levels point at streamed textures
+	m_textureStreamer.Delete();
+	m_textureUploader.Delete();
+	m_residency.Delete();
+	m_textureSources.clear();
+	m_residentMeshes.clear();
+
 	// Delete cached meshes
 	for (auto& model : m_modelCache) {
 		model.second->Delete();
@@ -25,6 +129,7 @@ void ResourceManager::ReleaseAllResources() {
 
 /***********************************************************************************/
 std::string ResourceManager::LoadTextFile(const std::filesystem::path& path) const {
+	PROFILE_FUNCTION();
 	std::ifstream in(path, std::ios::in);
 	in.exceptions(std::ifstream::failbit | std::ifstream::badbit);
 
@@ -38,6 +143,7 @@ std::string ResourceManager::LoadTextFile(const std::filesystem::path& path) con
 
 /***********************************************************************************/
 unsigned int ResourceManager::LoadHDRI(const std::string_view path) const {
+	PROFILE_FUNCTION();
 	//stbi_set_flip_vertically_on_load(true);
 	
 	// Dont flip HDR otherwise the probe will be upside down. We flip the y-coord in the
@@ -72,7 +178,8 @@ unsigned int ResourceManager::LoadHDRI(const std::string_view path) const {
 }
 
 /***********************************************************************************/
-unsigned int ResourceManager::LoadTexture(const std::string_view path, const bool useMipMaps, const bool useUnalignedUnpack) {
+unsigned int ResourceManager::LoadTexture(const std::string_view path, const bool useMipMaps) {
+	PROFILE_FUNCTION();
 
 	// Check if texture is already loaded somewhere
 	const auto val = m_textureCache.find(path.data());
@@ -82,56 +189,448 @@ unsigned int ResourceManager::LoadTexture(const std::string_view path, const boo
 		return val->second;
 	}
 
-	if (useUnalignedUnpack) {
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	const auto image{ decodeTexture(path, useMipMaps, m_mipFilter, MipGenerator::ColorSpace::Linear) };
+	if (image.Levels.empty()) {
+		return 0;
 	}
 
 	// Create and cache a new texture
 	unsigned int textureID;
 	glGenTextures(1, &textureID);
 
+	const auto residentBytes{ uploadTexture(textureID, image) };
+	m_textureMemory.ResidentBytes += residentBytes;
+	m_textureMemory.UncompressedBytes += image.UncompressedBytes;
+
+	// Without mips there is nothing to drop
+	if (m_residency.IsEnabled() && useMipMaps) {
+		m_textureSources.try_emplace(textureID, TextureSource{ std::string(path) });
+		m_residency.Track(ResidencyManager::Type::Texture, textureID, residentBytes, true);
+	}
+
+#ifdef _DEBUG
+	std::cout << "Resource Manager: loaded texture: " << path << std::endl;
+#endif
+
+	return m_textureCache.try_emplace(path.data(), textureID).first->second;
+}
+
+/***********************************************************************************/
+unsigned int ResourceManager::LoadCompressedTexture(const std::string_view path, const TextureCompressor::Semantic semantic) {
+	PROFILE_FUNCTION();
+
+	const auto val = m_textureCache.find(path.data());
+	if (val != m_textureCache.end()) {
+		return val->second;
+	}
+
+	if (m_textureUploader.GetNumBuffers() == 0) {
+		m_textureUploader.Init(m_numUploadBuffers);
+	}
+
+	// The name is handed out right away, the texture is empty until its upload
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+
+	// Tracked once uploaded, unless it turns out to be streamed
+	if (m_residency.IsEnabled()) {
+		m_textureSources.try_emplace(textureID, TextureSource{ std::string(path), semantic, true });
+	}
+
+	if (m_asyncTextureLoads) {
+		if (!m_loadingTextures) {
+			m_loadingTextures = true;
+			m_textureLoadStart = std::chrono::steady_clock::now();
+			m_texturesAtLoadStart = m_textureCache.size();
+		}
+
+		JobSystem::GetInstance().Run([this, path = std::string(path), semantic, textureID]() {
+			auto texture{ prepareTexture(path, semantic) };
+			texture.Image.Texture = textureID;
+			submitTexture(std::move(texture));
+		}, &m_textureJobs);
+	}
+	else {
+		auto texture{ prepareTexture(path, semantic) };
+		texture.Image.Texture = textureID;
+		submitTexture(std::move(texture));
+		addUploadStats(m_textureUploader.Process(-1.0));
+	}
+
+	return m_textureCache.try_emplace(path.data(), textureID).first->second;
+}
+
+/***********************************************************************************/
+void ResourceManager::ProcessTextureUploads() {
+	PROFILE_FUNCTION();
+
+	m_textureMemory.ResidentBytes -= m_textureStreamer.Update();
+
+	// Checked before processing, everything submitted by then gets uploaded below
+	const auto decoded{ m_textureJobs.IsDone() };
+	addUploadStats(m_textureUploader.Process(m_uploadBudgetMs));
+
+	if (m_loadingTextures && decoded && m_textureUploader.IsEmpty()) {
+		finishTextureLoads();
+	}
+}
+
+/***********************************************************************************/
+void ResourceManager::FinishTextureUploads() {
+	if (!m_loadingTextures) {
+		return;
+	}
+
+	JobSystem::GetInstance().Wait(m_textureJobs);
+	addUploadStats(m_textureUploader.Process(-1.0));
+	finishTextureLoads();
+}
+
+/***********************************************************************************/
+void ResourceManager::SetTextureStreaming(const bool enabled, const std::size_t budgetBytes, const int tailSize, const std::size_t maxLoads, const float bias) {
+	if (!enabled) {
+		return;
+	}
+
+	// Levels are read back from the KTX2 cache
+	if (!m_compressTextures || m_textureCacheDir.empty()) {
+		std::cerr << "Resource Manager: texture streaming needs texture compression with a cache path, streaming is off\n";
+		return;
+	}
+
+	m_textureStreamer.Init(m_textureUploader, budgetBytes, tailSize, maxLoads, bias);
+}
+
+/***********************************************************************************/
+void ResourceManager::SetResidency(const bool enabled, const std::size_t budgetBytes) {
+	if (!enabled) {
+		return;
+	}
+
+	m_residency.Init(budgetBytes,
+		[this](const auto type, const auto name) { return evictResource(type, name); },
+		[this](const auto type, const auto name) { reloadResource(type, name); });
+}
+
+/***********************************************************************************/
+void ResourceManager::UpdateResidency(const RenderSnapshot& snapshot) {
+	if (!m_residency.IsEnabled()) {
+		return;
+	}
+	PROFILE_FUNCTION();
+
+	m_residency.BeginFrame();
+	for (const auto& instance : snapshot.Instances) {
+		for (const auto& mesh : instance.Model->GetMeshes()) {
+			m_residency.Use(ResidencyManager::Type::Mesh, mesh.VAO.GetHandle());
+			if (!mesh.Material) {
+				continue;
+			}
+
+			// The textures the renderer binds
+			for (const auto parameter : { PBRMaterial::ALBEDO, PBRMaterial::NORMAL, PBRMaterial::METALLIC, PBRMaterial::ROUGHNESS }) {
+				m_residency.Use(ResidencyManager::Type::Texture, mesh.Material->GetParameterTexture(parameter));
+			}
+		}
+	}
+
+	// Streamed textures count, but keep to their own budget
+	m_residency.Update(m_textureStreamer.GetStats().ResidentBytes);
+}
+
+/***********************************************************************************/
+void ResourceManager::SetTextureUploads(const bool async, const double budgetMs, const std::size_t numBuffers) {
+	m_asyncTextureLoads = async;
+	m_uploadBudgetMs = budgetMs;
+	m_numUploadBuffers = numBuffers;
+}
+
+/***********************************************************************************/
+void ResourceManager::SetTextureCompression(const bool enabled, const std::filesystem::path& dir, const bool preferBC7) {
+	m_compressTextures = enabled;
+	m_textureCacheDir = dir;
+	m_preferBC7 = preferBC7;
+}
+
+/***********************************************************************************/
+ResourceManager::PreparedTexture ResourceManager::prepareTexture(const std::string_view path, const TextureCompressor::Semantic semantic, const bool stream) const {
+	PreparedTexture texture;
+	if (!m_compressTextures) {
+		texture.Image = decodeTexture(path, true, m_mipFilter, getColorSpace(semantic));
+		return texture;
+	}
+
+	// Only the header, for the channel count of the source
 	int width, height, nrComponents;
-	unsigned char* data = stbi_load(path.data(), &width, &height, &nrComponents, 0);
-	if (!data) {
+	if (!stbi_info(path.data(), &width, &height, &nrComponents)) {
 		std::cerr << "Failed to load texture: " << path << std::endl;
-		stbi_image_free(data);
-		return 0;
+		return texture;
 	}
 
-	GLenum format = 0;
-	switch (nrComponents) {
-	case 1:
-		format = GL_RED;
-		break;
-	case 3:
-		format = GL_RGB;
-		break;
-	case 4:
-		format = GL_RGBA;
-		break;
+	const std::filesystem::path source(path);
+	auto key{ Hash::File(source) };
+	key = Hash::Value(semantic, key);
+	key = Hash::Value(m_preferBC7, key);
+	key = Hash::Value(TextureCompressor::Version, key);
+	key = Hash::Value(MipGenerator::Version, key);
+	key = Hash::Value(m_mipFilter, key);
+
+	std::ostringstream cacheName;
+	cacheName << source.stem().string() << '-' << std::hex << std::setw(16) << std::setfill('0') << key << ".ktx2";
+	texture.CachePath = m_textureCacheDir / cacheName.str();
+	texture.Key = key;
+
+	auto& image{ texture.Image };
+	// Streamed textures start with their mip tail, the rest is read from the cache file later
+	const auto firstLevel{ stream && m_textureStreamer.IsEnabled() ? m_textureStreamer.GetTailLevel(width, height) : 0 };
+
+	KTX2Texture cached;
+	if (!m_textureCacheDir.empty() && cached.Load(texture.CachePath, key) && TextureCompressor::IsSupported(cached.GetFormat())) {
+		texture.Format = cached.GetFormat();
+		image.InternalFormat = TextureCompressor::GetGLFormat(cached.GetFormat());
+		image.Width = cached.GetWidth();
+		image.Height = cached.GetHeight();
+		image.FirstLevel = std::min(firstLevel, static_cast<int>(cached.GetLevels().size()) - 1);
+		for (auto level = cached.GetLevels().cbegin() + image.FirstLevel; level != cached.GetLevels().cend(); ++level) {
+			const auto* data{ reinterpret_cast<const std::uint8_t*>(level->Data) };
+			image.Levels.emplace_back(data, data + level->Size);
+		}
+		texture.Streamed = image.FirstLevel > 0;
 	}
+	else {
+		auto* data{ stbi_load(path.data(), &width, &height, &nrComponents, 4) };
+		if (!data) {
+			std::cerr << "Failed to load texture: " << path << std::endl;
+			return texture;
+		}
+
+		auto hasAlpha{ false };
+		if (nrComponents == 2 || nrComponents == 4) {
+			for (std::size_t i = 3; i < static_cast<std::size_t>(width) * height * 4 && !hasAlpha; i += 4) {
+				hasAlpha = data[i] < 255;
+			}
+		}
+
+		// BC7 covers everything BC1 and BC3 do where S3TC is missing
+		auto format{ TextureCompressor::ChooseFormat(semantic, hasAlpha, m_preferBC7) };
+		if (!TextureCompressor::IsSupported(format)) {
+			format = TextureCompressor::Format::BC7;
+		}
+		if (!TextureCompressor::IsSupported(format)) {
+			stbi_image_free(data);
+			texture.Image = decodeTexture(path, true, m_mipFilter, getColorSpace(semantic));
+			return texture;
+		}
+
+		for (const auto& mip : MipGenerator::Generate(data, width, height, 4, m_mipFilter, getColorSpace(semantic))) {
+			image.Levels.push_back(TextureCompressor::Compress(mip.Pixels.data(), mip.Width, mip.Height, format));
+		}
+		stbi_image_free(data);
+
+		const auto cached{ !m_textureCacheDir.empty() && KTX2Texture::Write(texture.CachePath, format, width, height, key, image.Levels) };
+
+		std::cout << "Resource Manager: compressed texture: " << path << " (" << TextureCompressor::GetName(format) << ")\n";
 
-	glBindTexture(GL_TEXTURE_2D, textureID);
-	glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-	if (useMipMaps) {
-		glGenerateMipmap(GL_TEXTURE_2D);
+		texture.Format = format;
+		image.InternalFormat = TextureCompressor::GetGLFormat(format);
+		image.Width = width;
+		image.Height = height;
+
+		// Only streamed from a file that made it to disk
+		if (cached && firstLevel > 0) {
+			image.Levels.erase(image.Levels.begin(), image.Levels.begin() + firstLevel);
+			image.FirstLevel = firstLevel;
+			texture.Streamed = true;
+		}
 	}
 
-	stbi_image_free(data);
+	image.UncompressedBytes = getUncompressedSize(width, height, nrComponents);
 
 #ifdef _DEBUG
-	std::cout << "Resource Manager: loaded texture: " << path << std::endl;
+	std::cout << "Resource Manager: loaded compressed texture: " << path << std::endl;
 #endif
 
-	if (useUnalignedUnpack) {
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 0);
+	return texture;
+}
+
+/***********************************************************************************/
+void ResourceManager::submitTexture(PreparedTexture&& texture) {
+	if (texture.Streamed) {
+		m_textureStreamer.Add(std::move(texture.Image), texture.Format, texture.CachePath, texture.Key);
+	}
+	else {
+		m_textureUploader.Submit(std::move(texture.Image));
 	}
+}
 
-	return m_textureCache.try_emplace(path.data(), textureID).first->second;
+/***********************************************************************************/
+void ResourceManager::addUploadStats(const TextureUploader::Stats& stats) {
+	m_textureMemory.ResidentBytes += stats.ResidentBytes;
+	m_textureMemory.UncompressedBytes += stats.UncompressedBytes;
+
+	if (!m_residency.IsEnabled()) {
+		return;
+	}
+
+	for (const auto& upload : stats.Uploads) {
+		const auto source = m_textureSources.find(upload.Texture);
+		if (source == m_textureSources.end()) {
+			continue;
+		}
+
+		// The streamer manages the mips of its textures, they only count towards the budget as a whole
+		if (m_textureStreamer.IsStreamed(upload.Texture)) {
+			m_textureSources.erase(source);
+			continue;
+		}
+
+		// A reload replaces whatever was left of the texture
+		m_textureMemory.ResidentBytes -= m_residency.Track(ResidencyManager::Type::Texture, upload.Texture, upload.ResidentBytes, true);
+	}
+}
+
+/***********************************************************************************/
+std::size_t ResourceManager::evictResource(const ResidencyManager::Type type, const GLuint name) {
+	if (type == ResidencyManager::Type::Texture) {
+		const auto freed{ dropTextureLevel(name) };
+		m_textureMemory.ResidentBytes -= freed;
+		return freed;
+	}
+
+	const auto mesh = m_residentMeshes.find(name);
+	return mesh != m_residentMeshes.end() ? mesh->second.first->EvictMesh(mesh->second.second) : 0;
+}
+
+/***********************************************************************************/
+void ResourceManager::reloadResource(const ResidencyManager::Type type, const GLuint name) {
+	if (type == ResidencyManager::Type::Mesh) {
+		const auto mesh = m_residentMeshes.find(name);
+		if (mesh != m_residentMeshes.end()) {
+			// Straight from the mapped mesh cache, the mesh is drawn this frame
+			m_residency.Track(type, name, mesh->second.first->ReloadMesh(mesh->second.second), true);
+		}
+		return;
+	}
+
+	const auto source = m_textureSources.find(name);
+	if (source == m_textureSources.end()) {
+		return;
+	}
+
+	// Drawn from its remaining mips until the reload is uploaded
+	if (!source->second.Compressed) {
+		const auto image{ decodeTexture(source->second.Path, true, m_mipFilter, MipGenerator::ColorSpace::Linear) };
+		if (!image.Levels.empty()) {
+			const auto residentBytes{ uploadTexture(name, image) };
+			m_textureMemory.ResidentBytes += residentBytes;
+			m_textureMemory.ResidentBytes -= m_residency.Track(type, name, residentBytes, true);
+		}
+		return;
+	}
+
+	const auto prepare = [this, path = source->second.Path, semantic = source->second.Semantic, name]() {
+		auto texture{ prepareTexture(path, semantic, false) };
+		texture.Image.Texture = name;
+		// Counted by the first load
+		texture.Image.UncompressedBytes = 0;
+		m_textureUploader.Submit(std::move(texture.Image));
+	};
+
+	if (m_asyncTextureLoads) {
+		JobSystem::GetInstance().Run(prepare, &m_textureJobs);
+	}
+	else {
+		prepare();
+		addUploadStats(m_textureUploader.Process(-1.0));
+	}
+}
+
+/***********************************************************************************/
+std::size_t ResourceManager::dropTextureLevel(const GLuint texture) {
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	GLint baseLevel, maxLevel;
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, &baseLevel);
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+	// The texture has to stay complete
+	if (baseLevel >= maxLevel) {
+		return 0;
+	}
+
+	GLint compressed, internalFormat, width, height;
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, baseLevel, GL_TEXTURE_COMPRESSED, &compressed);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, baseLevel, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, baseLevel, GL_TEXTURE_WIDTH, &width);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, baseLevel, GL_TEXTURE_HEIGHT, &height);
+
+	std::size_t size;
+	if (compressed) {
+		GLint imageSize;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, baseLevel, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &imageSize);
+		size = imageSize;
+	}
+	else {
+		GLint bits{ 0 };
+		for (const auto component : { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE }) {
+			GLint componentBits;
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, baseLevel, component, &componentBits);
+			bits += componentBits;
+		}
+		size = static_cast<std::size_t>(width) * height * bits / 8;
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, baseLevel + 1);
+	// An empty image releases the level's storage
+	if (compressed) {
+		glCompressedTexImage2D(GL_TEXTURE_2D, baseLevel, internalFormat, 0, 0, 0, 0, nullptr);
+	}
+	else {
+		glTexImage2D(GL_TEXTURE_2D, baseLevel, internalFormat, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+
+	return size;
+}
+
+/***********************************************************************************/
+void ResourceManager::trackMeshes(Model& model) {
+	if (!m_residency.IsEnabled()) {
+		return;
+	}
+
+	const auto& meshes{ model.GetMeshes() };
+	for (std::size_t i = 0; i < meshes.size(); ++i) {
+		const auto& vao{ meshes[i].VAO };
+		m_residentMeshes.insert_or_assign(vao.GetHandle(), std::make_pair(&model, i));
+		m_residency.Track(ResidencyManager::Type::Mesh, vao.GetHandle(),
+			vao.GetBufferSize(GLVertexArray::BufferType::ARRAY) + vao.GetBufferSize(GLVertexArray::BufferType::ELEMENT), model.CanReloadMesh(i));
+	}
+}
+
+/***********************************************************************************/
+void ResourceManager::untrackMeshes(const Model& model) {
+	if (!m_residency.IsEnabled()) {
+		return;
+	}
+
+	for (const auto& mesh : model.GetMeshes()) {
+		m_residentMeshes.erase(mesh.VAO.GetHandle());
+		m_residency.Untrack(ResidencyManager::Type::Mesh, mesh.VAO.GetHandle());
+	}
+}
+
+/***********************************************************************************/
+void ResourceManager::finishTextureLoads() {
+	m_loadingTextures = false;
+
+	const auto elapsedMs{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_textureLoadStart).count() };
+	std::cout << "Resource Manager: loaded " << m_textureCache.size() - m_texturesAtLoadStart << " textures in " << elapsedMs << " ms on "
+		<< JobSystem::GetInstance().GetNumThreads() << " threads, VRAM " << m_textureMemory.ResidentBytes / (1024.0 * 1024.0) << " MB ("
+		<< m_textureMemory.UncompressedBytes / (1024.0 * 1024.0) << " MB uncompressed)\n";
 }
 
 /***********************************************************************************/
 std::vector<char> ResourceManager::LoadBinaryFile(const std::string_view path) const {
+	PROFILE_FUNCTION();
 	std::ifstream in(path.data(), std::ios::binary);
 	in.exceptions(std::ifstream::failbit | std::ifstream::badbit);
 
@@ -150,13 +649,16 @@ std::vector<char> ResourceManager::LoadBinaryFile(const std::string_view path) c
 
 /***********************************************************************************/
 ModelPtr ResourceManager::GetModel(const std::string_view name, const std::string_view path) {
+	PROFILE_FUNCTION();
 
 	// Check if model is already loaded.
 	const auto val = m_modelCache.find(path.data());
 
 	if (val == m_modelCache.end()) {
 		// Load model, cache it, and return a shared_ptr to it.
-		return m_modelCache.try_emplace(name.data(), std::make_shared<Model>(path, name)).first->second;
+		const auto& model{ m_modelCache.try_emplace(name.data(), std::make_shared<Model>(path, name)).first->second };
+		trackMeshes(*model);
+		return model;
 	}
 
 	return val->second;
@@ -164,10 +666,17 @@ ModelPtr ResourceManager::GetModel(const std::string_view name, const std::strin
 
 /***********************************************************************************/
 ModelPtr ResourceManager::CacheModel(const std::string_view name, const Model model, const bool overwriteIfExists) {
-	if (overwriteIfExists) {
-		return m_modelCache.insert_or_assign(name.data(), std::make_shared<Model>(model)).first->second;
+	const auto cached = m_modelCache.find(name.data());
+	if (cached != m_modelCache.end() && !overwriteIfExists) {
+		return cached->second;
 	}
-	return m_modelCache.try_emplace(name.data(), std::make_shared<Model>(model)).first->second;
+	if (cached != m_modelCache.end()) {
+		untrackMeshes(*cached->second);
+	}
+
+	const auto& added{ m_modelCache.insert_or_assign(name.data(), std::make_shared<Model>(model)).first->second };
+	trackMeshes(*added);
+	return added;
 }
 
 /***********************************************************************************/
@@ -196,6 +705,7 @@ void ResourceManager::UnloadModel(const std::string_view modelName) {
 	const auto model = m_modelCache.find(modelName.data());
 
 	if (model != m_modelCache.end()) {
+		untrackMeshes(*model->second);
 		model->second->Delete();
 
 		m_modelCache.erase(modelName.data());
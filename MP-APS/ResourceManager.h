@@ -1,10 +1,19 @@
 #pragma once
 
 #include "Model.h"
+#include "Core/JobSystem.h"
+#include "Graphics/MipGenerator.h"
+#include "Graphics/ResidencyManager.h"
+#include "Graphics/TextureCompressor.h"
+#include "Graphics/TextureStreamer.h"
+#include "Graphics/TextureUploader.h"
 
 #include <unordered_map>
 #include <optional>
 #include <filesystem>
+#include <chrono>
+
+struct RenderSnapshot;
 
 class ResourceManager {
 	ResourceManager() = default;
@@ -25,8 +34,21 @@ public:
 	std::string LoadTextFile(const std::filesystem::path& path) const;
 	// Loads an HDR image and generates an OpenGL floating-point texture.
 	unsigned int LoadHDRI(const std::string_view path) const;
-	// Loads an image (if not cached) and generates an OpenGL texture.
-	unsigned int LoadTexture(const std::string_view path, const bool useMipMaps = true, const bool useUnalignedUnpack = false);
+	// Loads an image (if not cached) and generates an OpenGL texture. Mips are generated on the
+	// CPU with the mip filter, treating the image as linear data.
+	unsigned int LoadTexture(const std::string_view path, const bool useMipMaps = true);
+	// Loads a block compressed texture with all mips from the texture cache, compressing and
+	// caching the image first if needed. Uncompressed with generated mips while compression is
+	// disabled. Mips of albedo are filtered in linear space, those of normal maps renormalised.
+	// With async uploads the image is prepared on the job system and the returned texture stays
+	// empty until ProcessTextureUploads() has uploaded it.
+	unsigned int LoadCompressedTexture(const std::string_view path, const TextureCompressor::Semantic semantic);
+	// GL thread, once per frame. Updates streaming and uploads prepared textures within the
+	// upload budget.
+	void ProcessTextureUploads();
+	// GL thread. Blocks until every texture requested so far is uploaded.
+	void FinishTextureUploads();
+	auto IsLoadingTextures() const noexcept { return m_loadingTextures; }
 	// Loads a binary file into a vector and returns it
 	std::vector<char> LoadBinaryFile(const std::string_view path) const;
 	
@@ -50,12 +72,109 @@ public:
 	// Removes a named model from cache.
 	void UnloadModel(const std::string_view modelName);
 
+	// Directory for compiled meshes, so models skip the Assimp import when their source hasn't
+	// changed. Empty disables the mesh cache.
+	void SetMeshCacheDirectory(const std::filesystem::path& dir) { m_meshCacheDir = dir; }
+	const auto& GetMeshCacheDirectory() const noexcept { return m_meshCacheDir; }
+	// GPU layout of the model meshes loaded from here on. Procedural meshes stay float.
+	void SetVertexFormat(const VertexCompressor::Format format) noexcept { m_vertexFormat = format; }
+	auto GetVertexFormat() const noexcept { return m_vertexFormat; }
+
+	// Compressed textures are cached in dir as KTX2 files keyed by their source. An empty
+	// directory compresses on every load. preferBC7 uses BC7 rather than BC1/BC3 for albedo.
+	void SetTextureCompression(const bool enabled, const std::filesystem::path& dir, const bool preferBC7);
+	// Filter for the mips of textures loaded from here on. Part of the texture cache key.
+	void SetMipFilter(const MipGenerator::Filter filter) noexcept { m_mipFilter = filter; }
+	// async prepares textures on the job system, budgetMs limits the time spent uploading per
+	// frame and numBuffers is the number of pixel unpack buffers used to stage them
+	void SetTextureUploads(const bool async, const double budgetMs, const std::size_t numBuffers);
+	// Material textures loaded from here on start with their mips up to tailSize texels and
+	// stream in the rest as needed, see TextureStreamer. Needs compression with a cache path.
+	void SetTextureStreaming(const bool enabled, const std::size_t budgetBytes, const int tailSize, const std::size_t maxLoads, const float bias);
+	// Screen coverage of the textures drawn this frame, any thread
+	void RequestTextureDetail(std::vector<TextureStreamer::Request>&& requests) { m_textureStreamer.SetRequests(std::move(requests)); }
+	auto IsStreamingTextures() const noexcept { return m_textureStreamer.IsEnabled(); }
+	auto GetTextureStreamingStats() const { return m_textureStreamer.GetStats(); }
+	// Material textures and model meshes loaded from here on are kept within budgetBytes of VRAM
+	// together with the streamed textures, see ResidencyManager. Textures lose their top mips,
+	// meshes from the mesh cache their buffers, and both are reloaded when drawn again.
+	void SetResidency(const bool enabled, const std::size_t budgetBytes);
+	// GL thread, once per frame before it is rendered. Marks what the snapshot draws as used and
+	// evicts down to the budget.
+	void UpdateResidency(const RenderSnapshot& snapshot);
+	auto IsResidencyEnabled() const noexcept { return m_residency.IsEnabled(); }
+	auto GetResidencyStats() const { return m_residency.GetStats(); }
+
+	// Texture memory of everything loaded so far, mips included
+	struct TextureMemory {
+		std::size_t ResidentBytes{ 0 };		// As uploaded
+		std::size_t UncompressedBytes{ 0 };	// Had every texture been uploaded as 8 bits per channel
+	};
+	const auto& GetTextureMemory() const noexcept { return m_textureMemory; }
+
 	auto GetNumLoadedTextures() const noexcept { return m_textureCache.size(); }
 	auto GetNumLoadedModels() const noexcept { return m_modelCache.size(); }
 	auto GetNumMaterials() const noexcept { return m_materialCache.size(); }
 
 private:
+	// A material texture ready for upload. Streamed textures only hold their mip tail.
+	struct PreparedTexture {
+		TextureUploader::Image Image;
+		TextureCompressor::Format Format{ TextureCompressor::Format::BC7 };
+		std::filesystem::path CachePath;
+		std::uint64_t Key{ 0 };
+		bool Streamed{ false };
+	};
+
+	// Where an evictable texture is reloaded from
+	struct TextureSource {
+		std::string Path;
+		TextureCompressor::Semantic Semantic{ TextureCompressor::Semantic::Mask };
+		bool Compressed{ false };	// From LoadCompressedTexture(), LoadTexture() with mips otherwise
+	};
+
+	// Decoded or compressed pixels of a material texture, only the mip tail if stream and streaming
+	// is on. Safe on any thread.
+	PreparedTexture prepareTexture(const std::string_view path, const TextureCompressor::Semantic semantic, const bool stream = true) const;
+	// Hands a prepared texture to the uploader, or to the streamer if only its tail is loaded
+	void submitTexture(PreparedTexture&& texture);
+	void addUploadStats(const TextureUploader::Stats& stats);
+	// Reports the time and memory of the textures loaded since m_textureLoadStart
+	void finishTextureLoads();
+
+	// Residency callbacks, see ResidencyManager
+	std::size_t evictResource(const ResidencyManager::Type type, const GLuint name);
+	void reloadResource(const ResidencyManager::Type type, const GLuint name);
+	// Releases the base level of a texture, the last level always stays. Returns the bytes freed.
+	static std::size_t dropTextureLevel(const GLuint texture);
+	// Tracks the meshes of a model, those from the mesh cache as evictable
+	void trackMeshes(Model& model);
+	void untrackMeshes(const Model& model);
+
 	std::unordered_map<std::string, ModelPtr> m_modelCache;
 	std::unordered_map<std::string, unsigned int> m_textureCache;
 	std::unordered_map<std::string, PBRMaterialPtr> m_materialCache;
+	std::filesystem::path m_meshCacheDir;
+	VertexCompressor::Format m_vertexFormat{ VertexCompressor::Format::Float };
+
+	bool m_compressTextures{ false }, m_preferBC7{ false };
+	MipGenerator::Filter m_mipFilter{ MipGenerator::Filter::Box };
+	std::filesystem::path m_textureCacheDir;
+	TextureMemory m_textureMemory;
+
+	bool m_asyncTextureLoads{ false };
+	double m_uploadBudgetMs{ 2.0 };
+	std::size_t m_numUploadBuffers{ 4 };
+	TextureUploader m_textureUploader;
+	TextureStreamer m_textureStreamer;
+	// Jobs preparing textures
+	JobCounter m_textureJobs;
+	bool m_loadingTextures{ false };
+	std::chrono::steady_clock::time_point m_textureLoadStart;
+	std::size_t m_texturesAtLoadStart{ 0 };
+
+	ResidencyManager m_residency;
+	std::unordered_map<GLuint, TextureSource> m_textureSources;
+	// Model and mesh index of every tracked mesh by VAO
+	std::unordered_map<GLuint, std::pair<Model*, std::size_t>> m_residentMeshes;
 };
@@ -1,6 +1,7 @@
 #include "Skybox.h"
 
 #include "ResourceManager.h"
+#include "Core/Profiler.h"
 #include "Graphics/GLShader.h"
 #include "Graphics/GLShaderProgram.h"
 
@@ -10,6 +11,7 @@
 
 /***********************************************************************************/
 void Skybox::Init(const std::string_view hdrPath, const std::size_t resolution) {
+	PROFILE_FUNCTION();
 
 	const std::array<Vertex, 4> screenQuadVertices {
 		// Positions				// GLTexture Coords
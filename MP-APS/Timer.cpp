@@ -1,6 +1,7 @@
 #include "Timer.h"
 
 #include <iostream>
+#include <algorithm>
 
 /***********************************************************************************/
 Timer::Timer() noexcept : m_delta(0.0), m_lastFrame(0.0), m_lastTime(0.0), m_nbFrames(0) {
@@ -15,7 +16,15 @@ void Timer::Update(const double time) noexcept {
 	if (currentFrame - m_lastTime >= 1.0) {
 		const auto frameTime = 1000.0 / static_cast<double>(m_nbFrames);
 
-		std::cout << frameTime << " ms - " << 1.0 / (frameTime / 1000.0) << " fps" << '\n';
+		std::cout << frameTime << " ms - " << 1.0 / (frameTime / 1000.0) << " fps";
+		for (auto& stat : m_stats) {
+			if (stat.Samples > 0) {
+				std::cout << " | " << stat.Name << ": " << stat.Total / static_cast<double>(stat.Samples) << stat.Unit;
+			}
+			stat.Total = 0.0;
+			stat.Samples = 0;
+		}
+		std::cout << '\n';
 
 		m_nbFrames = 0;
 		m_lastTime += 1.0;
@@ -24,3 +33,31 @@ void Timer::Update(const double time) noexcept {
 	m_delta = currentFrame - m_lastFrame;
 	m_lastFrame = currentFrame;
 }
+
+/***********************************************************************************/
+double Timer::GetTime() noexcept {
+	static const auto epoch{ std::chrono::steady_clock::now() };
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+/***********************************************************************************/
+void Timer::AddScopeTime(const std::string_view name, const double milliseconds) {
+	addSample(name, " ms", milliseconds);
+}
+
+/***********************************************************************************/
+void Timer::AddCounter(const std::string_view name, const double value) {
+	addSample(name, "", value);
+}
+
+/***********************************************************************************/
+void Timer::addSample(const std::string_view name, const char* unit, const double value) {
+	auto stat{ std::find_if(m_stats.begin(), m_stats.end(), [name](const auto& s) { return s.Name == name; }) };
+	if (stat == m_stats.end()) {
+		m_stats.push_back({ std::string(name), unit, 0.0, 0 });
+		stat = m_stats.end() - 1;
+	}
+
+	stat->Total += value;
+	++stat->Samples;
+}
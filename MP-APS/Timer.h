@@ -1,5 +1,9 @@
 #pragma once
 #include <cstdint>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
 
 class Timer {
 public:
@@ -11,7 +15,44 @@ public:
 	void Update(const double time) noexcept;
 	auto GetDelta() const noexcept { return m_delta; }
 
+	// Seconds on the steady clock since the first call. Doesn't need a window, unlike glfwGetTime().
+	static double GetTime() noexcept;
+
+	// Adds one frame's worth of time spent in a named scope. Averages are printed
+	// alongside the frame time.
+	void AddScopeTime(const std::string_view name, const double milliseconds);
+	// Same for a unitless per-frame count
+	void AddCounter(const std::string_view name, const double value);
+
 private:
+	struct Stat {
+		std::string Name;
+		const char* Unit;
+		double Total;
+		uint32_t Samples;
+	};
+
+	void addSample(const std::string_view name, const char* unit, const double value);
+
 	double m_delta, m_lastFrame, m_lastTime;
 	uint32_t m_nbFrames;
+
+	std::vector<Stat> m_stats;
+};
+
+/***********************************************************************************/
+// Adds the wall time spent in the enclosing scope to a millisecond counter.
+class ScopedTimer {
+public:
+	explicit ScopedTimer(double& elapsedMs) noexcept : m_elapsedMs(elapsedMs), m_start(std::chrono::steady_clock::now()) {}
+	~ScopedTimer() {
+		m_elapsedMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+	}
+
+	ScopedTimer(const ScopedTimer&) = delete;
+	ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+	double& m_elapsedMs;
+	const std::chrono::steady_clock::time_point m_start;
 };
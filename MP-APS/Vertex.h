@@ -2,10 +2,12 @@
 
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
 
 struct Vertex {
 	using vec2 = glm::vec2;
 	using vec3 = glm::vec3;
+	using vec4 = glm::vec4;
 
 	Vertex() = default;
 
@@ -21,11 +23,12 @@ struct Vertex {
 	Vertex(const vec3& position, const vec2& texcoords, const vec3& normal, const vec3& tangent) : Position(position),
 	                                                                                               TexCoords(texcoords),
 	                                                                                               Normal(normal),
-	                                                                                               Tangent(tangent) {
+	                                                                                               Tangent(tangent, 1.0f) {
 	}
 
 	vec3 Position;
 	vec2 TexCoords;
 	vec3 Normal;
-	vec3 Tangent;
+	// w is the sign of the bitangent, cross(normal, tangent) * w
+	vec4 Tangent{ 0.0f, 0.0f, 0.0f, 1.0f };
 };
@@ -8,14 +8,42 @@
 
 #include "Demos/DemoCrytekSponza.h"
 
+#include <string_view>
+
 /***********************************************************************************/
-int main() {
+// --benchmark		runs the headless benchmark configured in config.xml
+// --play <file>	flies along a recorded camera path
+// --regression		runs the benchmark, then compares views and metrics against Data/Regression.
+//					Exits with 1 on a regression or if golden images or the baseline are missing.
+// --update-golden	with --regression, rewrites the golden images and baseline from this run
+// --allow-missing-references	with --regression, exits with 2 instead of 1 if references are missing
+int main(int argc, char* argv[]) {
 #ifdef _DEBUG
 	// Detects memory leaks upon program exit
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
 
-	Engine engine("Data/config.xml");
+	EngineOptions options;
+	for (auto i = 1; i < argc; ++i) {
+		const std::string_view arg{ argv[i] };
+		if (arg == "--benchmark") {
+			options.Benchmark = true;
+		}
+		else if (arg == "--regression") {
+			options.Regression = true;
+		}
+		else if (arg == "--update-golden") {
+			options.UpdateGolden = true;
+		}
+		else if (arg == "--allow-missing-references") {
+			options.AllowMissingReferences = true;
+		}
+		else if (arg == "--play" && i + 1 < argc) {
+			options.PlayPath = argv[++i];
+		}
+	}
+
+	Engine engine("Data/config.xml", options);
 
 	const auto scene = std::make_shared<DemoCrytekSponza>();
 	scene->Init("Sponza");
@@ -23,7 +51,5 @@ int main() {
 	engine.AddScene(std::static_pointer_cast<SceneBase, DemoCrytekSponza>(scene));
 	engine.SetActiveScene("Sponza");
 
-	engine.Execute();
-
-	return 0;
+	return engine.Execute();
 }